@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * lu: Compare the blocked dense LU (ES_DenseLU) and the sparse LU
+ * (ES_SparseLU) against M_FactorizeLU() and M_BacksubstLU() on random
+ * MNA-like systems (a conductance network with grounded voltage sources,
+ * which requires pivoting) of the given sizes. The best of the runs is
+ * reported for factoring and solving.
+ *
+ * The sparse LU is run with 1, 2 and the number of threads given by -j.
+ * The program fails if any residual exceeds LU_MAX_RESIDUAL, or if the
+ * sparse factors or solution differ in any bit between thread counts.
+ */
+
+#include <core/core.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LU_MAX_RESIDUAL	1e-9	/* Largest acceptable |z - Ax| */
+
+static Uint nThreadsMax = 4;
+
+static double
+Now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((double)ts.tv_sec*1e6 + (double)ts.tv_nsec/1e3);
+}
+
+static void
+printusage(void)
+{
+	fprintf(stderr, "Usage: lu [-n runs] [-j threads] [size] [...]\n");
+	exit(1);
+}
+
+static M_Real
+Random(void)
+{
+	return ((M_Real)rand()/RAND_MAX);
+}
+
+/*
+ * Stamp n-m nodes connected by random conductances (and a small leak to
+ * ground), and m voltage sources from nodes 0..m-1 to ground.
+ */
+static void
+GenerateMNA(M_Matrix *A, Uint n, Uint m)
+{
+	Uint nNodes = n-m, i, k, j;
+	M_Real g;
+
+	M_SetZero(A);
+	for (i = 0; i < nNodes; i++) {
+		*M_GetElement(A, i, i) += 1e-3*(1.0 + Random());
+		for (k = 0; k < 3; k++) {
+			j = rand() % nNodes;
+			if (j == i) {
+				continue;
+			}
+			g = Random();
+			*M_GetElement(A, i, i) += g;
+			*M_GetElement(A, j, j) += g;
+			*M_GetElement(A, i, j) -= g;
+			*M_GetElement(A, j, i) -= g;
+		}
+	}
+	for (k = 0; k < m; k++) {
+		*M_GetElement(A, k, nNodes+k) = 1.0;
+		*M_GetElement(A, nNodes+k, k) = 1.0;
+	}
+}
+
+static void
+CopyMatrix(M_Matrix *D, M_Matrix *S, Uint n)
+{
+	Uint i, j;
+
+	for (i = 0; i < n; i++)
+		for (j = 0; j < n; j++)
+			*M_GetElement(D, i, j) = *M_GetElement(S, i, j);
+}
+
+/* Return the entries of A which are nonzero, in row-major order. */
+static ES_MatrixEntry *
+Pattern(M_Matrix *A, Uint n, Uint *nEnts)
+{
+	ES_MatrixEntry *ents;
+	Uint i, j, k = 0;
+
+	ents = Malloc((n*n > 0 ? n*n : 1)*sizeof(ES_MatrixEntry));
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < n; j++) {
+			if (*M_GetElement(A, i, j) != 0.0) {
+				ents[k].row = i;
+				ents[k].col = j;
+				k++;
+			}
+		}
+	}
+	*nEnts = k;
+	return (ents);
+}
+
+/* Return the largest entry of |z - Ax|. */
+static M_Real
+Residual(M_Matrix *A, M_Vector *z, M_Vector *x, Uint n)
+{
+	M_Real r, rMax = 0.0;
+	Uint i, j;
+
+	for (i = 0; i < n; i++) {
+		r = M_VecGet(z, i);
+		for (j = 0; j < n; j++) {
+			r -= (*M_GetElement(A, i, j))*M_VecGet(x, j);
+		}
+		if (Fabs(r) > rMax)
+			rMax = Fabs(r);
+	}
+	return (rMax);
+}
+
+/* Copy an array (for comparison across thread counts). */
+static M_Real *
+Dup(const M_Real *v, Uint n)
+{
+	M_Real *w;
+
+	w = Malloc((n+1)*sizeof(M_Real));
+	memcpy(w, v, n*sizeof(M_Real));
+	return (w);
+}
+
+/*
+ * Factor and solve with the sparse LU using 1, 2 and nThreadsMax threads,
+ * reporting the best times with the most threads. Fail if the residual is
+ * too large, or if the factors or the solution differ from those computed
+ * with one thread.
+ */
+static int
+RunSparse(M_Matrix *A, M_Vector *z, M_Vector *x, Uint n, int nRuns,
+    double *tFact, double *tSolve, M_Real *res)
+{
+	ES_SparseLU lu;
+	ES_MatrixEntry *ents;
+	M_Real *xRef = NULL, *lxRef = NULL, *uxRef = NULL, *dRef = NULL, v;
+	Uint nThreads[3], nEnts, nnz = 0, t, i;
+	double t0, t1, t2;
+	int r, rv = -1;
+
+	nThreads[0] = 1;
+	nThreads[1] = 2;
+	nThreads[2] = nThreadsMax;
+	ents = Pattern(A, n, &nEnts);
+
+	for (t = 0; t < 3; t++) {
+		ES_SparseLUInit(&lu);
+		ES_SparseLUSetThreads(&lu, nThreads[t]);
+		if (ES_SparseLUAnalyze(&lu, A, n, ents, nEnts) == -1) {
+			goto fail;
+		}
+		*tFact = *tSolve = HUGE_VAL;
+		for (r = 0; r < nRuns; r++) {
+			t0 = Now();
+			if (ES_SparseLUFactor(&lu) == -1) {
+				goto fail;
+			}
+			t1 = Now();
+			M_VecCopy(x, z);
+			ES_SparseLUSolve(&lu, x);
+			t2 = Now();
+			*tFact = MIN(*tFact, t1-t0);
+			*tSolve = MIN(*tSolve, t2-t1);
+		}
+		if ((*res = Residual(A, z, x, n)) > LU_MAX_RESIDUAL) {
+			AG_SetError("Sparse LU (%u threads): Residual %.2e",
+			    nThreads[t], (double)*res);
+			goto fail;
+		}
+		if (t == 0) {
+			nnz = lu.nnz;
+			lxRef = Dup(lu.lx, nnz);
+			uxRef = Dup(lu.ux, nnz);
+			dRef = Dup(lu.d, n);
+			xRef = Malloc(n*sizeof(M_Real));
+			for (i = 0; i < n; i++)
+				xRef[i] = M_VecGet(x, i);
+		} else {
+			if (lu.nnz != nnz ||
+			    memcmp(lu.lx, lxRef, nnz*sizeof(M_Real)) != 0 ||
+			    memcmp(lu.ux, uxRef, nnz*sizeof(M_Real)) != 0 ||
+			    memcmp(lu.d, dRef, n*sizeof(M_Real)) != 0) {
+				AG_SetError("Sparse LU (%u threads): "
+				    "Factors differ from 1 thread",
+				    nThreads[t]);
+				goto fail;
+			}
+			for (i = 0; i < n; i++) {
+				v = M_VecGet(x, i);
+				if (memcmp(&v, &xRef[i], sizeof(M_Real)) != 0) {
+					AG_SetError("Sparse LU (%u threads): "
+					    "x[%u] differs from 1 thread",
+					    nThreads[t], i);
+					goto fail;
+				}
+			}
+		}
+		ES_SparseLUDestroy(&lu);
+	}
+	rv = 0;
+	goto out;
+fail:
+	ES_SparseLUDestroy(&lu);
+out:
+	Free(ents);
+	Free(xRef);
+	Free(lxRef);
+	Free(uxRef);
+	Free(dRef);
+	return (rv);
+}
+
+static int
+RunSize(Uint n, int nRuns)
+{
+	M_Matrix *A, *F;
+	M_Vector *z, *x;
+	ES_DenseLU lu;
+	double t0, t1, t2, tFact[3], tSolve[3];
+	M_Real res[3];
+	Uint i;
+	int r;
+
+	A = M_New(n, n);
+	F = M_New(n, n);
+	z = M_VecNew(n);
+	x = M_VecNew(n);
+	GenerateMNA(A, n, n/10);
+	for (i = 0; i < n; i++) {
+		*M_VecGetElement(z, i) = Random() - 0.5;
+	}
+	ES_DenseLUInit(&lu);
+	ES_DenseLUResize(&lu, n);
+
+	tFact[0] = tFact[1] = tSolve[0] = tSolve[1] = HUGE_VAL;
+	for (r = 0; r < nRuns; r++) {
+		CopyMatrix(F, A, n);
+		t0 = Now();
+		if (M_FactorizeLU(F) == -1) {
+			goto fail;
+		}
+		t1 = Now();
+		M_VecCopy(x, z);
+		M_BacksubstLU(F, x);
+		t2 = Now();
+		tFact[0] = MIN(tFact[0], t1-t0);
+		tSolve[0] = MIN(tSolve[0], t2-t1);
+	}
+	res[0] = Residual(A, z, x, n);
+
+	for (r = 0; r < nRuns; r++) {
+		t0 = Now();
+		ES_DenseLULoad(&lu, A);
+		if (ES_DenseLUFactor(&lu) == -1) {
+			goto fail;
+		}
+		t1 = Now();
+		M_VecCopy(x, z);
+		ES_DenseLUSolve(&lu, x);
+		t2 = Now();
+		tFact[1] = MIN(tFact[1], t1-t0);
+		tSolve[1] = MIN(tSolve[1], t2-t1);
+	}
+	res[1] = Residual(A, z, x, n);
+	for (i = 0; i < 2; i++) {
+		if (res[i] > LU_MAX_RESIDUAL) {
+			AG_SetError("%s: Residual %.2e",
+			    (i == 0) ? "M_FactorizeLU" : "Dense LU",
+			    (double)res[i]);
+			goto fail;
+		}
+	}
+
+	if (RunSparse(A, z, x, n, nRuns, &tFact[2], &tSolve[2],
+	    &res[2]) == -1)
+		goto fail;
+
+	printf("%u\t%.2f\t%.2f\t%.2e\t%.2f\t%.2f\t%.2e\t%.2fx\t"
+	       "%.2f\t%.2f\t%.2e\t%.2fx\n", n,
+	    tFact[0], tSolve[0], (double)res[0],
+	    tFact[1], tSolve[1], (double)res[1],
+	    (tFact[0]+tSolve[0]) / (tFact[1]+tSolve[1]),
+	    tFact[2], tSolve[2], (double)res[2],
+	    (tFact[0]+tSolve[0]) / (tFact[2]+tSolve[2]));
+
+	ES_DenseLUDestroy(&lu);
+	M_Free(A);
+	M_Free(F);
+	M_VecFree(z);
+	M_VecFree(x);
+	return (0);
+fail:
+	fprintf(stderr, "%u: %s\n", n, AG_GetError());
+	ES_DenseLUDestroy(&lu);
+	M_Free(A);
+	M_Free(F);
+	M_VecFree(z);
+	M_VecFree(x);
+	return (-1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int c, i, nRuns = 50;
+
+	while ((c = getopt(argc, argv, "?hn:j:")) != -1) {
+		extern char *optarg;
+
+		switch (c) {
+		case 'n':
+			nRuns = atoi(optarg);
+			break;
+		case 'j':
+			nThreadsMax = (Uint)atoi(optarg);
+			break;
+		case '?':
+		case 'h':
+			printusage();
+		}
+	}
+	if (optind == argc || nRuns < 1 || nThreadsMax < 1) {
+		printusage();
+	}
+	if (AG_InitCore("lu", 0) == -1) {
+		return (1);
+	}
+	M_InitSubsystem();
+	srand(1);
+
+	printf("#Size\tM_Factorize (us)\tM_Backsubst (us)\tResidual\t"
+	       "ES_DenseLUFactor (us)\tES_DenseLUSolve (us)\tResidual\t"
+	       "Speedup\tES_SparseLUFactor (us, %u threads)\t"
+	       "ES_SparseLUSolve (us)\tResidual\tSpeedup\n", nThreadsMax);
+	for (i = optind; i < argc; i++) {
+		if (RunSize((Uint)atoi(argv[i]), nRuns) == -1)
+			return (1);
+	}
+	return (0);
+}
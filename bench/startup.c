@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * startup: Measure the cold start time of a command-line tool, from
+ * process creation to the first simulated timestep. Every run is done
+ * in a freshly exec'd process, which reports the time spent in each
+ * phase of its initialization.
+ */
+
+#include <core/core.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double
+Now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((double)ts.tv_sec*1e3 + (double)ts.tv_nsec/1e6);
+}
+
+static void
+printusage(void)
+{
+	fprintf(stderr, "Usage: startup [-n runs] [file]\n");
+	exit(1);
+}
+
+/* Child: initialize, load the circuit and simulate one step. */
+static int
+RunOnce(const char *file)
+{
+	double t0, tCore, tInit, tLoad, tStep;
+	ES_Run *run;
+
+	t0 = Now();
+	if (AG_InitCore("startup", 0) == -1) {
+		return (1);
+	}
+	agDebugLvl = 0;
+	tCore = Now();
+	ES_CoreInit(0);
+	tInit = Now();
+	if ((run = ES_RunOpen(file)) == NULL) {
+		fprintf(stderr, "%s: %s\n", file, AG_GetError());
+		return (1);
+	}
+	tLoad = Now();
+	ES_RunSetStop(run, 0.0, 1);
+	if (ES_RunExec(run) == -1) {
+		fprintf(stderr, "%s: %s\n", file, AG_GetError());
+		return (1);
+	}
+	tStep = Now();
+	printf("AG_InitCore %.3f\tES_CoreInit %.3f\tload %.3f\tstep %.3f\t",
+	    tCore-t0, tInit-tCore, tLoad-tInit, tStep-tLoad);
+	fflush(stdout);
+	ES_RunClose(run);
+	return (0);
+}
+
+static int
+CompareTimes(const void *p1, const void *p2)
+{
+	double a = *(const double *)p1, b = *(const double *)p2;
+
+	return (a < b) ? -1 : (a > b) ? 1 : 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	double *times;
+	int c, i, nRuns = 10, child = 0, status;
+	pid_t pid;
+
+	while ((c = getopt(argc, argv, "?hcn:")) != -1) {
+		extern char *optarg;
+
+		switch (c) {
+		case 'c':
+			child = 1;
+			break;
+		case 'n':
+			nRuns = atoi(optarg);
+			break;
+		case '?':
+		case 'h':
+			printusage();
+		}
+	}
+	if (optind == argc || nRuns < 1) {
+		printusage();
+	}
+	if (child) {
+		return RunOnce(argv[optind]);
+	}
+
+	if ((times = malloc(nRuns*sizeof(double))) == NULL) {
+		return (1);
+	}
+	printf("#Run\tPhases (ms)\n");
+	for (i = 0; i < nRuns; i++) {
+		double t0 = Now();
+
+		printf("%d\t", i);
+		fflush(stdout);
+		if ((pid = fork()) == -1) {
+			perror("fork");
+			return (1);
+		} else if (pid == 0) {
+			execl(argv[0], argv[0], "-c", argv[optind],
+			    (char *)NULL);
+			perror(argv[0]);
+			_exit(1);
+		}
+		if (waitpid(pid, &status, 0) == -1 ||
+		    !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			fprintf(stderr, "Run %d failed\n", i);
+			return (1);
+		}
+		times[i] = Now() - t0;
+		printf("total %.3f\n", times[i]);
+	}
+	qsort(times, nRuns, sizeof(double), CompareTimes);
+	printf("#Cold start to first step: min %.3f ms, median %.3f ms, "
+	       "max %.3f ms\n", times[0], times[nRuns/2], times[nRuns-1]);
+	free(times);
+	return (0);
+}
@@ -82,34 +82,23 @@ EditClose(AG_Event *event)
 		AG_PostEvent(com, "circuit-hidden", NULL);
 }
 
-/* Update the voltage entries in the Circuit's property table. */
-static M_Real
-NodeVoltageFn(AG_Event *event)
-{
-	ES_Circuit *ckt = ES_CIRCUIT_PTR(1);
-	const int v = AG_INT(2);
-
-	return ES_NodeVoltage(ckt, v);
-}
-
-/* Update the branch current entries in the Circuit's property table. */
-static M_Real
-BranchCurrentFn(AG_Event *event)
-{
-	ES_Circuit *ckt = ES_CIRCUIT_PTR(1);
-	const int i = AG_INT(2);
-
-	return ES_BranchCurrent(ckt, i);
-}
-
 /* Commit a change in the circuit topology. */
 void
 ES_CircuitModified(ES_Circuit *ckt)
 {
-	char key[32];
 	ES_Component *com;
 /*	ES_Vsource *vs; */
-	Uint i;
+/*	Uint i; */
+
+	/* Remove the nodes left unused by the edit. */
+	ES_CompactNodes(ckt);
+
+	/*
+	 * Headless circuits have no views (and may be modified from worker
+	 * threads), so there is no spatial index to invalidate.
+	 */
+	if (!(ckt->flags & ES_CIRCUIT_HEADLESS) && ckt->vg != NULL)
+		ES_SpatialInvalidate(ckt->vg);
 
 #if 0
 	/* Regenerate loop and pair information. */
@@ -144,22 +133,11 @@ ES_CircuitModified(ES_Circuit *ckt)
 	    ckt->sim->ops->cktmod != NULL)
 		ckt->sim->ops->cktmod(ckt->sim, ckt);
 
-	/* Update the voltage/current entries in the property table. */
-#if 0
-	/* XXX TODO clear the v* and I* variables only */
-	AG_ObjectFreeVariables(OBJECT(ckt));
-#endif
-	for (i = 1; i < ckt->n; i++) {
-		Snprintf(key, sizeof(key), "v%u-fn", i);
-		AG_SetPointer(ckt, key, NodeVoltageFn);
-/*		M_BindRealFn(ckt, key, NodeVoltageFn, "%p,%i", ckt, i); */
-	}
-	for (i = 0; i < ckt->m; i++) {
-		Snprintf(key, sizeof(key), "I%u-fn", i);
-		AG_SetPointer(ckt, key, BranchCurrentFn);
-/*		M_BindRealFn(ckt, key, BranchCurrentFn, "%p,%i", ckt, i); */
-	}
-	
+	/*
+	 * Node voltages and branch currents are not exported as object
+	 * variables; they are resolved on lookup by ES_ParseProbe().
+	 */
+
 	/* Notify the component models of the change. */
 	CIRCUIT_FOREACH_COMPONENT(com, ckt)
 		AG_PostEvent(com, "circuit-modified", NULL);
@@ -181,37 +159,70 @@ static void
 Init(void *p)
 {
 	ES_Circuit *ckt = p;
+	Uint nodesInit, symHashInit;
 
 	/* OBJECT(ckt)->flags |= AG_OBJECT_DEBUG_DATA; */
 
 	ckt->flags = ES_CIRCUIT_SHOW_NODES|ES_CIRCUIT_SHOW_NODESYMS;
-	ckt->descr[0] = '\0';
-	ckt->authors[0] = '\0';
-	ckt->keywords[0] = '\0';
+	if (AG_OfClass(ckt, "ES_Circuit:ES_Component:*")) {
+		/*
+		 * The circuit part of a component is only used for its
+		 * (optional) equivalent circuit; keep it minimal.
+		 */
+		ckt->flags |= ES_CIRCUIT_COMPONENT;
+		ckt->info = NULL;
+		nodesInit = 1;
+		symHashInit = 1;
+	} else {
+		ckt->info = Malloc(sizeof(ES_CircuitInfo));
+		memset(ckt->info, 0, sizeof(ES_CircuitInfo));
+		nodesInit = ESCIRCUIT_NODES_INIT;
+		symHashInit = ESCIRCUIT_SYM_HASH_INIT;
+	}
 	ckt->sim = NULL;
 	ckt->loops = NULL;
 	ckt->l = 0;
 	ckt->vSrcs = NULL;
+	ckt->vSrcsMax = 0;
 	ckt->m = 0;
-	ckt->nodes = Malloc(sizeof(ES_Node *));
+	ckt->nodes = Malloc(nodesInit*sizeof(ES_Node));
+	ckt->nodesMax = nodesInit;
 	ckt->console = NULL;
 	ckt->extObjs = NULL;
 	ckt->nExtObjs = 0;
+	ckt->extObjsMax = 0;
 	TAILQ_INIT(&ckt->layouts);
 	TAILQ_INIT(&ckt->syms);
+	ckt->symHash = Malloc(symHashInit*sizeof(ES_Sym *));
+	memset(ckt->symHash, 0, symHashInit*sizeof(ES_Sym *));
+	ckt->symHashSize = symHashInit;
+	ckt->nSyms = 0;
 	TAILQ_INIT(&ckt->components);
 	
 	ckt->n = 1;
+	ckt->nUnused = 0;
 	InitGround(ckt);
 
-	ckt->vg = VG_New(0);
-	Strlcpy(ckt->vg->layers[0].name, _("Schematic"),
-	    sizeof(ckt->vg->layers[0].name));
+	ckt->vg = NULL;
+	if (!(ckt->flags & ES_CIRCUIT_COMPONENT))
+		ES_CircuitGetVG(ckt);
 	
 	AG_SetEvent(ckt, "edit-open", EditOpen, NULL);
 	AG_SetEvent(ckt, "edit-close", EditClose, NULL);
 }
 
+/* Return the schematics of a circuit, creating them if needed. */
+VG *
+ES_CircuitGetVG(ES_Circuit *ckt)
+{
+	if (ckt->vg == NULL) {
+		ckt->vg = VG_New(0);
+		Strlcpy(ckt->vg->layers[0].name, _("Schematic"),
+		    sizeof(ckt->vg->layers[0].name));
+	}
+	return (ckt->vg);
+}
+
 static void
 FreeNode(ES_Node *node)
 {
@@ -221,10 +232,93 @@ FreeNode(ES_Node *node)
 	     br != TAILQ_END(&node->branches);
 	     br = nbr) {
 		nbr = TAILQ_NEXT(br, branches);
+		if (br->port != NULL && br->port->branch == br) {
+			br->port->branch = NULL;
+		}
 		Free(br);
 	}
 	TAILQ_INIT(&node->branches);
-	Free(node);
+}
+
+/*
+ * Relink the branch list of a node record which has been moved in memory
+ * (the first branch and the list head point to each other).
+ */
+static void
+RelinkNode(ES_Node *node)
+{
+	ES_Branch *br, *nbr;
+
+	br = TAILQ_FIRST(&node->branches);
+	TAILQ_INIT(&node->branches);
+	for (; br != NULL; br = nbr) {
+		nbr = TAILQ_NEXT(br, branches);
+		TAILQ_INSERT_TAIL(&node->branches, br, branches);
+	}
+}
+
+/*
+ * Ensure that the node array can hold at least count nodes. Growing the
+ * array moves the node records; pointers returned by ES_GetNode() are
+ * invalidated.
+ */
+void
+ES_ReserveNodes(ES_Circuit *ckt, Uint count)
+{
+	ES_Node *nodesOld = ckt->nodes;
+	Uint i, nodesMax;
+
+	if (count <= ckt->nodesMax) {
+		return;
+	}
+	if (count > ESCIRCUIT_MAX_NODES)
+		AG_FatalError("Too many nodes");
+
+	for (nodesMax = ckt->nodesMax; nodesMax < count; nodesMax *= 2)
+		;;
+	ckt->nodes = Realloc(ckt->nodes, nodesMax*sizeof(ES_Node));
+	ckt->nodesMax = nodesMax;
+	if (ckt->nodes != nodesOld) {
+		for (i = 0; i < ckt->n; i++)
+			RelinkNode(&ckt->nodes[i]);
+	}
+}
+
+static __inline__ Uint
+HashSymbol(const char *name)
+{
+	Uint h = 2166136261U;
+
+	for (; *name != '\0'; name++) {
+		h = (h ^ (Uint8)*name) * 16777619U;
+	}
+	return (h);
+}
+
+/*
+ * Insert a symbol at the end of its hash chain, so that lookups return the
+ * first symbol defined under a given name.
+ */
+static void
+InsertSymbolHash(ES_Circuit *ckt, ES_Sym *sym)
+{
+	ES_Sym **pSym;
+
+	pSym = &ckt->symHash[HashSymbol(sym->name) & (ckt->symHashSize-1)];
+	while (*pSym != NULL) {
+		pSym = &(*pSym)->hashNext;
+	}
+	sym->hashNext = NULL;
+	*pSym = sym;
+}
+
+/* Make sym the reverse mapping of its node, unless it already has one. */
+static void
+LinkNodeSymbol(ES_Circuit *ckt, ES_Sym *sym)
+{
+	if (sym->p.node >= 0 && sym->p.node < (int)ckt->n &&
+	    ckt->nodes[sym->p.node].sym == NULL)
+		ckt->nodes[sym->p.node].sym = sym;
 }
 
 static void
@@ -244,6 +338,7 @@ FreeDataset(void *p)
 
 	Free(ckt->vSrcs);
 	ckt->vSrcs = NULL;
+	ckt->vSrcsMax = 0;
 	ckt->m = 0;
 
 	for (sym = TAILQ_FIRST(&ckt->syms);
@@ -253,12 +348,14 @@ FreeDataset(void *p)
 		Free(sym);
 	}
 	TAILQ_INIT(&ckt->syms);
+	memset(ckt->symHash, 0, ckt->symHashSize*sizeof(ES_Sym *));
+	ckt->nSyms = 0;
 
 	for (i = 0; i < ckt->n; i++) {
-		FreeNode(ckt->nodes[i]);
+		FreeNode(&ckt->nodes[i]);
 	}
-	ckt->nodes = Realloc(ckt->nodes, sizeof(ES_Node *));
 	ckt->n = 1;
+	ckt->nUnused = 0;
 	InitGround(ckt);
 
 	CIRCUIT_FOREACH_COMPONENT(com, ckt) {
@@ -268,26 +365,94 @@ FreeDataset(void *p)
 			port->flags = 0;
 		}
 	}
-	VG_Clear(ckt->vg);
+	if (ckt->vg != NULL)
+		VG_Clear(ckt->vg);
+}
+
+/* Components by name (used while loading). */
+typedef struct es_com_index {
+	ES_Component **coms;		/* Open-addressed table */
+	Uint size;			/* Table size (power of two) */
+} ES_ComIndex;
+
+/*
+ * Index the components of a circuit by name (open addressing with linear
+ * probing), so that the references in a circuit file resolve in constant
+ * time.
+ */
+static int
+InitComIndex(ES_ComIndex *idx, ES_Circuit *ckt)
+{
+	ES_Component *com;
+	Uint count = 0, i;
+
+	CIRCUIT_FOREACH_COMPONENT(com, ckt) {
+		count++;
+	}
+	for (idx->size = 16; idx->size < count*2; idx->size <<= 1)
+		;
+	if ((idx->coms = TryMalloc(idx->size*sizeof(ES_Component *))) == NULL) {
+		return (-1);
+	}
+	memset(idx->coms, 0, idx->size*sizeof(ES_Component *));
+
+	CIRCUIT_FOREACH_COMPONENT(com, ckt) {
+		i = HashSymbol(OBJECT(com)->name) & (idx->size-1);
+		while (idx->coms[i] != NULL) {
+			i = (i+1) & (idx->size-1);
+		}
+		idx->coms[i] = com;
+	}
+	return (0);
+}
+
+static ES_Component *
+LookupComIndex(const ES_ComIndex *idx, const char *name)
+{
+	ES_Component *com;
+	Uint i;
+
+	i = HashSymbol(name) & (idx->size-1);
+	while ((com = idx->coms[i]) != NULL) {
+		if (strcmp(OBJECT(com)->name, name) == 0) {
+			return (com);
+		}
+		i = (i+1) & (idx->size-1);
+	}
+	AG_SetError("No such component: \"%s\"", name);
+	return (NULL);
 }
 
 static int
 Load(void *p, AG_DataSource *ds, const AG_Version *ver)
 {
 	ES_Circuit *ckt = p;
-	VG *vg = ckt->vg;
+	ES_CircuitInfo info;
+	VG *vg;
 	ES_Component *com;
+	ES_ComIndex idx;
 	Uint i, j, count;
 	ES_SchemBlock *sb;
 	ES_SchemWire *sw;
 	ES_SchemPort *sp;
 	VG_Text *vt;
+	Uint32 vgSize, fileFlags;
 
 	/* Circuit information */
-	AG_CopyString(ckt->descr, ds, sizeof(ckt->descr));
-	AG_CopyString(ckt->authors, ds, sizeof(ckt->authors));
-	AG_CopyString(ckt->keywords, ds, sizeof(ckt->keywords));
-	ckt->flags = AG_ReadUint32(ds);
+	AG_CopyString(info.descr, ds, sizeof(info.descr));
+	AG_CopyString(info.authors, ds, sizeof(info.authors));
+	AG_CopyString(info.keywords, ds, sizeof(info.keywords));
+	if (ckt->info == NULL &&
+	    (info.descr[0] != '\0' || info.authors[0] != '\0' ||
+	     info.keywords[0] != '\0')) {
+		ckt->info = Malloc(sizeof(ES_CircuitInfo));
+	}
+	if (ckt->info != NULL) {
+		memcpy(ckt->info, &info, sizeof(ES_CircuitInfo));
+	}
+	fileFlags = AG_ReadUint32(ds);
+	ckt->flags &= ~(ES_CIRCUIT_SAVED_FLAGS);
+	ckt->flags |= fileFlags & ES_CIRCUIT_SAVED_FLAGS;
 
 	/* Component models */
 	count = (Uint)AG_ReadUint32(ds);
@@ -306,9 +471,9 @@ Load(void *p, AG_DataSource *ds, const AG_Version *ver)
 
 		/*
 		 * Lookup the component class. If a "@libs" specification
-		 * was given, attempt to load the specified libraries.
+		 * was given, attempt to load the specified modules.
 		 */
-		if ((comClass = AG_LoadClass(classSpec)) == NULL) {
+		if ((comClass = ES_LoadClass(classSpec)) == NULL) {
 			/* XXX TODO skip here? */
 			return (-1);
 		}
@@ -327,9 +492,16 @@ Load(void *p, AG_DataSource *ds, const AG_Version *ver)
 		TAILQ_INSERT_TAIL(&ckt->components, com, components);
 		com->flags |= ES_COMPONENT_CONNECTED;
 	}
+	if (InitComIndex(&idx, ckt) == -1)
+		return (-1);
 
 	/* Circuit nodes and branches */
 	count = (Uint)AG_ReadUint32(ds);
+	if (count > ESCIRCUIT_MAX_NODES) {
+		AG_SetError("Bogus node count: %u", count);
+		goto fail;
+	}
+	ES_ReserveNodes(ckt, count);
 	for (i = 0; i < count; i++) {
 		Uint nBranches, flags;
 		int name;
@@ -338,7 +510,8 @@ Load(void *p, AG_DataSource *ds, const AG_Version *ver)
 		nBranches = (Uint)AG_ReadUint32(ds);
 		if (i != 0) {
 			name = ES_AddNode(ckt);
-			ckt->nodes[name]->flags = flags & ~(CKTNODE_EXAM);
+			ckt->nodes[name].flags = flags &
+			    ~(CKTNODE_EXAM|CKTNODE_UNUSED);
 		} else {
 			name = 0;
 		}
@@ -353,13 +526,13 @@ Load(void *p, AG_DataSource *ds, const AG_Version *ver)
 			AG_ReadUint32(ds);			/* Pad */
 			pPort = (Uint)AG_ReadUint32(ds);
 			
-			if ((com = AG_ObjectFindChild(ckt, comName)) == NULL) {
-				return (-1);
+			if ((com = LookupComIndex(&idx, comName)) == NULL) {
+				goto fail;
 			}
-			if (pPort > com->nports) {
+			if (pPort < 1 || pPort > com->nports) {
 				AG_SetError("Bogus branch: %s:%u", comName,
 				    pPort);
-				return (-1);
+				goto fail;
 			}
 			br = ES_AddBranch(ckt, name, &com->ports[pPort]);
 			com->ports[pPort].node = name;
@@ -369,27 +542,49 @@ Load(void *p, AG_DataSource *ds, const AG_Version *ver)
 
 	/*
 	 * Load the circuit schematics and re-attach the schematic entities
-	 * with the actual circuit structures.
+	 * with the actual circuit structures. Headless circuits skip over
+	 * the schematics entirely (if the file records their size).
+	 *
+	 * The version passed to us is that of the class being loaded (e.g.,
+	 * a component), so the presence of the size is given by a flag.
+	 * Plain circuits of version 1.1 always have it.
 	 */
+	if ((fileFlags & ES_CIRCUIT_VG_FRAMED) ||
+	    (OBJECT_CLASS(ckt) == &esCircuitClass && ver->major == 1 &&
+	     ver->minor == 1)) {
+		vgSize = AG_ReadUint32(ds);
+		if (vgSize < sizeof(Uint32)) {
+			AG_SetError("Bogus schematics size: %u", (Uint)vgSize);
+			goto fail;
+		}
+		if (ckt->flags & ES_CIRCUIT_HEADLESS) {
+			if (AG_Seek(ds, (off_t)(vgSize - sizeof(Uint32)),
+			    AG_SEEK_CUR) == -1) {
+				goto fail;
+			}
+			goto load_syms;
+		}
+	}
+	vg = ES_CircuitGetVG(ckt);
 	if (AG_ObjectUnserialize(vg, ds) == -1) {
-		return (-1);
+		goto fail;
 	}
 	VG_FOREACH_NODE_CLASS(vt, vg, vg_text, "Text")
 		VG_TextSubstObject(vt, ckt);
 
 	VG_FOREACH_NODE_CLASS(sb, vg, es_schem_block, "SchemBlock") {
-		if ((com = AG_ObjectFindChild(ckt, sb->name)) == NULL) {
+		if ((com = LookupComIndex(&idx, sb->name)) == NULL) {
 			AG_SetError("SchemBlock: No such component: \"%s\"",
 			    sb->name);
-			return (-1);
+			goto fail;
 		}
 		sb->com = com;
 	}
 	VG_FOREACH_NODE_CLASS(sw, vg, es_schem_wire, "SchemWire") {
-		if ((com = AG_ObjectFindChild(ckt, sw->name)) == NULL) {
+		if ((com = LookupComIndex(&idx, sw->name)) == NULL) {
 			AG_SetError("SchemWire: No such wire: \"%s\"",
 			    sw->name);
-			return (-1);
+			goto fail;
 		}
 		sw->wire = com;
 	}
@@ -397,33 +592,41 @@ Load(void *p, AG_DataSource *ds, const AG_Version *ver)
 		if (sp->comName[0] == '\0' || sp->portName == -1) {
 			continue;
 		}
-		if ((com = AG_ObjectFindChild(ckt, sp->comName)) == NULL) {
+		if ((com = LookupComIndex(&idx, sp->comName)) == NULL) {
 			AG_SetError("SchemPort refers to unexisting "
 			            "component: \"%s\"", sp->name);
-			return (-1);
+			goto fail;
 		}
 		if (sp->portName < 1 || sp->portName > com->nports) {
 			AG_SetError("SchemPort refers to invalid "
 			            "port of %s: %d", sp->comName,
 				    sp->portName);
-			return (-1);
+			goto fail;
 		}
 		sp->port = &com->ports[sp->portName];
 	}
+	if ((ckt->flags & ES_CIRCUIT_COMPONENT) &&
+	    TAILQ_EMPTY(&vg->root->cNodes)) {
+		AG_ObjectDestroy(vg);			/* No equivalent circuit */
+		ckt->vg = NULL;
+	}
 	
+load_syms:
 	/* Symbol table */
 	count = (Uint)AG_ReadUint32(ds);
 	for (i = 0; i < count; i++) {
+		char symName[ESCIRCUIT_SYM_MAX];
 		ES_Sym *sym;
 		
-		sym = ES_AddSymbol(ckt, NULL);
-		AG_CopyString(sym->name, ds, sizeof(sym->name));
+		AG_CopyString(symName, ds, sizeof(symName));
+		sym = ES_AddSymbol(ckt, symName);
 		AG_CopyString(sym->descr, ds, sizeof(sym->descr));
 		sym->type = (enum es_sym_type)AG_ReadUint32(ds);
 		AG_ReadUint32(ds);				/* Pad */
 		switch (sym->type) {
 		case ES_SYM_NODE:
 			sym->p.node = (int)AG_ReadSint32(ds);
+			LinkNodeSymbol(ckt, sym);
 			break;
 		case ES_SYM_VSOURCE:
 			sym->p.vsource = (int)AG_ReadSint32(ds);
@@ -443,31 +646,31 @@ Load(void *p, AG_DataSource *ds, const AG_Version *ver)
 		ES_Port *port;
 
 		AG_CopyString(comName, ds, sizeof(comName));
-		CIRCUIT_FOREACH_COMPONENT(com, ckt) {
-			if (strcmp(OBJECT(com)->name, comName) == 0)
-				break;
-		}
-		if (com == NULL) {
+		if ((com = LookupComIndex(&idx, comName)) == NULL) {
 			AG_SetError("Bogus port component: %s", comName);
-			return (-1);
+			goto fail;
 		}
 		
 		/* Load the port information. */
-		com->nports = (Uint)AG_ReadUint32(ds);
+		if ((Uint)AG_ReadUint32(ds) != com->nports) {
+			AG_SetError("%s: Bogus port count", comName);
+			goto fail;
+		}
 		COMPONENT_FOREACH_PORT(port, j, com) {
+			char portName[COMPONENT_PORT_NAME_MAX];
 			ES_Branch *br;
 			ES_Node *node;
 			int portNode;
 
 			port->n = (int)AG_ReadUint32(ds);
-			AG_CopyString(port->name, ds, sizeof(port->name));
+			AG_CopyString(portName, ds, sizeof(portName));	/* Unused */
 			portNode = (int)AG_ReadUint32(ds);
 			if (portNode >= ckt->n) {
 				AG_SetError("Bogus port node#: %d", port->node);
-				return (-1);
+				goto fail;
 			}
 			port->node = portNode;
-			node = ckt->nodes[port->node];
+			node = &ckt->nodes[port->node];
 		
 			NODE_FOREACH_BRANCH(br, node) {
 				if (br->port->com == com &&
@@ -477,21 +680,63 @@ Load(void *p, AG_DataSource *ds, const AG_Version *ver)
 			if (br == NULL) {
 				AG_SetError("Port is missing branch: %u(%s)-%d",
 				    port->n, port->name, port->node);
-				return (-1);
+				goto fail;
 			}
 			port->branch = br;
 			port->flags = 0;
 		}
 	}
 
+	Free(idx.coms);
+
 	/* Notify components */
 	CIRCUIT_FOREACH_COMPONENT(com, ckt) {
 		AG_PostEvent(com, "circuit-connected", NULL);
-		AG_PostEvent(com, "circuit-shown", NULL);
+		if (!(ckt->flags & ES_CIRCUIT_HEADLESS))
+			AG_PostEvent(com, "circuit-shown", NULL);
 	}
 
 	ES_CircuitModified(ckt);
 	return (0);
+fail:
+	Free(idx.coms);
+	return (-1);
+}
+
+/*
+ * Return the numbering the nodes would have after ES_CompactNodes(), so
+ * that the circuit can be saved or exported without being modified. Nodes
+ * to be removed map to -1. Returns NULL if no nodes are to be removed.
+ */
+static int *
+CompactedNodeMap(const ES_Circuit *ckt, Uint *nNodes)
+{
+	const ES_Node *node;
+	int *map;
+	Uint i, j;
+
+	if (ckt->nUnused == 0) {
+		*nNodes = ckt->n;
+		return (NULL);
+	}
+	map = Malloc(ckt->n*sizeof(int));
+	map[0] = 0;
+	for (i = 1, j = 1; i < ckt->n; i++) {
+		node = &ckt->nodes[i];
+		if ((node->flags & CKTNODE_UNUSED) && node->nBranches == 0) {
+			map[i] = -1;
+			continue;
+		}
+		map[i] = (int)j++;
+	}
+	*nNodes = j;
+	return (map);
+}
+
+static __inline__ int
+CompactedNode(const ES_Circuit *ckt, const int *map, int n)
+{
+	return (map != NULL && n >= 0 && n < (int)ckt->n) ? map[n] : n;
 }
 
 static int
@@ -503,13 +748,15 @@ Save(void *p, AG_DataSource *ds)
 	ES_Sym *sym;
 	off_t countOffs, skipSizeOffs;
 	Uint32 count;
-	Uint i;
+	Uint i, nNodes;
+	int *map = NULL;
 
 	/* Circuit information */
-	AG_WriteString(ds, ckt->descr);
-	AG_WriteString(ds, ckt->authors);
-	AG_WriteString(ds, ckt->keywords);
-	AG_WriteUint32(ds, ckt->flags);
+	AG_WriteString(ds, (ckt->info != NULL) ? ckt->info->descr : "");
+	AG_WriteString(ds, (ckt->info != NULL) ? ckt->info->authors : "");
+	AG_WriteString(ds, (ckt->info != NULL) ? ckt->info->keywords : "");
+	AG_WriteUint32(ds, (ckt->flags & ES_CIRCUIT_SAVED_FLAGS) |
+	                   ES_CIRCUIT_VG_FRAMED);
 
 	/* Component models */
 	countOffs = AG_Tell(ds);
@@ -545,13 +792,17 @@ Save(void *p, AG_DataSource *ds)
 	}
 	AG_WriteUint32At(ds, count, countOffs);
 
-	/* Circuit nodes and branches */
-	AG_WriteUint32(ds, ckt->n);
+	/* Circuit nodes and branches (without the nodes left unused) */
+	map = CompactedNodeMap(ckt, &nNodes);
+	AG_WriteUint32(ds, nNodes);
 	for (i = 0; i < ckt->n; i++) {
-		ES_Node *node = ckt->nodes[i];
+		ES_Node *node = &ckt->nodes[i];
 
+		if (CompactedNode(ckt, map, i) == -1) {
+			continue;
+		}
 		Debug(ckt, "Saving node n%u (0x%x)\n", i, node->flags);
-		AG_WriteUint32(ds, (Uint32)node->flags);
+		AG_WriteUint32(ds, (Uint32)(node->flags & ~(CKTNODE_UNUSED)));
 		countOffs = AG_Tell(ds);
 		count = 0;
 		AG_WriteUint32(ds, 0);
@@ -574,8 +825,21 @@ Save(void *p, AG_DataSource *ds)
 	}
 	
 	/* Circuit schematics */
-	if (AG_ObjectSerialize(ckt->vg, ds) == -1)
-		return (-1);
+	skipSizeOffs = AG_Tell(ds);
+	AG_WriteUint32(ds, 0);
+	if (ckt->vg != NULL) {
+		if (AG_ObjectSerialize(ckt->vg, ds) == -1)
+			goto fail;
+	} else {
+		VG *vgEmpty = VG_New(0);
+
+		if (AG_ObjectSerialize(vgEmpty, ds) == -1) {
+			AG_ObjectDestroy(vgEmpty);
+			goto fail;
+		}
+		AG_ObjectDestroy(vgEmpty);
+	}
+	AG_WriteUint32At(ds, AG_Tell(ds)-skipSizeOffs, skipSizeOffs);
 
 	/* Symbol table */
 	countOffs = AG_Tell(ds);
@@ -588,7 +852,8 @@ Save(void *p, AG_DataSource *ds)
 		AG_WriteUint32(ds, 0);				/* Pad */
 		switch (sym->type) {
 		case ES_SYM_NODE:
-			AG_WriteSint32(ds, (Sint32)sym->p.node);
+			AG_WriteSint32(ds,
+			    (Sint32)CompactedNode(ckt, map, sym->p.node));
 			break;
 		case ES_SYM_VSOURCE:
 			AG_WriteSint32(ds, (Sint32)sym->p.vsource);
@@ -613,12 +878,17 @@ Save(void *p, AG_DataSource *ds)
 		COMPONENT_FOREACH_PORT(port, i, com) {
 			AG_WriteUint32(ds, (Uint32)port->n);
 			AG_WriteString(ds, port->name);
-			AG_WriteUint32(ds, (Uint32)port->node);
+			AG_WriteUint32(ds,
+			    (Uint32)CompactedNode(ckt, map, port->node));
 		}
 		count++;
 	}
 	AG_WriteUint32At(ds, count, countOffs);
+	Free(map);
 	return (0);
+fail:
+	Free(map);
+	return (-1);
 }
 
 /* Generate a text representation of the circuit. */
@@ -628,7 +898,8 @@ ES_CircuitExportTXT(ES_Circuit *ckt, const char *path)
 	char buf[128];
 	ES_Component *com;
 	FILE *f;
-	Uint i;
+	Uint i, nNodes;
+	int *map;
 
 	if ((f = fopen(path, "w")) == NULL) {
 		AG_SetError("%s: %s", path, strerror(errno));
@@ -638,9 +909,11 @@ ES_CircuitExportTXT(ES_Circuit *ckt, const char *path)
 	    "# %s\n"
 	    "# Generated by Edacious %s <http://edacious.org>\n"
 	    "#\n", OBJECT(ckt)->name, VERSION);
-	if (ckt->descr[0] != '\0') { fprintf(f, "# Description: %s\n", ckt->descr); }
-	if (ckt->authors[0] != '\0') { fprintf(f, "# Author(s): %s\n", ckt->authors); }
-	if (ckt->keywords[0] != '\0') { fprintf(f, "# Keywords: %s\n", ckt->keywords); }
+	if (ckt->info != NULL) {
+		if (ckt->info->descr[0] != '\0') { fprintf(f, "# Description: %s\n", ckt->info->descr); }
+		if (ckt->info->authors[0] != '\0') { fprintf(f, "# Author(s): %s\n", ckt->info->authors); }
+		if (ckt->info->keywords[0] != '\0') { fprintf(f, "# Keywords: %s\n", ckt->info->keywords); }
+	}
 	fprintf(f, "\n");
 
 	CIRCUIT_FOREACH_COMPONENT(com, ckt) {
@@ -656,11 +929,15 @@ ES_CircuitExportTXT(ES_Circuit *ckt, const char *path)
 		fprintf(f, "}\n");
 	}
 
+	map = CompactedNodeMap(ckt, &nNodes);
 	for (i = 0; i < ckt->n; i++) {
-		ES_Node *node = ckt->nodes[i];
+		ES_Node *node = &ckt->nodes[i];
 		ES_Branch *br;
 
-		fprintf(f, "node %d {\n", i);
+		if (CompactedNode(ckt, map, i) == -1) {
+			continue;
+		}
+		fprintf(f, "node %d {\n", CompactedNode(ckt, map, i));
 		NODE_FOREACH_BRANCH(br, node) {
 			if (br->port == NULL || br->port->com == NULL ||
 			    COMPONENT_IS_FLOATING(br->port->com)) {
@@ -675,7 +952,7 @@ ES_CircuitExportTXT(ES_Circuit *ckt, const char *path)
 		}
 		fprintf(f, "}\n");
 	}
-
+	Free(map);
 	fclose(f);
 
 	AG_TextTmsg(AG_MSG_INFO, 1250,
@@ -689,15 +966,15 @@ InitNode(ES_Node *node)
 {
 	node->flags = 0;
 	node->nBranches = 0;
+	node->sym = NULL;
 	TAILQ_INIT(&node->branches);
 }
 
 static void
 InitGround(ES_Circuit *ckt)
 {
-	ckt->nodes[0] = Malloc(sizeof(ES_Node));
-	InitNode(ckt->nodes[0]);
-	ckt->nodes[0]->flags |= CKTNODE_REFERENCE;
+	InitNode(&ckt->nodes[0]);
+	ckt->nodes[0].flags |= CKTNODE_REFERENCE;
 	ES_AddNodeSymbol(ckt, "Gnd", 0);
 }
 
@@ -705,21 +982,23 @@ InitGround(ES_Circuit *ckt)
 int
 ES_AddNode(ES_Circuit *ckt)
 {
-	ckt->nodes = Realloc(ckt->nodes, (ckt->n+1)*sizeof(ES_Node *));
-	ckt->nodes[ckt->n] = Malloc(sizeof(ES_Node));
-	InitNode(ckt->nodes[ckt->n]);
+	if (ckt->n+1 > ckt->nodesMax) {
+		ES_ReserveNodes(ckt, ckt->n+1);
+	}
+	InitNode(&ckt->nodes[ckt->n]);
 	Debug(ckt, "Added node n%d\n", ckt->n);
 	return (ckt->n++);
 }
 
 /*
  * Remove a node and all references to it. If necessary, shift the entire
- * node array and update all port references accordingly.
+ * node array and update all port and symbol references.
  */
 void
 ES_DelNode(ES_Circuit *ckt, int n)
 {
 	ES_Branch *br;
+	ES_Sym *sym;
 	int i;
 
 	Debug(ckt, _("Deleting node n%d\n"), n);
@@ -727,10 +1006,13 @@ ES_DelNode(ES_Circuit *ckt, int n)
 	if (n == 0 || n >= ckt->n)
 		Fatal("ES_DelNode index");
 #endif
+	if (ckt->nodes[n].flags & CKTNODE_UNUSED) {
+		ckt->nUnused--;
+	}
 	if (n != ckt->n-1) {
 		/* Update the Branch port pointers. */
 		for (i = n; i < ckt->n; i++) {
-			NODE_FOREACH_BRANCH(br, ckt->nodes[i]) {
+			NODE_FOREACH_BRANCH(br, &ckt->nodes[i]) {
 				if (br->port != NULL && br->port->com != NULL) {
 #if 0
 					ES_ComponentLog(br->port->com,
@@ -743,44 +1025,135 @@ ES_DelNode(ES_Circuit *ckt, int n)
 				}
 			}
 		}
-		FreeNode(ckt->nodes[n]);
+		FreeNode(&ckt->nodes[n]);
 		memmove(&ckt->nodes[n], &ckt->nodes[n+1],
-		    (ckt->n - n - 1) * sizeof(ES_Node *));
+		    (ckt->n - n - 1) * sizeof(ES_Node));
+		for (i = n; i < ckt->n-1; i++)
+			RelinkNode(&ckt->nodes[i]);
 	} else {
-		FreeNode(ckt->nodes[n]);
+		FreeNode(&ckt->nodes[n]);
 	}
 	ckt->n--;
+
+	TAILQ_FOREACH(sym, &ckt->syms, syms) {
+		if (sym->type != ES_SYM_NODE) {
+			continue;
+		}
+		if (sym->p.node == n) {
+			sym->p.node = -1;
+		} else if (sym->p.node > n) {
+			sym->p.node--;
+		}
+	}
 }
 
 /*
- * Merge the branches of two nodes, creating a new node from them. The
- * new node will always use whichever of the two node names is the lowest
- * numbered. The reference node (0) is never deleted.
+ * Merge the branches of two nodes and return the resulting node. Only the
+ * branches of the node with fewer branches are moved and relabeled, but the
+ * reference node (0) is always kept. The emptied node is flagged unused,
+ * and is removed by the next ES_CompactNodes() in a single pass.
  */
 int
 ES_MergeNodes(ES_Circuit *ckt, int N1, int N2)
 {
+	ES_Node *nodeDst, *nodeSrc;
 	ES_Branch *br;
-	int Nnew, Nold;
+	ES_Sym *sym;
+	int Ndst, Nsrc;
 
-	if (N1 < N2) {
-		Nnew = N1;
-		Nold = N2;
+	if (N1 == N2) {
+		return (N1);
+	}
+	if (N1 == 0 ||
+	    (N2 != 0 &&
+	     ckt->nodes[N1].nBranches >= ckt->nodes[N2].nBranches)) {
+		Ndst = N1;
+		Nsrc = N2;
 	} else {
-		Nnew = N2;
-		Nold = N1;
-	}
-	Debug(ckt, _("Merging nodes: n%d,n%d -> n%d\n"), N1, N2, Nnew);
-rescan:
-	NODE_FOREACH_BRANCH(br, ckt->nodes[Nold]) {
-		ES_Port *brPort = br->port;
-		brPort->node = Nnew;
-		ES_AddBranch(ckt, Nnew, brPort);
-		ES_DelBranch(ckt, Nold, br);
-		goto rescan;
-	}
-	ES_DelNode(ckt, Nold);
-	return (Nnew);
+		Ndst = N2;
+		Nsrc = N1;
+	}
+	Debug(ckt, _("Merging nodes: n%d,n%d -> n%d\n"), N1, N2, Ndst);
+	nodeDst = &ckt->nodes[Ndst];
+	nodeSrc = &ckt->nodes[Nsrc];
+
+	while ((br = TAILQ_FIRST(&nodeSrc->branches)) != NULL) {
+		TAILQ_REMOVE(&nodeSrc->branches, br, branches);
+		TAILQ_INSERT_TAIL(&nodeDst->branches, br, branches);
+		if (br->port != NULL)
+			br->port->node = Ndst;
+	}
+	nodeDst->nBranches += nodeSrc->nBranches;
+	nodeDst->flags &= ~(CKTNODE_UNUSED);
+	nodeSrc->nBranches = 0;
+
+	/* Symbols naming the emptied node now name the merged node. */
+	if (nodeSrc->sym != NULL) {
+		TAILQ_FOREACH(sym, &ckt->syms, syms) {
+			if (sym->type == ES_SYM_NODE && sym->p.node == Nsrc)
+				sym->p.node = Ndst;
+		}
+		if (nodeDst->sym == NULL) {
+			nodeDst->sym = nodeSrc->sym;
+		}
+		nodeSrc->sym = NULL;
+	}
+	if (!(nodeSrc->flags & CKTNODE_UNUSED)) {
+		nodeSrc->flags |= CKTNODE_UNUSED;
+		ckt->nUnused++;
+	}
+	return (Ndst);
+}
+
+/*
+ * Remove the nodes flagged unused (and still without branches), renumbering
+ * the remaining nodes and updating the ports and symbols referencing them.
+ * Runs in a single pass over the nodes and their branches, so that bulk edits
+ * can leave nodes behind and compact once.
+ */
+void
+ES_CompactNodes(ES_Circuit *ckt)
+{
+	ES_Node *node;
+	ES_Branch *br;
+	ES_Sym *sym;
+	int *map;
+	Uint i, j;
+
+	if (ckt->nUnused == 0) {
+		return;
+	}
+	map = Malloc(ckt->n*sizeof(int));
+	map[0] = 0;
+	for (i = 1, j = 1; i < ckt->n; i++) {
+		node = &ckt->nodes[i];
+		if ((node->flags & CKTNODE_UNUSED) && node->nBranches == 0) {
+			Debug(ckt, "n%u is unused; removing\n", i);
+			FreeNode(node);
+			map[i] = -1;
+			continue;
+		}
+		node->flags &= ~(CKTNODE_UNUSED);
+		if (i != j) {
+			NODE_FOREACH_BRANCH(br, node) {
+				if (br->port != NULL && br->port->com != NULL)
+					br->port->node = (int)j;
+			}
+		}
+		if (i != j) {
+			ckt->nodes[j] = *node;
+			RelinkNode(&ckt->nodes[j]);
+		}
+		map[i] = (int)j++;
+	}
+	TAILQ_FOREACH(sym, &ckt->syms, syms) {
+		if (sym->type == ES_SYM_NODE &&
+		    sym->p.node >= 0 && sym->p.node < (int)ckt->n)
+			sym->p.node = map[sym->p.node];
+	}
+	ckt->n = j;
+	ckt->nUnused = 0;
+	Free(map);
 }
 
 /*
@@ -794,7 +1167,11 @@ ES_AddVoltageSource(ES_Circuit *ckt, void *obj)
 	if (!AG_OfClass(obj, "ES_Circuit:ES_Component:*"))
 		AG_FatalError("Not a component");
 #endif
-	ckt->vSrcs = Realloc(ckt->vSrcs, (ckt->m+1)*sizeof(ES_Component *));
+	if (ckt->m+1 > ckt->vSrcsMax) {
+		ckt->vSrcsMax = (ckt->vSrcsMax > 0) ? ckt->vSrcsMax*2 : 8;
+		ckt->vSrcs = Realloc(ckt->vSrcs,
+		    ckt->vSrcsMax*sizeof(ES_Component *));
+	}
 	ckt->vSrcs[ckt->m] = obj;
 	Debug(ckt, "Added voltage source v%d\n", ckt->m);
 	return (ckt->m++);
@@ -828,6 +1205,7 @@ ES_AddNodeSymbol(ES_Circuit *ckt, const char *name, int node)
 	sym = ES_AddSymbol(ckt, name);
 	sym->type = ES_SYM_NODE;
 	sym->p.node = node;
+	LinkNodeSymbol(ckt, sym);
 	return (sym);
 }
 
@@ -871,6 +1249,20 @@ ES_AddSymbol(ES_Circuit *ckt, const char *name)
 	sym->type = 0;
 	sym->p.node = 0;
 	TAILQ_INSERT_TAIL(&ckt->syms, sym, syms);
+
+	if (++ckt->nSyms > ckt->symHashSize*2) {
+		ES_Sym *symOther;
+
+		/* Grow the table, rehashing in order of definition. */
+		ckt->symHashSize *= 2;
+		ckt->symHash = Realloc(ckt->symHash,
+		    ckt->symHashSize*sizeof(ES_Sym *));
+		memset(ckt->symHash, 0, ckt->symHashSize*sizeof(ES_Sym *));
+		TAILQ_FOREACH(symOther, &ckt->syms, syms)
+			InsertSymbolHash(ckt, symOther);
+	} else {
+		InsertSymbolHash(ckt, sym);
+	}
 	return (sym);
 }
 
@@ -878,7 +1270,30 @@ ES_AddSymbol(ES_Circuit *ckt, const char *name)
 void
 ES_DelSymbol(ES_Circuit *ckt, ES_Sym *sym)
 {
+	ES_Sym **pSym, *symOther;
+	ES_Node *node;
+
+	pSym = &ckt->symHash[HashSymbol(sym->name) & (ckt->symHashSize-1)];
+	while (*pSym != sym) {
+		pSym = &(*pSym)->hashNext;
+	}
+	*pSym = sym->hashNext;
 	TAILQ_REMOVE(&ckt->syms, sym, syms);
+	ckt->nSyms--;
+
+	/* Update the reverse mapping of the node. */
+	if (sym->type == ES_SYM_NODE &&
+	    sym->p.node >= 0 && sym->p.node < (int)ckt->n &&
+	    (node = &ckt->nodes[sym->p.node])->sym == sym) {
+		node->sym = NULL;
+		TAILQ_FOREACH(symOther, &ckt->syms, syms) {
+			if (symOther->type == ES_SYM_NODE &&
+			    symOther->p.node == sym->p.node) {
+				node->sym = symOther;
+				break;
+			}
+		}
+	}
 	Free(sym);
 }
 
@@ -888,7 +1303,8 @@ ES_LookupSymbol(ES_Circuit *ckt, const char *name)
 {
 	ES_Sym *sym;
 
-	TAILQ_FOREACH(sym, &ckt->syms, syms) {
+	sym = ckt->symHash[HashSymbol(name) & (ckt->symHashSize-1)];
+	for (; sym != NULL; sym = sym->hashNext) {
 		if (strcmp(sym->name, name) == 0)
 			break;
 	}
@@ -937,6 +1353,79 @@ ES_BranchCurrentPrevStep(ES_Circuit *ckt, int k, int n)
 	return (ckt->sim->ops->branch_current_prev_step(ckt->sim, k, n));
 }
 
+/*
+ * Resolve a probed quantity: "v<node>" for a node voltage or "i<vsource>"
+ * for a voltage source branch current, where the node or source is given
+ * either by symbol or by number.
+ */
+int
+ES_ParseProbe(ES_Circuit *ckt, const char *name, ES_Probe *probe)
+{
+	enum es_probe_type type;
+	ES_Sym *sym;
+	const char *s;
+	int idx;
+
+	switch (name[0]) {
+	case 'v':
+	case 'V':
+		type = ES_PROBE_VOLTAGE;
+		break;
+	case 'i':
+	case 'I':
+		type = ES_PROBE_CURRENT;
+		break;
+	default:
+		AG_SetError(_("%s: Expected v<node> or i<vsource>"), name);
+		return (-1);
+	}
+	s = &name[1];
+	if ((sym = ES_LookupSymbol(ckt, s)) != NULL) {
+		if (type == ES_PROBE_VOLTAGE && sym->type == ES_SYM_NODE) {
+			idx = sym->p.node;
+		} else if (type == ES_PROBE_CURRENT &&
+		    sym->type == ES_SYM_VSOURCE) {
+			idx = sym->p.vsource;
+		} else {
+			AG_SetError(_("%s: Symbol type mismatch"), name);
+			return (-1);
+		}
+	} else {
+		if (*s == 'n') {
+			s++;
+		}
+		if (*s < '0' || *s > '9') {
+			AG_SetError(_("%s: No such node or source"), name);
+			return (-1);
+		}
+		idx = atoi(s);
+	}
+	if (type == ES_PROBE_VOLTAGE) {
+		if (idx < 0 || idx >= ckt->n) {
+			AG_SetError(_("%s: Bad node number"), name);
+			return (-1);
+		}
+	} else {
+		if (idx < 0 || idx >= ckt->m) {
+			AG_SetError(_("%s: Bad voltage source number"), name);
+			return (-1);
+		}
+	}
+
+	probe->type = type;
+	probe->idx = idx;
+	return (0);
+}
+
+/* Return the value of a probed quantity from the last simulation step. */
+M_Real
+ES_ProbeValue(ES_Circuit *ckt, const ES_Probe *probe)
+{
+	return (probe->type == ES_PROBE_VOLTAGE) ?
+	       ES_NodeVoltage(ckt, probe->idx) :
+	       ES_BranchCurrent(ckt, probe->idx);
+}
+
 /* Lookup an existing node by number or die. */
 ES_Node *
 ES_GetNode(ES_Circuit *ckt, int n)
@@ -944,7 +1433,7 @@ ES_GetNode(ES_Circuit *ckt, int n)
 	if (n < 0 || n >= ckt->n) {
 		Fatal("ES_GetNode");
 	}
-	return (ckt->nodes[n]);
+	return (&ckt->nodes[n]);
 }
 
 /* Return the matching symbol (or "nX") for a given node. */
@@ -952,21 +1441,15 @@ ES_GetNode(ES_Circuit *ckt, int n)
 void
 ES_CopyNodeSymbol(ES_Circuit *ckt, int n, char *dst, size_t dst_len)
 {
-	ES_Sym *sym;
-
 	if (n < 0) {
 		Strlcpy(dst, "(null)", dst_len);
 		return;
 	}
-	TAILQ_FOREACH(sym, &ckt->syms, syms) {
-		if (sym->type == ES_SYM_NODE &&
-		    sym->p.node == n) {
-			Strlcpy(dst, sym->name, dst_len);
-			return;
-		}
+	if (n < (int)ckt->n && ckt->nodes[n].sym != NULL) {
+		Strlcpy(dst, ckt->nodes[n].sym->name, dst_len);
+		return;
 	}
 	Snprintf(dst, dst_len, "n%d", n);
-	return;
 }
 
 /* Search for a node matching the given name (symbol or "nX") */
@@ -976,17 +1459,18 @@ ES_GetNodeBySymbol(ES_Circuit *ckt, const char *name)
 {
 	ES_Sym *sym;
 
-	TAILQ_FOREACH(sym, &ckt->syms, syms) {
+	sym = ckt->symHash[HashSymbol(name) & (ckt->symHashSize-1)];
+	for (; sym != NULL; sym = sym->hashNext) {
 		if (sym->type == ES_SYM_NODE &&
 		    strcmp(sym->name, name) == 0 &&
 		    sym->p.node >= 0 && sym->p.node < ckt->n)
-			return (ckt->nodes[sym->p.node]);
+			return (&ckt->nodes[sym->p.node]);
 	}
 	if (name[0] == 'n' && name[1] != '\0') {
 		int n = atoi(&name[1]);
 
 		if (n >= 0 && n < ckt->n) {
-			return (ckt->nodes[n]);
+			return (&ckt->nodes[n]);
 		}
 	}
 	AG_SetError(_("No such node: `%s'"), name);
@@ -997,13 +1481,17 @@ ES_GetNodeBySymbol(ES_Circuit *ckt, const char *name)
 ES_Branch *
 ES_AddBranch(ES_Circuit *ckt, int n, ES_Port *port)
 {
-	ES_Node *node = ckt->nodes[n];
+	ES_Node *node = &ckt->nodes[n];
 	ES_Branch *br;
 
 	br = Malloc(sizeof(ES_Branch));
 	br->port = port;
 	TAILQ_INSERT_TAIL(&node->branches, br, branches);
 	node->nBranches++;
+	node->flags &= ~(CKTNODE_UNUSED);
+	if (port != NULL) {
+		port->branch = br;
+	}
 	return (br);
 }
 
@@ -1011,7 +1499,7 @@ ES_AddBranch(ES_Circuit *ckt, int n, ES_Port *port)
 ES_Branch *
 ES_LookupBranch(ES_Circuit *ckt, int n, ES_Port *port)
 {
-	ES_Node *node = ckt->nodes[n];
+	ES_Node *node = &ckt->nodes[n];
 	ES_Branch *br;
 
 	NODE_FOREACH_BRANCH(br, node) {
@@ -1021,18 +1509,28 @@ ES_LookupBranch(ES_Circuit *ckt, int n, ES_Port *port)
 	return (br);
 }
 
-/* Remove the specified branch. */
+/*
+ * Remove the specified branch. If the node is left without branches, flag
+ * it for removal by ES_CompactNodes().
+ */
 void
 ES_DelBranch(ES_Circuit *ckt, int n, ES_Branch *br)
 {
-	ES_Node *node = ckt->nodes[n];
+	ES_Node *node = &ckt->nodes[n];
 
 	TAILQ_REMOVE(&node->branches, br, branches);
+	if (br->port != NULL && br->port->branch == br) {
+		br->port->branch = NULL;
+	}
 	Free(br);
 #ifdef ES_DEBUG
 	if (node->nBranches == 0) { Fatal("--nBranches < 0"); }
 #endif
-	node->nBranches--;
+	if (--node->nBranches == 0 && n != 0 &&
+	    !(node->flags & CKTNODE_UNUSED)) {
+		node->flags |= CKTNODE_UNUSED;
+		ckt->nUnused++;
+	}
 }
 
 /* Stop any simulation in progress and free the simulation object. */
@@ -1051,26 +1549,43 @@ Destroy(void *p)
 {
 	ES_Circuit *ckt = p;
 
+	FreeNode(&ckt->nodes[0]);
+	Free(ckt->nodes);
+	Free(ckt->symHash);
 	Free(ckt->extObjs);
-	AG_ObjectDestroy(ckt->vg);
+	Free(ckt->info);
+	if (ckt->vg != NULL)
+		AG_ObjectDestroy(ckt->vg);
 }
 
-/* Select the simulation mode. */
+/*
+ * Create a simulation object for the circuit, replacing any existing one.
+ * No settings window is created, so this is safe for batch processing.
+ */
 ES_Sim *
-ES_SetSimulationMode(ES_Circuit *ckt, const ES_SimOps *sops)
+ES_CreateSimulation(ES_Circuit *ckt, const ES_SimOps *sops)
 {
 	ES_Sim *sim;
 
 	ES_DestroySimulation(ckt);
+	ES_CompactNodes(ckt);
 
 	ckt->sim = sim = Malloc(sops->size);
-	sim->ckt = ckt;
-	sim->ops = sops;
-	sim->running = 0;
-
+	ES_SimInit(sim, sops);
 	if (sim->ops->init != NULL) {
 		sim->ops->init(sim);
 	}
+	sim->ckt = ckt;				/* init() may reset it */
+	return (sim);
+}
+
+/* Select the simulation mode. */
+ES_Sim *
+ES_SetSimulationMode(ES_Circuit *ckt, const ES_SimOps *sops)
+{
+	ES_Sim *sim;
+
+	sim = ES_CreateSimulation(ckt, sops);
 	if (agGUI &&
 	    sim->ops->edit != NULL &&
 	   (sim->win = sim->ops->edit(sim, ckt)) != NULL) {
@@ -1108,8 +1623,11 @@ ES_CircuitLog(void *p, const char *fmt, ...)
 void
 ES_AddSimulationObj(ES_Circuit *ckt, const char *refName, void *obj)
 {
-	ckt->extObjs = Realloc(ckt->extObjs, (ckt->nExtObjs+1) * 
-	                                     sizeof(AG_Object *));
+	if (ckt->nExtObjs+1 > ckt->extObjsMax) {
+		ckt->extObjsMax = (ckt->extObjsMax > 0) ? ckt->extObjsMax*2 : 4;
+		ckt->extObjs = Realloc(ckt->extObjs,
+		    ckt->extObjsMax*sizeof(AG_Object *));
+	}
 	ckt->extObjs[ckt->nExtObjs++] = obj;
 	AG_BindObject(ckt, refName, obj);		/* Add dependency */
 }
@@ -1117,7 +1635,7 @@ ES_AddSimulationObj(ES_Circuit *ckt, const char *refName, void *obj)
 AG_ObjectClass esCircuitClass = {
 	"Edacious(Circuit)",
 	sizeof(ES_Circuit),
-	{ 1,0 },
+	{ 1,1 },
 	Init,
 	FreeDataset,
 	Destroy,
@@ -5,12 +5,15 @@
 #define ESCIRCUIT_KEYWORDS_MAX	128
 
 #define ESCIRCUIT_MAX_BRANCHES	32
-#define ESCIRCUIT_MAX_NODES	(0xffff-1)
+#define ESCIRCUIT_MAX_NODES	(0x7fffffff-1)
+#define ESCIRCUIT_NODES_INIT	16	/* Initial node records */
 #define ESCIRCUIT_SYM_MAX	24
 #define ESCIRCUIT_SYM_DESCR_MAX	128
+#define ESCIRCUIT_SYM_HASH_INIT	64	/* Initial symbol hash buckets */
 
 struct es_port;
 struct es_pair;
+struct es_sym;
 struct es_sim;
 struct es_sim_ops;
 
@@ -26,9 +29,12 @@ typedef struct es_node {
 #define CKTNODE_EXAM		0x01	/* Branches are being examined
 					   (used to avoid redundancies) */
 #define CKTNODE_REFERENCE	0x02	/* Reference node (eg. ground) */
+#define CKTNODE_UNUSED		0x04	/* Left without branches (removed
+					   by next ES_CompactNodes()) */
 
 	TAILQ_HEAD(,es_branch) branches;
 	Uint		      nBranches;
+	struct es_sym *sym;		/* First symbol naming the node */
 } ES_Node;
 
 /* Closed loop of port pairs with respect to some component in the circuit. */
@@ -54,45 +60,73 @@ typedef struct es_sym {
 		int vsource;
 		int isource;
 	} p;
+	struct es_sym *hashNext;	/* Next in hash chain */
 	TAILQ_ENTRY(es_sym) syms;
 } ES_Sym;
 
 struct es_scope;
 struct ag_console;
 
+/* Descriptive information (not allocated for components). */
+typedef struct es_circuit_info {
+	char descr[ESCIRCUIT_DESCR_MAX];	/* Description */
+	char authors[ESCIRCUIT_AUTHORS_MAX];	/* Authors */
+	char keywords[ESCIRCUIT_KEYWORDS_MAX];	/* Keywords */
+} ES_CircuitInfo;
+
 /* The basic Circuit model object. */
 typedef struct es_circuit {
 	struct ag_object obj;			/* AG_Object -> ES_Circuit */
 
-	char descr[ESCIRCUIT_DESCR_MAX];	/* Description */
-	char authors[ESCIRCUIT_AUTHORS_MAX];	/* Authors */
-	char keywords[ESCIRCUIT_KEYWORDS_MAX];	/* Keywords */
-	VG *vg;					/* Schematics */
+	ES_CircuitInfo *info;			/* Description (or NULL) */
+	VG *vg;					/* Schematics (or NULL) */
 	
 	struct es_sim *sim;			/* Current simulation mode */
 	Uint flags;
 #define ES_CIRCUIT_SHOW_NODES		0x01
 #define ES_CIRCUIT_SHOW_NODENAMES	0x02
 #define ES_CIRCUIT_SHOW_NODESYMS	0x04
+#define ES_CIRCUIT_HEADLESS		0x08	/* Schematics not loaded */
+#define ES_CIRCUIT_COMPONENT		0x10	/* Part of a component */
+#define ES_CIRCUIT_VG_FRAMED		0x20	/* Schematics preceded by their
+						   size (in saved files only) */
+#define ES_CIRCUIT_SAVED_FLAGS		(ES_CIRCUIT_SHOW_NODES| \
+					 ES_CIRCUIT_SHOW_NODENAMES| \
+					 ES_CIRCUIT_SHOW_NODESYMS)
 	int simlock;			/* Simulation is locked */
 
-	ES_Node **nodes;		/* Nodes (element 0 is ground) */
+	ES_Node *nodes;			/* Nodes (element 0 is ground) */
+	Uint nodesMax;			/* Allocated node records */
 	ES_Loop **loops;		/* Closed loops */
 	struct es_component **vSrcs;	/* Independent voltage sources */
+	Uint vSrcsMax;			/* Allocated vSrcs entries */
 	TAILQ_HEAD(,es_sym) syms;	/* Symbols */
+	ES_Sym **symHash;		/* Symbols by name */
+	Uint     symHashSize;		/* Buckets (power of two) */
+	Uint     nSyms;
 
 	Uint l;				/* Loops */
 	Uint m;				/* Independent voltage sources */
 	Uint n;				/* Nodes (except ground) */
+	Uint nUnused;			/* Nodes flagged CKTNODE_UNUSED */
 	
 	struct ag_console *console;	/* Log console */
 	struct ag_object **extObjs;	/* External simulation objects */
-	Uint              nExtObjs;
+	Uint              nExtObjs, extObjsMax;
 
 	TAILQ_HEAD(,es_component) components;	/* Connected components */
 	TAILQ_HEAD(,es_layout) layouts;		/* Associated PCB layouts */
 } ES_Circuit;
 
+/* Probed quantity: "v<node>" or "i<vsource>". */
+typedef struct es_probe {
+	enum es_probe_type {
+		ES_PROBE_VOLTAGE,	/* Node voltage */
+		ES_PROBE_CURRENT	/* Voltage source branch current */
+	} type;
+	int idx;			/* Node or voltage source index */
+} ES_Probe;
+
 #define ESCIRCUIT(p)             ((ES_Circuit *)(p))
 #define ESCCIRCUIT(obj)          ((const ES_Circuit *)(obj))
 #define ES_CIRCUIT_SELF()          ESCIRCUIT( AG_OBJECT(0,"ES_Circuit:*") )
@@ -145,10 +179,13 @@ void       *ES_CircuitEdit(void *);
 AG_Window  *ES_CircuitOpenObject(void *);
 void        ES_CircuitCloseObject(void *);
 int         ES_CircuitExportTXT(ES_Circuit *, const char *);
+VG         *ES_CircuitGetVG(ES_Circuit *);
 
 int         ES_AddNode(ES_Circuit *);
+void        ES_ReserveNodes(ES_Circuit *, Uint);
 void        ES_DelNode(ES_Circuit *, int);
 int         ES_MergeNodes(ES_Circuit *, int, int);
+void        ES_CompactNodes(ES_Circuit *);
 ES_Branch  *ES_AddBranch(ES_Circuit *, int, struct es_port *);
 void        ES_DelBranch(ES_Circuit *, int, ES_Branch *);
 
@@ -166,8 +203,12 @@ M_Real      ES_NodeVoltagePrevStep(ES_Circuit *, int, int);
 M_Real      ES_BranchCurrent(ES_Circuit *, int);
 M_Real      ES_BranchCurrentPrevStep(ES_Circuit *, int, int);
 
+int         ES_ParseProbe(ES_Circuit *, const char *, ES_Probe *);
+M_Real      ES_ProbeValue(ES_Circuit *, const ES_Probe *);
+
 void        ES_ResumeSimulation(ES_Circuit *);
 void        ES_SuspendSimulation(ES_Circuit *);
+struct es_sim *ES_CreateSimulation(ES_Circuit *, const struct es_sim_ops *);
 struct es_sim *ES_SetSimulationMode(ES_Circuit *, const struct es_sim_ops *);
 void        ES_AddSimulationObj(ES_Circuit *, const char *, void *);
 void        ES_CircuitModified(ES_Circuit *);
@@ -110,7 +110,7 @@ PollCircuitNodes(AG_Event *event)
 
 	AG_TlistClear(tl);
 	for (i = 0; i < ckt->n; i++) {
-		ES_Node *node = ckt->nodes[i];
+		ES_Node *node = &ckt->nodes[i];
 		ES_Branch *br;
 		AG_TlistItem *it;
 
@@ -209,20 +209,24 @@ ShowProperties(AG_Event *event)
 	if ((win = AG_WindowNew(0)) == NULL) {
 		return;
 	}
+	if (ckt->info == NULL) {		/* Component circuit */
+		ckt->info = Malloc(sizeof(ES_CircuitInfo));
+		memset(ckt->info, 0, sizeof(ES_CircuitInfo));
+	}
 	AG_WindowSetCaption(win, _("Circuit properties: %s"),
 	    OBJECT(ckt)->name);
 	AG_WindowSetGeometryAlignedPct(win, AG_WINDOW_MC, 40, 30);
 	
 	tb = AG_TextboxNewS(win, AG_TEXTBOX_HFILL, _("Author: "));
-	AG_TextboxBindUTF8(tb, ckt->authors, sizeof(ckt->authors));
+	AG_TextboxBindUTF8(tb, ckt->info->authors, sizeof(ckt->info->authors));
 
 	tb = AG_TextboxNewS(win, AG_TEXTBOX_HFILL, _("Keywords: "));
-	AG_TextboxBindUTF8(tb, ckt->keywords, sizeof(ckt->keywords));
+	AG_TextboxBindUTF8(tb, ckt->info->keywords, sizeof(ckt->info->keywords));
 
 	AG_LabelNew(win, 0, _("Description: "));
 	tb = AG_TextboxNewS(win, AG_TEXTBOX_EXPAND|AG_TEXTBOX_MULTILINE|
 	                         AG_TEXTBOX_CATCH_TAB, NULL);
-	AG_TextboxBindUTF8(tb, ckt->descr, sizeof(ckt->descr));
+	AG_TextboxBindUTF8(tb, ckt->info->descr, sizeof(ckt->info->descr));
 	AG_WidgetFocus(tb);
 
 	AG_ButtonNewFn(win, AG_BUTTON_HFILL, _("Close"), AGWINCLOSE(win));
@@ -85,6 +85,25 @@ FreePairs(ES_Component *com)
 	com->pairs = NULL;
 }
 
+static void
+FreeSpecs(ES_Component *com)
+{
+	ES_SpecCondition *cond;
+	Uint i;
+
+	for (i = 0; i < com->nspecs; i++) {
+		ES_Spec *spec = &com->specs[i];
+
+		while ((cond = SLIST_FIRST(&spec->conds)) != NULL) {
+			SLIST_REMOVE_HEAD(&spec->conds, conds);
+			free(cond);
+		}
+	}
+	Free(com->specs);
+	com->specs = NULL;
+	com->nspecs = 0;
+}
+
 static void
 FreeDataset(void *p)
 {
@@ -101,6 +120,8 @@ Destroy(void *p)
 	ES_Component *com = p;
 
 	FreePairs(com);
+	FreeSpecs(com);
+	Free(com->ports);
 }
 
 /*
@@ -191,7 +212,8 @@ OnAttach(AG_Event *event)
 	TAILQ_FOREACH(scm, &com->schems, schems) {
 		ES_SchemBlock *sb;
 
-		sb = ES_SchemBlockNew(ckt->vg->root, OBJECT(com)->name);
+		sb = ES_SchemBlockNew(ES_CircuitGetVG(ckt)->root,
+		    OBJECT(com)->name);
 		VG_Merge(sb, scm->vg);
 		ES_AttachSchemEntity(com, VGNODE(sb));
 	}
@@ -206,7 +228,7 @@ OnAttach(AG_Event *event)
 	 * more SchemBlock entities in the Circuit VG.
 	 */
 	if (COMCLASS(com)->draw != NULL)
-		COMCLASS(com)->draw(com, ckt->vg);
+		COMCLASS(com)->draw(com, ES_CircuitGetVG(ckt));
 
 	ES_UnlockCircuit(ckt);
 }
@@ -244,33 +266,30 @@ OnDetach(AG_Event *event)
 			AG_FatalError(AG_GetError());
 	}
 
-del_branches:
-	/* Remove the associated branches. XXX */
-	for (i = 0; i < ckt->n; i++) {
-		ES_Node *node = ckt->nodes[i];
-		ES_Branch *br, *nbr;
-
-		for (br = TAILQ_FIRST(&node->branches);
-		     br != TAILQ_END(&node->branches);
-		     br = nbr) {
-			nbr = TAILQ_NEXT(br, branches);
-			if (br->port != NULL && br->port->com == com) {
-				Debug(com, "Removing branch in n%u\n", i);
-				ES_DelBranch(ckt, i, br);
-				goto del_branches;
-			}
-		}
-	}
-
-del_nodes:
-	/* Remove node structures no longer needed. XXX */
-	for (i = 1; i < ckt->n; i++) {
-		ES_Node *node = ckt->nodes[i];
+	/*
+	 * Remove the branches of our ports. Nodes left without branches
+	 * (including new nodes never connected) are flagged and removed by
+	 * ES_CompactNodes().
+	 */
+	COMPONENT_FOREACH_PORT(port, i, com) {
+		ES_Node *node;
+		ES_Branch *br;
 
-		if (node->nBranches == 0) {
-			Debug(com, "n%u has no more branches; removing\n", i);
-			ES_DelNode(ckt, i);
-			goto del_nodes;
+		if (port->node < 0 || port->node >= (int)ckt->n) {
+			continue;
+		}
+		node = &ckt->nodes[port->node];
+		if ((br = port->branch) == NULL || br->port != port) {
+			br = ES_LookupBranch(ckt, port->node, port);
+		}
+		if (br != NULL) {
+			Debug(com, "Removing branch in n%d\n", port->node);
+			ES_DelBranch(ckt, port->node, br);
+		}
+		if (node->nBranches == 0 && port->node != 0 &&
+		    !(node->flags & CKTNODE_UNUSED)) {
+			node->flags |= CKTNODE_UNUSED;
+			ckt->nUnused++;
 		}
 	}
 
@@ -310,6 +329,7 @@ Init(void *obj)
 	com->flags = 0;
 	com->ckt = NULL;
 	com->Tspec = 27.0+273.15;
+	com->ports = NULL;
 	com->nports = 0;
 	com->pairs = NULL;
 	com->npairs = 0;
@@ -317,6 +337,7 @@ Init(void *obj)
 	com->nspecs = 0;
 
 	com->dcSimBegin = NULL;
+	com->dcTempUpdate = NULL;
 	com->dcStepBegin = NULL;
 	com->dcStepIter = NULL;
 	com->dcStepEnd = NULL;
@@ -331,7 +352,11 @@ Init(void *obj)
 	AG_SetEvent(com, "detached", OnDetach, NULL);
 }
 
-/* Initialize the Ports of a Component instance. */
+/*
+ * Initialize the Ports of a Component instance. The array is sized to the
+ * number of ports, and the port names refer to the (static) port table of
+ * the model, which is shared by all instances of the class.
+ */
 void
 ES_InitPorts(void *p, const ES_Port *ports)
 {
@@ -339,19 +364,28 @@ ES_InitPorts(void *p, const ES_Port *ports)
 	const ES_Port *modelPort;
 	ES_Pair *pair;
 	ES_Port *iPort, *jPort;
-	int i, j, k;
+	int i, j, k, count;
 
 	/* Instantiate the array of Ports. */
 	if (com->npairs > 0) {
 		FreePairs(com);
 	}
+	for (count = 0, modelPort = &ports[1];
+	     count < COMPONENT_MAX_PORTS-1 && modelPort->n >= 0;
+	     count++, modelPort++)
+		;
+	com->ports = Realloc(com->ports, (count+1)*sizeof(ES_Port));
+	memset(&com->ports[0], 0, sizeof(ES_Port));
+	com->ports[0].name = "";
+	com->ports[0].com = com;
+	com->ports[0].node = -1;
 	com->nports = 0;
 	for (i = 1, modelPort = &ports[1];
-	     i < COMPONENT_MAX_PORTS && modelPort->n >= 0;
+	     i <= count;
 	     i++, modelPort++) {
 		ES_Port *port = &com->ports[i];
 
-		Strlcpy(port->name, modelPort->name, sizeof(port->name));
+		port->name = modelPort->name;
 		port->n = i;
 		port->com = com;
 		port->node = -1;
@@ -386,8 +420,8 @@ ES_InitPorts(void *p, const ES_Port *ports)
 			pair->com = com;
 			pair->p1 = iPort;
 			pair->p2 = jPort;
-			pair->loops = Malloc(sizeof(ES_Loop *));
-			pair->loopPolarity = Malloc(sizeof(int));
+			pair->loops = NULL;		/* Allocated on demand */
+			pair->loopPolarity = NULL;
 			pair->nLoops = 0;
 		}
 	}
@@ -400,7 +434,7 @@ Load(void *p, AG_DataSource *ds, const AG_Version *ver)
 	Uint i, count;
 	ES_Schem *scm;
 	
-	com->flags = (Uint)AG_ReadUint32(ds);
+	com->flags = (Uint)AG_ReadUint32(ds) | (com->flags & ES_COMPONENT_LINEAR);
 	com->Tspec = M_ReadReal(ds);
 
 	/* Load the schematic blocks. */
@@ -517,6 +551,70 @@ ES_FindPort(void *p, const char *portname)
 	return (NULL);
 }
 
+/*
+ * Add (or replace) a min/typ/max specification for a component parameter.
+ * The name must match one of the real-valued variables of the component
+ * (e.g., "R" for a Resistor).
+ */
+ES_Spec *
+ES_ComponentAddSpec(void *p, const char *name, M_Real min, M_Real typ,
+    M_Real max)
+{
+	ES_Component *com = p;
+	ES_Spec *spec;
+
+	if (min > typ || typ > max) {
+		AG_SetError(_("%s: %s: Expected min <= typ <= max"),
+		    OBJECT(com)->name, name);
+		return (NULL);
+	}
+	if ((spec = ES_ComponentGetSpec(com, name)) == NULL) {
+		com->specs = Realloc(com->specs,
+		    (com->nspecs+1)*sizeof(ES_Spec));
+		spec = &com->specs[com->nspecs++];
+		Strlcpy(spec->name, name, sizeof(spec->name));
+		spec->descr[0] = '\0';
+		SLIST_INIT(&spec->conds);
+	}
+	spec->min = min;
+	spec->typ = typ;
+	spec->max = max;
+	return (spec);
+}
+
+/* Lookup a component specification by name. */
+ES_Spec *
+ES_ComponentGetSpec(void *p, const char *name)
+{
+	ES_Component *com = p;
+	Uint i;
+
+	for (i = 0; i < com->nspecs; i++) {
+		if (strcmp(com->specs[i].name, name) == 0)
+			return (&com->specs[i]);
+	}
+	AG_SetError(_("%s: No such specification: <%s>"), OBJECT(com)->name,
+	    name);
+	return (NULL);
+}
+
+/*
+ * Restrict a specification to the conditions where the named specification
+ * (of the same component) lies within [min,max].
+ */
+ES_SpecCondition *
+ES_SpecAddCondition(ES_Spec *spec, const char *name, M_Real min, M_Real max)
+{
+	ES_SpecCondition *cond;
+
+	cond = Malloc(sizeof(ES_SpecCondition));
+	Strlcpy(cond->name, name, sizeof(cond->name));
+	cond->min = min;
+	cond->max = max;
+	SLIST_INSERT_HEAD(&spec->conds, cond, conds);
+	return (cond);
+}
+
 /* Select the specified component */
 void
 ES_SelectComponent(ES_Component *com, VG_View *vv)
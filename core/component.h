@@ -28,7 +28,7 @@ enum circuit_format {
 /* Interface element between the model and the circuit. */
 typedef struct es_port {
 	int n;					/* Port number */
-	char name[COMPONENT_PORT_NAME_MAX];	/* Port name */
+	const char *name;			/* Port name (from class) */
 	struct es_component *com;		/* Component object */
 	int node;				/* Node connection (or -1) */
 	struct es_branch *branch;		/* Branch into node */
@@ -96,11 +96,13 @@ typedef struct es_component {
 #define ES_COMPONENT_SUPPRESSED	 0x08		/* Become zero voltage source */
 #define ES_COMPONENT_SPECIAL	 0x10		/* Exclude from components list */
 #define ES_COMPONENT_CONNECTED	 0x20		/* Connected to circuit */
+#define ES_COMPONENT_LINEAR	 0x40		/* dcStepIter() stamps do not depend
+						   on the iterate */
 #define ES_COMPONENT_SAVED_FLAGS (ES_COMPONENT_SUPPRESSED|ES_COMPONENT_SPECIAL)
 
 	M_Real Tspec;				/* Instance temp (k) */
-	ES_Port ports[COMPONENT_MAX_PORTS];	/* Ports (indices 1..nports) */
-	Uint   nports;
+	ES_Port *ports;				/* Ports (indices 1..nports) */
+	Uint    nports;
 	ES_Pair *pairs;				/* Port pairs */
 	Uint    npairs;
 	ES_Spec	*specs;				/* Model specifications */
@@ -108,6 +110,7 @@ typedef struct es_component {
 
 	int (*dcSimPrep)(void *, struct es_sim_dc *);
 	int (*dcSimBegin)(void *, struct es_sim_dc *);
+	void (*dcTempUpdate)(void *, struct es_sim_dc *);
 	void (*dcStepBegin)(void *, struct es_sim_dc *);
 	void (*dcStepIter)(void *, struct es_sim_dc *);
 	void (*dcStepEnd)(void *, struct es_sim_dc *);
@@ -187,6 +190,9 @@ void     ES_InitPorts(void *, const ES_Port *);
 Uint	 ES_PortNode(ES_Component *, int);
 int	 ES_PairIsInLoop(ES_Pair *, struct es_loop *, int *);
 ES_Port	*ES_FindPort(void *, const char *);
+ES_Spec *ES_ComponentAddSpec(void *, const char *, M_Real, M_Real, M_Real);
+ES_Spec *ES_ComponentGetSpec(void *, const char *);
+ES_SpecCondition *ES_SpecAddCondition(ES_Spec *, const char *, M_Real, M_Real);
 void     ES_SelectComponent(ES_Component *, VG_View *);
 
 /* Select/unselect components. */
@@ -164,13 +164,18 @@ DeleteSelections(AG_Event *event)
 {
 	ES_Circuit *ckt = ES_CIRCUIT_PTR(1);
 	VG_View *vv = VG_VIEW_PTR(2);
-	ES_Component *com;
+	ES_Component *com, *comNext;
 	int changed = 0;
 
 	VG_ClearEditAreas(vv);
 	ES_LockCircuit(ckt);
-rescan:
-	CIRCUIT_FOREACH_COMPONENT_SELECTED(com, ckt) {
+	for (com = TAILQ_FIRST(&ckt->components);
+	     com != TAILQ_END(&ckt->components);
+	     com = comNext) {
+		comNext = TAILQ_NEXT(com, components);
+		if (!(com->flags & ES_COMPONENT_SELECTED)) {
+			continue;
+		}
 		if (!AG_ObjectInUse(com)) {
 			AG_ObjectDelete(com);
 			changed++;
@@ -179,10 +184,9 @@ rescan:
 			    _("Cannot delete %s: Component is in use!"),
 			    OBJECT(com)->name);
 		}
-		goto rescan;
 	}
 	if (changed) {
-		ES_CircuitModified(ckt);
+		ES_CircuitModified(ckt);	/* Compacts the nodes once */
 	}
 	ES_UnlockCircuit(ckt);
 }
@@ -890,7 +894,8 @@ ES_ComponentEdit(void *obj)
 		AG_Box *hBox;
 		AG_Toolbar *tb;
 	
-		vv = VG_ViewNew(NULL, ckt->vg, VG_VIEW_EXPAND|VG_VIEW_GRID);
+		vv = VG_ViewNew(NULL, ES_CircuitGetVG(ckt),
+		    VG_VIEW_EXPAND|VG_VIEW_GRID);
 		VG_ViewSetSnapMode(vv, VG_GRID);
 		VG_ViewSetScale(vv, DEFAULT_CIRCUIT_SCALE);
 
@@ -40,186 +40,20 @@
 #endif
 
 AG_Object *esComponentLibrary = NULL;	/* Component model library */
+ES_LibraryIndex esComponentIndex;	/* Index of model files */
 
 char **esComponentLibraryDirs;
 int    esComponentLibraryDirCount;
 
-/* Load a component model from file. */
-static int
-LoadComponentFile(const char *path, AG_Object *objParent)
-{
-	AG_ObjectHeader oh;
-	AG_DataSource *ds;
-	AG_ObjectClass *cl;
-	AG_Object *obj;
-
-	/* Fetch class information from the object file's header. */
-	if ((ds = AG_OpenFile(path, "rb")) == NULL) {
-		return (-1);
-	}
-	if (AG_ObjectReadHeader(ds, &oh) == -1) {
-		AG_CloseFile(ds);
-		return (-1);
-	}
-	AG_CloseFile(ds);
-
-	Debug(objParent, "%s: Model for %s\n", AG_ShortFilename(path),
-	    oh.cs.hier);
-
-	/*
-	 * Fetch class information for the model contained. If dynamic library
-	 * modules are required, they get linked at this stage.
-	 */
-	if ((cl = AG_LoadClass(oh.cs.hier)) == NULL)
-		return (-1);
-
-	/* Create the component model instance and load its contents. */
-	if ((obj = AG_ObjectNew(objParent, NULL, cl)) == NULL) {
-		return (-1);
-	}
-	if (AG_ObjectLoadFromFile(obj, path) == -1) {
-		AG_SetError("%s: %s", path, AG_GetError());
-		AG_ObjectDelete(obj);
-		return (-1);
-	}
-	AG_SetString(obj, "archive-path", path);
-	AG_ObjectSetNameS(obj, AG_ShortFilename(path));
-	return (0);
-}
-
-/* Load component model files in specified directory (and subdirectories). */
-static int
-LoadComponentsFromDisk(const char *modelDir, AG_Object *objParent)
-{
-	char path[AG_PATHNAME_MAX];
-	AG_Object *objFolder;
-	AG_Dir *dir;
-	int j;
-#if 0
-	Debug(NULL, "Scanning model directory: %s (under \"%s\")\n",
-	    modelDir, objParent->name);
-#endif
-	if ((dir = AG_OpenDir(modelDir)) == NULL) {
-		return (-1);
-	}
-	for (j = 0; j < dir->nents; j++) {
-		char *file = dir->ents[j];
-		AG_FileInfo fileInfo;
-		char *s;
-
-		if (file[0] == '.')
-			continue;
-
-		Strlcpy(path, modelDir, sizeof(path));
-		Strlcat(path, PATHSEP, sizeof(path));
-		Strlcat(path, file, sizeof(path));
-			
-		if (AG_GetFileInfo(path, &fileInfo) == -1) {
-			AG_Verbose("Ignoring: %s (%s)\n", path, AG_GetError());
-			continue;
-		}
-		if (fileInfo.type == AG_FILE_DIRECTORY) {
-			if ((objFolder = AG_ObjectFindChild(objParent, file))
-			    == NULL) {
-				/* Should not happen */
-				AG_Verbose("Ignoring folder: %s\n", file);
-				continue;
-			}
-			if (LoadComponentsFromDisk(path, objFolder) == -1) {
-				AG_Verbose("Ignoring model dir: %s (%s)\n",
-				    path, AG_GetError());
-			}
-			continue;
-		}
-		if ((s = strstr(file, ".em")) == NULL || s[3] != '\0') {
-			continue;
-		}
-		if (LoadComponentFile(path, objParent) == -1)
-			AG_Verbose("Ignoring model file: %s (%s)", path,
-			    AG_GetError());
-	}
-	AG_CloseDir(dir);
-	return (0);
-}
-
-/* Load component model "folder" objects from disk. */
-static int
-LoadFoldersFromDisk(const char *modelDir, AG_Object *objParent)
-{
-	char path[AG_PATHNAME_MAX];
-	AG_Dir *dir;
-	AG_Object *objFolder;
-	int j;
-#if 0
-	Debug(NULL, "Scanning for folders in: %s (under \"%s\")\n",
-	    modelDir, objParent->name);
-#endif
-	if ((dir = AG_OpenDir(modelDir)) == NULL) {
-		return (-1);
-	}
-	for (j = 0; j < dir->nents; j++) {
-		char *file = dir->ents[j];
-		AG_FileInfo fileInfo;
-
-		if (file[0] == '.')
-			continue;
-
-		Strlcpy(path, modelDir, sizeof(path));
-		Strlcat(path, PATHSEP, sizeof(path));
-		Strlcat(path, file, sizeof(path));
-			
-		if (AG_GetFileInfo(path, &fileInfo) == -1) {
-			AG_Verbose("Ignoring: %s (%s)\n", path, AG_GetError());
-			continue;
-		}
-		if (fileInfo.type != AG_FILE_DIRECTORY) {
-			continue;
-		}
-		if ((objFolder = AG_ObjectNew(objParent, file, &agObjectClass))
-		    == NULL) {
-			AG_Verbose("Ignoring folder: %s (%s)\n", path,
-			    AG_GetError());
-			continue;
-		}
-		if (LoadFoldersFromDisk(path, objFolder) == -1) {
-			AG_Verbose("Ignoring folder: %s (%s)\n", path,
-			    AG_GetError());
-		}
-	}
-	AG_CloseDir(dir);
-	return (0);
-}
-
-/* Load the model library from disk. */
+/* Bring the model library up to date with the model directories. */
 int
 ES_ComponentLibraryLoad(void)
 {
-	int i;
-
-	if (esComponentLibrary != NULL) {
-		if (AG_ObjectInUse(esComponentLibrary)) {
-			/* XXX */
-			AG_Verbose("Not freeing model library; model(s) are"
-			           "currently in use");
-		} else {
-	//		AG_ObjectDestroy(esComponentLibrary);
-		}
-	}
-
-	/* Create the folder structure. */
-	esComponentLibrary = AG_ObjectNew(NULL, "Component Library",
-	    &agObjectClass);
-	for (i = 0; i < esComponentLibraryDirCount; i++) {
-		if (LoadFoldersFromDisk(esComponentLibraryDirs[i], esComponentLibrary) == -1)
-			AG_Verbose("Skipping: %s\n",  AG_GetError());
-	}
-
-	/* Load the model files. */
-	for (i = 0; i < esComponentLibraryDirCount; i++) {
-		if (LoadComponentsFromDisk(esComponentLibraryDirs[i],
-		    esComponentLibrary) == -1)
-			AG_Verbose("Skipping: %s\n",  AG_GetError());
+	if (ES_LibraryIndexUpdate(&esComponentIndex, "Component Library",
+	    esComponentLibraryDirs, esComponentLibraryDirCount) == -1) {
+		return (-1);
 	}
+	esComponentLibrary = esComponentIndex.root;
 	return (0);
 }
 
@@ -267,6 +101,7 @@ ES_ComponentLibraryInit(void)
 	esComponentLibrary = NULL;
 	esComponentLibraryDirs = NULL;
 	esComponentLibraryDirCount = 0;
+	ES_LibraryIndexInit(&esComponentIndex, "Models", ".em", NULL);
 	
 	Strlcpy(path, DATADIR, sizeof(path));
 	Strlcat(path, "/Models", sizeof(path));
@@ -289,58 +124,24 @@ ES_ComponentLibraryInit(void)
 		ES_ComponentLibraryRegisterDir(path);
 	}
 #endif
-	if (ES_ComponentLibraryLoad() == -1)
-		AG_Verbose("Loading library: %s", AG_GetError());
 }
 
 /* Destroy the model library. */
 void
 ES_ComponentLibraryDestroy(void)
 {
-	AG_ObjectDestroy(esComponentLibrary);
+	ES_LibraryIndexDestroy(&esComponentIndex);
 	esComponentLibrary = NULL;
 	Free(esComponentLibraryDirs);
 }
 
-static AG_TlistItem *
-FindComponents(AG_Tlist *tl, AG_Object *pob, int depth)
-{
-	AG_Object *chld;
-	AG_TlistItem *it;
-	int isComponent = AG_OfClass(pob, "ES_Circuit:ES_Component:*");
-
-	it = AG_TlistAddPtr(tl,
-	    isComponent ? esIconComponent.s : agIconDirectory.s,
-	    pob->name, pob);
-	it->depth = depth;
-	it->cat = isComponent ? "component" : "folder";
-
-	if (!TAILQ_EMPTY(&pob->children)) {
-		it->flags |= AG_TLIST_HAS_CHILDREN;
-	}
-	if ((it->flags & AG_TLIST_HAS_CHILDREN) &&
-	    AG_TlistVisibleChildren(tl, it)) {
-		TAILQ_FOREACH(chld, &pob->children, cobjs)
-			FindComponents(tl, chld, depth+1);
-	}
-	return (it);
-}
-
 /* Generate a Tlist tree for the component model library. */
 static void
 PollLibrary(AG_Event *event)
 {
 	AG_Tlist *tl = AG_TLIST_SELF();
-	AG_TlistItem *ti;
-	
-	AG_TlistClear(tl);
-	AG_LockVFS(esComponentLibrary);
 
-	ti = FindComponents(tl, OBJECT(esComponentLibrary), 0);
-	ti->flags |= AG_TLIST_ITEM_EXPANDED;
-
-	AG_UnlockVFS(esComponentLibrary);
-	AG_TlistRestore(tl);
+	ES_LibraryIndexPoll(&esComponentIndex, tl);
 }
 
 static void
@@ -349,12 +150,19 @@ InsertComponent(AG_Event *event)
 	VG_View *vv = VG_VIEW_PTR(1);
 	ES_Circuit *ckt = ES_CIRCUIT_PTR(2);
 	AG_TlistItem *ti = AG_TLIST_ITEM_PTR(3);
-	ES_Component *comModel = ti->p1;
+	ES_Component *comModel;
 	VG_Tool *insTool;
 
-	if (strcmp(ti->cat, "component") != 0)
+	if (strcmp(ti->cat, "object") != 0)
 		return;
 
+	/* The model is only loaded once it is needed. */
+	if ((comModel = (ES_Component *)ES_LibraryIndexLoadItem(
+	    &esComponentIndex, ti)) == NULL) {
+		AG_TextMsgFromError();
+		return;
+	}
+
 	if ((insTool = VG_ViewFindToolByOps(vv, &esComponentInsertTool)) == NULL) {
 		AG_TextMsgFromError();
 		return;
@@ -369,16 +177,12 @@ InsertComponent(AG_Event *event)
 		AG_TextMsgFromError();
 }
 
+/* Rescan all model directories (attached browsers are refreshed). */
 static void
 RefreshLibrary(AG_Event *event)
 {
-	AG_Tlist *tl = AG_TLIST_PTR(1);
-
-	if (ES_ComponentLibraryLoad() == -1) {
+	if (ES_ComponentLibraryLoad() == -1)
 		AG_TextMsgFromError();
-		return;
-	}
-	AG_TlistRefresh(tl);
 }
 
 static void
@@ -440,9 +244,18 @@ static void
 ComponentMenu(AG_Event *event)
 {
 	AG_Tlist *tl = AG_TLIST_SELF();
-	AG_Object *obj = AG_TlistSelectedItemPtr(tl);
+	AG_TlistItem *ti = AG_TlistSelectedItem(tl);
 	AG_PopupMenu *pm;
+	AG_Object *obj;
 
+	if (ti == NULL || strcmp(ti->cat, "object") != 0)
+		return;
+
+	if ((obj = ES_LibraryIndexLoadItem(&esComponentIndex, ti))
+	    == NULL) {
+		AG_TextMsgFromError();
+		return;
+	}
 	if (!AG_OfClass(obj, "ES_Circuit:ES_Component:*"))
 		return;
 	
@@ -467,7 +280,11 @@ ES_ComponentLibraryEditorNew(void *parent, VG_View *vv, ES_Circuit *ckt,
 	AG_Box *box;
 	AG_Button *btn;
 	AG_Tlist *tl;
-	AG_Event ev;
+
+	/* The library is only scanned once a browser is needed. */
+	if (esComponentLibrary == NULL &&
+	    ES_ComponentLibraryLoad() == -1)
+		AG_Verbose("Loading library: %s", AG_GetError());
 
 	box = AG_BoxNewVert(parent, AG_BOX_EXPAND);
 
@@ -482,10 +299,11 @@ ES_ComponentLibraryEditorNew(void *parent, VG_View *vv, ES_Circuit *ckt,
 	    InsertComponent, "%p,%p", vv, ckt);
 
 	btn = AG_ButtonNewFn(box, AG_BUTTON_HFILL, _("Refresh list"),
-	    RefreshLibrary, "%p", tl);
+	    RefreshLibrary, NULL);
 	AG_WidgetSetFocusable(btn, 0);
 
-	AG_EventArgs(&ev, "%p", tl);
-	RefreshLibrary(&ev);
+	/* Changes to the model directories are pushed to the list. */
+	ES_LibraryIndexAttach(&esComponentIndex, tl);
+	AG_TlistRefresh(tl);
 	return (ES_ComponentLibraryEditor *)box;
 }
@@ -4,6 +4,7 @@ typedef AG_Box ES_ComponentLibraryEditor;
 
 __BEGIN_DECLS
 extern AG_Object *esComponentLibrary;
+extern ES_LibraryIndex esComponentIndex;
 extern char **esComponentLibraryDirs;
 extern int    esComponentLibraryDirCount;
 
@@ -63,9 +63,6 @@ const char *esEditableClasses[] = {
 	NULL
 };
 
-/* Dummy variable to write everything related to ground to */
-M_Real esDummy = 0.0;
-
 #ifdef FP_DEBUG
 #include <fenv.h>
 #endif
@@ -89,6 +86,10 @@ ES_LoadModule(const char *dsoName)
 
 	AG_LockDSO();
 
+	if (AG_LookupDSO(dsoName) != NULL) {		/* Already loaded */
+		AG_UnlockDSO();
+		return (0);
+	}
 	if ((dso = AG_LoadDSO(dsoName, 0)) == NULL)
 		goto fail;
 
@@ -137,6 +138,39 @@ fail:
 	return (-1);
 }
 
+/*
+ * Look up a class by specification. If it is not registered yet and the
+ * specification names modules (e.g., "ES_Component:ES_Resistor@generic"),
+ * load them with ES_LoadModule() so that all of their classes are
+ * registered and initialized on first use.
+ */
+AG_ObjectClass *
+ES_LoadClass(const char *classSpec)
+{
+	AG_ObjectClassSpec cs;
+	AG_ObjectClass *cl;
+	char *s, *lib;
+
+	if (AG_ParseClassSpec(&cs, classSpec) == -1) {
+		return (NULL);
+	}
+	if ((cl = AG_LookupClass(cs.hier)) != NULL) {
+		return (cl);
+	}
+	for (s = cs.libs; (lib = Strsep(&s, ", ")) != NULL; ) {
+		if (lib[0] == '\0') {
+			continue;
+		}
+		if (ES_LoadModule(lib) == -1)
+			return (NULL);
+	}
+	if ((cl = AG_LookupClass(cs.hier)) == NULL) {
+		AG_SetError(_("%s: No such class"), cs.hier);
+		return (NULL);
+	}
+	return (cl);
+}
+
 /* Unload an Edacious module assuming none of its classes are in use. */
 int
 ES_UnloadModule(const char *dsoName)
@@ -219,6 +253,7 @@ ES_CoreInit(Uint flags)
 
 	AG_ObjectSetName(&esVfsRoot, "Edacious VFS");
 	AG_MutexInitRecursive(&objLock);
+	ES_ModelCardsInit();
 
 	/* Register es_core's icons if a GUI is in use. */
 	if (agGUI)
@@ -252,6 +287,7 @@ ES_CoreDestroy(void)
 	AG_LockDSO();
 	ES_ComponentLibraryDestroy();
 	ES_SchemLibraryDestroy();
+	ES_ModelCardsDestroy();
 
 	for (dso = TAILQ_FIRST(&agLoadedDSOs);
 	     dso != TAILQ_END(&agLoadedDSOs);
@@ -777,13 +813,19 @@ ES_GUI_Quit(AG_Event *event)
 		if (AG_ObjectChanged(vfsObj))
 			break;
 	}
-	OBJECT_FOREACH_CHILD(modelObj, &esComponentLibrary, ag_object) {
-		if (AG_ObjectChanged(modelObj))
-			break;
+	modelObj = NULL;
+	if (esComponentLibrary != NULL) {
+		OBJECT_FOREACH_CHILD(modelObj, esComponentLibrary, ag_object) {
+			if (AG_ObjectChanged(modelObj))
+				break;
+		}
 	}
-	OBJECT_FOREACH_CHILD(schemObj, &esSchemLibrary, ag_object) {
-		if (AG_ObjectChanged(schemObj))
-			break;
+	schemObj = NULL;
+	if (esSchemLibrary != NULL) {
+		OBJECT_FOREACH_CHILD(schemObj, esSchemLibrary, ag_object) {
+			if (AG_ObjectChanged(schemObj))
+				break;
+		}
 	}
 
 	if (vfsObj == NULL &&
@@ -20,14 +20,24 @@
 #include <edacious/core/sim.h>
 #include <edacious/core/circuit.h>
 #include <edacious/core/component.h>
+#include <edacious/core/model_card.h>
+#include <edacious/core/table_model.h>
 #include <edacious/core/integration.h>
+#include <edacious/core/dense_lu.h>
+#include <edacious/core/sparse_lu.h>
 #include <edacious/core/dc.h>
+#include <edacious/core/corner.h>
+#include <edacious/core/run.h>
+#include <edacious/core/netlist.h>
 #include <edacious/core/icons.h>
 #include <edacious/core/scope.h>
 #include <edacious/core/stamp.h>
+#include <edacious/core/limit.h>
 #include <edacious/core/spice.h>
 #include <edacious/core/wire.h>
+#include <edacious/core/spatial.h>
 
+#include <edacious/core/library_index.h>
 #include <edacious/core/component_library.h>
 #include <edacious/core/schem_library.h>
 #include <edacious/core/package_library.h>
@@ -63,6 +73,7 @@ void	ES_SetObjectCloseHandler(void (*fn)(void *));
 
 int	ES_LoadModule(const char *);
 int	ES_UnloadModule(const char *);
+AG_ObjectClass *ES_LoadClass(const char *);
 
 /* For GUI */
 void       ES_InitMenuMDI(void);
@@ -0,0 +1,558 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Corner (worst-case) analysis. Every component specification (ES_Spec)
+ * is set to its min, typ or max value and a transient analysis is performed
+ * for each resulting corner. The envelope of the probed quantities over all
+ * corners is recorded on a uniform time grid.
+ *
+ * The reference circuit is serialized to memory once, and every worker
+ * thread instantiates its own copy from that image. Corners are then run
+ * on independent simulation objects.
+ */
+
+#include "core.h"
+
+#include <agar/config/ag_threads.h>
+
+/* Upper bound on the number of specifications in a full factorial design. */
+#define ES_CORNER_FULL_MAX	16
+
+ES_CornerAnalysis *
+ES_CornerNew(ES_Circuit *ckt)
+{
+	ES_CornerAnalysis *ca;
+
+	ca = Malloc(sizeof(ES_CornerAnalysis));
+	ca->ckt = ckt;
+	ca->design = ES_CORNER_FULL;
+	ca->tStop = 1.0;
+	ca->nPoints = 101;
+	ca->nThreads = 1;
+	ca->params = NULL;
+	ca->nParams = 0;
+	ca->levels = NULL;
+	ca->status = NULL;
+	ca->errors = NULL;
+	ca->nCorners = 0;
+	ca->nFailed = 0;
+	ca->probes = NULL;
+	ca->nProbes = 0;
+	ca->image = NULL;
+	ca->imageSize = 0;
+	ca->nextCorner = 0;
+	AG_MutexInit(&ca->lock);
+	return (ca);
+}
+
+static void
+FreeErrors(ES_CornerAnalysis *ca)
+{
+	Uint c;
+
+	if (ca->errors == NULL) {
+		return;
+	}
+	for (c = 0; c < ca->nCorners; c++) {
+		Free(ca->errors[c]);
+	}
+	free(ca->errors);
+	ca->errors = NULL;
+}
+
+void
+ES_CornerFree(ES_CornerAnalysis *ca)
+{
+	Uint i;
+
+	FreeErrors(ca);
+	for (i = 0; i < ca->nProbes; i++) {
+		Free(ca->probes[i].min);
+		Free(ca->probes[i].max);
+	}
+	Free(ca->probes);
+	Free(ca->params);
+	Free(ca->levels);
+	Free(ca->status);
+	Free(ca->image);
+	AG_MutexDestroy(&ca->lock);
+	free(ca);
+}
+
+/* Register a quantity to probe (see ES_ParseProbe()). */
+int
+ES_CornerAddProbe(ES_CornerAnalysis *ca, const char *name)
+{
+	ES_CornerProbe *cp;
+	ES_Probe probe;
+
+	if (ES_ParseProbe(ca->ckt, name, &probe) == -1) {
+		return (-1);
+	}
+	ca->probes = Realloc(ca->probes, (ca->nProbes+1) *
+	                                 sizeof(ES_CornerProbe));
+	cp = &ca->probes[ca->nProbes++];
+	Strlcpy(cp->name, name, sizeof(cp->name));
+	cp->probe = probe;
+	cp->min = NULL;
+	cp->max = NULL;
+	return (0);
+}
+
+static __inline__ M_Real
+SpecValue(const ES_Spec *spec, enum es_corner_level level)
+{
+	switch (level) {
+	case ES_CORNER_MIN:
+		return (spec->min);
+	case ES_CORNER_MAX:
+		return (spec->max);
+	default:
+		return (spec->typ);
+	}
+}
+
+/* Return the value of parameter p in corner c. */
+M_Real
+ES_CornerValue(const ES_CornerAnalysis *ca, Uint c, Uint p)
+{
+	return SpecValue(ca->params[p].spec, ES_CORNER_LEVEL(ca,c,p));
+}
+
+/*
+ * Check the test conditions of every specification in a given corner.
+ * Conditions refer to other specifications of the same component; if the
+ * named specification is not varied, the component's current value of
+ * that parameter is used instead.
+ */
+static int
+CornerIsValid(ES_CornerAnalysis *ca, Uint c)
+{
+	ES_SpecCondition *cond;
+	Uint p, q;
+
+	for (p = 0; p < ca->nParams; p++) {
+		ES_CornerParam *cp = &ca->params[p];
+
+		SLIST_FOREACH(cond, &cp->spec->conds, conds) {
+			M_Real v;
+
+			for (q = 0; q < ca->nParams; q++) {
+				if (strcmp(ca->params[q].comName,
+				    cp->comName) == 0 &&
+				    strcmp(ca->params[q].spec->name,
+				    cond->name) == 0)
+					break;
+			}
+			if (q < ca->nParams) {
+				v = ES_CornerValue(ca, c, q);
+			} else {
+				ES_Component *com;
+
+				com = AG_ObjectFindChild(ca->ckt, cp->comName);
+				if (com == NULL ||
+				    !AG_Defined(com, cond->name)) {
+					continue;
+				}
+				v = M_GetReal(com, cond->name);
+			}
+			if (v < cond->min || v > cond->max)
+				return (0);
+		}
+	}
+	return (1);
+}
+
+/* Append a corner with every parameter at the given level. */
+static Uint8 *
+AddCorner(ES_CornerAnalysis *ca, enum es_corner_level level)
+{
+	Uint8 *lv;
+	Uint p;
+
+	ca->levels = Realloc(ca->levels, (ca->nCorners+1)*ca->nParams + 1);
+	lv = &ca->levels[ca->nCorners*ca->nParams];
+	for (p = 0; p < ca->nParams; p++) {
+		lv[p] = (Uint8)level;
+	}
+	ca->nCorners++;
+	return (lv);
+}
+
+/* Enumerate the corners to simulate. Corner 0 is always the typical case. */
+static int
+EnumerateCorners(ES_CornerAnalysis *ca)
+{
+	Uint c, p, nValid;
+
+	FreeErrors(ca);
+	Free(ca->levels);
+	ca->levels = NULL;
+	ca->nCorners = 0;
+
+	AddCorner(ca, ES_CORNER_TYP);
+
+	switch (ca->design) {
+	case ES_CORNER_FULL:
+		if (ca->nParams > ES_CORNER_FULL_MAX) {
+			AG_SetError(_("Too many specifications (%u) for a "
+			              "full factorial design (max %u)"),
+				      ca->nParams, ES_CORNER_FULL_MAX);
+			return (-1);
+		}
+		for (c = 0; c < (1U << ca->nParams) && ca->nParams > 0; c++) {
+			Uint8 *lv = AddCorner(ca, ES_CORNER_MIN);
+
+			for (p = 0; p < ca->nParams; p++) {
+				if (c & (1U << p))
+					lv[p] = ES_CORNER_MAX;
+			}
+		}
+		break;
+	case ES_CORNER_PRUNED:
+		for (p = 0; p < ca->nParams; p++) {
+			AddCorner(ca, ES_CORNER_TYP)[p] = ES_CORNER_MIN;
+			AddCorner(ca, ES_CORNER_TYP)[p] = ES_CORNER_MAX;
+		}
+		if (ca->nParams > 1) {
+			AddCorner(ca, ES_CORNER_MIN);
+			AddCorner(ca, ES_CORNER_MAX);
+		}
+		break;
+	}
+
+	/* Discard the corners which violate the specification conditions. */
+	for (c = 0, nValid = 0; c < ca->nCorners; c++) {
+		if (!CornerIsValid(ca, c)) {
+			continue;
+		}
+		if (c != nValid) {
+			memcpy(&ca->levels[nValid*ca->nParams],
+			       &ca->levels[c*ca->nParams], ca->nParams);
+		}
+		nValid++;
+	}
+	ca->nCorners = nValid;
+	return (0);
+}
+
+/*
+ * Collect the component specifications, enumerate the corners and take
+ * a snapshot of the reference circuit.
+ */
+int
+ES_CornerSetup(ES_CornerAnalysis *ca, enum es_corner_design design)
+{
+	ES_Circuit *ckt = ca->ckt;
+	ES_Component *com;
+	AG_DataSource *ds;
+	Uint i;
+
+	ca->design = design;
+
+	Free(ca->params);
+	ca->params = NULL;
+	ca->nParams = 0;
+	CIRCUIT_FOREACH_COMPONENT(com, ckt) {
+		for (i = 0; i < com->nspecs; i++) {
+			ES_Spec *spec = &com->specs[i];
+			ES_CornerParam *cp;
+
+			if (!AG_Defined(com, spec->name)) {
+				AG_SetError(_("%s: No such parameter: <%s>"),
+				    OBJECT(com)->name, spec->name);
+				return (-1);
+			}
+			ca->params = Realloc(ca->params, (ca->nParams+1) *
+			                                 sizeof(ES_CornerParam));
+			cp = &ca->params[ca->nParams++];
+			Strlcpy(cp->comName, OBJECT(com)->name,
+			    sizeof(cp->comName));
+			cp->spec = spec;
+		}
+	}
+	if (EnumerateCorners(ca) == -1)
+		return (-1);
+
+	/* Serialize the circuit once; workers instantiate from the image. */
+	if ((ds = AG_OpenAutoCore()) == NULL) {
+		return (-1);
+	}
+	if (AG_ObjectSerialize(ckt, ds) == -1) {
+		AG_CloseDataSource(ds);
+		return (-1);
+	}
+	Free(ca->image);
+	ca->imageSize = AG_CORE_SOURCE(ds)->size;
+	ca->image = Malloc(ca->imageSize);
+	memcpy(ca->image, AG_CORE_SOURCE(ds)->data, ca->imageSize);
+	AG_CloseDataSource(ds);
+	return (0);
+}
+
+/* Instantiate a private copy of the reference circuit. */
+static ES_Circuit *
+CloneCircuit(ES_CornerAnalysis *ca)
+{
+	ES_Circuit *ckt;
+	AG_DataSource *ds;
+
+	if ((ds = AG_OpenConstCore(ca->image, ca->imageSize)) == NULL) {
+		return (NULL);
+	}
+	ckt = AG_ObjectNew(NULL, OBJECT(ca->ckt)->name, &esCircuitClass);
+	ckt->flags |= ES_CIRCUIT_HEADLESS;
+	if (AG_ObjectUnserialize(ckt, ds) == -1) {
+		AG_CloseDataSource(ds);
+		AG_ObjectDestroy(ckt);
+		return (NULL);
+	}
+	AG_CloseDataSource(ds);
+	return (ckt);
+}
+
+/*
+ * Simulate corner c on the given circuit instance, writing the probed
+ * values interpolated on the output grid into samples[].
+ */
+static int
+RunCorner(ES_CornerAnalysis *ca, ES_Circuit *ckt, Uint c, M_Real *samples,
+    M_Real *vPrev, M_Real *vCur)
+{
+	const Uint nPoints = ca->nPoints;
+	ES_SimDC *sim;
+	M_Real tPrev, t, tGrid;
+	Uint k, p, iPoint;
+
+	for (p = 0; p < ca->nParams; p++) {
+		ES_CornerParam *cp = &ca->params[p];
+		ES_Component *com;
+
+		if ((com = AG_ObjectFindChild(ckt, cp->comName)) == NULL) {
+			AG_SetError(_("%s: No such component"), cp->comName);
+			return (-1);
+		}
+		M_SetReal(com, cp->spec->name, ES_CornerValue(ca, c, p));
+	}
+
+	sim = (ES_SimDC *)ES_CreateSimulation(ckt, &esSimDcOps);
+	sim->flags |= ES_SIMDC_HEADLESS;
+	if (ES_SimDCBegin(sim) == -1)
+		goto fail;
+
+	for (k = 0; k < ca->nProbes; k++) {
+		vPrev[k] = ES_ProbeValue(ckt, &ca->probes[k].probe);
+		samples[k*nPoints] = vPrev[k];
+	}
+	tPrev = 0.0;
+	for (iPoint = 1; iPoint < nPoints; ) {
+		if (ES_SimDCStep(sim) == -1) {
+			goto fail;
+		}
+		t = sim->Telapsed;
+		for (k = 0; k < ca->nProbes; k++) {
+			vCur[k] = ES_ProbeValue(ckt, &ca->probes[k].probe);
+		}
+		for (;
+		     iPoint < nPoints &&
+		     (tGrid = ca->tStop*iPoint/(nPoints-1)) <= t;
+		     iPoint++) {
+			M_Real a = (t > tPrev) ? (tGrid - tPrev)/(t - tPrev) :
+			                         1.0;
+
+			for (k = 0; k < ca->nProbes; k++) {
+				samples[k*nPoints + iPoint] = vPrev[k] +
+				    a*(vCur[k] - vPrev[k]);
+			}
+		}
+		for (k = 0; k < ca->nProbes; k++) {
+			vPrev[k] = vCur[k];
+		}
+		tPrev = t;
+	}
+	ES_DestroySimulation(ckt);
+	return (0);
+fail:
+	ES_DestroySimulation(ckt);
+	return (-1);
+}
+
+/* Merge the results of corner c into the envelope. */
+static void
+MergeCorner(ES_CornerAnalysis *ca, Uint c, const M_Real *samples)
+{
+	const Uint nPoints = ca->nPoints;
+	Uint k, i;
+
+	for (k = 0; k < ca->nProbes; k++) {
+		ES_CornerProbe *cp = &ca->probes[k];
+		const M_Real *v = &samples[k*nPoints];
+
+		for (i = 0; i < nPoints; i++) {
+			if (v[i] < cp->min[i]) { cp->min[i] = v[i]; }
+			if (v[i] > cp->max[i]) { cp->max[i] = v[i]; }
+
+			/* Ties go to the lowest corner for reproducibility. */
+			if (v[i] < cp->worstMin ||
+			   (v[i] == cp->worstMin && c < cp->cornerMin)) {
+				cp->worstMin = v[i];
+				cp->cornerMin = c;
+			}
+			if (v[i] > cp->worstMax ||
+			   (v[i] == cp->worstMax && c < cp->cornerMax)) {
+				cp->worstMax = v[i];
+				cp->cornerMax = c;
+			}
+		}
+	}
+}
+
+/*
+ * Worker: simulate corners until there are none left. Every corner is run
+ * on a fresh copy of the reference circuit, so that no state left over by
+ * a previous corner (model cards, solver state, component variables) can
+ * affect it, regardless of how corners are distributed among threads.
+ */
+static void *
+CornerWorker(void *arg)
+{
+	ES_CornerAnalysis *ca = arg;
+	ES_Circuit *ckt;
+	M_Real *samples, *vPrev, *vCur;
+	Uint c;
+
+	samples = Malloc((ca->nProbes*ca->nPoints + 1)*sizeof(M_Real));
+	vPrev = Malloc((ca->nProbes + 1)*sizeof(M_Real));
+	vCur = Malloc((ca->nProbes + 1)*sizeof(M_Real));
+
+	for (;;) {
+		int rv = -1;
+
+		AG_MutexLock(&ca->lock);
+		c = ca->nextCorner++;
+		AG_MutexUnlock(&ca->lock);
+		if (c >= ca->nCorners)
+			break;
+
+		if ((ckt = CloneCircuit(ca)) != NULL) {
+			rv = RunCorner(ca, ckt, c, samples, vPrev, vCur);
+			AG_ObjectDestroy(ckt);
+		}
+		AG_MutexLock(&ca->lock);
+		ca->status[c] = rv;
+		if (rv == 0) {
+			MergeCorner(ca, c, samples);
+		} else {
+			ca->errors[c] = Strdup(AG_GetError());
+			ca->nFailed++;
+		}
+		AG_MutexUnlock(&ca->lock);
+	}
+
+	free(vCur);
+	free(vPrev);
+	free(samples);
+	return (NULL);
+}
+
+/*
+ * Simulate every corner and compute the envelope of the probed quantities.
+ * Returns -1 if the analysis could not be performed at all; individual
+ * corners which fail to converge are reported in status[], errors[] and
+ * nFailed, and the error of the first failed corner is set.
+ */
+int
+ES_CornerRun(ES_CornerAnalysis *ca)
+{
+	Uint i, k;
+
+	if (ca->image == NULL) {
+		AG_SetError(_("Corner analysis is not set up"));
+		return (-1);
+	}
+	if (ca->nPoints < 2 || ca->tStop <= 0.0) {
+		AG_SetError(_("Bad output grid"));
+		return (-1);
+	}
+	for (k = 0; k < ca->nProbes; k++) {
+		ES_CornerProbe *cp = &ca->probes[k];
+
+		cp->min = Realloc(cp->min, ca->nPoints*sizeof(M_Real));
+		cp->max = Realloc(cp->max, ca->nPoints*sizeof(M_Real));
+		for (i = 0; i < ca->nPoints; i++) {
+			cp->min[i] = HUGE_VAL;
+			cp->max[i] = -HUGE_VAL;
+		}
+		cp->worstMin = HUGE_VAL;
+		cp->worstMax = -HUGE_VAL;
+		cp->cornerMin = 0;
+		cp->cornerMax = 0;
+	}
+	FreeErrors(ca);
+	ca->status = Realloc(ca->status, (ca->nCorners+1)*sizeof(int));
+	ca->errors = Malloc((ca->nCorners+1)*sizeof(char *));
+	for (i = 0; i < ca->nCorners; i++) {
+		ca->errors[i] = NULL;
+	}
+	ca->nFailed = 0;
+	ca->nextCorner = 0;
+
+#ifdef AG_THREADS
+	if (ca->nThreads > 1 && ca->nCorners > 1) {
+		Uint nThreads = MIN(ca->nThreads, ca->nCorners);
+		AG_Thread *th;
+
+		th = Malloc(nThreads*sizeof(AG_Thread));
+		for (i = 0; i < nThreads; i++) {
+			AG_ThreadCreate(&th[i], CornerWorker, ca);
+		}
+		for (i = 0; i < nThreads; i++) {
+			AG_ThreadJoin(th[i], NULL);
+		}
+		free(th);
+	} else
+#endif
+	{
+		CornerWorker(ca);
+	}
+	for (i = 0; i < ca->nCorners; i++) {
+		if (ca->status[i] != 0) {
+			AG_SetError(_("Corner %u: %s"), i, ca->errors[i]);
+			break;
+		}
+	}
+	return (0);
+}
+
+/* Return the error which caused corner c to fail (or NULL). */
+const char *
+ES_CornerError(const ES_CornerAnalysis *ca, Uint c)
+{
+	if (ca->errors == NULL || c >= ca->nCorners) {
+		return (NULL);
+	}
+	return (ca->errors[c]);
+}
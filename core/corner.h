@@ -0,0 +1,66 @@
+/*	Public domain	*/
+
+/* Selection of corners from the min/typ/max specifications. */
+enum es_corner_design {
+	ES_CORNER_FULL,		/* Full factorial over {min,max}, plus typ */
+	ES_CORNER_PRUNED	/* One specification at a time at min/max */
+};
+
+/* Level of a specification in a given corner. */
+enum es_corner_level {
+	ES_CORNER_MIN,
+	ES_CORNER_TYP,
+	ES_CORNER_MAX
+};
+
+/* Component specification being varied. */
+typedef struct es_corner_param {
+	char comName[AG_OBJECT_NAME_MAX];	/* Component name */
+	ES_Spec *spec;				/* Specification */
+} ES_CornerParam;
+
+/* Worst-case envelope of a probed quantity. */
+typedef struct es_corner_probe {
+	char name[ESCIRCUIT_SYM_MAX+1];		/* "v<node>" or "i<vsource>" */
+	ES_Probe probe;				/* Probed quantity */
+	M_Real *min, *max;			/* Envelope at each point */
+	M_Real worstMin, worstMax;		/* Worst-case extrema */
+	Uint cornerMin, cornerMax;		/* Corners of the extrema */
+} ES_CornerProbe;
+
+/* Corner (worst-case) analysis over a circuit. */
+typedef struct es_corner_analysis {
+	ES_Circuit *ckt;		/* Reference circuit */
+	enum es_corner_design design;
+	M_Real tStop;			/* Simulated time per corner (s) */
+	Uint nPoints;			/* Number of output points */
+	Uint nThreads;			/* Number of worker threads */
+
+	ES_CornerParam *params;		/* Specifications being varied */
+	Uint           nParams;
+	Uint8 *levels;			/* Levels (nCorners x nParams) */
+	int   *status;			/* Per-corner result (0 or -1) */
+	char **errors;			/* Per-corner error (or NULL) */
+	Uint  nCorners;
+	Uint  nFailed;			/* Corners which failed to converge */
+
+	ES_CornerProbe *probes;		/* Probed quantities */
+	Uint           nProbes;
+
+	Uint8 *image;			/* Serialized reference circuit */
+	size_t imageSize;
+	Uint nextCorner;		/* Next corner to simulate */
+	AG_Mutex lock;
+} ES_CornerAnalysis;
+
+#define ES_CORNER_LEVEL(ca,c,p) ((ca)->levels[(c)*(ca)->nParams + (p)])
+
+__BEGIN_DECLS
+ES_CornerAnalysis *ES_CornerNew(ES_Circuit *);
+void               ES_CornerFree(ES_CornerAnalysis *);
+int                ES_CornerAddProbe(ES_CornerAnalysis *, const char *);
+int                ES_CornerSetup(ES_CornerAnalysis *, enum es_corner_design);
+int                ES_CornerRun(ES_CornerAnalysis *);
+M_Real             ES_CornerValue(const ES_CornerAnalysis *, Uint, Uint);
+const char        *ES_CornerError(const ES_CornerAnalysis *, Uint);
+__END_DECLS
@@ -36,6 +36,7 @@
 
 #include "core.h"
 #include <unistd.h>
+#include <stdlib.h>
 #include <agar/math/m_matview.h>
 
 /*
@@ -47,6 +48,25 @@
 #define MAX_V_DIFF	1e-6	/* 1 uV */
 #define MAX_I_DIFF	1e-9	/* 1 pA */
 
+/*
+ * In chord Newton mode, the LU factors are reused as long as the residual
+ * shrinks by at least this factor from one iteration to the next.
+ */
+#define CHORD_MAX_RATE	0.5
+
+/*
+ * Linear circuits whose matrix differs from the factored one in at most
+ * UPDATE_MAX_RANK columns are solved by a low-rank update of the LU
+ * factors. A rank-k update costs k extra triangular solves plus k^2 n for
+ * the capacitance matrix, which is cheaper than refactoring for k under
+ * about n/2; systems under UPDATE_MIN_SIZE unknowns are always refactored.
+ * The update is abandoned for a full factorization if the capacitance
+ * matrix has a pivot under UPDATE_MIN_PIVOT (relative).
+ */
+#define UPDATE_MAX_RANK		8
+#define UPDATE_MIN_SIZE		4
+#define UPDATE_MIN_PIVOT	1e-10
+
 /*
  * A relative LTE over MAX_REL_LTE will cause the step to
  * be rejected, and a LTE under MIN_REL_LTE will cause the
@@ -62,16 +82,488 @@
 
 /* #define DC_DEBUG */
 
-/* Solve the system of equations. */
+static int
+ComparePattern(const void *p1, const void *p2)
+{
+	const ES_MatrixEntry *e1 = p1, *e2 = p2;
+
+	if (e1->row != e2->row) {
+		return (e1->row < e2->row ? -1 : 1);
+	}
+	if (e1->col != e2->col) {
+		return (e1->col < e2->col ? -1 : 1);
+	}
+	return (0);
+}
+
+/*
+ * Return a pointer to an element of A for stamping, and record it in the
+ * pattern of A used by the sparse factorization.
+ */
+M_Real *
+ES_SimDCGetElement(ES_SimDC *sim, Uint k, Uint l)
+{
+	ES_MatrixEntry ent;
+
+	ent.row = k;
+	ent.col = l;
+	if (!sim->patternSorted ||
+	    bsearch(&ent, sim->pattern, sim->nPattern, sizeof(ES_MatrixEntry),
+	    ComparePattern) == NULL) {
+		if (sim->nPattern+1 > sim->maxPattern) {
+			sim->maxPattern = (sim->maxPattern > 0) ?
+			                  sim->maxPattern*2 : 64;
+			sim->pattern = Realloc(sim->pattern,
+			    sim->maxPattern*sizeof(ES_MatrixEntry));
+		}
+		sim->pattern[sim->nPattern++] = ent;
+		sim->patternSorted = 0;
+		sim->patternAnalyzed = 0;
+	}
+	return (M_GetElement(sim->A, k, l));
+}
+
+/* Sort the pattern of A and remove duplicate entries. */
+static void
+SortPattern(ES_SimDC *sim)
+{
+	Uint i, k;
+
+	qsort(sim->pattern, sim->nPattern, sizeof(ES_MatrixEntry),
+	    ComparePattern);
+	for (i = 1, k = (sim->nPattern > 0); i < sim->nPattern; i++) {
+		if (ComparePattern(&sim->pattern[i], &sim->pattern[k-1]) != 0)
+			sim->pattern[k++] = sim->pattern[i];
+	}
+	sim->nPattern = k;
+	sim->patternSorted = 1;
+}
+
+/* Sort the pattern of A and analyze it for the sparse factorization. */
+static int
+AnalyzePattern(ES_SimDC *sim, Uint n)
+{
+	if (!sim->patternSorted) {
+		SortPattern(sim);
+	}
+	sim->patternAnalyzed = 1;
+	return ES_SparseLUAnalyze(&sim->slu, sim->A, n, sim->pattern,
+	    sim->nPattern);
+}
+
+/*
+ * Save the values of A over its (sorted) pattern as factored by the sparse
+ * LU. Entries outside of the pattern are never stamped, so this is enough
+ * to detect changes to A in SolveLTI().
+ */
+static void
+SaveFactoredPattern(ES_SimDC *sim)
+{
+	Uint p;
+
+	sim->AfactVals = Realloc(sim->AfactVals,
+	    (sim->nPattern > 0 ? sim->nPattern : 1)*sizeof(M_Real));
+	for (p = 0; p < sim->nPattern; p++) {
+		sim->AfactVals[p] = *M_GetElement(sim->A, sim->pattern[p].row,
+		    sim->pattern[p].col);
+	}
+}
+
+/*
+ * Solve the system of equations. Systems of up to ES_DENSE_LU_MAX unknowns
+ * are factored by the blocked dense LU, larger ones by the sparse LU (both
+ * always keep the factors). If the sparse LU fails (its pivot order is
+ * static), or otherwise in chord Newton mode and for linear circuits, A
+ * is factored into a copy so that the factors may be reused.
+ */
 static int
 SolveMNA(ES_SimDC *sim, ES_Circuit *ckt)
 {
+	M_Matrix *F = sim->A;
+	Uint i, j, n = ckt->n + ckt->m;
+
 	*sim->groundNode = 1.0;
-	if (M_FactorizeLU(sim->A) == -1) {
-		return (-1);
+	sim->luValid = 0;
+	sim->nUpdCols = 0;
+	if (sim->sparse) {
+		ES_SparseLUSetThreads(&sim->slu, sim->nThreads);
+		if ((!sim->patternAnalyzed && AnalyzePattern(sim, n) == -1) ||
+		    ES_SparseLUFactor(&sim->slu) == -1) {
+			Verbose("%s; using the generic LU\n", AG_GetError());
+			sim->sparse = 0;
+			M_Resize(sim->LU, n, n);
+			M_Resize(sim->Afact, n, n);
+		} else {
+			sim->luValid = 1;
+		}
 	}
+	if (sim->isLTI) {
+		if (sim->sparse) {
+			SaveFactoredPattern(sim);
+		} else {
+			for (i = 0; i < n; i++) {
+				for (j = 0; j < n; j++)
+					*M_GetElement(sim->Afact, i, j) =
+					    *M_GetElement(sim->A, i, j);
+			}
+		}
+	}
+	if (sim->dense) {
+		ES_DenseLULoad(&sim->dlu, sim->A);
+		if (ES_DenseLUFactor(&sim->dlu) == -1) {
+			return (-1);
+		}
+		sim->luValid = 1;
+	} else if (!sim->sparse) {
+		if ((sim->flags & ES_SIMDC_CHORD) || sim->isLTI) {
+			for (i = 0; i < n; i++) {
+				for (j = 0; j < n; j++)
+					*M_GetElement(sim->LU, i, j) =
+					    *M_GetElement(sim->A, i, j);
+			}
+			F = sim->LU;
+		}
+		if (M_FactorizeLU(F) == -1) {
+			return (-1);
+		}
+		sim->luValid = (F == sim->LU);
+	}
+	sim->factorsTotal++;
 	M_VecCopy(sim->x, sim->z);
-	M_BacksubstLU(sim->A, sim->x); 
+	if (sim->dense) {
+		ES_DenseLUSolve(&sim->dlu, sim->x);
+	} else if (sim->sparse) {
+		ES_SparseLUSolve(&sim->slu, sim->x);
+	} else {
+		M_BacksubstLU(F, sim->x);
+	}
+	return (0);
+}
+
+/* Solve in place with the saved factors of A. */
+static void
+BacksubstLU(ES_SimDC *sim, M_Vector *v)
+{
+	if (sim->dense) {
+		ES_DenseLUSolve(&sim->dlu, v);
+	} else if (sim->sparse) {
+		ES_SparseLUSolve(&sim->slu, v);
+	} else {
+		M_BacksubstLU(sim->LU, v);
+	}
+}
+
+/*
+ * Compute W = LU^-1 U and factor the k x k capacitance matrix
+ * S = I + W[C,:] (Gaussian elimination with partial pivoting), where C
+ * are the updated columns. Return -1 if S is nearly singular.
+ */
+static int
+FactorUpdate(ES_SimDC *sim, Uint n)
+{
+	Uint k = sim->nUpdCols, i, j, l, p;
+	M_Real *W = sim->updW, *S = sim->updS, sMax = 0.0, t;
+
+	for (j = 0; j < k; j++) {
+		for (i = 0; i < n; i++) {
+			*M_VecGetElement(sim->r, i) = sim->updU[j*n + i];
+		}
+		BacksubstLU(sim, sim->r);
+		for (i = 0; i < n; i++)
+			W[j*n + i] = M_VecGet(sim->r, i);
+	}
+	for (i = 0; i < k; i++) {
+		for (j = 0; j < k; j++) {
+			S[i*k + j] = W[j*n + sim->updCols[i]];
+			if (i == j) {
+				S[i*k + j] += 1.0;
+			}
+			if (Fabs(S[i*k + j]) > sMax)
+				sMax = Fabs(S[i*k + j]);
+		}
+	}
+	for (l = 0; l < k; l++) {
+		for (p = l, i = l+1; i < k; i++) {
+			if (Fabs(S[i*k + l]) > Fabs(S[p*k + l]))
+				p = i;
+		}
+		if (Fabs(S[p*k + l]) <= UPDATE_MIN_PIVOT*sMax) {
+			return (-1);
+		}
+		sim->updPiv[l] = p;
+		if (p != l) {
+			for (j = 0; j < k; j++) {
+				t = S[l*k + j];
+				S[l*k + j] = S[p*k + j];
+				S[p*k + j] = t;
+			}
+		}
+		for (i = l+1; i < k; i++) {
+			S[i*k + l] /= S[l*k + l];
+			for (j = l+1; j < k; j++)
+				S[i*k + j] -= S[i*k + l]*S[l*k + j];
+		}
+	}
+	return (0);
+}
+
+/*
+ * Solve with the low-rank update (Sherman-Morrison-Woodbury): if
+ * A = Afact + U E' where E selects the columns C, then x = y - W s
+ * with y = LU^-1 z and S s = y[C].
+ */
+static void
+SolveUpdate(ES_SimDC *sim, Uint n)
+{
+	Uint k = sim->nUpdCols, i, j, l;
+	M_Real s[UPDATE_MAX_RANK], t, *S = sim->updS;
+
+	M_VecCopy(sim->x, sim->z);
+	BacksubstLU(sim, sim->x);
+
+	for (l = 0; l < k; l++) {
+		s[l] = M_VecGet(sim->x, sim->updCols[l]);
+	}
+	for (l = 0; l < k; l++) {
+		if (sim->updPiv[l] != l) {
+			t = s[l];
+			s[l] = s[sim->updPiv[l]];
+			s[sim->updPiv[l]] = t;
+		}
+		for (i = 0; i < l; i++)
+			s[l] -= S[l*k + i]*s[i];
+	}
+	for (l = k; l-- > 0; ) {
+		for (i = l+1; i < k; i++) {
+			s[l] -= S[l*k + i]*s[i];
+		}
+		s[l] /= S[l*k + l];
+	}
+	for (j = 0; j < k; j++) {
+		for (i = 0; i < n; i++)
+			*M_VecGetElement(sim->x, i) -= sim->updW[j*n + i]*s[j];
+	}
+}
+
+/* Return 1 if a rank-k update of an n-by-n system beats refactoring. */
+static __inline__ int
+UpdateCheaper(Uint k, Uint n)
+{
+	return (k <= UPDATE_MAX_RANK && n >= UPDATE_MIN_SIZE && 2*k < n);
+}
+
+/*
+ * Find the columns where A differs from the matrix last factored, in
+ * increasing order. Return -1 if there are too many for a low-rank update.
+ */
+static int
+ChangedColumns(ES_SimDC *sim, Uint n, Uint *cols)
+{
+	Uint i, j, k = 0;
+
+	for (j = 0; j < n; j++) {
+		for (i = 0; i < n; i++) {
+			if (*M_GetElement(sim->A, i, j) !=
+			    *M_GetElement(sim->Afact, i, j))
+				break;
+		}
+		if (i < n) {
+			if (!UpdateCheaper(k+1, n)) {
+				return (-1);
+			}
+			cols[k++] = j;
+		}
+	}
+	return ((int)k);
+}
+
+/* Same as ChangedColumns(), comparing only the entries in the pattern. */
+static int
+ChangedColumnsSparse(ES_SimDC *sim, Uint n, Uint *cols)
+{
+	const ES_MatrixEntry *ent;
+	Uint p, l, j, k = 0;
+
+	for (p = 0; p < sim->nPattern; p++) {
+		ent = &sim->pattern[p];
+		if (*M_GetElement(sim->A, ent->row, ent->col) ==
+		    sim->AfactVals[p]) {
+			continue;
+		}
+		for (l = 0; l < k && cols[l] < ent->col; l++)
+			;;
+		if (l < k && cols[l] == ent->col) {
+			continue;
+		}
+		if (!UpdateCheaper(k+1, n)) {
+			return (-1);
+		}
+		for (j = k++; j > l; j--) {
+			cols[j] = cols[j-1];
+		}
+		cols[l] = ent->col;
+	}
+	return ((int)k);
+}
+
+/*
+ * Load U = A - Afact over the updated columns. Return 1 if U is unchanged
+ * from the last update (in which case it is still factored).
+ */
+static int
+LoadUpdate(ES_SimDC *sim, Uint n, int cached)
+{
+	Uint i, j, l, k = sim->nUpdCols;
+
+	for (l = 0; l < k; l++) {
+		j = sim->updCols[l];
+		for (i = 0; i < n; i++) {
+			M_Real d = *M_GetElement(sim->A, i, j) -
+			           *M_GetElement(sim->Afact, i, j);
+
+			if (cached && sim->updU[l*n + i] != d) {
+				cached = 0;
+			}
+			sim->updU[l*n + i] = d;
+		}
+	}
+	return (cached);
+}
+
+/*
+ * Same as LoadUpdate(), over the pattern. Entries outside of it are zero,
+ * and remain so from the last update if the columns are the same.
+ */
+static int
+LoadUpdateSparse(ES_SimDC *sim, Uint n, int cached)
+{
+	const ES_MatrixEntry *ent;
+	Uint i, l, p, k = sim->nUpdCols;
+
+	if (!cached) {
+		for (i = 0; i < k*n; i++)
+			sim->updU[i] = 0.0;
+	}
+	for (p = 0; p < sim->nPattern; p++) {
+		M_Real d;
+
+		ent = &sim->pattern[p];
+		for (l = 0; l < k && sim->updCols[l] != ent->col; l++)
+			;;
+		if (l == k) {
+			continue;
+		}
+		d = *M_GetElement(sim->A, ent->row, ent->col) -
+		    sim->AfactVals[p];
+		if (cached && sim->updU[l*n + ent->row] != d) {
+			cached = 0;
+		}
+		sim->updU[l*n + ent->row] = d;
+	}
+	return (cached);
+}
+
+/*
+ * Solve a linear time-invariant circuit. The LU factors are reused as
+ * long as the stamped matrix is identical to the one last factored (i.e.,
+ * same timestep and integration coefficients), in which case the step
+ * only costs the triangular solves. If only a few columns have changed
+ * (e.g., a switch has toggled), the factors are corrected by a low-rank
+ * update instead of refactoring. With the sparse LU, only the entries in
+ * the pattern of A are compared.
+ */
+static int
+SolveLTI(ES_SimDC *sim, ES_Circuit *ckt)
+{
+	Uint l, n = ckt->n + ckt->m;
+	Uint cols[UPDATE_MAX_RANK];
+	int k, cached;
+
+	*sim->groundNode = 1.0;
+	if (!sim->luValid || (sim->sparse && !sim->patternAnalyzed)) {
+		return (SolveMNA(sim, ckt));
+	}
+	k = sim->sparse ? ChangedColumnsSparse(sim, n, cols) :
+	                  ChangedColumns(sim, n, cols);
+	if (k == -1) {
+		return (SolveMNA(sim, ckt));
+	}
+	if (k == 0) {
+		M_VecCopy(sim->x, sim->z);
+		BacksubstLU(sim, sim->x);
+		return (0);
+	}
+
+	/* Reuse the last update if it recurs (e.g., switch still toggled). */
+	cached = ((Uint)k == sim->nUpdCols);
+	for (l = 0; l < (Uint)k; l++) {
+		if (cached && cols[l] != sim->updCols[l]) {
+			cached = 0;
+		}
+		sim->updCols[l] = cols[l];
+	}
+	sim->nUpdCols = (Uint)k;
+	cached = sim->sparse ? LoadUpdateSparse(sim, n, cached) :
+	                       LoadUpdate(sim, n, cached);
+	if (!cached && FactorUpdate(sim, n) == -1) {
+		return (SolveMNA(sim, ckt));
+	}
+	SolveUpdate(sim, n);
+	sim->updatesLowRank++;
+	return (0);
+}
+
+/*
+ * Compute the residual r = z - Ax and return its largest entry. Only the
+ * entries in the pattern of A (which includes the ground node) can be
+ * nonzero, so the product is taken over the pattern.
+ */
+static M_Real
+Residual(ES_SimDC *sim, Uint n)
+{
+	const ES_MatrixEntry *ent;
+	Uint i, p;
+	M_Real r, rMax = 0.0;
+
+	if (!sim->patternSorted) {
+		SortPattern(sim);
+	}
+	*sim->groundNode = 1.0;
+	M_VecCopy(sim->r, sim->z);
+	for (p = 0; p < sim->nPattern; p++) {
+		ent = &sim->pattern[p];
+		*M_VecGetElement(sim->r, ent->row) -=
+		    (*M_GetElement(sim->A, ent->row, ent->col)) *
+		    M_VecGet(sim->x, ent->col);
+	}
+	for (i = 0; i < n; i++) {
+		r = Fabs(M_VecGet(sim->r, i));
+		if (r > rMax)
+			rMax = r;
+	}
+	return (rMax);
+}
+
+/*
+ * Chord step: solve for the update with the saved factors of A. On the
+ * first iteration of a step, the factors are those of an earlier step
+ * (different timestep and operating point), so the update is only kept
+ * if it reduces the residual of the new linearization by CHORD_MAX_RATE.
+ * Otherwise x is restored and -1 is returned.
+ */
+static int
+ChordStep(ES_SimDC *sim, Uint n, M_Real rNorm, int validate)
+{
+	Uint i;
+
+	BacksubstLU(sim, sim->r);
+	for (i = 0; i < n; i++)
+		*M_VecGetElement(sim->x, i) += M_VecGet(sim->r, i);
+
+	if (validate && Residual(sim, n) > CHORD_MAX_RATE*rNorm) {
+		M_VecCopy(sim->x, sim->xPrevIter);
+		return (-1);
+	}
 	return (0);
 }
 
@@ -98,7 +590,8 @@ static int
 NR_Iterations(ES_Circuit *ckt, ES_SimDC *sim)
 {
 	ES_Component *com;
-	Uint i = 0, j;
+	Uint i = 0, j, n;
+	M_Real rNorm, rNormPrev = HUGE_VAL;
 
 	{
 	iter:
@@ -106,6 +599,7 @@ NR_Iterations(ES_Circuit *ckt, ES_SimDC *sim)
 			return -i; 
 
 		sim->isDamped = 0;
+		sim->itersTotal++;
 		M_SetZero(sim->A);
 		M_VecSetZero(sim->z);
 		
@@ -115,16 +609,34 @@ NR_Iterations(ES_Circuit *ckt, ES_SimDC *sim)
 		}
 
 		M_VecCopy(sim->xPrevIter, sim->x);
-		if (SolveMNA(sim, ckt) == -1)
-			return 0;
+		if (sim->flags & ES_SIMDC_CHORD) {
+			/*
+			 * Refactor only if the residual stagnates or grows
+			 * under the old factors.
+			 */
+			n = ckt->n + ckt->m;
+			rNorm = Residual(sim, n);
+			if (sim->luValid && rNorm <= CHORD_MAX_RATE*rNormPrev &&
+			    ChordStep(sim, n, rNorm, (i == 1)) == 0) {
+				sim->itersChord++;
+			} else if (SolveMNA(sim, ckt) == -1) {
+				return 0;
+			}
+			rNormPrev = rNorm;
+		} else {
+			if (SolveMNA(sim, ckt) == -1)
+				return 0;
+		}
 
 		/*
 		 * Decide whether or not to exit the loop, based on
 		 * the difference from previous iteration and the fact
 		 * that the simulation may be damped
 		 */
-		if (sim->isDamped)
+		if (sim->isDamped) {
+			sim->itersLimited++;
 			goto iter;
+		}
 
 		/* check for undefined voltages or current, which are a sign that the timestep is too large */
 		for (j=0; j < (ckt->m+ckt->n); j++)
@@ -158,7 +670,10 @@ NR_Iterations(ES_Circuit *ckt, ES_SimDC *sim)
 	}
 
 	/* Update the statistics. */
-	M_SetReal(ckt, "nrIters", i);
+	sim->itersLast = i;
+	if (!(sim->flags & ES_SIMDC_HEADLESS)) {
+		M_SetReal(ckt, "nrIters", i);
+	}
 	if (i > sim->itersHigh) { sim->itersHigh = i; }
 	if (i < sim->itersLow) { sim->itersLow = i; }
 	
@@ -202,12 +717,14 @@ CyclePreviousSolutions(ES_SimDC *sim)
 	M_VecSetZero(last);
 }
 
-/* Simulation timestep. */
-static Uint32
-StepMNA(AG_Timer *tm, AG_Event *event)
+/*
+ * Advance the simulation by one accepted timestep. This is independent of
+ * the real-time scheduling, and may be used directly by batch analyses.
+ */
+int
+ES_SimDCStep(ES_SimDC *sim)
 {
-	ES_Circuit *ckt = ES_CIRCUIT_SELF();
-	ES_SimDC *sim = AG_PTR(1);
+	ES_Circuit *ckt = SIM(sim)->ckt;
 	ES_Component *com;
 	Uint retries;
 	int i;
@@ -217,8 +734,11 @@ StepMNA(AG_Timer *tm, AG_Event *event)
 	sim->currStep++;
 
 	/* Notify the simulation objects of the beginning timestep. */
-	for (i = 0; i < ckt->nExtObjs; i++)
-		AG_PostEvent(ckt->extObjs[i], "circuit-step-begin", NULL);
+	if (!(sim->flags & ES_SIMDC_HEADLESS)) {
+		for (i = 0; i < ckt->nExtObjs; i++)
+			AG_PostEvent(ckt->extObjs[i], "circuit-step-begin",
+			    NULL);
+	}
 
 stepbegin:
 	sim->inputStep = 0;
@@ -229,9 +749,17 @@ stepbegin:
 			com->dcStepBegin(com, sim);
 	}
 	
+	/* A linear circuit is solved exactly by the step begin stamps. */
+	if (sim->isLTI) {
+		if (SolveLTI(sim, ckt) == -1) {
+			return (-1);
+		}
+		goto stepend;
+	}
+
 	/* DC biasing */
 	if (SolveMNA(sim, ckt) == -1)
-		goto halt;
+		return (-1);
 
 	retries = 0;
 	/* NR control loop : shrink timestep until a stable solution is found. */
@@ -239,7 +767,7 @@ stepbegin:
 		/* NR_Iterations failed to converge : we reduce step size */
 		if (++retries > sim->retriesMax) {
 			AG_SetError(_("Could not find stable solution."));
-			goto halt;
+			return (-1);
 		}
 #ifdef DC_DEBUG
 		Debug(ckt,"NR failed to converge; timestep %g -> %g, "
@@ -259,9 +787,10 @@ stepbegin:
 				com->dcStepBegin(com, sim);
 		}
 		if (SolveMNA(sim, ckt) == -1)
-			goto halt;
+			return (-1);
 	}
 
+stepend:
 	/* Invoke the Component DC specific post-timestep callbacks. */
 	CIRCUIT_FOREACH_COMPONENT(com, ckt) {
 		if (com->dcStepEnd != NULL)
@@ -278,7 +807,8 @@ stepbegin:
 	if (error < 0.0) {
 		error = 0.0;
 	}
-	M_SetReal(ckt, "%err", error*100);
+	if (!(sim->flags & ES_SIMDC_HEADLESS))
+		M_SetReal(ckt, "%err", error*100);
 	
 	/* Do we accept this step ? */
 	if (error > MAX_REL_LTE) {
@@ -293,8 +823,10 @@ stepbegin:
 	}
 	
 	/* Notify the simulation objects of the completed timestep. */
-	for (i = 0; i < ckt->nExtObjs; i++)
-		AG_PostEvent(ckt->extObjs[i], "circuit-step-end", NULL);
+	if (!(sim->flags & ES_SIMDC_HEADLESS)) {
+		for (i = 0; i < ckt->nExtObjs; i++)
+			AG_PostEvent(ckt->extObjs[i], "circuit-step-end", NULL);
+	}
 
 	/* Keep solution */
 	CyclePreviousSolutions(sim);
@@ -309,6 +841,18 @@ stepbegin:
 #endif
 		SetTimestep(sim, sim->deltaT*2.0);
 	}
+	return (0);
+}
+
+/* Simulation timestep (real-time mode). */
+static Uint32
+StepMNA(AG_Timer *tm, AG_Event *event)
+{
+	ES_Circuit *ckt = ES_CIRCUIT_SELF();
+	ES_SimDC *sim = AG_PTR(1);
+
+	if (ES_SimDCStep(sim) == -1)
+		goto halt;
 	
 	/* Schedule next step */
 	if (SIM(sim)->running) {
@@ -328,6 +872,14 @@ ClearStats(ES_SimDC *sim)
 {
 	sim->itersLow = 1000;
 	sim->itersHigh = 0;
+	sim->itersLast = 0;
+	sim->itersTotal = 0;
+	sim->itersLimited = 0;
+	sim->bypassHits = 0;
+	sim->bypassMisses = 0;
+	sim->factorsTotal = 0;
+	sim->itersChord = 0;
+	sim->updatesLowRank = 0;
 	sim->stepLow = HUGE_VAL;
 	sim->stepHigh = 0;
 	sim->Telapsed = 0.0;
@@ -353,12 +905,54 @@ Init(void *p)
 	sim->deltaTPrevSteps = NULL;
 	sim->stepsToKeep = 0;
 	sim->xPrevIter = M_VecNew(0);
+	sim->LU = M_New(0,0);
+	ES_DenseLUInit(&sim->dlu);
+	sim->dense = 0;
+	ES_SparseLUInit(&sim->slu);
+	sim->sparse = 0;
+	sim->nThreads = 1;
+	sim->pattern = NULL;
+	sim->nPattern = 0;
+	sim->maxPattern = 0;
+	sim->patternSorted = 0;
+	sim->patternAnalyzed = 0;
+	sim->r = M_VecNew(0);
+	sim->luValid = 0;
+	sim->Afact = M_New(0,0);
+	sim->AfactVals = NULL;
+	sim->isLTI = 0;
+	sim->updCols = NULL;
+	sim->nUpdCols = 0;
+	sim->updU = NULL;
+	sim->updW = NULL;
+	sim->updS = NULL;
+	sim->updPiv = NULL;
 	sim->groundNode = NULL;
+	sim->groundSink = 0.0;
+	sim->flags = 0;
 
 	AG_InitTimer(&sim->toUpdate, "stepMNA", 0);
 	ClearStats(sim);
 }
 
+static void
+FreePrevSteps(ES_SimDC *sim)
+{
+	int i;
+
+	if (sim->xPrevSteps != NULL) {
+		for (i = 0; i < sim->stepsToKeep; i++) {
+			M_VecFree(sim->xPrevSteps[i]);
+		}
+		free(sim->xPrevSteps);
+		sim->xPrevSteps = NULL;
+	}
+	if (sim->deltaTPrevSteps != NULL) {
+		free(sim->deltaTPrevSteps);
+		sim->deltaTPrevSteps = NULL;
+	}
+}
+
 static void
 InitMatrices(void *p, ES_Circuit *ckt)
 {
@@ -373,13 +967,40 @@ InitMatrices(void *p, ES_Circuit *ckt)
 	M_VecResize(sim->z, n+m);
 	M_VecResize(sim->x, n+m);
 	M_VecResize(sim->xPrevIter, n+m);
+	sim->dense = (n+m <= ES_DENSE_LU_MAX) &&
+	             !(sim->flags & (ES_SIMDC_SPARSE|ES_SIMDC_GENERIC_LU));
+	sim->sparse = !sim->dense && !(sim->flags & ES_SIMDC_GENERIC_LU);
+	if (sim->dense) {
+		ES_DenseLUResize(&sim->dlu, n+m);
+	} else if (!sim->sparse) {
+		M_Resize(sim->LU, n+m, n+m);
+	}
+	M_VecResize(sim->r, n+m);
+	if (sim->sparse) {
+		M_Resize(sim->Afact, 0, 0);	/* Uses AfactVals */
+	} else {
+		M_Resize(sim->Afact, n+m, n+m);
+	}
+	sim->luValid = 0;
+	sim->updCols = Realloc(sim->updCols, UPDATE_MAX_RANK*sizeof(Uint));
+	sim->updPiv = Realloc(sim->updPiv, UPDATE_MAX_RANK*sizeof(Uint));
+	sim->updU = Realloc(sim->updU, (n+m)*UPDATE_MAX_RANK*sizeof(M_Real));
+	sim->updW = Realloc(sim->updW, (n+m)*UPDATE_MAX_RANK*sizeof(M_Real));
+	sim->updS = Realloc(sim->updS,
+	    UPDATE_MAX_RANK*UPDATE_MAX_RANK*sizeof(M_Real));
+	sim->nUpdCols = 0;
 	M_VecSetZero(sim->z);
 	M_VecSetZero(sim->x);
 	M_VecSetZero(sim->xPrevIter);
 
 	sim->groundNode = M_GetElement(sim->A, 0, 0);
+	sim->nPattern = 0;
+	sim->patternSorted = 0;
+	sim->patternAnalyzed = 0;
+	(void)ES_SimDCGetElement(sim, 0, 0);
 
 	/* Get number of steps to keep according to integration method. XXX */
+	FreePrevSteps(sim);
 	sim->stepsToKeep = 4;
 
 	/* Initialise arrays */
@@ -394,10 +1015,13 @@ InitMatrices(void *p, ES_Circuit *ckt)
 	}
 }
 
-static void
-Start(void *p)
+/*
+ * Size the system of equations, invoke the dcSimBegin() callbacks and find
+ * the initial bias point. This does not schedule any real-time updates.
+ */
+int
+ES_SimDCBegin(ES_SimDC *sim)
 {
-	ES_SimDC *sim = p;
 	ES_Circuit *ckt = SIM(sim)->ckt;
 	ES_Component *com;
 
@@ -408,6 +1032,7 @@ Start(void *p)
 
 	/* Set the initial timing parameters and clear the statistics. */
 	ClearStats(sim);
+	sim->currStep = 0;
 	sim->deltaT = ((M_Real) sim->ticksDelay)/1000.0;
 
 	/* Invoke the DC-specific simulation start callback. */
@@ -416,27 +1041,87 @@ Start(void *p)
 			if (com->dcSimBegin(com, sim) == -1) {
 				AG_SetError("%s: %s", OBJECT(com)->name,
 				    AG_GetError());
-				goto halt;
+				return (-1);
 			}
 		}
 	}
 
+	/*
+	 * If no component has stamps which depend on the iterate, the
+	 * circuit is linear and the NR loop can be skipped.
+	 */
+	sim->isLTI = !(sim->flags & ES_SIMDC_NO_LTI);
+	CIRCUIT_FOREACH_COMPONENT(com, ckt) {
+		if (com->dcStepIter != NULL &&
+		    !(com->flags & ES_COMPONENT_LINEAR))
+			sim->isLTI = 0;
+	}
+
 	M_MNAPreorder(sim->A);
 
 	/* Find the initial bias point. */
 	if (SolveMNA(sim, ckt) == -1) {
-		goto halt;
+		return (-1);
 	}
-
 	if (NR_Iterations(ckt,sim) <= 0) {
 		AG_SetError("Failed to find initial bias point.");
-		goto halt;
+		return (-1);
 	}
 
 	/* Keep solution */
 	CyclePreviousSolutions(sim);
 	M_VecCopy(sim->xPrevSteps[0], sim->x);
 	sim->deltaTPrevSteps[0] = sim->deltaT;
+	return (0);
+}
+
+/*
+ * Change the circuit temperature. The dcTempUpdate() callbacks recompute
+ * the temperature-dependent parameters once, so that the NR iterations
+ * only need to stamp them. (dcSimBegin() is expected to leave them up to
+ * date for the temperature in effect when the simulation begins.)
+ */
+void
+ES_SimDCSetTemp(ES_SimDC *sim, M_Real T)
+{
+	ES_Circuit *ckt = SIM(sim)->ckt;
+	ES_Component *com;
+
+	sim->T0 = T;
+	CIRCUIT_FOREACH_COMPONENT(com, ckt) {
+		if (com->dcTempUpdate != NULL)
+			com->dcTempUpdate(com, sim);
+	}
+}
+
+/*
+ * Find the operating point again after a change of temperature or other
+ * parameters. The matrix structure of ES_SimDCBegin() is reused, and the
+ * current solution is used as the initial guess.
+ */
+int
+ES_SimDCSolveOP(ES_SimDC *sim)
+{
+	ES_Circuit *ckt = SIM(sim)->ckt;
+
+	if (NR_Iterations(ckt,sim) <= 0) {
+		AG_SetError("Failed to find bias point at T=%gK.", sim->T0);
+		return (-1);
+	}
+	CyclePreviousSolutions(sim);
+	M_VecCopy(sim->xPrevSteps[0], sim->x);
+	sim->deltaTPrevSteps[0] = sim->deltaT;
+	return (0);
+}
+
+static void
+Start(void *p)
+{
+	ES_SimDC *sim = p;
+	ES_Circuit *ckt = SIM(sim)->ckt;
+
+	if (ES_SimDCBegin(sim) == -1)
+		goto halt;
 	
 	/* Schedule the call to StepMNA() */
 	AG_LockTimers(ckt);
@@ -473,7 +1158,6 @@ static void
 Destroy(void *p)
 {
 	ES_SimDC *sim = p;
-	int i;
 	
 	Stop(sim);
 
@@ -481,15 +1165,20 @@ Destroy(void *p)
 	M_VecFree(sim->z);
 	M_VecFree(sim->x);
 	M_VecFree(sim->xPrevIter);
-
-	if (sim->xPrevSteps) {
-		for (i = 0; i < sim->stepsToKeep; i++) {
-			M_VecFree(sim->xPrevSteps[i]);
-		}
-		free(sim->xPrevSteps);
-	}
-	if (sim->deltaTPrevSteps)
-		free(sim->deltaTPrevSteps);
+	M_Free(sim->LU);
+	ES_DenseLUDestroy(&sim->dlu);
+	ES_SparseLUDestroy(&sim->slu);
+	Free(sim->pattern);
+	M_VecFree(sim->r);
+	M_Free(sim->Afact);
+	Free(sim->AfactVals);
+	Free(sim->updCols);
+	Free(sim->updPiv);
+	Free(sim->updU);
+	Free(sim->updW);
+	Free(sim->updS);
+
+	FreePrevSteps(sim);
 }
 
 static void
@@ -534,6 +1223,10 @@ Edit(void *p, ES_Circuit *ckt)
 	
 		AG_NumericalNewUint(nt, 0, NULL, _("Refresh rate (delay): "), &sim->ticksDelay);
 		AG_NumericalNewUint(nt, 0, NULL, _("Max. iterations/step: "), &sim->itersMax);
+		AG_CheckboxNewFlag(nt, 0, _("Reuse LU factors (chord Newton)"),
+		    &sim->flags, ES_SIMDC_CHORD);
+		AG_NumericalNewUint(nt, 0, NULL, _("Sparse LU threads: "),
+		    &sim->nThreads);
 
 		rad = AG_RadioNewUint(nt, 0, NULL, &sim->method);
 		for (i = 0; i < esIntegrationMethodCount; i++)
@@ -547,6 +1240,15 @@ Edit(void *p, ES_Circuit *ckt)
 		    &sim->stepLow, &sim->stepHigh);
 		AG_LabelNewPolled(nt, 0, _("Iterations: %u-%u"),
 		    &sim->itersLow, &sim->itersHigh);
+		AG_LabelNewPolled(nt, 0, _("Total iterations: %u (%u limited)"),
+		    &sim->itersTotal, &sim->itersLimited);
+		AG_LabelNewPolled(nt, 0, _("Device evaluations: %u (%u bypassed)"),
+		    &sim->bypassMisses, &sim->bypassHits);
+		AG_LabelNewPolled(nt, 0, _("LU factorizations: %u (%u chord "
+		                           "iterations)"),
+		    &sim->factorsTotal, &sim->itersChord);
+		AG_LabelNewPolled(nt, 0, _("Low-rank LU updates: %u"),
+		    &sim->updatesLowRank);
 	}
 	
 	nt = AG_NotebookAdd(nb, _("Equations"), AG_BOX_VERT);
@@ -4,6 +4,19 @@ typedef struct es_sim_dc {
 	struct es_sim _inherit;
 
 	enum es_integration_method method;	/* Method of integration used */
+	Uint flags;
+#define ES_SIMDC_HEADLESS 0x01	/* Don't update circuit variables or post
+				   step events (batch use) */
+#define ES_SIMDC_NO_BYPASS 0x02	/* Always evaluate nonlinear devices */
+#define ES_SIMDC_ANALYTIC  0x04	/* Ignore table models */
+#define ES_SIMDC_CHORD     0x08	/* Reuse LU factors between iterations
+				   (chord Newton) */
+#define ES_SIMDC_NO_LTI    0x10	/* Solve linear circuits by NR as well */
+#define ES_SIMDC_SPARSE    0x20	/* Use the sparse LU at any size */
+#define ES_SIMDC_NO_LIMIT  0x40	/* Clamp junction steps to Vt and don't
+				   limit FETs (reference for tests) */
+#define ES_SIMDC_GENERIC_LU 0x80 /* Use the generic LU of the math library
+				   at any size (reference for tests) */
 	
 	AG_Timer toUpdate;	/* Timer for simulation updates */
 	M_Real Telapsed;        /* Simulated elapsed time (s) */
@@ -23,6 +36,14 @@ typedef struct es_sim_dc {
 	Uint itersMax;		/* Limit on iterations/step */
 	Uint itersHigh;		/* Most iterations/step recorded */
 	Uint itersLow;		/* Least iterations/step recorded */
+	Uint itersLast;		/* Iterations of the last NR loop */
+	Uint itersTotal;	/* Iterations since the simulation began */
+	Uint itersLimited;	/* Iterations with limited device voltages */
+	Uint bypassHits;	/* Device evaluations bypassed */
+	Uint bypassMisses;	/* Device evaluations performed */
+	Uint factorsTotal;	/* LU factorizations since the simulation began */
+	Uint itersChord;	/* Iterations which reused LU factors */
+	Uint updatesLowRank;	/* Steps solved by low-rank update of LU */
 	M_Real stepLow;		/* Smallest timestep used */
 	M_Real stepHigh;	/* Largest timestep used */
 
@@ -33,14 +54,45 @@ typedef struct es_sim_dc {
 
 	M_Vector *xPrevIter;	/* Solution from last iteration */
 
+	M_Matrix *LU;		/* Factors of A (chord Newton) */
+	ES_DenseLU dlu;		/* Factors of A (small systems) */
+	int dense;		/* Use dlu instead of LU */
+	ES_SparseLU slu;	/* Factors of A (large systems) */
+	int sparse;		/* Use slu instead of LU */
+	Uint nThreads;		/* Threads for the sparse factorization */
+	ES_MatrixEntry *pattern; /* Entries of A used by the stamps */
+	Uint nPattern, maxPattern;
+	int patternSorted;	/* Pattern is sorted (no duplicates) */
+	int patternAnalyzed;	/* Pattern is analyzed by the sparse LU */
+	M_Vector *r;		/* Residual z - Ax (chord Newton) */
+	int luValid;		/* LU holds the factors of a recent A */
+	M_Matrix *Afact;	/* A as last factored into LU (LTI) */
+	M_Real *AfactVals;	/* Same over the pattern (LTI, sparse LU) */
+	int isLTI;		/* Circuit is linear time-invariant */
+	Uint *updCols;		/* Columns where A differs from Afact */
+	Uint nUpdCols;		/* Rank of the update (0 = none cached) */
+	M_Real *updU;		/* A - Afact over updCols (column-major) */
+	M_Real *updW;		/* LU^-1 updU (column-major) */
+	M_Real *updS;		/* Factors of the capacitance matrix */
+	Uint *updPiv;		/* Row interchanges in updS */
+
 	int stepsToKeep;        /* Number of previous solutions to keep */
 	M_Vector **xPrevSteps;	/* Solutions from last steps */
 	M_Real *deltaTPrevSteps;/* Previous timesteps. deltaTPrevSteps[i] is
 				 * the timestep used to compute xPrevSteps[i] */
 
 	M_Real *groundNode;     /* Pointer to A(0, 0) */
+	M_Real groundSink;	/* Receives the stamps involving ground
+				   (per-simulation, so that independent
+				   circuits may be simulated concurrently) */
 } ES_SimDC;
 
 __BEGIN_DECLS
 extern const ES_SimOps esSimDcOps;
+
+int  ES_SimDCBegin(ES_SimDC *);
+int  ES_SimDCStep(ES_SimDC *);
+void ES_SimDCSetTemp(ES_SimDC *, M_Real);
+M_Real *ES_SimDCGetElement(ES_SimDC *, Uint, Uint);
+int  ES_SimDCSolveOP(ES_SimDC *);
 __END_DECLS
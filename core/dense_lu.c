@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Cache-blocked dense LU factorization with partial pivoting. For every
+ * panel of ES_DENSE_LU_BLOCK columns, the panel is factored column by
+ * column (row interchanges are applied to whole rows), the corresponding
+ * block row of U is obtained by forward substitution, and the trailing
+ * submatrix receives a rank-ES_DENSE_LU_BLOCK update. The update is done
+ * four rows at a time with the partial sums held in vector registers, so
+ * the block row of U is streamed from cache once per four rows.
+ */
+
+#include "core.h"
+
+#include <string.h>
+
+#if defined(DOUBLE_PRECISION) && defined(__AVX2__)
+# include <immintrin.h>
+typedef __m256d VReal;
+# define VLEN		4
+# define VLOAD(p)	_mm256_loadu_pd(p)
+# define VSTORE(p,v)	_mm256_storeu_pd((p),(v))
+# define VSPLAT(x)	_mm256_set1_pd(x)
+# define VZERO()	_mm256_setzero_pd()
+# ifdef __FMA__
+#  define VNMADD(a,b,c)	_mm256_fnmadd_pd((a),(b),(c))
+#  define VMADD(a,b,c)	_mm256_fmadd_pd((a),(b),(c))
+# else
+#  define VNMADD(a,b,c)	_mm256_sub_pd((c),_mm256_mul_pd((a),(b)))
+#  define VMADD(a,b,c)	_mm256_add_pd((c),_mm256_mul_pd((a),(b)))
+# endif
+#elif defined(DOUBLE_PRECISION) && defined(__ARM_NEON) && defined(__aarch64__)
+# include <arm_neon.h>
+typedef float64x2_t VReal;
+# define VLEN		2
+# define VLOAD(p)	vld1q_f64(p)
+# define VSTORE(p,v)	vst1q_f64((p),(v))
+# define VSPLAT(x)	vdupq_n_f64(x)
+# define VZERO()	vdupq_n_f64(0.0)
+# define VNMADD(a,b,c)	vfmsq_f64((c),(a),(b))
+# define VMADD(a,b,c)	vfmaq_f64((c),(a),(b))
+#else
+typedef M_Real VReal;
+# define VLEN		1
+# define VLOAD(p)	(*(p))
+# define VSTORE(p,v)	(*(p) = (v))
+# define VSPLAT(x)	(x)
+# define VZERO()	(0.0)
+# define VNMADD(a,b,c)	((c) - (a)*(b))
+# define VMADD(a,b,c)	((c) + (a)*(b))
+#endif
+
+/* Columns of the trailing submatrix updated per pass (fits in L1). */
+#define COLS_PER_PASS	64
+
+/* c[0..len) -= l*u[0..len) */
+static __inline__ void
+Axpy(M_Real *c, M_Real l, const M_Real *u, Uint len)
+{
+	VReal vl = VSPLAT(l);
+	Uint j;
+
+	for (j = 0; j+VLEN <= len; j += VLEN) {
+		VSTORE(&c[j], VNMADD(vl, VLOAD(&u[j]), VLOAD(&c[j])));
+	}
+	for (; j < len; j++)
+		c[j] -= l*u[j];
+}
+
+/* Return the sum of a[i]*b[i] over [0..len). */
+static __inline__ M_Real
+Dot(const M_Real *a, const M_Real *b, Uint len)
+{
+	VReal acc = VZERO();
+	M_Real t[VLEN], sum = 0.0;
+	Uint j;
+
+	for (j = 0; j+VLEN <= len; j += VLEN) {
+		acc = VMADD(VLOAD(&a[j]), VLOAD(&b[j]), acc);
+	}
+	VSTORE(t, acc);
+	for (j = 0; j < VLEN; j++) {
+		sum += t[j];
+	}
+	for (j = len - len%VLEN; j < len; j++)
+		sum += a[j]*b[j];
+
+	return (sum);
+}
+
+/*
+ * Trailing update of rows i..i+3, columns [j0,j1) (multiple of VLEN):
+ * A(i,j) -= sum over k in [k0,k1) of L(i,k)*U(k,j).
+ */
+static void
+Update4(M_Real *a, Uint stride, Uint i, Uint k0, Uint k1, Uint j0, Uint j1)
+{
+	M_Real *c0 = &a[i*stride], *c1 = c0+stride;
+	M_Real *c2 = c1+stride, *c3 = c2+stride;
+	Uint j, k;
+
+	for (j = j0; j < j1; j += VLEN) {
+		VReal r0 = VLOAD(&c0[j]), r1 = VLOAD(&c1[j]);
+		VReal r2 = VLOAD(&c2[j]), r3 = VLOAD(&c3[j]);
+
+		for (k = k0; k < k1; k++) {
+			VReal u = VLOAD(&a[k*stride + j]);
+
+			r0 = VNMADD(VSPLAT(c0[k]), u, r0);
+			r1 = VNMADD(VSPLAT(c1[k]), u, r1);
+			r2 = VNMADD(VSPLAT(c2[k]), u, r2);
+			r3 = VNMADD(VSPLAT(c3[k]), u, r3);
+		}
+		VSTORE(&c0[j], r0);
+		VSTORE(&c1[j], r1);
+		VSTORE(&c2[j], r2);
+		VSTORE(&c3[j], r3);
+	}
+}
+
+void
+ES_DenseLUInit(ES_DenseLU *lu)
+{
+	lu->n = 0;
+	lu->stride = 0;
+	lu->a = NULL;
+	lu->piv = NULL;
+	lu->b = NULL;
+}
+
+void
+ES_DenseLUDestroy(ES_DenseLU *lu)
+{
+	Free(lu->a);
+	Free(lu->piv);
+	Free(lu->b);
+}
+
+void
+ES_DenseLUResize(ES_DenseLU *lu, Uint n)
+{
+	lu->n = n;
+	lu->stride = (n + ES_DENSE_LU_PAD-1)/ES_DENSE_LU_PAD*ES_DENSE_LU_PAD;
+	lu->a = Realloc(lu->a, (n*lu->stride + 1)*sizeof(M_Real));
+	lu->piv = Realloc(lu->piv, (n+1)*sizeof(Uint));
+	lu->b = Realloc(lu->b, (n+1)*sizeof(M_Real));
+	memset(lu->a, 0, n*lu->stride*sizeof(M_Real));	/* Zero padding */
+}
+
+/* Copy the matrix to be factored. */
+void
+ES_DenseLULoad(ES_DenseLU *lu, M_Matrix *A)
+{
+	Uint i, j;
+
+	for (i = 0; i < lu->n; i++) {
+		M_Real *row = &lu->a[i*lu->stride];
+
+		for (j = 0; j < lu->n; j++)
+			row[j] = *M_GetElement(A, i, j);
+	}
+}
+
+/* Factor the loaded matrix in place. */
+int
+ES_DenseLUFactor(ES_DenseLU *lu)
+{
+	M_Real *a = lu->a, *rk, *ri, t;
+	Uint n = lu->n, stride = lu->stride;
+	Uint k0, k1, k, i, j, p, jp;
+
+	for (k0 = 0; k0 < n; k0 = k1) {
+		k1 = MIN(k0+ES_DENSE_LU_BLOCK, n);
+
+		/* Factor the panel [k0,k1) over rows [k0,n). */
+		for (k = k0; k < k1; k++) {
+			for (p = k, i = k+1; i < n; i++) {
+				if (Fabs(a[i*stride + k]) > Fabs(a[p*stride + k]))
+					p = i;
+			}
+			if (a[p*stride + k] == 0.0) {
+				AG_SetError(_("Singular matrix"));
+				return (-1);
+			}
+			lu->piv[k] = p;
+			if (p != k) {
+				rk = &a[k*stride];
+				ri = &a[p*stride];
+				for (j = 0; j < stride; j++) {
+					t = rk[j];
+					rk[j] = ri[j];
+					ri[j] = t;
+				}
+			}
+			rk = &a[k*stride];
+			for (i = k+1; i < n; i++) {
+				ri = &a[i*stride];
+				ri[k] /= rk[k];
+				Axpy(&ri[k+1], ri[k], &rk[k+1], k1-k-1);
+			}
+		}
+		if (k1 == n)
+			break;
+
+		/* Block row of U: forward substitution with the unit L11. */
+		for (k = k0; k < k1; k++) {
+			rk = &a[k*stride];
+			for (i = k+1; i < k1; i++) {
+				ri = &a[i*stride];
+				Axpy(&ri[k1], ri[k], &rk[k1], stride-k1);
+			}
+		}
+
+		/* Rank-(k1-k0) update of the trailing submatrix. */
+		for (jp = k1; jp < stride; jp += COLS_PER_PASS) {
+			Uint jEnd = MIN(jp+COLS_PER_PASS, stride);
+
+			for (i = k1; i+4 <= n; i += 4) {
+				Update4(a, stride, i, k0, k1, jp, jEnd);
+			}
+			for (; i < n; i++) {
+				ri = &a[i*stride];
+				for (k = k0; k < k1; k++)
+					Axpy(&ri[jp], ri[k], &a[k*stride + jp],
+					    jEnd-jp);
+			}
+		}
+	}
+	return (0);
+}
+
+/*
+ * Solve Ax = v in place using the factors: permute v, then run forward
+ * and back substitution over a contiguous copy.
+ */
+void
+ES_DenseLUSolve(ES_DenseLU *lu, M_Vector *v)
+{
+	M_Real *a = lu->a, *b = lu->b, *row, t;
+	Uint n = lu->n, stride = lu->stride, i;
+
+	for (i = 0; i < n; i++) {
+		b[i] = M_VecGet(v, i);
+	}
+	for (i = 0; i < n; i++) {
+		if (lu->piv[i] != i) {
+			t = b[i];
+			b[i] = b[lu->piv[i]];
+			b[lu->piv[i]] = t;
+		}
+		b[i] -= Dot(&a[i*stride], b, i);
+	}
+	for (i = n; i-- > 0; ) {
+		row = &a[i*stride];
+		b[i] = (b[i] - Dot(&row[i+1], &b[i+1], n-i-1)) / row[i];
+		*M_VecGetElement(v, i) = b[i];
+	}
+}
@@ -0,0 +1,31 @@
+/*	Public domain	*/
+
+/*
+ * Dense LU factorization with partial pivoting for small and medium MNA
+ * systems. The matrix is copied into a contiguous row-major array whose
+ * rows are padded to ES_DENSE_LU_PAD entries, and factored by a blocked
+ * right-looking algorithm whose trailing update is vectorized (AVX2 or
+ * NEON where the compiler targets them). Larger systems are left to the
+ * generic solver.
+ */
+
+#define ES_DENSE_LU_MAX		256	/* Largest system factored densely */
+#define ES_DENSE_LU_BLOCK	32	/* Panel width (columns) */
+#define ES_DENSE_LU_PAD		4	/* Row length granularity */
+
+typedef struct es_dense_lu {
+	Uint n;				/* Order of the system */
+	Uint stride;			/* Row stride (padded) */
+	M_Real *a;			/* L (unit diagonal) and U, row-major */
+	Uint *piv;			/* Row interchanges */
+	M_Real *b;			/* Right-hand side being solved */
+} ES_DenseLU;
+
+__BEGIN_DECLS
+void ES_DenseLUInit(ES_DenseLU *);
+void ES_DenseLUDestroy(ES_DenseLU *);
+void ES_DenseLUResize(ES_DenseLU *, Uint);
+void ES_DenseLULoad(ES_DenseLU *, M_Matrix *);
+int  ES_DenseLUFactor(ES_DenseLU *);
+void ES_DenseLUSolve(ES_DenseLU *, M_Vector *);
+__END_DECLS
@@ -79,176 +79,86 @@ typedef struct tagOPERATIONINFO {
 	void *                p_fonction;
 }OPERATIONINFO;
 
-OPERATIONINFO TabOperations[NB_OPERATIONS];
 
-int     EnleverEspaces(char * lpszString);
-BOOL    IsSeparator(int c);
-int     EmpilerMot(char * lpMot, size_t cchMot, LPPARAM lpParams, size_t nbParams);
-int     EmpilerSep(int c);
-int     EmpilerOperande(M_Real x);
-int     EmpilerChaine(char * lpszMot, LPPARAM lpParams, size_t nbParams);
-int     EmpilerFonction(int f);
-int     EmpilerParam(char * lpszParam, LPPARAM lpParams, size_t nbParams);
-BOOL    Prioritaire(int operation, int second_operation);
-int     Evaluer(void);
+static char *  EnleverEspaces(const char * lpszString);
+static BOOL    IsSeparator(int c);
+static int     EmpilerMot(LPINTERPRETEUR, char * lpMot, size_t cchMot, LPPARAM lpParams, size_t nbParams);
+static int     EmpilerSep(LPINTERPRETEUR, int c);
+static int     EmpilerOperande(LPINTERPRETEUR, M_Real x);
+static int     EmpilerChaine(LPINTERPRETEUR, char * lpszMot, LPPARAM lpParams, size_t nbParams);
+static int     EmpilerFonction(LPINTERPRETEUR, int f);
+static int     EmpilerParam(LPINTERPRETEUR, char * lpszParam, LPPARAM lpParams, size_t nbParams);
+static BOOL    Prioritaire(int operation, int second_operation);
+static int     Evaluer(LPINTERPRETEUR);
+
+static M_Real  my_Somme(M_Real a, M_Real b);
+static M_Real  my_Diff(M_Real a, M_Real b);
+static M_Real  my_Prod(M_Real a, M_Real b);
+static M_Real  my_Div(M_Real a, M_Real b);
+static M_Real  my_Pow(M_Real a, M_Real b);
+static M_Real  my_Opp(M_Real x);
+static M_Real  my_Sin(M_Real x);
+static M_Real  my_Cos(M_Real x);
+static M_Real  my_Tan(M_Real x);
+static M_Real  my_Abs(M_Real x);
+static M_Real  my_Racine(M_Real x);
+static M_Real  my_Log(M_Real x);
+static M_Real  my_Log10(M_Real x);
+static M_Real  my_Exp(M_Real x);
+static M_Real  my_UnitStep(M_Real x);
 
-M_Real  my_Somme(M_Real a, M_Real b);
-M_Real  my_Diff(M_Real a, M_Real b);
-M_Real  my_Prod(M_Real a, M_Real b);
-M_Real  my_Div(M_Real a, M_Real b);
-M_Real  my_Pow(M_Real a, M_Real b);
-M_Real  my_Opp(M_Real x);
-M_Real  my_Sin(M_Real x);
-M_Real  my_Cos(M_Real x);
-M_Real  my_Tan(M_Real x);
-M_Real  my_Abs(M_Real x);
-M_Real  my_Racine(M_Real x);
-M_Real  my_Log(M_Real x);
-M_Real  my_Log10(M_Real x);
-M_Real  my_Exp(M_Real x);
-M_Real  my_UnitStep(M_Real x);
-
-#define MAX_OPERATIONS    20
-#define MAX_OPERANDES     20
-
-struct {
-	size_t    NbElements;
-	int       t[MAX_OPERATIONS];
-}Operations;
-
-struct {
-	size_t    NbElements;
-	M_Real    t[MAX_OPERANDES];
-}Operandes;
-
-
-
-
-
-
-
-
-
-
-
-
-
-void InterpreteurInit()
-{
-	TabOperations[P_O].priorite          = PRIOR_P_O;
-	TabOperations[P_O].associativite     = GAUCHE;
-	TabOperations[P_O].nbArgs            = 0;
-	TabOperations[P_O].p_fonction        = NULL;
-
-	TabOperations[P_F].priorite          = PRIOR_P_F;
-	TabOperations[P_F].associativite     = GAUCHE;
-	TabOperations[P_F].nbArgs            = 0;
-	TabOperations[P_F].p_fonction        = NULL;
-
-	TabOperations[END].priorite          = PRIOR_END;
-	TabOperations[END].associativite     = GAUCHE;
-	TabOperations[END].nbArgs            = 0;
-	TabOperations[END].p_fonction        = NULL;
-
-	TabOperations[PLUS].priorite         = PRIOR_PLUS_MOINS;
-	TabOperations[PLUS].associativite    = GAUCHE;
-	TabOperations[PLUS].nbArgs           = 2;
-	TabOperations[PLUS].p_fonction       = my_Somme;
-
-	TabOperations[MOINS].priorite        = PRIOR_PLUS_MOINS;
-	TabOperations[MOINS].associativite   = GAUCHE;
-	TabOperations[MOINS].nbArgs          = 2;
-	TabOperations[MOINS].p_fonction      = my_Diff;
-
-	TabOperations[FOIS].priorite         = PRIOR_FOIS_DIV;
-	TabOperations[FOIS].associativite    = GAUCHE;
-	TabOperations[FOIS].nbArgs           = 2;
-	TabOperations[FOIS].p_fonction       = my_Prod;
-
-	TabOperations[DIV].priorite          = PRIOR_FOIS_DIV;
-	TabOperations[DIV].associativite     = GAUCHE;
-	TabOperations[DIV].nbArgs            = 2;
-	TabOperations[DIV].p_fonction        = my_Div;
-
-	TabOperations[POW].priorite          = PRIOR_POW;
-	TabOperations[POW].associativite     = GAUCHE;
-	TabOperations[POW].nbArgs            = 2;
-	TabOperations[POW].p_fonction        = my_Pow;
-
-	TabOperations[OPP].priorite          = PRIOR_FONCTION;
-	TabOperations[OPP].associativite     = DROITE;
-	TabOperations[OPP].nbArgs            = 1;
-	TabOperations[OPP].p_fonction        = my_Opp;
-
-	TabOperations[SIN].priorite          = PRIOR_FONCTION;
-	TabOperations[SIN].associativite     = DROITE;
-	TabOperations[SIN].nbArgs            = 1;
-	TabOperations[SIN].p_fonction        = my_Sin;
-
-	TabOperations[COS].priorite          = PRIOR_FONCTION;
-	TabOperations[COS].associativite     = DROITE;
-	TabOperations[COS].nbArgs            = 1;
-	TabOperations[COS].p_fonction        = my_Cos;
-
-	TabOperations[TAN].priorite          = PRIOR_FONCTION;
-	TabOperations[TAN].associativite     = DROITE;
-	TabOperations[TAN].nbArgs            = 1;
-	TabOperations[TAN].p_fonction        = my_Tan;
-
-	TabOperations[ABS].priorite          = PRIOR_FONCTION;
-	TabOperations[ABS].associativite     = DROITE;
-	TabOperations[ABS].nbArgs            = 1;
-	TabOperations[ABS].p_fonction        = my_Abs;
-
-	TabOperations[RACINE].priorite       = PRIOR_FONCTION;
-	TabOperations[RACINE].associativite  = DROITE;
-	TabOperations[RACINE].nbArgs         = 1;
-	TabOperations[RACINE].p_fonction     = my_Racine;
-
-	TabOperations[LOG].priorite          = PRIOR_FONCTION;
-	TabOperations[LOG].associativite     = DROITE;
-	TabOperations[LOG].nbArgs            = 1;
-	TabOperations[LOG].p_fonction        = my_Log;
-
-	TabOperations[LOG10].priorite        = PRIOR_FONCTION;
-	TabOperations[LOG10].associativite   = DROITE;
-	TabOperations[LOG10].nbArgs          = 1;
-	TabOperations[LOG10].p_fonction      = my_Log10;
-
-	TabOperations[EXP].priorite          = PRIOR_FONCTION;
-	TabOperations[EXP].associativite     = DROITE;
-	TabOperations[EXP].nbArgs            = 1;
-	TabOperations[EXP].p_fonction        = my_Exp;
-
-	TabOperations[USTEP].priorite          = PRIOR_FONCTION;
-	TabOperations[USTEP].associativite     = DROITE;
-	TabOperations[USTEP].nbArgs            = 1;
-	TabOperations[USTEP].p_fonction        = my_UnitStep;
-
-}
-
-void InterpreteurReset()
+/*
+ * Table des operations (lecture seule). Les piles d'evaluation sont dans
+ * le contexte INTERPRETEUR fourni par l'appelant.
+ */
+static const OPERATIONINFO TabOperations[NB_OPERATIONS] = {
+	{ PRIOR_P_O,        GAUCHE, 0, NULL },		/* P_O */
+	{ PRIOR_P_F,        GAUCHE, 0, NULL },		/* P_F */
+	{ PRIOR_END,        GAUCHE, 0, NULL },		/* END */
+	{ PRIOR_PLUS_MOINS, GAUCHE, 2, my_Somme },	/* PLUS */
+	{ PRIOR_PLUS_MOINS, GAUCHE, 2, my_Diff },	/* MOINS */
+	{ PRIOR_FOIS_DIV,   GAUCHE, 2, my_Prod },	/* FOIS */
+	{ PRIOR_FOIS_DIV,   GAUCHE, 2, my_Div },	/* DIV */
+	{ PRIOR_POW,        GAUCHE, 2, my_Pow },	/* POW */
+	{ PRIOR_FONCTION,   DROITE, 1, my_Opp },	/* OPP */
+	{ PRIOR_FONCTION,   DROITE, 1, my_Sin },	/* SIN */
+	{ PRIOR_FONCTION,   DROITE, 1, my_Cos },	/* COS */
+	{ PRIOR_FONCTION,   DROITE, 1, my_Tan },	/* TAN */
+	{ PRIOR_FONCTION,   DROITE, 1, my_Abs },	/* ABS */
+	{ PRIOR_FONCTION,   DROITE, 1, my_Racine },	/* RACINE */
+	{ PRIOR_FONCTION,   DROITE, 1, my_Log },	/* LOG */
+	{ PRIOR_FONCTION,   DROITE, 1, my_Log10 },	/* LOG10 */
+	{ PRIOR_FONCTION,   DROITE, 1, my_Exp },	/* EXP */
+	{ PRIOR_FONCTION,   DROITE, 1, my_UnitStep }	/* USTEP */
+};
+
+void InterpreteurReset(LPINTERPRETEUR ctx)
 {
-	Operations.NbElements = 0;
-	Operations.t[0] = INVALIDF;
-	Operandes.NbElements = 0;
+	ctx->Operations.NbElements = 0;
+	ctx->Operations.t[0] = INVALIDF;
+	ctx->Operandes.NbElements = 0;
 }
 
-int Calculer(char * lpszString, LPPARAM lpParams, size_t nbParams, M_Real * lpResult)
+int Calculer(LPINTERPRETEUR ctx, const char * lpszString, LPPARAM lpParams, size_t nbParams, M_Real * lpResult)
 {
 	int ret = EVALUER_SUCCESS;
 
-	if ((lpszString != NULL) && (lpResult != NULL))
+	if ((ctx != NULL) && (lpszString != NULL) && (lpResult != NULL))
 	{
+		char * lpszExpr = NULL;
 		char * lpMot = NULL;
 		int c, sep;
 		/* c   : caractere courant */
 		/* sep : caractere precedent */
 		size_t i = 0;
 
-		ret = EnleverEspaces(lpszString);
+		InterpreteurReset(ctx);
 
-		lpMot = lpszString;
+		/* La chaine d'entree n'est pas modifiee. */
+		if ((lpszExpr = EnleverEspaces(lpszString)) == NULL)
+			return EVALUER_MEMOIRE_INSUFFISANTE;
+
+		lpMot = lpszExpr;
 		sep = c = lpMot[i];
 
 		while (ret == EVALUER_SUCCESS)
@@ -267,11 +177,11 @@ int Calculer(char * lpszString, LPPARAM lpParams, size_t nbParams, M_Real * lpRe
 					c = 'o';
 
 				if (i > 0)
-					ret = EmpilerMot(lpMot, i, lpParams, nbParams);
+					ret = EmpilerMot(ctx, lpMot, i, lpParams, nbParams);
 
 				if (ret == EVALUER_SUCCESS)
 				{
-					ret = EmpilerSep(c);
+					ret = EmpilerSep(ctx, c);
 
 					if (c == '\0')
 						break;
@@ -292,17 +202,19 @@ int Calculer(char * lpszString, LPPARAM lpParams, size_t nbParams, M_Real * lpRe
 
 		if (ret == EVALUER_SUCCESS)
 		{
-			if (Operandes.NbElements == 1)
-                if (Operations.NbElements == 0)
-                    *lpResult = Operandes.t[0];
+			if (ctx->Operandes.NbElements == 1)
+                if (ctx->Operations.NbElements == 0)
+                    *lpResult = ctx->Operandes.t[0];
                 else
-					if (Operations.t[Operations.NbElements - 1] == P_O)
+					if (ctx->Operations.t[ctx->Operations.NbElements - 1] == P_O)
 						ret = EVALUER_P_F_MANQUANTE;
 					else
 						ret = EVALUER_FEW_ARGS;
 			else
 				ret = EVALUER_TOO_MUCH_ARGS;
 		}
+
+		free(lpszExpr);
 	}
 	else
 		ret = EVALUER_NULL_ARG;
@@ -310,9 +222,9 @@ int Calculer(char * lpszString, LPPARAM lpParams, size_t nbParams, M_Real * lpRe
 	return ret;
 }
 
-int EnleverEspaces(char * lpszString)
+/* Retourne une copie de la chaine sans espaces (a liberer avec free()). */
+static char * EnleverEspaces(const char * lpszString)
 {
-	int ret = EVALUER_SUCCESS;
 	char * lpBuffer;
 
 	lpBuffer = malloc(strlen(lpszString) + 1);
@@ -322,20 +234,15 @@ int EnleverEspaces(char * lpszString)
 		char c;
 
 		for(i = 0; (c = lpszString[i]) != '\0'; i++)
-			if (!isspace(c))
+			if (!isspace((unsigned char)c))
 				lpBuffer[j++] = c;
 		lpBuffer[j] = '\0';
-
-		strcpy(lpszString, lpBuffer);
-		free(lpBuffer);
 	}
-	else
-		ret = EVALUER_MEMOIRE_INSUFFISANTE;
 
-	return ret;
+	return lpBuffer;
 }
 
-BOOL IsSeparator(int c)
+static BOOL IsSeparator(int c)
 {
 	BOOL ret;
 
@@ -352,7 +259,7 @@ BOOL IsSeparator(int c)
 	return ret;
 }
 
-int EmpilerMot(char * lpMot, size_t cchMot, LPPARAM lpParams, size_t nbParams)
+static int EmpilerMot(LPINTERPRETEUR ctx, char * lpMot, size_t cchMot, LPPARAM lpParams, size_t nbParams)
 {
 	int ret = EVALUER_SUCCESS;
 	char * lpszMot = NULL;
@@ -373,12 +280,12 @@ int EmpilerMot(char * lpMot, size_t cchMot, LPPARAM lpParams, size_t nbParams)
 		{
 		    /* c'est un nombre (une operande) */
 			EvaluerDebug("EmpilerOperande %g\n", x);
-			ret = EmpilerOperande(x);
+			ret = EmpilerOperande(ctx, x);
 		}
 		else
 		{
 		    /* c'est peut etre le nom d'une fonction ou un parametre ... */
-			ret = EmpilerChaine(lpszMot, lpParams, nbParams);
+			ret = EmpilerChaine(ctx, lpszMot, lpParams, nbParams);
 		}
 
 		free(lpszMot);
@@ -389,14 +296,14 @@ int EmpilerMot(char * lpMot, size_t cchMot, LPPARAM lpParams, size_t nbParams)
 	return ret;
 }
 
-int EmpilerOperande(M_Real x)
+static int EmpilerOperande(LPINTERPRETEUR ctx, M_Real x)
 {
 	int ret = EVALUER_SUCCESS;
 
-	if (Operandes.NbElements < MAX_OPERANDES)
+	if (ctx->Operandes.NbElements < INTERPRETEUR_MAX_OPERANDES)
 	{
-		Operandes.t[Operandes.NbElements] = x;
-		Operandes.NbElements++;
+		ctx->Operandes.t[ctx->Operandes.NbElements] = x;
+		ctx->Operandes.NbElements++;
 	}
 	else
 		ret = EVALUER_PILE_PLEINE;
@@ -404,7 +311,7 @@ int EmpilerOperande(M_Real x)
 	return ret;
 }
 
-int EmpilerChaine(char * lpszMot, LPPARAM lpParams, size_t nbParams)
+static int EmpilerChaine(LPINTERPRETEUR ctx, char * lpszMot, LPPARAM lpParams, size_t nbParams)
 {
 	int fonction = INVALIDF, ret = EVALUER_SUCCESS;
 
@@ -437,22 +344,22 @@ int EmpilerChaine(char * lpszMot, LPPARAM lpParams, size_t nbParams)
 	if (fonction != INVALIDF)
 	{
 		EvaluerDebug("EmpilerFonction %s\n", lpszMot);
-		ret = EmpilerFonction(fonction);
+		ret = EmpilerFonction(ctx, fonction);
 	}
 	else
 	{
 		EvaluerDebug("EmpilerParam %s = ", lpszMot);
-		ret = EmpilerParam(lpszMot, lpParams, nbParams);
+		ret = EmpilerParam(ctx, lpszMot, lpParams, nbParams);
 	}
 
 	return ret;
 }
 
-int EmpilerSep(int c)
+static int EmpilerSep(LPINTERPRETEUR ctx, int c)
 {
 	int ret = EVALUER_SUCCESS;
 
-	if (Operations.NbElements < MAX_OPERATIONS)
+	if (ctx->Operations.NbElements < INTERPRETEUR_MAX_OPERATIONS)
 	{
 		int operation;
 
@@ -501,7 +408,7 @@ int EmpilerSep(int c)
 		if (ret == EVALUER_SUCCESS)
 		{
 			EvaluerDebug("EmpilerFonction %c\n", c == 'o' ? '-' : (c == '\0' ? '$' : c));
-			ret = EmpilerFonction(operation);
+			ret = EmpilerFonction(ctx, operation);
 		}
 	}
 	else
@@ -510,27 +417,27 @@ int EmpilerSep(int c)
 	return ret;
 }
 
-int EmpilerFonction(int f)
+static int EmpilerFonction(LPINTERPRETEUR ctx, int f)
 {
 	int p_o = 0, ret = EVALUER_SUCCESS;
 
-	if (f != P_O)
+	if (f != P_O && ctx->Operations.NbElements > 0)
 	{
 		int operation_courante;
 
-		operation_courante = Operations.t[Operations.NbElements - 1];
+		operation_courante = ctx->Operations.t[ctx->Operations.NbElements - 1];
 
-		while ((Operations.NbElements > 0) && Prioritaire(operation_courante, f))
+		while ((ctx->Operations.NbElements > 0) && Prioritaire(operation_courante, f))
 		{
 			EvaluerDebug("IRQ!\n");
 			p_o = (operation_courante == P_O);
-			ret = Evaluer();
+			ret = Evaluer(ctx);
 
 			if ((ret != EVALUER_SUCCESS) || ((f == P_F) && (p_o)))
 				break;
 
-			if (Operations.NbElements > 0)
-				operation_courante = Operations.t[Operations.NbElements - 1];
+			if (ctx->Operations.NbElements > 0)
+				operation_courante = ctx->Operations.t[ctx->Operations.NbElements - 1];
 		}
 	}
 
@@ -543,10 +450,10 @@ int EmpilerFonction(int f)
 		}
 		else
 		{
-			if (Operations.NbElements < MAX_OPERATIONS)
+			if (ctx->Operations.NbElements < INTERPRETEUR_MAX_OPERATIONS)
 			{
-				Operations.t[Operations.NbElements] = f;
-				Operations.NbElements++;
+				ctx->Operations.t[ctx->Operations.NbElements] = f;
+				ctx->Operations.NbElements++;
 			}
 			else
 				ret = EVALUER_PILE_PLEINE;
@@ -556,7 +463,7 @@ int EmpilerFonction(int f)
 	return ret;
 }
 
-BOOL Prioritaire(int operation, int second_operation)
+static BOOL Prioritaire(int operation, int second_operation)
 {
 	int prior_operation, prior_second, associativite;
 
@@ -567,7 +474,7 @@ BOOL Prioritaire(int operation, int second_operation)
 	return ((prior_operation > prior_second) || ((prior_operation == prior_second) && (associativite == GAUCHE)));
 }
 
-int EmpilerParam(char * lpszParam, LPPARAM lpParams, size_t nbParams)
+static int EmpilerParam(LPINTERPRETEUR ctx, char * lpszParam, LPPARAM lpParams, size_t nbParams)
 {
 	int ret = EVALUER_SUCCESS;
 
@@ -590,7 +497,7 @@ int EmpilerParam(char * lpszParam, LPPARAM lpParams, size_t nbParams)
 		{
 		    /* on empile la valeur du parametre */
 			EvaluerDebug("EmpilerOperande %g\n", x);
-			ret = EmpilerOperande(x);
+			ret = EmpilerOperande(ctx, x);
 		}
 		else
 		{
@@ -604,21 +511,21 @@ int EmpilerParam(char * lpszParam, LPPARAM lpParams, size_t nbParams)
 	return ret;
 }
 
-int Evaluer()
+static int Evaluer(LPINTERPRETEUR ctx)
 {
 	int ret = EVALUER_SUCCESS;
 
-	if (Operations.NbElements > 0)
+	if (ctx->Operations.NbElements > 0)
 	{
 		int operation;
 		size_t nbArgs, nbOperandes;
 		void * p_fonction;
 
-		operation = Operations.t[Operations.NbElements - 1];
+		operation = ctx->Operations.t[ctx->Operations.NbElements - 1];
 		nbArgs = TabOperations[operation].nbArgs;
 		p_fonction = TabOperations[operation].p_fonction;
 
-		nbOperandes = Operandes.NbElements;
+		nbOperandes = ctx->Operandes.NbElements;
 
 		if (nbOperandes >= nbArgs)
 		{
@@ -627,12 +534,12 @@ int Evaluer()
 				switch(nbArgs)
 				{
 				case 1:
-					Operandes.t[nbOperandes - 1] = ((F1VAR)p_fonction)(Operandes.t[nbOperandes - 1]);
+					ctx->Operandes.t[nbOperandes - 1] = ((F1VAR)p_fonction)(ctx->Operandes.t[nbOperandes - 1]);
 					break;
 
 				case 2:
-					Operandes.t[nbOperandes - 2] = ((F2VAR)p_fonction)(Operandes.t[nbOperandes - 2], Operandes.t[nbOperandes - 1]);
-					Operandes.NbElements--;
+					ctx->Operandes.t[nbOperandes - 2] = ((F2VAR)p_fonction)(ctx->Operandes.t[nbOperandes - 2], ctx->Operandes.t[nbOperandes - 1]);
+					ctx->Operandes.NbElements--;
 					break;
 
 				default:
@@ -640,7 +547,7 @@ int Evaluer()
 				}
 			}
 
-			Operations.NbElements--;
+			ctx->Operations.NbElements--;
 		}
 		else
 			ret = EVALUER_FEW_ARGS;
@@ -651,7 +558,7 @@ int Evaluer()
 	return ret;
 }
 
-M_Real my_Somme(M_Real a, M_Real b)
+static M_Real my_Somme(M_Real a, M_Real b)
 {
 	M_Real y;
 	y = a + b;
@@ -659,7 +566,7 @@ M_Real my_Somme(M_Real a, M_Real b)
 	return y;
 }
 
-M_Real my_Diff(M_Real a, M_Real b)
+static M_Real my_Diff(M_Real a, M_Real b)
 {
 	M_Real y;
 	y = a - b;
@@ -667,7 +574,7 @@ M_Real my_Diff(M_Real a, M_Real b)
 	return y;
 }
 
-M_Real my_Prod(M_Real a, M_Real b)
+static M_Real my_Prod(M_Real a, M_Real b)
 {
 	M_Real y;
 	y = a * b;
@@ -675,7 +582,7 @@ M_Real my_Prod(M_Real a, M_Real b)
 	return y;
 }
 
-M_Real my_Div(M_Real a, M_Real b)
+static M_Real my_Div(M_Real a, M_Real b)
 {
 	M_Real y;
 	y = a / b;
@@ -683,7 +590,7 @@ M_Real my_Div(M_Real a, M_Real b)
 	return y;
 }
 
-M_Real my_Pow(M_Real a, M_Real b)
+static M_Real my_Pow(M_Real a, M_Real b)
 {
 	M_Real y;
 	y = Pow(a, b);
@@ -691,7 +598,7 @@ M_Real my_Pow(M_Real a, M_Real b)
 	return y;
 }
 
-M_Real my_Opp(M_Real x)
+static M_Real my_Opp(M_Real x)
 {
 	M_Real y;
 	y = -x;
@@ -699,7 +606,7 @@ M_Real my_Opp(M_Real x)
 	return y;
 }
 
-M_Real my_Sin(M_Real x)
+static M_Real my_Sin(M_Real x)
 {
 	M_Real y;
 	y = Sin(x);
@@ -707,7 +614,7 @@ M_Real my_Sin(M_Real x)
 	return y;
 }
 
-M_Real my_Cos(M_Real x)
+static M_Real my_Cos(M_Real x)
 {
 	M_Real y;
 	y = Cos(x);
@@ -715,7 +622,7 @@ M_Real my_Cos(M_Real x)
 	return y;
 }
 
-M_Real my_Tan(M_Real x)
+static M_Real my_Tan(M_Real x)
 {
 	M_Real y;
 	y = Tan(x);
@@ -723,7 +630,7 @@ M_Real my_Tan(M_Real x)
 	return y;
 }
 
-M_Real my_Abs(M_Real x)
+static M_Real my_Abs(M_Real x)
 {
 	M_Real y;
 	y = Fabs(x);
@@ -731,7 +638,7 @@ M_Real my_Abs(M_Real x)
 	return y;
 }
 
-M_Real my_Racine(M_Real x)
+static M_Real my_Racine(M_Real x)
 {
 	M_Real y;
 	y = Sqrt(x);
@@ -739,7 +646,7 @@ M_Real my_Racine(M_Real x)
 	return y;
 }
 
-M_Real my_Log(M_Real x)
+static M_Real my_Log(M_Real x)
 {
 	M_Real y;
 	y = Log(x);
@@ -747,7 +654,7 @@ M_Real my_Log(M_Real x)
 	return y;
 }
 
-M_Real my_Log10(M_Real x)
+static M_Real my_Log10(M_Real x)
 {
 	M_Real y;
 	y = Log(x) / Log(10);
@@ -755,7 +662,7 @@ M_Real my_Log10(M_Real x)
 	return y;
 }
 
-M_Real my_Exp(M_Real x)
+static M_Real my_Exp(M_Real x)
 {
 	M_Real y;
 	y = Exp(x);
@@ -763,7 +670,7 @@ M_Real my_Exp(M_Real x)
 	return y;
 }
 
-M_Real my_UnitStep(M_Real x)
+static M_Real my_UnitStep(M_Real x)
 {
 	M_Real y;
 	y = x > 0 ? 1 : 0;
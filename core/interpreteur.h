@@ -26,8 +26,27 @@ typedef struct tagPARAM {
 	M_Real Value;
 }PARAM, * LPPARAM;
 
-void  InterpreteurInit(void);
-void  InterpreteurReset(void);
-int   Calculer(char * lpszString, LPPARAM lpParams, size_t nbParams, M_Real * lpResult);
+#define INTERPRETEUR_MAX_OPERATIONS    20
+#define INTERPRETEUR_MAX_OPERANDES     20
+
+/*
+ * Contexte d'evaluation (piles). Un contexte par appelant concurrent;
+ * Calculer() le reinitialise a chaque appel.
+ */
+typedef struct tagINTERPRETEUR {
+	struct {
+		size_t    NbElements;
+		int       t[INTERPRETEUR_MAX_OPERATIONS];
+	} Operations;
+	struct {
+		size_t    NbElements;
+		M_Real    t[INTERPRETEUR_MAX_OPERANDES];
+	} Operandes;
+}INTERPRETEUR, * LPINTERPRETEUR;
+
+__BEGIN_DECLS
+void  InterpreteurReset(LPINTERPRETEUR);
+int   Calculer(LPINTERPRETEUR, const char * lpszString, LPPARAM lpParams, size_t nbParams, M_Real * lpResult);
+__END_DECLS
 
 #endif /* _EDACIOUS_INTERPRETEUR_H_ */
@@ -38,6 +38,8 @@ Init(void *p)
 
 	lb->name[0] = '\0';
 	lb->com = NULL;
+	lb->extGen = 0;
+	lb->extScale = 0.0f;
 }
 
 static int
@@ -67,23 +69,40 @@ GetNodeExtent(VG_Node *vn, VG_View *vv, VG_Vector *aBlk, VG_Vector *bBlk)
 
 	if (vn->ops->extent != NULL) {
 		vn->ops->extent(vn, vv, &a, &b);
+		if (a.x < aBlk->x) { aBlk->x = a.x; }
+		if (a.y < aBlk->y) { aBlk->y = a.y; }
+		if (b.x > bBlk->x) { bBlk->x = b.x; }
+		if (b.y > bBlk->y) { bBlk->y = b.y; }
 	}
-	if (a.x < aBlk->x) { aBlk->x = a.x; }
-	if (a.y < aBlk->y) { aBlk->y = a.y; }
-	if (b.x > bBlk->x) { bBlk->x = b.x; }
-	if (b.y > bBlk->y) { bBlk->y = b.y; }
 
 	VG_FOREACH_CHLD(vnChld, vn, vg_node)
 		GetNodeExtent(vnChld, vv, aBlk, bBlk);
 }
 
+/*
+ * Return the extent of the block. Computing the extents of the entities
+ * (text in particular) is costly, so the result is cached (relative to the
+ * position of the block, so that it remains valid while the block is
+ * dragged) until the next edit of the VG (see ES_SpatialInvalidate()) or
+ * until the view is zoomed.
+ */
 static void
 Extent(void *p, VG_View *vv, VG_Vector *a, VG_Vector *b)
 {
 	ES_LayoutBlock *lb = p;
-	VG_Vector vPos = VG_Pos(lb);
+	VG_Vector vPos;
 	VG_Node *vnChld;
 
+	vPos = VG_Pos(lb);
+	if (lb->extScale == vv->wPixel &&
+	    lb->extGen == ES_SpatialGeneration(vv->vg)) {
+		a->x = vPos.x + lb->extA.x;
+		a->y = vPos.y + lb->extA.y;
+		b->x = vPos.x + lb->extB.x;
+		b->y = vPos.y + lb->extB.y;
+		return;
+	}
+
 	a->x = vPos.x;
 	a->y = vPos.y;
 	b->x = vPos.x;
@@ -91,6 +110,13 @@ Extent(void *p, VG_View *vv, VG_Vector *a, VG_Vector *b)
 
 	VG_FOREACH_CHLD(vnChld, lb, vg_node)
 		GetNodeExtent(vnChld, vv, a, b);
+
+	lb->extA.x = a->x - vPos.x;
+	lb->extA.y = a->y - vPos.y;
+	lb->extB.x = b->x - vPos.x;
+	lb->extB.y = b->y - vPos.y;
+	lb->extGen = ES_SpatialGeneration(vv->vg);
+	lb->extScale = vv->wPixel;
 }
 
 static void
@@ -103,6 +129,9 @@ Draw(void *p, VG_View *vv)
 
 	if (lb->com->flags & (ES_COMPONENT_SELECTED|ES_COMPONENT_HIGHLIGHTED)) {
 		Extent(lb, vv, &a, &b);
+		if (!ES_SpatialVisible(vv, a, b)) {
+			return;
+		}
 		a.x -= vv->wPixel*4;
 		a.y -= vv->wPixel*4;
 		b.x += vv->wPixel*4;
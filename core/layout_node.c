@@ -74,11 +74,19 @@ Draw(void *p, VG_View *vv)
 {
 	ES_LayoutNode *ln = p;
 	AG_Color c;
-	int x, y;
+	int x, y, r;
 
 	VG_GetViewCoords(vv, VG_Pos(ln), &x, &y);
+
+	/* Skip nodes outside of the view or smaller than a pixel. */
+	r = (int)(1.0f*vv->scale);
+	if (r < 1 ||
+	    x+r < 0 || x-r >= AGWIDGET(vv)->w ||
+	    y+r < 0 || y-r >= AGWIDGET(vv)->h)
+		return;
+
 	c = VG_MapColorRGB(VGNODE(ln)->color);
-	AG_DrawCircle(vv, x, y, (int)(1.0f*vv->scale), &c);
+	AG_DrawCircle(vv, x, y, r, &c);
 }
 
 static void
@@ -92,6 +92,9 @@ Draw(void *p, VG_View *vv)
 	AG_Color c;
 	int x1, y1, x2, y2;
 	
+	if (!ES_SpatialVisible(vv, v1, v2)) {
+		return;
+	}
 	VG_GetViewCoords(vv, v1, &x1, &y1);
 	VG_GetViewCoords(vv, v2, &x2, &y2);
 	c = VG_MapColorRGB(VGNODE(lt)->color);
@@ -0,0 +1,1342 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere <vedge@csoft.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Persistent index of the object files in a library. Rather than loading
+ * every file at startup, the search directories are scanned and only the
+ * headers of new or modified files are read. The index is saved under
+ * ~/.edacious, and the objects are instantiated on demand.
+ *
+ * While browsers are attached, the directories are watched (with inotify
+ * on Linux, otherwise by polling their modification times) and only the
+ * directories which have changed are rescanned.
+ */
+
+#include "core.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <config/have_getpwuid.h>
+#include <config/have_getuid.h>
+
+#if defined(HAVE_GETPWUID) && defined(HAVE_GETUID)
+#include <pwd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#define ES_LIBRARY_INOTIFY_MASK (IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | \
+                                 IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | \
+                                 IN_DELETE_SELF | IN_MOVE_SELF)
+#endif
+
+#define ES_LIBRARY_INDEX_MAX	(1024*1024)	/* Sanity check */
+
+/* Entries of the previous update, matched against the files found. */
+typedef struct es_library_scan {
+	ES_LibraryEntry *old;		/* Previous entries (sorted by path) */
+	Uint            nOld;
+	Uint8          *taken;		/* Entry was carried over */
+} ES_LibraryScan;
+
+static int
+CompareEntryPaths(const void *p1, const void *p2)
+{
+	const ES_LibraryEntry *e1 = p1, *e2 = p2;
+
+	return strcmp(e1->path, e2->path);
+}
+
+static int
+CompareEntries(const void *p1, const void *p2)
+{
+	const ES_LibraryEntry *e1 = p1, *e2 = p2;
+
+	if (e1->folder != e2->folder) {
+		return (e1->folder - e2->folder);
+	}
+	return strcmp(e1->name, e2->name);
+}
+
+static int
+CompareEntryIds(const void *p1, const void *p2)
+{
+	const ES_LibraryEntry *e1 = *(ES_LibraryEntry *const *)p1;
+	const ES_LibraryEntry *e2 = *(ES_LibraryEntry *const *)p2;
+
+	return (e1->id < e2->id) ? -1 : (e1->id > e2->id);
+}
+
+static void
+FreeEntry(ES_LibraryEntry *ent)
+{
+	Free(ent->path);
+	Free(ent->classSpec);
+	Free(ent->categories);
+}
+
+/*
+ * Drop the instance of an entry which no longer exists (or has changed on
+ * disk). Instances which are in use or have unsaved changes are left in
+ * the library root.
+ */
+static void
+ReleaseObject(AG_Object *obj)
+{
+	if (obj == NULL ||
+	    AG_ObjectInUse(obj) ||
+	    AG_ObjectChanged(obj)) {
+		return;
+	}
+	AG_ObjectDelete(obj);
+}
+
+/*
+ * Resolve the class of an entry if it is registered (without loading any
+ * module), and record its categories.
+ */
+static void
+ResolveClass(ES_LibraryIndex *idx, ES_LibraryEntry *ent)
+{
+	AG_ObjectClassSpec cs;
+	ES_ComponentClass *clCom;
+
+	if (ent->cls == NULL) {
+		if (AG_ParseClassSpec(&cs, ent->classSpec) == -1 ||
+		    (ent->cls = AG_LookupClass(cs.hier)) == NULL)
+			return;
+	}
+	if (ent->categories == NULL &&
+	    AG_ClassIsNamed(ent->cls, "ES_Circuit:ES_Component:*")) {
+		clCom = (ES_ComponentClass *)ent->cls;
+		if (clCom->categories != NULL) {
+			ent->categories = Strdup(clCom->categories);
+			idx->dirty = 1;
+		}
+	}
+}
+
+/* Read the class of an object file from its header. */
+static int
+ReadEntryHeader(ES_LibraryIndex *idx, ES_LibraryEntry *ent, const char *path)
+{
+	char spec[AG_OBJECT_HIER_MAX+AG_OBJECT_LIBS_MAX+1];
+	AG_ObjectHeader oh;
+	AG_DataSource *ds;
+
+	if ((ds = AG_OpenFile(path, "rb")) == NULL) {
+		return (-1);
+	}
+	if (AG_ObjectReadHeader(ds, &oh) == -1) {
+		AG_CloseFile(ds);
+		return (-1);
+	}
+	AG_CloseFile(ds);
+
+	Strlcpy(spec, oh.cs.hier, sizeof(spec));
+	if (oh.cs.libs[0] != '\0') {
+		Strlcat(spec, "@", sizeof(spec));
+		Strlcat(spec, oh.cs.libs, sizeof(spec));
+	}
+	ent->classSpec = Strdup(spec);
+	ResolveClass(idx, ent);
+	idx->nHeaders++;
+	return (0);
+}
+
+/* Read the entries of the saved index (sorted by path). */
+static int
+ReadIndex(ES_LibraryIndex *idx, ES_LibraryScan *scan)
+{
+	AG_DataSource *ds;
+	ES_LibraryEntry *ents;
+	Uint i, count;
+
+	if (idx->path[0] == '\0' || AG_FileExists(idx->path) != 1) {
+		return (0);
+	}
+	if ((ds = AG_OpenFile(idx->path, "rb")) == NULL) {
+		return (-1);
+	}
+	if (AG_ReadUint32(ds) != ES_LIBRARY_INDEX_MAGIC ||
+	    AG_ReadUint32(ds) != ES_LIBRARY_INDEX_VERSION ||
+	    (count = (Uint)AG_ReadUint32(ds)) > ES_LIBRARY_INDEX_MAX) {
+		AG_SetError(_("%s: Bad index version"), idx->path);
+		AG_CloseFile(ds);
+		return (-1);
+	}
+	ents = (count > 0) ? Malloc(count*sizeof(ES_LibraryEntry)) : NULL;
+	for (i = 0; i < count; i++) {
+		ES_LibraryEntry *ent = &ents[i];
+
+		memset(ent, 0, sizeof(ES_LibraryEntry));
+		ent->path = AG_ReadString(ds);
+		ent->mtime = AG_ReadUint32(ds);
+		ent->size = AG_ReadUint32(ds);
+		ent->classSpec = AG_ReadString(ds);
+		ent->categories = AG_ReadString(ds);
+		if (ent->path == NULL || ent->classSpec == NULL ||
+		    ent->categories == NULL) {
+			AG_SetError(_("%s: Bad index entry"), idx->path);
+			count = i+1;
+			goto fail;
+		}
+		if (ent->categories[0] == '\0') {
+			Free(ent->categories);
+			ent->categories = NULL;
+		}
+	}
+	AG_CloseFile(ds);
+
+	if (count > 0) {
+		qsort(ents, count, sizeof(ES_LibraryEntry), CompareEntryPaths);
+	}
+	scan->old = ents;
+	scan->nOld = count;
+	return (0);
+fail:
+	for (i = 0; i < count; i++) {
+		FreeEntry(&ents[i]);
+	}
+	Free(ents);
+	AG_CloseFile(ds);
+	return (-1);
+}
+
+/* Save the index. */
+static int
+WriteIndex(ES_LibraryIndex *idx)
+{
+	char pathTmp[AG_PATHNAME_MAX];
+	AG_DataSource *ds;
+	Uint i;
+
+	if (idx->path[0] == '\0') {
+		return (0);
+	}
+	Strlcpy(pathTmp, idx->path, sizeof(pathTmp));
+	Strlcat(pathTmp, ".tmp", sizeof(pathTmp));
+	if ((ds = AG_OpenFile(pathTmp, "wb")) == NULL) {
+		return (-1);
+	}
+	AG_WriteUint32(ds, ES_LIBRARY_INDEX_MAGIC);
+	AG_WriteUint32(ds, ES_LIBRARY_INDEX_VERSION);
+	AG_WriteUint32(ds, (Uint32)idx->nEnts);
+	for (i = 0; i < idx->nEnts; i++) {
+		ES_LibraryEntry *ent = &idx->ents[i];
+
+		AG_WriteString(ds, ent->path);
+		AG_WriteUint32(ds, ent->mtime);
+		AG_WriteUint32(ds, ent->size);
+		AG_WriteString(ds, ent->classSpec);
+		AG_WriteString(ds, (ent->categories != NULL) ?
+		                   ent->categories : "");
+	}
+	AG_CloseFile(ds);
+
+	/* Replace the old index atomically. */
+	if (rename(pathTmp, idx->path) == -1) {
+		AG_SetError("%s: %s", idx->path, strerror(errno));
+		return (-1);
+	}
+	idx->dirty = 0;
+	return (0);
+}
+
+/* Return the named subfolder of a folder, creating it if needed. */
+static int
+GetFolder(ES_LibraryIndex *idx, int parent, const char *name)
+{
+	char path[AG_PATHNAME_MAX];
+	ES_LibraryFolder *fo;
+	int f, prev = -1, cmp = 1;
+	char *s;
+
+	/* Siblings are kept in alphabetical order. */
+	for (f = idx->folders[parent].child; f != -1;
+	     f = idx->folders[f].next) {
+		if ((cmp = strcmp(idx->folders[f].name, name)) >= 0) {
+			break;
+		}
+		prev = f;
+	}
+	if (f != -1 && cmp == 0) {
+		return (f);
+	}
+	if (idx->folders[parent].path[0] != '\0') {
+		Strlcpy(path, idx->folders[parent].path, sizeof(path));
+		Strlcat(path, PATHSEP, sizeof(path));
+		Strlcat(path, name, sizeof(path));
+	} else {
+		Strlcpy(path, name, sizeof(path));
+	}
+	idx->folders = Realloc(idx->folders,
+	    (idx->nFolders+1)*sizeof(ES_LibraryFolder));
+	fo = &idx->folders[idx->nFolders];
+	fo->path = Strdup(path);
+	fo->name = (s = strrchr(fo->path, PATHSEPCHAR)) != NULL ? &s[1] :
+	                                                     fo->path;
+	fo->id = ++idx->lastId;
+	fo->parent = parent;
+	fo->child = -1;
+	fo->next = f;
+	fo->entFirst = 0;
+	fo->nEnts = 0;
+	fo->flags = 0;
+
+	if (prev == -1) {
+		idx->folders[parent].child = (int)idx->nFolders;
+	} else {
+		idx->folders[prev].next = (int)idx->nFolders;
+	}
+	return ((int)idx->nFolders++);
+}
+
+/* Return 1 if path is a file or directory immediately under dir. */
+static int
+IsChildPath(const char *dir, const char *path)
+{
+	size_t len = strlen(dir);
+
+	return (strncmp(path, dir, len) == 0 &&
+	        path[len] == PATHSEPCHAR &&
+	        strchr(&path[len+1], PATHSEPCHAR) == NULL);
+}
+
+/* Hide a folder from its parent. */
+static void
+UnlinkFolder(ES_LibraryIndex *idx, int f)
+{
+	int *pLink;
+
+	for (pLink = &idx->folders[idx->folders[f].parent].child;
+	     *pLink != -1;
+	     pLink = &idx->folders[*pLink].next) {
+		if (*pLink == f) {
+			*pLink = idx->folders[f].next;
+			break;
+		}
+	}
+}
+
+/* Watch a library directory for changes. */
+static void
+AddWatch(ES_LibraryIndex *idx, const char *path, int folder)
+{
+	ES_LibraryWatch *w;
+	struct stat sb;
+	Uint i;
+
+	for (i = 0; i < idx->nWatches; i++) {
+		if (strcmp(idx->watches[i].path, path) == 0)
+			return;
+	}
+	idx->watches = Realloc(idx->watches,
+	    (idx->nWatches+1)*sizeof(ES_LibraryWatch));
+	w = &idx->watches[idx->nWatches++];
+	w->path = Strdup(path);
+	w->folder = folder;
+	w->wd = -1;
+	w->mtime = (stat(path, &sb) == 0) ? (Uint32)sb.st_mtime : 0;
+	w->tScan = (Uint32)time(NULL);
+	w->flags = 0;
+#ifdef __linux__
+	if (idx->watchFd != -1 &&
+	    (w->wd = inotify_add_watch(idx->watchFd, path,
+	     ES_LIBRARY_INOTIFY_MASK)) == -1)
+		AG_Verbose("Watching %s: %s\n", path, strerror(errno));
+#endif
+}
+
+static void
+RemoveWatch(ES_LibraryIndex *idx, Uint i)
+{
+	ES_LibraryWatch *w = &idx->watches[i];
+
+#ifdef __linux__
+	if (w->wd != -1)
+		inotify_rm_watch(idx->watchFd, w->wd);
+#endif
+	Free(w->path);
+	if (i < idx->nWatches-1) {
+		memmove(w, &idx->watches[i+1],
+		    (idx->nWatches-i-1)*sizeof(ES_LibraryWatch));
+	}
+	idx->nWatches--;
+}
+
+static void
+ClearWatches(ES_LibraryIndex *idx)
+{
+	while (idx->nWatches > 0)
+		RemoveWatch(idx, idx->nWatches-1);
+}
+
+/*
+ * Forget about a directory which no longer exists, its contents and
+ * its subdirectories.
+ */
+static void
+RemoveDir(ES_LibraryIndex *idx, const char *pathDir)
+{
+	char path[AG_PATHNAME_MAX];
+	size_t len;
+	int folder = -1;
+	Uint i;
+
+	Strlcpy(path, pathDir, sizeof(path));
+	len = strlen(path);
+
+	for (i = 0; i < idx->nEnts; i++) {
+		ES_LibraryEntry *ent = &idx->ents[i];
+
+		if (strncmp(ent->path, path, len) == 0 &&
+		    ent->path[len] == PATHSEPCHAR)
+			ent->flags |= ES_LIBRARY_ENTRY_REMOVED;
+	}
+	for (i = 0; i < idx->nWatches; ) {
+		ES_LibraryWatch *w = &idx->watches[i];
+
+		if (strcmp(w->path, path) == 0) {
+			folder = w->folder;
+		} else if (strncmp(w->path, path, len) != 0 ||
+		           w->path[len] != PATHSEPCHAR) {
+			i++;
+			continue;
+		}
+		RemoveWatch(idx, i);
+	}
+
+	/* Hide the folder unless it also exists under another search path. */
+	if (folder > 0) {
+		for (i = 0; i < idx->nWatches; i++) {
+			if (idx->watches[i].folder == folder)
+				return;
+		}
+		UnlinkFolder(idx, folder);
+	}
+}
+
+/* Add an object file found on disk. */
+static int
+AddEntry(ES_LibraryIndex *idx, ES_LibraryScan *scan, const char *path,
+    const struct stat *sb, int folder)
+{
+	ES_LibraryEntry key, *prev = NULL, *ent;
+
+	if (scan->nOld > 0) {
+		key.path = (char *)path;
+		prev = bsearch(&key, scan->old, scan->nOld,
+		    sizeof(ES_LibraryEntry), CompareEntryPaths);
+		if (prev != NULL && scan->taken[prev - scan->old])
+			prev = NULL;
+	}
+	idx->ents = Realloc(idx->ents, (idx->nEnts+1)*sizeof(ES_LibraryEntry));
+	ent = &idx->ents[idx->nEnts];
+
+	if (prev != NULL &&
+	    prev->mtime == (Uint32)sb->st_mtime &&
+	    prev->size == (Uint32)sb->st_size) {
+		/* Unchanged since the last update. */
+		memcpy(ent, prev, sizeof(ES_LibraryEntry));
+		scan->taken[prev - scan->old] = 1;
+
+		/* Forget instances which were saved under another name. */
+		if (ent->obj != NULL &&
+		    (!AG_Defined(ent->obj, "archive-path") ||
+		     strcmp(AG_GetStringP(ent->obj,"archive-path"), path) != 0))
+			ent->obj = NULL;
+	} else {
+		memset(ent, 0, sizeof(ES_LibraryEntry));
+		if (ReadEntryHeader(idx, ent, path) == -1) {
+			return (-1);
+		}
+		ent->path = Strdup(path);
+		ent->mtime = (Uint32)sb->st_mtime;
+		ent->size = (Uint32)sb->st_size;
+		idx->dirty = 1;
+	}
+	Strlcpy(ent->name, AG_ShortFilename(path), sizeof(ent->name));
+	ent->folder = folder;
+	ent->flags = 0;
+	if (ent->id == 0) {
+		ent->id = ++idx->lastId;
+	}
+	idx->nEnts++;
+	return (0);
+}
+
+/* Scan a library directory (and subdirectories) for object files. */
+static int
+ScanDir(ES_LibraryIndex *idx, ES_LibraryScan *scan, const char *dirPath,
+    int folder)
+{
+	char path[AG_PATHNAME_MAX];
+	size_t extLen = strlen(idx->ext);
+	AG_Dir *dir;
+	int j;
+
+	if ((dir = AG_OpenDir(dirPath)) == NULL) {
+		return (-1);
+	}
+	AddWatch(idx, dirPath, folder);
+
+	for (j = 0; j < dir->nents; j++) {
+		char *file = dir->ents[j];
+		struct stat sb;
+		size_t len;
+
+		if (file[0] == '.')
+			continue;
+
+		Strlcpy(path, dirPath, sizeof(path));
+		Strlcat(path, PATHSEP, sizeof(path));
+		Strlcat(path, file, sizeof(path));
+
+		if (stat(path, &sb) == -1) {
+			AG_Verbose("Ignoring: %s (%s)\n", path, strerror(errno));
+			continue;
+		}
+		if (S_ISDIR(sb.st_mode)) {
+			if (ScanDir(idx, scan, path,
+			    GetFolder(idx, folder, file)) == -1) {
+				AG_Verbose("Ignoring folder: %s (%s)\n", path,
+				    AG_GetError());
+			}
+			continue;
+		}
+		if ((len = strlen(file)) <= extLen ||
+		    strcmp(&file[len-extLen], idx->ext) != 0) {
+			continue;
+		}
+		if (AddEntry(idx, scan, path, &sb, folder) == -1)
+			AG_Verbose("Ignoring file: %s (%s)\n", path,
+			    AG_GetError());
+	}
+	AG_CloseDir(dir);
+	return (0);
+}
+
+/* Refresh the attached browsers. */
+static void
+RefreshBrowsers(ES_LibraryIndex *idx)
+{
+	Uint i;
+
+	for (i = 0; i < idx->nTlists; i++)
+		AG_TlistRefresh(idx->tlists[i]);
+}
+
+/*
+ * Refresh the browsers which display a folder that has changed. Entries
+ * and subfolders of a changed folder are only listed while the folder
+ * itself is displayed, so changes under collapsed folders are not pushed.
+ */
+static void
+RefreshChanged(ES_LibraryIndex *idx)
+{
+	AG_Tlist *tl;
+	Uint i, f;
+
+	for (i = 0; i < idx->nTlists; i++) {
+		tl = idx->tlists[i];
+		for (f = 0; f < idx->nFolders; f++) {
+			ES_LibraryFolder *fo = &idx->folders[f];
+
+			if ((fo->flags & ES_LIBRARY_FOLDER_CHANGED) &&
+			    AG_TlistFindPtr(tl, ES_LIBRARY_ITEM_KEY(fo->id))
+			    != NULL) {
+				AG_TlistRefresh(tl);
+				break;
+			}
+		}
+	}
+	for (f = 0; f < idx->nFolders; f++)
+		idx->folders[f].flags &= ~(ES_LIBRARY_FOLDER_CHANGED);
+}
+
+/*
+ * Group the entries by folder, dropping the entries which were removed,
+ * and index them by key for ES_LibraryIndexGetItem().
+ */
+static void
+Regroup(ES_LibraryIndex *idx)
+{
+	Uint i, j, f;
+
+	for (i = 0, j = 0; i < idx->nEnts; i++) {
+		ES_LibraryEntry *ent = &idx->ents[i];
+
+		if (ent->flags & ES_LIBRARY_ENTRY_REMOVED) {
+			ReleaseObject(ent->obj);
+			FreeEntry(ent);
+			idx->dirty = 1;
+			continue;
+		}
+		ent->flags = 0;
+		if (i != j) {
+			memcpy(&idx->ents[j], ent, sizeof(ES_LibraryEntry));
+		}
+		j++;
+	}
+	idx->nEnts = j;
+
+	if (idx->nEnts > 0) {
+		qsort(idx->ents, idx->nEnts, sizeof(ES_LibraryEntry),
+		    CompareEntries);
+	}
+	for (f = 0; f < idx->nFolders; f++) {
+		idx->folders[f].entFirst = 0;
+		idx->folders[f].nEnts = 0;
+	}
+	for (i = idx->nEnts; i > 0; i--) {
+		ES_LibraryFolder *fo = &idx->folders[idx->ents[i-1].folder];
+
+		fo->entFirst = i-1;
+		fo->nEnts++;
+	}
+	idx->nGrouped = idx->nEnts;
+	idx->byId = Realloc(idx->byId,
+	    (idx->nEnts+1)*sizeof(ES_LibraryEntry *));
+	for (i = 0; i < idx->nEnts; i++) {
+		idx->byId[i] = &idx->ents[i];
+	}
+	if (idx->nEnts > 0) {
+		qsort(idx->byId, idx->nEnts, sizeof(ES_LibraryEntry *),
+		    CompareEntryIds);
+	}
+	idx->pollNext = 0;
+	idx->gen++;
+}
+
+/* Look up the entry of a file in a folder (or among new entries). */
+static ES_LibraryEntry *
+LookupEntry(ES_LibraryIndex *idx, int folder, const char *path)
+{
+	ES_LibraryFolder *fo = &idx->folders[folder];
+	Uint i;
+
+	for (i = fo->entFirst; i < fo->entFirst+fo->nEnts; i++) {
+		ES_LibraryEntry *ent = &idx->ents[i];
+
+		if (!(ent->flags & ES_LIBRARY_ENTRY_REMOVED) &&
+		    strcmp(ent->path, path) == 0)
+			return (ent);
+	}
+	for (i = idx->nGrouped; i < idx->nEnts; i++) {
+		ES_LibraryEntry *ent = &idx->ents[i];
+
+		if (!(ent->flags & ES_LIBRARY_ENTRY_REMOVED) &&
+		    strcmp(ent->path, path) == 0)
+			return (ent);
+	}
+	return (NULL);
+}
+
+/* Re-read the header of a file which has been modified. */
+static int
+ReloadEntry(ES_LibraryIndex *idx, ES_LibraryEntry *ent, const struct stat *sb)
+{
+	ES_LibraryEntry entNew;
+
+	memset(&entNew, 0, sizeof(ES_LibraryEntry));
+	if (ReadEntryHeader(idx, &entNew, ent->path) == -1) {
+		ent->flags |= ES_LIBRARY_ENTRY_REMOVED;
+		return (-1);
+	}
+	Free(ent->classSpec);
+	Free(ent->categories);
+	ent->classSpec = entNew.classSpec;
+	ent->categories = entNew.categories;
+	ent->cls = entNew.cls;
+	ent->mtime = (Uint32)sb->st_mtime;
+	ent->size = (Uint32)sb->st_size;
+
+	/* The instance will be reloaded when it is next needed. */
+	ReleaseObject(ent->obj);
+	ent->obj = NULL;
+	idx->dirty = 1;
+	return (0);
+}
+
+/*
+ * Bring the entries and subfolders of a watched directory up to date.
+ * Return 1 if anything has changed.
+ */
+static int
+RescanDir(ES_LibraryIndex *idx, Uint wIdx)
+{
+	char dirPath[AG_PATHNAME_MAX], path[AG_PATHNAME_MAX];
+	ES_LibraryScan scan;
+	ES_LibraryEntry *ent;
+	size_t extLen = strlen(idx->ext);
+	int folder = idx->watches[wIdx].folder, changed = 0, j;
+	struct stat sb;
+	AG_Dir *dir;
+	Uint i;
+
+	Strlcpy(dirPath, idx->watches[wIdx].path, sizeof(dirPath));
+	idx->watches[wIdx].flags &= ~(ES_LIBRARY_WATCH_DIRTY);
+
+	if ((dir = AG_OpenDir(dirPath)) == NULL) {
+		idx->folders[folder].flags |= ES_LIBRARY_FOLDER_CHANGED;
+		RemoveDir(idx, dirPath);
+		return (1);
+	}
+	if (stat(dirPath, &sb) == 0) {
+		idx->watches[wIdx].mtime = (Uint32)sb.st_mtime;
+	}
+	idx->watches[wIdx].tScan = (Uint32)time(NULL);
+	for (i = 0; i < idx->nEnts; i++) {
+		idx->ents[i].flags &= ~(ES_LIBRARY_ENTRY_SEEN);
+	}
+	for (i = 0; i < idx->nWatches; i++) {
+		idx->watches[i].flags &= ~(ES_LIBRARY_WATCH_SEEN);
+	}
+	scan.old = NULL;
+	scan.nOld = 0;
+	scan.taken = NULL;
+
+	for (j = 0; j < dir->nents; j++) {
+		char *file = dir->ents[j];
+		size_t len;
+
+		if (file[0] == '.')
+			continue;
+
+		Strlcpy(path, dirPath, sizeof(path));
+		Strlcat(path, PATHSEP, sizeof(path));
+		Strlcat(path, file, sizeof(path));
+
+		if (stat(path, &sb) == -1) {
+			continue;
+		}
+		if (S_ISDIR(sb.st_mode)) {
+			Uint nWatches = idx->nWatches;
+
+			for (i = 0; i < nWatches; i++) {
+				if (strcmp(idx->watches[i].path, path) == 0)
+					break;
+			}
+			if (i < nWatches) {
+				idx->watches[i].flags |= ES_LIBRARY_WATCH_SEEN;
+				continue;
+			}
+			/* New folder */
+			if (ScanDir(idx, &scan, path,
+			    GetFolder(idx, folder, file)) == -1) {
+				AG_Verbose("Ignoring folder: %s (%s)\n", path,
+				    AG_GetError());
+				continue;
+			}
+			idx->watches[nWatches].flags |= ES_LIBRARY_WATCH_SEEN;
+			changed = 1;
+			continue;
+		}
+		if ((len = strlen(file)) <= extLen ||
+		    strcmp(&file[len-extLen], idx->ext) != 0) {
+			continue;
+		}
+		if ((ent = LookupEntry(idx, folder, path)) != NULL) {
+			ent->flags |= ES_LIBRARY_ENTRY_SEEN;
+			if (ent->mtime == (Uint32)sb.st_mtime &&
+			    ent->size == (Uint32)sb.st_size) {
+				continue;
+			}
+			if (ReloadEntry(idx, ent, &sb) == -1) {
+				AG_Verbose("Ignoring file: %s (%s)\n", path,
+				    AG_GetError());
+			}
+			changed = 1;
+		} else {
+			if (AddEntry(idx, &scan, path, &sb, folder) == -1) {
+				AG_Verbose("Ignoring file: %s (%s)\n", path,
+				    AG_GetError());
+				continue;
+			}
+			idx->ents[idx->nEnts-1].flags |= ES_LIBRARY_ENTRY_SEEN;
+			changed = 1;
+		}
+	}
+	AG_CloseDir(dir);
+
+	/* Files and subdirectories which have disappeared. */
+	for (i = 0; i < idx->nEnts; i++) {
+		ent = &idx->ents[i];
+		if (!(ent->flags & (ES_LIBRARY_ENTRY_SEEN |
+		                    ES_LIBRARY_ENTRY_REMOVED)) &&
+		    IsChildPath(dirPath, ent->path)) {
+			ent->flags |= ES_LIBRARY_ENTRY_REMOVED;
+			changed = 1;
+		}
+	}
+	for (i = 0; i < idx->nWatches; ) {
+		ES_LibraryWatch *w = &idx->watches[i];
+
+		if (!(w->flags & ES_LIBRARY_WATCH_SEEN) &&
+		    IsChildPath(dirPath, w->path)) {
+			RemoveDir(idx, w->path);
+			changed = 1;
+			i = 0;			/* Watches have changed */
+			continue;
+		}
+		i++;
+	}
+	if (changed) {
+		idx->folders[folder].flags |= ES_LIBRARY_FOLDER_CHANGED;
+	}
+	return (changed);
+}
+
+#ifdef __linux__
+/* Mark the directories reported by inotify for rescan. */
+static void
+ReadNotifications(ES_LibraryIndex *idx)
+{
+	char buf[4096]
+	    __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	ssize_t len;
+	char *p;
+	Uint i;
+
+	while ((len = read(idx->watchFd, buf, sizeof(buf))) > 0) {
+		for (p = buf; p < &buf[len];
+		     p += sizeof(struct inotify_event) + ev->len) {
+			ev = (const struct inotify_event *)p;
+			if (ev->mask & IN_Q_OVERFLOW) {
+				/* Events were lost; rescan everything. */
+				for (i = 0; i < idx->nWatches; i++) {
+					idx->watches[i].flags |=
+					    ES_LIBRARY_WATCH_DIRTY;
+				}
+				continue;
+			}
+			for (i = 0; i < idx->nWatches; i++) {
+				ES_LibraryWatch *w = &idx->watches[i];
+
+				if (w->wd != ev->wd) {
+					continue;
+				}
+				if (ev->mask & IN_IGNORED) {
+					w->wd = -1;
+				}
+				w->flags |= ES_LIBRARY_WATCH_DIRTY;
+				break;
+			}
+		}
+	}
+}
+#endif /* __linux__ */
+
+/*
+ * Mark the directories whose modification time differs from the one
+ * recorded at their last scan for rescan. Files modified in place do not
+ * affect the directory, so a few of them are checked on every call.
+ */
+static void
+PollChanges(ES_LibraryIndex *idx)
+{
+	Uint32 now = (Uint32)time(NULL);
+	struct stat sb;
+	Uint i, n;
+
+	for (i = 0; i < idx->nWatches; i++) {
+		ES_LibraryWatch *w = &idx->watches[i];
+
+		/*
+		 * Changes made within the second of the last scan would
+		 * not affect the mtime, so scan once more after that second
+		 * has passed (which also clears the condition).
+		 */
+		if (stat(w->path, &sb) == -1 ||
+		    (Uint32)sb.st_mtime != w->mtime ||
+		    (w->mtime >= w->tScan && now > w->mtime))
+			w->flags |= ES_LIBRARY_WATCH_DIRTY;
+	}
+	for (n = 0; n < ES_LIBRARY_POLL_FILES && n < idx->nEnts; n++) {
+		ES_LibraryEntry *ent;
+
+		if (idx->pollNext >= idx->nEnts) {
+			idx->pollNext = 0;
+		}
+		ent = &idx->ents[idx->pollNext++];
+		if (stat(ent->path, &sb) == 0 &&
+		    ent->mtime == (Uint32)sb.st_mtime &&
+		    ent->size == (Uint32)sb.st_size) {
+			continue;
+		}
+		for (i = 0; i < idx->nWatches; i++) {
+			if (IsChildPath(idx->watches[i].path, ent->path))
+				idx->watches[i].flags |= ES_LIBRARY_WATCH_DIRTY;
+		}
+	}
+}
+
+/*
+ * Process pending changes to the library directories, rescanning only
+ * the affected directories. Return 1 if the library has changed.
+ */
+int
+ES_LibraryIndexCheck(ES_LibraryIndex *idx)
+{
+	Uint i;
+	int changed = 0;
+
+	if (idx->root == NULL) {
+		return (0);
+	}
+#ifdef __linux__
+	if (idx->watchFd != -1) {
+		ReadNotifications(idx);
+	} else
+#endif
+	{
+		PollChanges(idx);
+	}
+
+	AG_LockVFS(idx->root);
+	idx->nHeaders = 0;
+	for (i = 0; i < idx->nWatches; ) {
+		if (idx->watches[i].flags & ES_LIBRARY_WATCH_DIRTY) {
+			if (RescanDir(idx, i) == 1) {
+				changed = 1;
+			}
+			i = 0;			/* Watches may have changed */
+			continue;
+		}
+		i++;
+	}
+	if (changed) {
+		Regroup(idx);
+		RefreshChanged(idx);
+	}
+	AG_UnlockVFS(idx->root);
+
+	if (changed) {
+		Debug(idx->root, "%s: %u entries, %u header(s) read\n",
+		    idx->name, idx->nEnts, idx->nHeaders);
+		if (idx->dirty && WriteIndex(idx) == -1)
+			AG_Verbose("Saving index: %s\n", AG_GetError());
+	}
+	return (changed);
+}
+
+static Uint32
+WatchLibrary(AG_Timer *tm, AG_Event *event)
+{
+	ES_LibraryIndex *idx = AG_PTR(1);
+
+	(void)ES_LibraryIndexCheck(idx);
+
+	return (idx->watchFd != -1) ? ES_LIBRARY_WATCH_IVAL :
+	                              ES_LIBRARY_POLL_IVAL;
+}
+
+static void
+StartWatching(ES_LibraryIndex *idx)
+{
+#ifdef __linux__
+	Uint i;
+
+	if ((idx->watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1) {
+		AG_Verbose("inotify: %s; polling for changes\n",
+		    strerror(errno));
+	} else {
+		for (i = 0; i < idx->nWatches; i++) {
+			ES_LibraryWatch *w = &idx->watches[i];
+
+			w->wd = inotify_add_watch(idx->watchFd, w->path,
+			    ES_LIBRARY_INOTIFY_MASK);
+		}
+	}
+#endif
+	AG_AddTimer(idx->root, &idx->toWatch,
+	    (idx->watchFd != -1) ? ES_LIBRARY_WATCH_IVAL : ES_LIBRARY_POLL_IVAL,
+	    WatchLibrary, "%p", idx);
+}
+
+static void
+StopWatching(ES_LibraryIndex *idx)
+{
+	Uint i;
+
+	AG_DelTimer(idx->root, &idx->toWatch);
+#ifdef __linux__
+	if (idx->watchFd != -1) {
+		close(idx->watchFd);
+		idx->watchFd = -1;
+	}
+#endif
+	for (i = 0; i < idx->nWatches; i++)
+		idx->watches[i].wd = -1;
+}
+
+static void
+OnBrowserDetach(AG_Event *event)
+{
+	AG_Tlist *tl = AG_TLIST_SELF();
+	ES_LibraryIndex *idx = AG_PTR(1);
+
+	ES_LibraryIndexDetach(idx, tl);
+}
+
+/*
+ * Keep a browser up to date with the library. The directories are watched
+ * for as long as browsers are attached.
+ */
+void
+ES_LibraryIndexAttach(ES_LibraryIndex *idx, AG_Tlist *tl)
+{
+	idx->tlists = Realloc(idx->tlists, (idx->nTlists+1)*sizeof(AG_Tlist *));
+	idx->tlists[idx->nTlists++] = tl;
+	AG_AddEvent(tl, "detached", OnBrowserDetach, "%p", idx);
+
+	if (idx->nTlists == 1 && idx->root != NULL)
+		StartWatching(idx);
+}
+
+void
+ES_LibraryIndexDetach(ES_LibraryIndex *idx, AG_Tlist *tl)
+{
+	Uint i;
+
+	for (i = 0; i < idx->nTlists; i++) {
+		if (idx->tlists[i] == tl)
+			break;
+	}
+	if (i == idx->nTlists) {
+		return;
+	}
+	if (i < idx->nTlists-1) {
+		memmove(&idx->tlists[i], &idx->tlists[i+1],
+		    (idx->nTlists-i-1)*sizeof(AG_Tlist *));
+	}
+	if (--idx->nTlists == 0 && idx->root != NULL)
+		StopWatching(idx);
+}
+
+/* Initialize a library index to be saved as ~/.edacious/<name>.idx. */
+void
+ES_LibraryIndexInit(ES_LibraryIndex *idx, const char *name, const char *ext,
+    AG_ObjectClass *cls)
+{
+	memset(idx, 0, sizeof(ES_LibraryIndex));
+	idx->name = name;
+	idx->ext = ext;
+	idx->cls = cls;
+	idx->path[0] = '\0';
+	idx->watchFd = -1;
+	AG_InitTimer(&idx->toWatch, "libraryWatch", 0);
+
+#if defined(HAVE_GETPWUID) && defined(HAVE_GETUID)
+	{
+		struct passwd *pwd = getpwuid(getuid());
+
+		if (pwd != NULL) {
+			Strlcpy(idx->path, pwd->pw_dir, sizeof(idx->path));
+			Strlcat(idx->path, PATHSEP, sizeof(idx->path));
+			Strlcat(idx->path, ".edacious", sizeof(idx->path));
+			Strlcat(idx->path, PATHSEP, sizeof(idx->path));
+			Strlcat(idx->path, name, sizeof(idx->path));
+			Strlcat(idx->path, ".idx", sizeof(idx->path));
+		}
+	}
+#endif
+}
+
+/* Save the index if needed and release all entries and instances. */
+void
+ES_LibraryIndexDestroy(ES_LibraryIndex *idx)
+{
+	Uint i;
+
+	if (idx->dirty && WriteIndex(idx) == -1) {
+		AG_Verbose("Saving index: %s\n", AG_GetError());
+	}
+	if (idx->nTlists > 0 && idx->root != NULL) {
+		StopWatching(idx);
+	}
+	ClearWatches(idx);
+	Free(idx->watches);
+	Free(idx->tlists);
+	idx->watches = NULL;
+	idx->tlists = NULL;
+	idx->nTlists = 0;
+
+	for (i = 0; i < idx->nEnts; i++) {
+		FreeEntry(&idx->ents[i]);
+	}
+	for (i = 0; i < idx->nFolders; i++) {
+		Free(idx->folders[i].path);
+	}
+	Free(idx->ents);
+	Free(idx->byId);
+	Free(idx->folders);
+	idx->ents = NULL;
+	idx->byId = NULL;
+	idx->nEnts = 0;
+	idx->folders = NULL;
+	idx->nFolders = 0;
+
+	if (idx->root != NULL) {
+		AG_ObjectDestroy(idx->root);
+		idx->root = NULL;
+	}
+}
+
+/*
+ * Bring the index up to date with the given search directories. Only the
+ * headers of files which are new or whose mtime or size have changed are
+ * read. Instances of unchanged files are preserved.
+ */
+int
+ES_LibraryIndexUpdate(ES_LibraryIndex *idx, const char *rootName,
+    char **dirs, int nDirs)
+{
+	ES_LibraryScan scan;
+	Uint i;
+	int j;
+
+	scan.old = NULL;
+	scan.nOld = 0;
+
+	if (idx->root == NULL) {
+		/* First update; start from the saved index. */
+		idx->root = AG_ObjectNew(NULL, rootName, &agObjectClass);
+		if (ReadIndex(idx, &scan) == -1) {
+			AG_Verbose("Rebuilding index: %s\n", AG_GetError());
+			idx->dirty = 1;
+		}
+	} else {
+		scan.old = idx->ents;
+		scan.nOld = idx->nEnts;
+		if (scan.nOld > 0) {
+			qsort(scan.old, scan.nOld, sizeof(ES_LibraryEntry),
+			    CompareEntryPaths);
+		}
+		for (i = 0; i < idx->nFolders; i++) {
+			Free(idx->folders[i].path);
+		}
+	}
+	scan.taken = (scan.nOld > 0) ? Malloc(scan.nOld) : NULL;
+	if (scan.nOld > 0) {
+		memset(scan.taken, 0, scan.nOld);
+	}
+
+	AG_LockVFS(idx->root);
+
+	idx->ents = NULL;
+	idx->nEnts = 0;
+	idx->nHeaders = 0;
+	ClearWatches(idx);
+	idx->folders = Realloc(idx->folders, sizeof(ES_LibraryFolder));
+	idx->folders[0].path = Strdup("");
+	idx->folders[0].name = OBJECT(idx->root)->name;
+	idx->folders[0].id = ++idx->lastId;
+	idx->folders[0].parent = -1;
+	idx->folders[0].child = -1;
+	idx->folders[0].next = -1;
+	idx->folders[0].flags = 0;
+	idx->nFolders = 1;
+
+	for (j = 0; j < nDirs; j++) {
+		if (ScanDir(idx, &scan, dirs[j], 0) == -1)
+			AG_Verbose("Skipping: %s\n", AG_GetError());
+	}
+
+	/* Forget about files which no longer exist (or have changed). */
+	for (i = 0; i < scan.nOld; i++) {
+		if (scan.taken[i]) {
+			continue;
+		}
+		ReleaseObject(scan.old[i].obj);
+		FreeEntry(&scan.old[i]);
+		idx->dirty = 1;
+	}
+	Free(scan.old);
+	Free(scan.taken);
+
+	Regroup(idx);
+	RefreshBrowsers(idx);
+	AG_UnlockVFS(idx->root);
+
+	Debug(idx->root, "%s: %u entries, %u header(s) read\n", idx->name,
+	    idx->nEnts, idx->nHeaders);
+
+	if (idx->dirty && WriteIndex(idx) == -1) {
+		AG_Verbose("Saving index: %s\n", AG_GetError());
+	}
+	return (0);
+}
+
+/* Return the entry displayed by a browser item. */
+ES_LibraryEntry *
+ES_LibraryIndexGetItem(ES_LibraryIndex *idx, const AG_TlistItem *ti)
+{
+	ES_LibraryEntry key, *pKey = &key, **pEnt;
+
+	key.id = ES_LIBRARY_ITEM_ID(ti);
+	if (idx->nGrouped > 0 &&
+	    (pEnt = bsearch(&pKey, idx->byId, idx->nGrouped,
+	     sizeof(ES_LibraryEntry *), CompareEntryIds)) != NULL &&
+	    !((*pEnt)->flags & ES_LIBRARY_ENTRY_REMOVED)) {
+		return (*pEnt);
+	}
+	AG_SetError(_("%s: No longer in the library"), ti->text);
+	return (NULL);
+}
+
+/* Return the instance of the entry displayed by a browser item. */
+AG_Object *
+ES_LibraryIndexLoadItem(ES_LibraryIndex *idx, const AG_TlistItem *ti)
+{
+	ES_LibraryEntry *ent;
+
+	if ((ent = ES_LibraryIndexGetItem(idx, ti)) == NULL) {
+		return (NULL);
+	}
+	return (ES_LibraryIndexLoadObject(idx, ent));
+}
+
+/* Return the instance of a library entry, loading it if needed. */
+AG_Object *
+ES_LibraryIndexLoadObject(ES_LibraryIndex *idx, ES_LibraryEntry *ent)
+{
+	AG_ObjectClass *cl;
+	AG_Object *obj;
+
+	if (ent->obj != NULL) {
+		return (ent->obj);
+	}
+	/*
+	 * Fetch class information for the object contained. If dynamic
+	 * library modules are required, they get linked at this stage.
+	 */
+	if ((cl = idx->cls) == NULL &&
+	    (cl = ES_LoadClass(ent->classSpec)) == NULL) {
+		AG_SetError("%s: %s", ent->path, AG_GetError());
+		return (NULL);
+	}
+	ent->cls = cl;
+	ResolveClass(idx, ent);
+
+	AG_LockVFS(idx->root);
+	if ((obj = AG_ObjectNew(idx->root, NULL, cl)) == NULL) {
+		goto fail;
+	}
+	if (AG_ObjectLoadFromFile(obj, ent->path) == -1) {
+		AG_SetError("%s: %s", ent->path, AG_GetError());
+		AG_ObjectDelete(obj);
+		goto fail;
+	}
+	AG_SetString(obj, "archive-path", ent->path);
+	AG_ObjectSetNameS(obj, ent->name);
+	ent->obj = obj;
+	AG_UnlockVFS(idx->root);
+	return (obj);
+fail:
+	AG_UnlockVFS(idx->root);
+	return (NULL);
+}
+
+/* Icon of a library entry (from its class, if registered). */
+static AG_Surface *
+EntryIcon(ES_LibraryIndex *idx, ES_LibraryEntry *ent)
+{
+	ES_ComponentClass *clCom;
+
+	ResolveClass(idx, ent);
+	if (ent->cls != NULL &&
+	    AG_ClassIsNamed(ent->cls, "ES_Circuit:ES_Component:*")) {
+		clCom = (ES_ComponentClass *)ent->cls;
+		if (clCom->icon != NULL)
+			return (clCom->icon->s);
+	}
+	return (esIconComponent.s);
+}
+
+static AG_TlistItem *
+PollFolder(ES_LibraryIndex *idx, AG_Tlist *tl, int f, int depth)
+{
+	ES_LibraryFolder *fo = &idx->folders[f];
+	AG_TlistItem *it, *itEnt;
+	Uint i;
+	int c;
+
+	it = AG_TlistAddPtr(tl, agIconDirectory.s, fo->name,
+	    ES_LIBRARY_ITEM_KEY(fo->id));
+	it->depth = depth;
+	it->cat = "folder";
+
+	if (fo->child != -1 || fo->nEnts > 0) {
+		it->flags |= AG_TLIST_HAS_CHILDREN;
+	}
+	if (!(it->flags & AG_TLIST_HAS_CHILDREN) ||
+	    !AG_TlistVisibleChildren(tl, it)) {
+		return (it);
+	}
+	for (c = fo->child; c != -1; c = idx->folders[c].next) {
+		(void)PollFolder(idx, tl, c, depth+1);
+	}
+	for (i = fo->entFirst; i < fo->entFirst+fo->nEnts; i++) {
+		ES_LibraryEntry *ent = &idx->ents[i];
+
+		itEnt = AG_TlistAddPtr(tl, EntryIcon(idx, ent), ent->name,
+		    ES_LIBRARY_ITEM_KEY(ent->id));
+		itEnt->depth = depth+1;
+		itEnt->cat = "object";
+	}
+	return (it);
+}
+
+/*
+ * Generate a Tlist tree for the library. Folder items have category
+ * "folder", and entry items have category "object". Items refer to
+ * entries by key (see ES_LibraryIndexGetItem()), since entries move
+ * whenever the index changes.
+ */
+void
+ES_LibraryIndexPoll(ES_LibraryIndex *idx, AG_Tlist *tl)
+{
+	AG_TlistItem *ti;
+
+	AG_TlistClear(tl);
+	if (idx->root != NULL) {
+		AG_LockVFS(idx->root);
+		ti = PollFolder(idx, tl, 0, 0);
+		ti->flags |= AG_TLIST_ITEM_EXPANDED;
+		AG_UnlockVFS(idx->root);
+	}
+	AG_TlistRestore(tl);
+}
@@ -0,0 +1,101 @@
+/*	Public domain	*/
+
+/*
+ * Persistent index over a library of object files (component models,
+ * schematics, packages). The index records the class of every file
+ * and is rebuilt incrementally from modification times, so objects
+ * only need to be instantiated when they are actually used. While a
+ * browser is attached, the directories are watched for changes.
+ */
+
+#define ES_LIBRARY_INDEX_MAGIC		0x45534c49	/* "ESLI" */
+#define ES_LIBRARY_INDEX_VERSION	1
+#define ES_LIBRARY_WATCH_IVAL		250	/* Notification check (ms) */
+#define ES_LIBRARY_POLL_IVAL		2000	/* Polling interval (ms) */
+#define ES_LIBRARY_POLL_FILES		128	/* Files checked per poll */
+
+/* Browser items refer to entries and folders by key, not by address. */
+#define ES_LIBRARY_ITEM_KEY(id)		((void *)(size_t)(id))
+#define ES_LIBRARY_ITEM_ID(ti)		((Uint)(size_t)(ti)->p1)
+
+/* Directory of the library, relative to the search paths. */
+typedef struct es_library_folder {
+	char *path;			/* Relative path ("" = top level) */
+	const char *name;		/* Last component of path */
+	Uint id;			/* Key of browser items */
+	int parent;			/* Parent folder (-1 = none) */
+	int child;			/* First subfolder (-1 = none) */
+	int next;			/* Next sibling (-1 = none) */
+	Uint entFirst, nEnts;		/* Entries in this folder */
+	Uint flags;
+#define ES_LIBRARY_FOLDER_CHANGED 0x01	/* Browsers need a refresh */
+} ES_LibraryFolder;
+
+/* Object file in the library. */
+typedef struct es_library_entry {
+	char *path;				/* Object file */
+	Uint32 mtime, size;			/* Last known mtime and size */
+	char *classSpec;			/* Class (from object header) */
+	char *categories;			/* Component categories (or NULL) */
+	char name[AG_OBJECT_NAME_MAX];		/* Display name */
+	int folder;				/* Containing folder */
+	Uint id;				/* Key of browser items */
+	AG_ObjectClass *cls;			/* Resolved class (or NULL) */
+	AG_Object *obj;				/* Instance (or NULL) */
+	Uint flags;
+#define ES_LIBRARY_ENTRY_REMOVED 0x01		/* File no longer exists */
+#define ES_LIBRARY_ENTRY_SEEN	 0x02		/* Found by current rescan */
+} ES_LibraryEntry;
+
+/* Directory being watched for changes. */
+typedef struct es_library_watch {
+	char *path;			/* Directory */
+	int folder;			/* Corresponding folder */
+	int wd;				/* inotify watch (or -1) */
+	Uint32 mtime;			/* Last known mtime (polling) */
+	Uint32 tScan;			/* Time of last scan (polling) */
+	Uint flags;
+#define ES_LIBRARY_WATCH_DIRTY	0x01	/* Needs rescan */
+#define ES_LIBRARY_WATCH_SEEN	0x02	/* Found by current rescan */
+} ES_LibraryWatch;
+
+typedef struct es_library_index {
+	const char *name;		/* Library name (e.g., "Models") */
+	const char *ext;		/* File extension (e.g., ".em") */
+	AG_ObjectClass *cls;		/* Class of all entries (or NULL) */
+	char path[AG_PATHNAME_MAX];	/* Index file ("" = not persistent) */
+	AG_Object *root;		/* Parent of instantiated objects */
+	ES_LibraryFolder *folders;	/* Folder tree (0 = top level) */
+	Uint             nFolders;
+	ES_LibraryEntry *ents;		/* Entries (sorted by folder, name) */
+	Uint            nEnts;
+	Uint            nGrouped;	/* Entries covered by the folders */
+	ES_LibraryEntry **byId;		/* Grouped entries sorted by key */
+	Uint nHeaders;			/* Headers read by the last update */
+	int dirty;			/* Differs from the saved index */
+	Uint gen;			/* Incremented on every change */
+	Uint lastId;			/* Last entry or folder key */
+	ES_LibraryWatch *watches;	/* Directories being watched */
+	Uint            nWatches;
+	int watchFd;			/* inotify descriptor (or -1) */
+	Uint pollNext;			/* Next entry to check (polling) */
+	AG_Timer toWatch;		/* Change notification timer */
+	AG_Tlist **tlists;		/* Browsers to refresh on changes */
+	Uint      nTlists;
+} ES_LibraryIndex;
+
+__BEGIN_DECLS
+void       ES_LibraryIndexInit(ES_LibraryIndex *, const char *, const char *,
+                               AG_ObjectClass *);
+void       ES_LibraryIndexDestroy(ES_LibraryIndex *);
+int        ES_LibraryIndexUpdate(ES_LibraryIndex *, const char *,
+                                 char **, int);
+AG_Object *ES_LibraryIndexLoadObject(ES_LibraryIndex *, ES_LibraryEntry *);
+ES_LibraryEntry *ES_LibraryIndexGetItem(ES_LibraryIndex *,
+                                        const AG_TlistItem *);
+AG_Object *ES_LibraryIndexLoadItem(ES_LibraryIndex *, const AG_TlistItem *);
+int        ES_LibraryIndexCheck(ES_LibraryIndex *);
+void       ES_LibraryIndexPoll(ES_LibraryIndex *, AG_Tlist *);
+void       ES_LibraryIndexAttach(ES_LibraryIndex *, AG_Tlist *);
+void       ES_LibraryIndexDetach(ES_LibraryIndex *, AG_Tlist *);
+__END_DECLS
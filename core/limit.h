@@ -0,0 +1,160 @@
+/*	Public domain	*/
+
+/*
+ * Limiting of the controlling voltages of nonlinear devices between
+ * Newton-Raphson iterations, after the pnjlim(), fetlim() and limvds()
+ * functions of SPICE. Each function returns the voltage to evaluate the
+ * device at, and sets *limited if it differs from the new iterate (the
+ * iteration then cannot be considered converged). With ES_SIMDC_NO_LIMIT,
+ * devices fall back to the former fixed step clamp (ES_LimitStep()).
+ *
+ * Also device bypass: a device whose controlling voltages moved by less
+ * than the bypass tolerance since it was last evaluated may stamp its
+ * cached companion model instead of being evaluated again. The tolerance
+ * is a tenth of the NR convergence criterion, so that bypassed devices
+ * cannot hold up convergence.
+ */
+
+#define ES_BYPASS_REL_DIFF	1e-4
+#define ES_BYPASS_V_DIFF	1e-7
+
+__BEGIN_DECLS
+
+/*
+ * pn junction: above the critical voltage Vcrit (where the junction
+ * current starts to grow faster than linearly), compress large steps
+ * logarithmically instead of following the exponential.
+ */
+static __inline__ M_Real
+ES_LimitPN(M_Real vNew, M_Real vOld, M_Real Vt, M_Real Vcrit, Uint *limited)
+{
+	M_Real arg;
+
+	if (vNew > Vcrit && Fabs(vNew - vOld) > 2.0*Vt) {
+		if (vOld > 0.0) {
+			arg = 1.0 + (vNew - vOld)/Vt;
+			vNew = (arg > 0.0) ? vOld + Vt*Log(arg) : Vcrit;
+		} else {
+			vNew = Vt*Log(vNew/Vt);
+		}
+		*limited = 1;
+	}
+	return (vNew);
+}
+
+/*
+ * FET gate-source voltage: limit the step depending on whether the device
+ * is off, near threshold (Vto) or fully on.
+ */
+static __inline__ M_Real
+ES_LimitFET(M_Real vNew, M_Real vOld, M_Real Vto, Uint *limited)
+{
+	M_Real vHi = Fabs(2.0*(vOld - Vto)) + 2.0;
+	M_Real vLo = vHi/2.0 + 2.0;
+	M_Real vOn = Vto + 3.5;
+	M_Real delta = vNew - vOld;
+	M_Real v = vNew;
+
+	if (vOld >= Vto) {
+		if (vOld >= vOn) {
+			if (delta <= 0.0) {			/* Going off */
+				if (vNew >= vOn) {
+					if (-delta > vLo)
+						v = vOld - vLo;
+				} else if (v < Vto + 2.0) {
+					v = Vto + 2.0;
+				}
+			} else if (delta >= vHi) {		/* Staying on */
+				v = vOld + vHi;
+			}
+		} else {					/* Near threshold */
+			if (delta <= 0.0) {
+				if (v < Vto - 0.5)
+					v = Vto - 0.5;
+			} else {
+				if (v > Vto + 4.0)
+					v = Vto + 4.0;
+			}
+		}
+	} else {						/* Off */
+		if (delta <= 0.0) {
+			if (-delta > vHi)
+				v = vOld - vHi;
+		} else if (vNew <= Vto + 0.5) {
+			if (delta > vLo)
+				v = vOld + vLo;
+		} else {
+			v = Vto + 0.5;
+		}
+	}
+	if (v != vNew) {
+		*limited = 1;
+	}
+	return (v);
+}
+
+/* Fixed clamp of the step from vOld to vOld +/- vStep. */
+static __inline__ M_Real
+ES_LimitStep(M_Real vNew, M_Real vOld, M_Real vStep, Uint *limited)
+{
+	if (Fabs(vNew - vOld) > vStep) {
+		*limited = 1;
+		return (vNew > vOld) ? vOld + vStep : vOld - vStep;
+	}
+	return (vNew);
+}
+
+/* FET drain-source voltage. */
+static __inline__ M_Real
+ES_LimitVDS(M_Real vNew, M_Real vOld, Uint *limited)
+{
+	M_Real v = vNew;
+
+	if (vOld >= 3.5) {
+		if (vNew > vOld) {
+			if (v > 3.0*vOld + 2.0)
+				v = 3.0*vOld + 2.0;
+		} else if (vNew < 3.5) {
+			if (v < 2.0)
+				v = 2.0;
+		}
+	} else {
+		if (vNew > vOld) {
+			if (v > 4.0)
+				v = 4.0;
+		} else {
+			if (v < -0.5)
+				v = -0.5;
+		}
+	}
+	if (v != vNew) {
+		*limited = 1;
+	}
+	return (v);
+}
+
+/* Return 1 if vNew is within the bypass tolerance of vOld. */
+static __inline__ int
+ES_BypassCheck(M_Real vNew, M_Real vOld)
+{
+	return (Fabs(vNew - vOld) <=
+	        ES_BYPASS_V_DIFF + ES_BYPASS_REL_DIFF*MAX(Fabs(vNew),Fabs(vOld)));
+}
+
+/*
+ * Decide whether a device evaluation is bypassed, and count it. The device
+ * passes a nonzero "unchanged" only if its cached companion model is valid
+ * and ES_BypassCheck() holds for all of its controlling voltages.
+ */
+static __inline__ int
+ES_SimDCBypass(ES_SimDC *dc, int unchanged)
+{
+	if (unchanged && !(dc->flags & ES_SIMDC_NO_BYPASS)) {
+		dc->bypassHits++;
+		return (1);
+	}
+	dc->bypassMisses++;
+	return (0);
+}
+
+__END_DECLS
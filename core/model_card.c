@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Shared model cards. Cards are interned by model type and parameter
+ * values, and released when the last instance referencing them goes away.
+ */
+
+#include "core.h"
+
+#include <string.h>
+
+static SLIST_HEAD(,es_model_card) esModelCards[ES_MODEL_CARD_HASH];
+static AG_Mutex esModelCardsLock;
+
+void
+ES_ModelCardsInit(void)
+{
+	Uint i;
+
+	for (i = 0; i < ES_MODEL_CARD_HASH; i++) {
+		SLIST_INIT(&esModelCards[i]);
+	}
+	AG_MutexInit(&esModelCardsLock);
+}
+
+void
+ES_ModelCardsDestroy(void)
+{
+	ES_ModelCard *card, *cardNext;
+	Uint i;
+
+	for (i = 0; i < ES_MODEL_CARD_HASH; i++) {
+		for (card = SLIST_FIRST(&esModelCards[i]);
+		     card != SLIST_END(&esModelCards[i]);
+		     card = cardNext) {
+			cardNext = SLIST_NEXT(card, cards);
+			if (card->cls->destroy != NULL) {
+				card->cls->destroy(card);
+			}
+			Free(card);
+		}
+		SLIST_INIT(&esModelCards[i]);
+	}
+	AG_MutexDestroy(&esModelCardsLock);
+}
+
+/*
+ * Create the parameter variables of a component, bound to the given array
+ * (one element per parameter, in table order) and set to default values.
+ */
+void
+ES_ModelCardInitParams(void *com, const ES_ModelCardClass *cls, M_Real *vals)
+{
+	const ES_ModelCardParam *prm;
+	Uint i;
+
+	for (prm = &cls->params[0], i = 0; prm->name != NULL; prm++, i++) {
+		vals[i] = prm->def;
+		M_BindReal(com, prm->name, &vals[i]);
+	}
+}
+
+/* FNV-1a over the model type and the parameter values. */
+static Uint32
+HashCard(const ES_ModelCard *card)
+{
+	const ES_ModelCardParam *prm;
+	const Uint8 *p;
+	Uint32 h = 2166136261U;
+	size_t i;
+
+	for (p = (const Uint8 *)card->cls->name; *p != '\0'; p++) {
+		h = (h ^ *p)*16777619U;
+	}
+	for (prm = &card->cls->params[0]; prm->name != NULL; prm++) {
+		p = (const Uint8 *)card + prm->offs;
+		for (i = 0; i < sizeof(M_Real); i++)
+			h = (h ^ p[i])*16777619U;
+	}
+	return (h);
+}
+
+static int
+SameParams(const ES_ModelCard *a, const ES_ModelCard *b)
+{
+	const ES_ModelCardParam *prm;
+
+	if (a->cls != b->cls) {
+		return (0);
+	}
+	for (prm = &a->cls->params[0]; prm->name != NULL; prm++) {
+		if (ES_MODEL_CARD_PARAM(a,prm) != ES_MODEL_CARD_PARAM(b,prm))
+			return (0);
+	}
+	return (1);
+}
+
+/* Look up an interned card with the same parameters; caller holds lock. */
+static ES_ModelCard *
+LookupCard(const ES_ModelCard *cardNew)
+{
+	ES_ModelCard *card;
+
+	SLIST_FOREACH(card, &esModelCards[cardNew->hash % ES_MODEL_CARD_HASH],
+	    cards) {
+		if (card->hash == cardNew->hash && SameParams(card, cardNew))
+			break;
+	}
+	return (card);
+}
+
+/*
+ * Return the card matching the current parameters of a component, creating
+ * it if no other instance uses the same model. Parameters missing from the
+ * component take their default value. The caller must release the card
+ * with ES_ModelCardRelease().
+ *
+ * The derived constants of a new card are computed without holding the
+ * card table lock; if another instance published an identical card in the
+ * meantime, that one is used and ours is discarded.
+ */
+void *
+ES_ModelCardGet(void *com, const ES_ModelCardClass *cls)
+{
+	const ES_ModelCardParam *prm;
+	ES_ModelCard *card, *cardNew;
+
+	cardNew = Malloc(cls->size);
+	memset(cardNew, 0, cls->size);
+	cardNew->cls = cls;
+	cardNew->nRefs = 1;
+	for (prm = &cls->params[0]; prm->name != NULL; prm++) {
+		ES_MODEL_CARD_PARAM(cardNew,prm) = AG_Defined(com, prm->name) ?
+		    M_GetReal(com, prm->name) : prm->def;
+	}
+	cardNew->hash = HashCard(cardNew);
+
+	AG_MutexLock(&esModelCardsLock);
+	if ((card = LookupCard(cardNew)) != NULL) {
+		card->nRefs++;
+		AG_MutexUnlock(&esModelCardsLock);
+		Free(cardNew);
+		return (card);
+	}
+	AG_MutexUnlock(&esModelCardsLock);
+
+	if (cls->derive != NULL)
+		cls->derive(cardNew);
+
+	AG_MutexLock(&esModelCardsLock);
+	if ((card = LookupCard(cardNew)) != NULL) {
+		card->nRefs++;
+		AG_MutexUnlock(&esModelCardsLock);
+		if (cls->destroy != NULL) {
+			cls->destroy(cardNew);
+		}
+		Free(cardNew);
+		return (card);
+	}
+	SLIST_INSERT_HEAD(&esModelCards[cardNew->hash % ES_MODEL_CARD_HASH],
+	    cardNew, cards);
+	AG_MutexUnlock(&esModelCardsLock);
+	return (cardNew);
+}
+
+/* Release a reference to a model card (NULL is ignored). */
+void
+ES_ModelCardRelease(void *p)
+{
+	ES_ModelCard *card = p;
+	int last;
+
+	if (card == NULL) {
+		return;
+	}
+	AG_MutexLock(&esModelCardsLock);
+	if ((last = (--card->nRefs == 0))) {
+		SLIST_REMOVE(&esModelCards[card->hash % ES_MODEL_CARD_HASH],
+		    card, es_model_card, cards);
+	}
+	AG_MutexUnlock(&esModelCardsLock);
+
+	if (last) {
+		if (card->cls->destroy != NULL) {
+			card->cls->destroy(card);
+		}
+		Free(card);
+	}
+}
+
+/*
+ * Return a pointer to the value of a model parameter (for editors). This is
+ * the bound instance storage, valid for the life of the component; changes
+ * apply to the card resolved at the next simulation start. If the component
+ * has no such parameter, return NULL and set an error.
+ */
+M_Real *
+ES_ModelCardParamPtr(void *com, const char *name)
+{
+	AG_Variable *V;
+	void *p;
+
+	if ((V = AG_GetVariable(com, name, &p)) == NULL) {
+		AG_SetError(_("%s: No such model parameter: %s"),
+		    OBJECT(com)->name, name);
+		return (NULL);
+	}
+	AG_UnlockVariable(V);
+	return ((M_Real *)p);
+}
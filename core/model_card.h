@@ -0,0 +1,48 @@
+/*	Public domain	*/
+
+/*
+ * Shared model cards (the equivalent of SPICE ".model" statements). The
+ * user-visible parameters of a device are object variables of the
+ * component, bound to a small array in the instance; when a simulation
+ * begins, each instance resolves them to a card which is shared by all
+ * instances of the same model with identical parameters. Derived constants
+ * are computed once when a card is created, so the evaluation loops only
+ * touch the card and the per-instance state. Parameter edits take effect
+ * when the next simulation begins.
+ */
+
+#define ES_MODEL_CARD_HASH	64	/* Buckets in card table */
+
+/* Model parameter (stored as an M_Real in the card structure). */
+typedef struct es_model_card_param {
+	const char *name;		/* Object variable name */
+	size_t offs;			/* Offset in card structure */
+	M_Real def;			/* Default value */
+} ES_ModelCardParam;
+
+typedef struct es_model_card_class {
+	const char *name;			/* Model type (e.g., "D") */
+	size_t size;				/* Size of card structure */
+	const ES_ModelCardParam *params;	/* Parameters (NULL-terminated) */
+	void (*derive)(void *);			/* Compute derived constants */
+	void (*destroy)(void *);		/* Free derived data */
+} ES_ModelCardClass;
+
+typedef struct es_model_card {
+	const ES_ModelCardClass *cls;
+	Uint nRefs;				/* Instances using the card */
+	Uint32 hash;				/* Hash of parameters */
+	SLIST_ENTRY(es_model_card) cards;
+} ES_ModelCard;
+
+#define ES_MODEL_CARD_PARAM(card,prm) \
+	(*(M_Real *)((char *)(card) + (prm)->offs))
+
+__BEGIN_DECLS
+void    ES_ModelCardsInit(void);
+void    ES_ModelCardsDestroy(void);
+void    ES_ModelCardInitParams(void *, const ES_ModelCardClass *, M_Real *);
+void   *ES_ModelCardGet(void *, const ES_ModelCardClass *);
+void    ES_ModelCardRelease(void *);
+M_Real *ES_ModelCardParamPtr(void *, const char *);
+__END_DECLS
@@ -0,0 +1,555 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Compiled netlists: flat, memory-mappable images of the topology and
+ * component models of a circuit, for repeated headless simulation.
+ */
+
+#include "core.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#ifdef _WIN32
+# include <io.h>
+#else
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+#define ES_NETLIST_ALIGN(n) ((((n)+7)/8)*8)
+
+/* Strings being compiled. */
+typedef struct es_netlist_strings {
+	char *s;
+	Uint32 len, maxLen;
+} ES_NetlistStrings;
+
+static Uint32
+AddString(ES_NetlistStrings *str, const char *s)
+{
+	Uint32 offs = str->len;
+	size_t len = strlen(s)+1;
+
+	if (str->len+len > str->maxLen) {
+		while (str->len+len > str->maxLen) {
+			str->maxLen = (str->maxLen > 0) ? str->maxLen*2 : 1024;
+		}
+		str->s = Realloc(str->s, str->maxLen);
+	}
+	memcpy(&str->s[str->len], s, len);
+	str->len += (Uint32)len;
+	return (offs);
+}
+
+/* Pad a table of len bytes to the next 8-byte boundary. */
+static int
+PadTable(AG_DataSource *ds, size_t len)
+{
+	static const Uint8 zero[8] = { 0,0,0,0,0,0,0,0 };
+
+	if (ES_NETLIST_ALIGN(len) > len &&
+	    AG_Write(ds, zero, ES_NETLIST_ALIGN(len) - len) == -1) {
+		return (-1);
+	}
+	return (0);
+}
+
+static int
+WriteTable(AG_DataSource *ds, const void *data, size_t len)
+{
+	if (len > 0 && AG_Write(ds, data, len) == -1) {
+		return (-1);
+	}
+	return PadTable(ds, len);
+}
+
+/* Compile a circuit into a netlist file. */
+int
+ES_NetlistCompile(ES_Circuit *ckt, const char *path)
+{
+	ES_NetlistHeader hdr;
+	ES_NetlistStrings str = { NULL, 0, 0 };
+	ES_NetlistCom *coms = NULL;
+	ES_NetlistSym *syms = NULL;
+	AG_ObjectClass **classes = NULL;
+	Uint32 *classNames = NULL;
+	Sint32 *ports = NULL;
+	AG_DataSource *dsParams, *ds;
+	ES_Component *com;
+	ES_Port *port;
+	ES_Sym *sym;
+	Uint32 offs, lenParams, i, j;
+	int rv = -1;
+
+	ES_CompactNodes(ckt);
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = ES_NETLIST_MAGIC;
+	hdr.version = ES_NETLIST_VERSION;
+	hdr.nNodes = ckt->n;
+	hdr.nVsources = ckt->m;
+	hdr.descr = AddString(&str,
+	    (ckt->info != NULL) ? ckt->info->descr : "");
+
+	CIRCUIT_FOREACH_COMPONENT(com, ckt) {
+		hdr.nComs++;
+		hdr.nPorts += com->nports;
+	}
+	coms = Malloc((hdr.nComs+1)*sizeof(ES_NetlistCom));
+	ports = Malloc((hdr.nPorts+1)*sizeof(Sint32));
+	classes = Malloc((hdr.nComs+1)*sizeof(AG_ObjectClass *));
+	classNames = Malloc((hdr.nComs+1)*sizeof(Uint32));
+	syms = Malloc((ckt->nSyms+1)*sizeof(ES_NetlistSym));
+
+	/* Serialize the component models into parameter blocks. */
+	if ((dsParams = AG_OpenAutoCore()) == NULL) {
+		goto out;
+	}
+	i = 0;
+	hdr.nPorts = 0;
+	CIRCUIT_FOREACH_COMPONENT(com, ckt) {
+		ES_NetlistCom *nc = &coms[i++];
+		AG_ObjectClass *cls = OBJECT_CLASS(com);
+
+		for (j = 0; j < hdr.nClasses; j++) {
+			if (classes[j] == cls)
+				break;
+		}
+		if (j == hdr.nClasses) {
+			char s[AG_OBJECT_TYPE_MAX];
+
+			Strlcpy(s, cls->hier, sizeof(s));
+			if (cls->pvt.libs[0] != '\0') {	/* Append @libs */
+				Strlcat(s, "@", sizeof(s));
+				Strlcat(s, cls->pvt.libs, sizeof(s));
+			}
+			classes[hdr.nClasses] = cls;
+			classNames[hdr.nClasses++] = AddString(&str, s);
+		}
+		nc->cls = j;
+		nc->name = AddString(&str, OBJECT(com)->name);
+		nc->params = (Uint32)AG_Tell(dsParams);
+		if (AG_ObjectSerialize(com, dsParams) == -1) {
+			goto out_params;
+		}
+		nc->lenParams = (Uint32)AG_Tell(dsParams) - nc->params;
+		if (PadTable(dsParams, nc->lenParams) == -1) {
+			goto out_params;
+		}
+		nc->port = hdr.nPorts;
+		nc->nPorts = com->nports;
+		COMPONENT_FOREACH_PORT(port, j, com) {
+			ports[hdr.nPorts++] = (Sint32)port->node;
+		}
+		nc->vsource = -1;
+		for (j = 0; j < ckt->m; j++) {
+			if (ckt->vSrcs[j] == com) {
+				nc->vsource = (Sint32)j;
+				break;
+			}
+		}
+		nc->pad = 0;
+	}
+	lenParams = (Uint32)AG_Tell(dsParams);
+
+	TAILQ_FOREACH(sym, &ckt->syms, syms) {
+		ES_NetlistSym *ns = &syms[hdr.nSyms++];
+
+		ns->name = AddString(&str, sym->name);
+		ns->type = (Uint32)sym->type;
+		switch (sym->type) {
+		case ES_SYM_NODE:
+			ns->idx = (Sint32)sym->p.node;
+			break;
+		case ES_SYM_VSOURCE:
+			ns->idx = (Sint32)sym->p.vsource;
+			break;
+		case ES_SYM_ISOURCE:
+			ns->idx = (Sint32)sym->p.isource;
+			break;
+		}
+		ns->pad = 0;
+	}
+
+	/* Lay out the tables. */
+	offs = ES_NETLIST_ALIGN(sizeof(ES_NetlistHeader));
+	hdr.offsClasses = offs;
+	offs += ES_NETLIST_ALIGN(hdr.nClasses*sizeof(Uint32));
+	hdr.offsComs = offs;
+	offs += ES_NETLIST_ALIGN(hdr.nComs*sizeof(ES_NetlistCom));
+	hdr.offsPorts = offs;
+	offs += ES_NETLIST_ALIGN(hdr.nPorts*sizeof(Sint32));
+	hdr.offsSyms = offs;
+	offs += ES_NETLIST_ALIGN(hdr.nSyms*sizeof(ES_NetlistSym));
+	for (i = 0; i < hdr.nComs; i++) {
+		coms[i].params += offs;
+	}
+	offs += lenParams;
+	hdr.offsStrings = offs;
+	hdr.lenStrings = str.len;
+	hdr.size = offs + ES_NETLIST_ALIGN(str.len);
+
+	if ((ds = AG_OpenFile(path, "wb")) == NULL) {
+		goto out_params;
+	}
+	if (WriteTable(ds, &hdr, sizeof(hdr)) == -1 ||
+	    WriteTable(ds, classNames, hdr.nClasses*sizeof(Uint32)) == -1 ||
+	    WriteTable(ds, coms, hdr.nComs*sizeof(ES_NetlistCom)) == -1 ||
+	    WriteTable(ds, ports, hdr.nPorts*sizeof(Sint32)) == -1 ||
+	    WriteTable(ds, syms, hdr.nSyms*sizeof(ES_NetlistSym)) == -1 ||
+	    WriteTable(ds, AG_CORE_SOURCE(dsParams)->data, lenParams) == -1 ||
+	    WriteTable(ds, str.s, str.len) == -1) {
+		AG_CloseFile(ds);
+		goto out_params;
+	}
+	AG_CloseFile(ds);
+	rv = 0;
+out_params:
+	AG_CloseDataSource(dsParams);
+out:
+	Free(str.s);
+	Free(syms);
+	Free(classNames);
+	Free(classes);
+	Free(ports);
+	Free(coms);
+	return (rv);
+}
+
+/* Return 1 if the given file is a compiled netlist. */
+int
+ES_NetlistIsCompiled(const char *path)
+{
+	Uint32 magic;
+	FILE *f;
+	int rv;
+
+	if ((f = fopen(path, "rb")) == NULL) {
+		return (0);
+	}
+	rv = (fread(&magic, sizeof(magic), 1, f) == 1 &&
+	      magic == ES_NETLIST_MAGIC);
+	fclose(f);
+	return (rv);
+}
+
+/* Check that a table lies within the file and is aligned. */
+static __inline__ int
+ValidTable(const ES_Netlist *nl, Uint32 offs, Uint32 count, size_t size)
+{
+	return ((offs & 7) == 0 && offs <= nl->size &&
+	        count <= (nl->size - offs)/size);
+}
+
+/*
+ * Map a compiled netlist into memory. The tables are accessed in place;
+ * only the pointers into the file need to be set up.
+ */
+ES_Netlist *
+ES_NetlistOpen(const char *path)
+{
+	ES_Netlist *nl;
+	const ES_NetlistHeader *hdr;
+	const Uint8 *data;
+	struct stat sb;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		AG_SetError("%s: %s", path, strerror(errno));
+		return (NULL);
+	}
+	if (fstat(fd, &sb) == -1) {
+		AG_SetError("%s: %s", path, strerror(errno));
+		close(fd);
+		return (NULL);
+	}
+	if ((size_t)sb.st_size < sizeof(ES_NetlistHeader)) {
+		AG_SetError("%s: Not a compiled netlist", path);
+		close(fd);
+		return (NULL);
+	}
+	nl = Malloc(sizeof(ES_Netlist));
+	nl->size = (size_t)sb.st_size;
+#ifdef _WIN32
+	nl->data = Malloc(nl->size);
+	nl->mapped = 0;
+	if (read(fd, nl->data, nl->size) != (int)nl->size) {
+		AG_SetError("%s: Read error", path);
+		close(fd);
+		goto fail;
+	}
+#else
+	nl->data = mmap(NULL, nl->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (nl->data == MAP_FAILED) {
+		AG_SetError("%s: %s", path, strerror(errno));
+		close(fd);
+		Free(nl);
+		return (NULL);
+	}
+	nl->mapped = 1;
+#endif
+	close(fd);
+
+	data = nl->data;
+	nl->hdr = hdr = (const ES_NetlistHeader *)data;
+	if (hdr->magic != ES_NETLIST_MAGIC) {
+		AG_SetError("%s: Not a compiled netlist", path);
+		goto fail;
+	}
+	if (hdr->version != ES_NETLIST_VERSION) {
+		AG_SetError("%s: Netlist version %u (expected %u)", path,
+		    (Uint)hdr->version, ES_NETLIST_VERSION);
+		goto fail;
+	}
+	if (hdr->size != nl->size ||
+	    !ValidTable(nl, hdr->offsClasses, hdr->nClasses, sizeof(Uint32)) ||
+	    !ValidTable(nl, hdr->offsComs, hdr->nComs, sizeof(ES_NetlistCom)) ||
+	    !ValidTable(nl, hdr->offsPorts, hdr->nPorts, sizeof(Sint32)) ||
+	    !ValidTable(nl, hdr->offsSyms, hdr->nSyms, sizeof(ES_NetlistSym)) ||
+	    !ValidTable(nl, hdr->offsStrings, hdr->lenStrings, 1) ||
+	    hdr->lenStrings == 0 ||
+	    data[hdr->offsStrings + hdr->lenStrings - 1] != '\0' ||
+	    hdr->descr >= hdr->lenStrings) {
+		AG_SetError("%s: Corrupt netlist", path);
+		goto fail;
+	}
+	nl->classes = (const Uint32 *)&data[hdr->offsClasses];
+	nl->coms = (const ES_NetlistCom *)&data[hdr->offsComs];
+	nl->ports = (const Sint32 *)&data[hdr->offsPorts];
+	nl->syms = (const ES_NetlistSym *)&data[hdr->offsSyms];
+	nl->strings = (const char *)&data[hdr->offsStrings];
+	return (nl);
+fail:
+	ES_NetlistClose(nl);
+	return (NULL);
+}
+
+void
+ES_NetlistClose(ES_Netlist *nl)
+{
+#ifndef _WIN32
+	if (nl->mapped) {
+		munmap(nl->data, nl->size);
+	} else
+#endif
+	{
+		Free(nl->data);
+	}
+	Free(nl);
+}
+
+/*
+ * Instantiate the components of a compiled netlist into an empty circuit
+ * and connect them. The circuit is flagged ES_CIRCUIT_HEADLESS (it has no
+ * schematics). On failure, the circuit should be destroyed.
+ */
+int
+ES_NetlistInstantiate(ES_Netlist *nl, ES_Circuit *ckt)
+{
+	const ES_NetlistHeader *hdr = nl->hdr;
+	AG_ObjectClass **classes;
+	ES_Component **coms;
+	ES_Component *com;
+	AG_DataSource *ds;
+	Uint i, j;
+
+	if (ckt->n != 1 || !TAILQ_EMPTY(&ckt->components)) {
+		AG_SetError("%s: Circuit is not empty", OBJECT(ckt)->name);
+		return (-1);
+	}
+	if (hdr->nNodes < 1 || hdr->nNodes > ESCIRCUIT_MAX_NODES) {
+		AG_SetError("Bogus node count: %u", (Uint)hdr->nNodes);
+		return (-1);
+	}
+	ckt->flags |= ES_CIRCUIT_HEADLESS;
+	if (ckt->info != NULL) {
+		Strlcpy(ckt->info->descr, ES_NETLIST_STRING(nl,hdr->descr),
+		    sizeof(ckt->info->descr));
+	}
+
+	classes = Malloc((hdr->nClasses+1)*sizeof(AG_ObjectClass *));
+	coms = Malloc((hdr->nComs+1)*sizeof(ES_Component *));
+	for (i = 0; i < hdr->nClasses; i++) {
+		if (nl->classes[i] >= hdr->lenStrings) {
+			AG_SetError("Bogus class name");
+			goto fail;
+		}
+		classes[i] = ES_LoadClass(ES_NETLIST_STRING(nl,nl->classes[i]));
+		if (classes[i] == NULL)
+			goto fail;
+	}
+
+	/* Components */
+	for (i = 0; i < hdr->nComs; i++) {
+		const ES_NetlistCom *nc = &nl->coms[i];
+
+		if (nc->cls >= hdr->nClasses ||
+		    nc->name >= hdr->lenStrings ||
+		    nc->params > nl->size ||
+		    nc->lenParams > nl->size - nc->params ||
+		    nc->port > hdr->nPorts ||
+		    nc->nPorts > hdr->nPorts - nc->port) {
+			AG_SetError("Bogus component #%u", i);
+			goto fail;
+		}
+		if ((com = AG_TryMalloc(classes[nc->cls]->size)) == NULL) {
+			goto fail;
+		}
+		AG_ObjectInit(com, classes[nc->cls]);
+		AG_ObjectSetNameS(com, ES_NETLIST_STRING(nl,nc->name));
+		if ((ds = AG_OpenConstCore((const Uint8 *)nl->data + nc->params,
+		    nc->lenParams)) == NULL) {
+			AG_ObjectDestroy(com);
+			goto fail;
+		}
+		if (AG_ObjectUnserialize(com, ds) == -1) {
+			AG_CloseDataSource(ds);
+			AG_ObjectDestroy(com);
+			goto fail;
+		}
+		AG_CloseDataSource(ds);
+		if (com->nports != nc->nPorts) {
+			AG_SetError("%s: Expected %u ports, not %u",
+			    OBJECT(com)->name, (Uint)nc->nPorts, com->nports);
+			AG_ObjectDestroy(com);
+			goto fail;
+		}
+		AG_ObjectAttach(ckt, com);
+		TAILQ_INSERT_TAIL(&ckt->components, com, components);
+		com->flags |= ES_COMPONENT_CONNECTED;
+		coms[i] = com;
+	}
+
+	/* Nodes and branches */
+	ES_ReserveNodes(ckt, hdr->nNodes);
+	for (i = 1; i < hdr->nNodes; i++) {
+		ES_AddNode(ckt);
+	}
+	for (i = 0; i < hdr->nComs; i++) {
+		const ES_NetlistCom *nc = &nl->coms[i];
+
+		com = coms[i];
+		for (j = 1; j <= nc->nPorts; j++) {
+			Sint32 node = nl->ports[nc->port + j-1];
+
+			if (node == -1) {
+				continue;
+			}
+			if (node < 0 || (Uint32)node >= hdr->nNodes) {
+				AG_SetError("%s: Bogus port node: %d",
+				    OBJECT(com)->name, (int)node);
+				goto fail;
+			}
+			ES_AddBranch(ckt, (int)node, &com->ports[j]);
+			com->ports[j].node = (int)node;
+		}
+	}
+
+	/* Symbol table (except for symbols the circuit defines, e.g. "Gnd") */
+	for (i = 0; i < hdr->nSyms; i++) {
+		const ES_NetlistSym *ns = &nl->syms[i];
+		const char *name;
+		ES_Sym *sym;
+
+		if (ns->name >= hdr->lenStrings) {
+			AG_SetError("Bogus symbol #%u", i);
+			goto fail;
+		}
+		name = ES_NETLIST_STRING(nl,ns->name);
+		if (ns->type == ES_SYM_NODE &&
+		    (sym = ES_LookupSymbol(ckt, name)) != NULL &&
+		    sym->type == ES_SYM_NODE && sym->p.node == (int)ns->idx) {
+			continue;
+		}
+		switch (ns->type) {
+		case ES_SYM_NODE:
+			if (ns->idx < 0 || (Uint32)ns->idx >= hdr->nNodes) {
+				AG_SetError("%s: Bogus node", name);
+				goto fail;
+			}
+			ES_AddNodeSymbol(ckt, name, (int)ns->idx);
+			break;
+		case ES_SYM_VSOURCE:
+			ES_AddVsourceSymbol(ckt, name, (int)ns->idx);
+			break;
+		case ES_SYM_ISOURCE:
+			ES_AddIsourceSymbol(ckt, name, (int)ns->idx);
+			break;
+		default:
+			AG_SetError("%s: Bogus symbol type", name);
+			goto fail;
+		}
+	}
+
+	/*
+	 * Notify the components. Voltage sources register in the same order
+	 * as in the compiled circuit, so that branch current indices match.
+	 */
+	for (i = 0; i < hdr->nComs; i++) {
+		AG_PostEvent(coms[i], "circuit-connected", NULL);
+	}
+	for (i = 0; i < hdr->nComs; i++) {
+		Sint32 vs = nl->coms[i].vsource;
+
+		if (vs != -1 &&
+		    (vs < 0 || (Uint)vs >= ckt->m || ckt->vSrcs[vs] != coms[i])) {
+			AG_SetError("%s: Voltage source mismatch",
+			    OBJECT(coms[i])->name);
+			goto fail;
+		}
+	}
+	ES_CircuitModified(ckt);
+
+	Free(coms);
+	Free(classes);
+	return (0);
+fail:
+	Free(coms);
+	Free(classes);
+	return (-1);
+}
+
+/* Load a compiled netlist into an empty circuit. */
+int
+ES_NetlistLoad(ES_Circuit *ckt, const char *path)
+{
+	ES_Netlist *nl;
+	int rv;
+
+	if ((nl = ES_NetlistOpen(path)) == NULL) {
+		return (-1);
+	}
+	rv = ES_NetlistInstantiate(nl, ckt);
+	ES_NetlistClose(nl);
+	return (rv);
+}
@@ -0,0 +1,73 @@
+/*	Public domain	*/
+
+/*
+ * Compiled netlist (.ecn) files, written by ecmcompile(1). A compiled
+ * netlist holds the topology of a circuit as flat tables, so that it can
+ * be mapped into memory and instantiated for headless simulation without
+ * unserializing the schematics or resolving any names. Integers are in
+ * host byte order, and every table starts on an 8-byte boundary.
+ *
+ * The file is an ES_NetlistHeader followed by the class table (string
+ * offsets of the class specifications), the component table, the port
+ * table (node of ports 1..nPorts of every component), the symbol table,
+ * the parameter blocks (serialized component models) and the string pool.
+ */
+
+#define ES_NETLIST_MAGIC	0x45534e4c	/* "ESNL" */
+#define ES_NETLIST_VERSION	2
+#define ES_NETLIST_EXT		".ecn"
+
+typedef struct es_netlist_header {
+	Uint32 magic;			/* ES_NETLIST_MAGIC */
+	Uint32 version;			/* ES_NETLIST_VERSION */
+	Uint32 size;			/* Total file size */
+	Uint32 descr;			/* Circuit description (string) */
+	Uint32 nClasses, offsClasses;	/* Component classes */
+	Uint32 nComs, offsComs;		/* Components */
+	Uint32 nPorts, offsPorts;	/* Port to node table */
+	Uint32 nSyms, offsSyms;		/* Symbols */
+	Uint32 nNodes;			/* Nodes (including ground) */
+	Uint32 nVsources;		/* Independent voltage sources */
+	Uint32 lenStrings, offsStrings;	/* String pool */
+} ES_NetlistHeader;
+
+typedef struct es_netlist_com {
+	Uint32 cls;			/* Index into class table */
+	Uint32 name;			/* Instance name (string) */
+	Uint32 params, lenParams;	/* Parameter block (file offset) */
+	Uint32 port;			/* First entry in port table */
+	Uint32 nPorts;			/* Number of ports */
+	Sint32 vsource;			/* Voltage source index (or -1) */
+	Uint32 pad;
+} ES_NetlistCom;
+
+typedef struct es_netlist_sym {
+	Uint32 name;			/* Symbol name (string) */
+	Uint32 type;			/* Type (enum es_sym_type) */
+	Sint32 idx;			/* Node, vsource or isource */
+	Uint32 pad;
+} ES_NetlistSym;
+
+/* Compiled netlist mapped into memory. */
+typedef struct es_netlist {
+	void *data;				/* File contents */
+	size_t size;
+	int mapped;				/* Data is mmap()ed */
+	const ES_NetlistHeader *hdr;
+	const Uint32          *classes;
+	const ES_NetlistCom   *coms;
+	const Sint32          *ports;
+	const ES_NetlistSym   *syms;
+	const char            *strings;
+} ES_Netlist;
+
+#define ES_NETLIST_STRING(nl,offs) (&(nl)->strings[offs])
+
+__BEGIN_DECLS
+int         ES_NetlistCompile(ES_Circuit *, const char *);
+int         ES_NetlistIsCompiled(const char *);
+ES_Netlist *ES_NetlistOpen(const char *);
+void        ES_NetlistClose(ES_Netlist *);
+int         ES_NetlistInstantiate(ES_Netlist *, ES_Circuit *);
+int         ES_NetlistLoad(ES_Circuit *, const char *);
+__END_DECLS
@@ -41,182 +41,20 @@
 #endif
 
 AG_Object *esPackageLibrary = NULL;	/* Package library */
+ES_LibraryIndex esPackageIndex;		/* Index of package files */
 
 char **esPackageLibraryDirs;
 int    esPackageLibraryDirCount;
 
-/* Load a package from file. */
-static int
-LoadPackageFile(const char *path, AG_Object *objParent)
-{
-	AG_ObjectHeader oh;
-	AG_DataSource *ds;
-	AG_ObjectClass *cl;
-	AG_Object *obj;
-
-	/* Fetch class information from the object file's header. */
-	if ((ds = AG_OpenFile(path, "rb")) == NULL) {
-		return (-1);
-	}
-	if (AG_ObjectReadHeader(ds, &oh) == -1) {
-		AG_CloseFile(ds);
-		return (-1);
-	}
-	AG_CloseFile(ds);
-
-	/*
-	 * Fetch class information for the model contained. If dynamic library
-	 * modules are required, they get linked at this stage.
-	 */
-	if ((cl = AG_LoadClass(oh.cs.hier)) == NULL)
-		return (-1);
-
-	/* Create the package model instance and load its contents. */
-	if ((obj = AG_ObjectNew(objParent, NULL, cl)) == NULL) {
-		return (-1);
-	}
-	if (AG_ObjectLoadFromFile(obj, path) == -1) {
-		AG_SetError("%s: %s", path, AG_GetError());
-		AG_ObjectDelete(obj);
-		return (-1);
-	}
-	AG_SetString(obj, "archive-path", path);
-	AG_ObjectSetNameS(obj, AG_ShortFilename(path));
-	return (0);
-}
-
-/* Load package model files in specified directory (and subdirectories). */
-static int
-LoadPackagesFromDisk(const char *modelDir, AG_Object *objParent)
-{
-	char path[AG_PATHNAME_MAX];
-	AG_Object *objFolder;
-	AG_Dir *dir;
-	int j;
-#if 0
-	Debug(NULL, "Scanning model directory: %s (under \"%s\")\n",
-	    modelDir, objParent->name);
-#endif
-	if ((dir = AG_OpenDir(modelDir)) == NULL) {
-		return (-1);
-	}
-	for (j = 0; j < dir->nents; j++) {
-		char *file = dir->ents[j];
-		AG_FileInfo fileInfo;
-		char *s;
-
-		if (file[0] == '.')
-			continue;
-
-		Strlcpy(path, modelDir, sizeof(path));
-		Strlcat(path, PATHSEP, sizeof(path));
-		Strlcat(path, file, sizeof(path));
-			
-		if (AG_GetFileInfo(path, &fileInfo) == -1) {
-			AG_Verbose("Ignoring: %s (%s)\n", path, AG_GetError());
-			continue;
-		}
-		if (fileInfo.type == AG_FILE_DIRECTORY) {
-			if ((objFolder = AG_ObjectFindChild(objParent, file))
-			    == NULL) {
-				/* Should not happen */
-				AG_Verbose("Ignoring folder: %s\n", file);
-				continue;
-			}
-			if (LoadPackagesFromDisk(path, objFolder) == -1) {
-				AG_Verbose("Ignoring model dir: %s (%s)\n",
-				    path, AG_GetError());
-			}
-			continue;
-		}
-		if ((s = strstr(file, ".em")) == NULL || s[3] != '\0') {
-			continue;
-		}
-		if (LoadPackageFile(path, objParent) == -1)
-			AG_Verbose("Ignoring model file: %s (%s)", path,
-			    AG_GetError());
-	}
-	AG_CloseDir(dir);
-	return (0);
-}
-
-/* Load package model "folder" objects from disk. */
-static int
-LoadFoldersFromDisk(const char *modelDir, AG_Object *objParent)
-{
-	char path[AG_PATHNAME_MAX];
-	AG_Dir *dir;
-	AG_Object *objFolder;
-	int j;
-#if 0
-	Debug(NULL, "Scanning for folders in: %s (under \"%s\")\n",
-	    modelDir, objParent->name);
-#endif
-	if ((dir = AG_OpenDir(modelDir)) == NULL) {
-		return (-1);
-	}
-	for (j = 0; j < dir->nents; j++) {
-		char *file = dir->ents[j];
-		AG_FileInfo fileInfo;
-
-		if (file[0] == '.')
-			continue;
-
-		Strlcpy(path, modelDir, sizeof(path));
-		Strlcat(path, PATHSEP, sizeof(path));
-		Strlcat(path, file, sizeof(path));
-			
-		if (AG_GetFileInfo(path, &fileInfo) == -1) {
-			AG_Verbose("Ignoring: %s (%s)\n", path, AG_GetError());
-			continue;
-		}
-		if (fileInfo.type != AG_FILE_DIRECTORY) {
-			continue;
-		}
-		if ((objFolder = AG_ObjectNew(objParent, file, &agObjectClass))
-		    == NULL) {
-			AG_Verbose("Ignoring folder: %s (%s)\n", path,
-			    AG_GetError());
-			continue;
-		}
-		if (LoadFoldersFromDisk(path, objFolder) == -1) {
-			AG_Verbose("Ignoring folder: %s (%s)\n", path,
-			    AG_GetError());
-		}
-	}
-	AG_CloseDir(dir);
-	return (0);
-}
-
-/* Load the model library from disk. */
+/* Bring the package library up to date with the package directories. */
 int
 ES_PackageLibraryLoad(void)
 {
-	int i;
-
-	if (esPackageLibrary != NULL) {
-		if (AG_ObjectInUse(esPackageLibrary)) {
-			/* XXX */
-			AG_Verbose("Not freeing model library; model(s) are"
-			           "currently in use");
-		} else {
-	//		AG_ObjectDestroy(esPackageLibrary);
-		}
-	}
-
-	/* Create the folder structure. */
-	esPackageLibrary = AG_ObjectNew(NULL, "Package Library", &agObjectClass);
-	for (i = 0; i < esPackageLibraryDirCount; i++) {
-		if (LoadFoldersFromDisk(esPackageLibraryDirs[i], esPackageLibrary) == -1)
-			AG_Verbose("Skipping: %s\n",  AG_GetError());
-	}
-
-	/* Load the model files. */
-	for (i = 0; i < esPackageLibraryDirCount; i++) {
-		if (LoadPackagesFromDisk(esPackageLibraryDirs[i],
-		    esPackageLibrary) == -1)
-			AG_Verbose("Skipping: %s\n",  AG_GetError());
+	if (ES_LibraryIndexUpdate(&esPackageIndex, "Package Library",
+	    esPackageLibraryDirs, esPackageLibraryDirCount) == -1) {
+		return (-1);
 	}
+	esPackageLibrary = esPackageIndex.root;
 	return (0);
 }
 
@@ -264,6 +102,7 @@ ES_PackageLibraryInit(void)
 	esPackageLibrary = NULL;
 	esPackageLibraryDirs = NULL;
 	esPackageLibraryDirCount = 0;
+	ES_LibraryIndexInit(&esPackageIndex, "Packages", ".edp", NULL);
 	
 	Strlcpy(path, DATADIR, sizeof(path));
 	Strlcat(path, "/Packages", sizeof(path));
@@ -288,69 +127,32 @@ ES_PackageLibraryInit(void)
 		ES_PackageLibraryRegisterDir(path);
 	}
 #endif
-	if (ES_PackageLibraryLoad() == -1)
-		AG_Verbose("Loading library: %s", AG_GetError());
 }
 
 /* Destroy the model library. */
 void
 ES_PackageLibraryDestroy(void)
 {
-	AG_ObjectDestroy(esPackageLibrary);
+	ES_LibraryIndexDestroy(&esPackageIndex);
 	esPackageLibrary = NULL;
 	Free(esPackageLibraryDirs);
 }
 
-static AG_TlistItem *
-FindPackages(AG_Tlist *tl, AG_Object *pob, int depth)
-{
-	AG_Object *chld;
-	AG_TlistItem *it;
-
-	it = AG_TlistAddPtr(tl,
-	    AG_OfClass(pob, "ES_Layout:ES_Package:*") ?
-	    esIconComponent.s : agIconDirectory.s,
-	    pob->name, pob);
-	it->depth = depth;
-
-	if (!TAILQ_EMPTY(&pob->children)) {
-		it->flags |= AG_TLIST_HAS_CHILDREN;
-	}
-	if ((it->flags & AG_TLIST_HAS_CHILDREN) &&
-	    AG_TlistVisibleChildren(tl, it)) {
-		TAILQ_FOREACH(chld, &pob->children, cobjs)
-			FindPackages(tl, chld, depth+1);
-	}
-	return (it);
-}
-
 /* Generate a Tlist tree for the package library. */
 static void
 PollLibrary(AG_Event *event)
 {
 	AG_Tlist *tl = AG_TLIST_SELF();
-	AG_TlistItem *ti;
-	
-	AG_TlistClear(tl);
-	AG_LockVFS(esPackageLibrary);
 
-	ti = FindPackages(tl, OBJECT(esPackageLibrary), 0);
-	ti->flags |= AG_TLIST_ITEM_EXPANDED;
-
-	AG_UnlockVFS(esPackageLibrary);
-	AG_TlistRestore(tl);
+	ES_LibraryIndexPoll(&esPackageIndex, tl);
 }
 
+/* Rescan all package directories (attached browsers are refreshed). */
 static void
 RefreshLibrary(AG_Event *event)
 {
-	AG_Tlist *tl = AG_TLIST_PTR(1);
-
-	if (ES_PackageLibraryLoad() == -1) {
+	if (ES_PackageLibraryLoad() == -1)
 		AG_TextMsgFromError();
-		return;
-	}
-	AG_TlistRefresh(tl);
 }
 
 static void
@@ -419,13 +221,22 @@ static void
 PackageMenu(AG_Event *event)
 {
 	AG_Tlist *tl = AG_TLIST_SELF();
-	AG_Object *obj = AG_TlistSelectedItemPtr(tl);
+	AG_TlistItem *ti = AG_TlistSelectedItem(tl);
 	AG_PopupMenu *pm;
+	AG_Object *obj;
 
+	if (ti == NULL || strcmp(ti->cat, "object") != 0)
+		return;
+
+	if ((obj = ES_LibraryIndexLoadItem(&esPackageIndex, ti))
+	    == NULL) {
+		AG_TextMsgFromError();
+		return;
+	}
 	if (!AG_OfClass(obj, "ES_Layout:ES_Package:*"))
 		return;
 
-	if ((pm = AG_PopupNew(tl)) != NULL)
+	if ((pm = AG_PopupNew(tl)) == NULL)
 		return;
 
 	AG_MenuAction(pm->root, _("Edit package model..."), esIconComponent.s,
@@ -446,9 +257,13 @@ ES_PackageLibraryEditorNew(void *parent, VG_View *vv, ES_Layout *lo,
 	AG_Box *box;
 	AG_Button *btn;
 	AG_Tlist *tl;
-	AG_Event ev;
 	AG_Event *evSel;
 
+	/* The library is only scanned once a browser is needed. */
+	if (esPackageLibrary == NULL &&
+	    ES_PackageLibraryLoad() == -1)
+		AG_Verbose("Loading library: %s", AG_GetError());
+
 	box = AG_BoxNewVert(parent, AG_BOX_EXPAND);
 
 	tl = AG_TlistNewPolled(box, AG_TLIST_TREE | AG_TLIST_EXPAND,
@@ -469,11 +284,12 @@ ES_PackageLibraryEditorNew(void *parent, VG_View *vv, ES_Layout *lo,
 	}
 
 	btn = AG_ButtonNewFn(box, AG_BUTTON_HFILL, _("Refresh list"),
-	    RefreshLibrary, "%p", tl);
+	    RefreshLibrary, NULL);
 
 	AG_WidgetSetFocusable(btn, 0);
 
-	AG_EventArgs(&ev, "%p", tl);
-	RefreshLibrary(&ev);
+	/* Changes to the package directories are pushed to the list. */
+	ES_LibraryIndexAttach(&esPackageIndex, tl);
+	AG_TlistRefresh(tl);
 	return (ES_PackageLibraryEditor *)box;
 }
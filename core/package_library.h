@@ -4,6 +4,7 @@ typedef AG_Box ES_PackageLibraryEditor;
 
 __BEGIN_DECLS
 extern AG_Object *esPackageLibrary;
+extern ES_LibraryIndex esPackageIndex;
 extern char **esPackageLibraryDirs;
 extern int    esPackageLibraryDirCount;
 
@@ -13,5 +14,10 @@ void    ES_PackageLibraryRegisterDir(const char *);
 void    ES_PackageLibraryUnregisterDir(const char *);
 int     ES_PackageLibraryLoad(void);
 
+/*
+ * The insert function receives the selected Tlist item. Items of category
+ * "object" point to an ES_LibraryEntry of esPackageIndex, to be loaded
+ * with ES_LibraryIndexLoadObject().
+ */
 ES_PackageLibraryEditor *ES_PackageLibraryEditorNew(void *, VG_View *, ES_Layout *, Uint, AG_EventFn, const char *, ...);
 __END_DECLS
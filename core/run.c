@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Headless simulation interface, for embedding the simulator in other
+ * programs. A circuit is loaded, an analysis is configured and run to
+ * completion, and samples of the probed quantities are either passed to
+ * a callback or stored. No GUI initialization, timers or event posting
+ * are involved; callers only need AG_InitCore() and ES_CoreInit().
+ */
+
+#include "core.h"
+
+/* Load a circuit from file and prepare to analyze it. */
+ES_Run *
+ES_RunOpen(const char *path)
+{
+	ES_Circuit *ckt;
+	ES_Run *run;
+
+	ckt = AG_ObjectNew(NULL, NULL, &esCircuitClass);
+	ckt->flags |= ES_CIRCUIT_HEADLESS;
+	if ((ES_NetlistIsCompiled(path) ?
+	    ES_NetlistLoad(ckt, path) :
+	    AG_ObjectLoadFromFile(ckt, path)) == -1) {
+		AG_ObjectDestroy(ckt);
+		return (NULL);
+	}
+	run = ES_RunNew(ckt);
+	run->ownCircuit = 1;
+	return (run);
+}
+
+/* Prepare to analyze an existing circuit. */
+ES_Run *
+ES_RunNew(ES_Circuit *ckt)
+{
+	ES_Run *run;
+
+	run = Malloc(sizeof(ES_Run));
+	run->ckt = ckt;
+	run->ownCircuit = 0;
+	run->analysis = ES_RUN_TRANSIENT;
+	run->flags = 0;
+	run->tStop = 0.0;
+	run->maxSteps = 0;
+	run->Tstart = 27.0+273.15;
+	run->Tstop = 27.0+273.15;
+	run->nTemps = 0;
+	run->simFlags = 0;
+	run->nThreads = 0;
+	run->probes = NULL;
+	run->nProbes = 0;
+	run->sampleFn = NULL;
+	run->sampleArg = NULL;
+	run->t = NULL;
+	run->v = NULL;
+	run->nSamples = 0;
+	run->maxSamples = 0;
+	run->vCur = NULL;
+	run->sim = NULL;
+	return (run);
+}
+
+void
+ES_RunClose(ES_Run *run)
+{
+	if (run->sim != NULL) {
+		ES_DestroySimulation(run->ckt);
+	}
+	if (run->ownCircuit) {
+		AG_ObjectDestroy(run->ckt);
+	}
+	Free(run->probes);
+	Free(run->t);
+	Free(run->v);
+	Free(run->vCur);
+	free(run);
+}
+
+int
+ES_RunSetAnalysis(ES_Run *run, enum es_run_analysis analysis)
+{
+	switch (analysis) {
+	case ES_RUN_TRANSIENT:
+	case ES_RUN_TEMP_SWEEP:
+		break;
+	default:
+		AG_SetError(_("No such analysis"));
+		return (-1);
+	}
+	run->analysis = analysis;
+	return (0);
+}
+
+/* Set the simulated time and/or the number of timesteps to run for. */
+void
+ES_RunSetStop(ES_Run *run, M_Real tStop, Uint maxSteps)
+{
+	run->tStop = tStop;
+	run->maxSteps = maxSteps;
+}
+
+/*
+ * Set the range of a temperature sweep (in K), and the number of points
+ * (including both ends).
+ */
+void
+ES_RunSetTempSweep(ES_Run *run, M_Real Tstart, M_Real Tstop, Uint nTemps)
+{
+	run->Tstart = Tstart;
+	run->Tstop = Tstop;
+	run->nTemps = nTemps;
+}
+
+/*
+ * Set ES_SIMDC_* solver options (e.g. ES_SIMDC_SPARSE, ES_SIMDC_CHORD or
+ * ES_SIMDC_NO_LTI) and the number of threads for the sparse factorization
+ * (0 = default), applied to the simulation before it is started.
+ */
+void
+ES_RunSetSolver(ES_Run *run, Uint simFlags, Uint nThreads)
+{
+	run->simFlags = simFlags;
+	run->nThreads = nThreads;
+}
+
+/*
+ * Register a quantity to probe (see ES_ParseProbe()). Returns the index
+ * of the quantity in the samples, or -1.
+ */
+int
+ES_RunAddProbe(ES_Run *run, const char *name)
+{
+	ES_Probe probe;
+
+	if (ES_ParseProbe(run->ckt, name, &probe) == -1) {
+		return (-1);
+	}
+	run->probes = Realloc(run->probes, (run->nProbes+1)*sizeof(ES_Probe));
+	run->probes[run->nProbes] = probe;
+	return (run->nProbes++);
+}
+
+void
+ES_RunSetSampleFn(ES_Run *run, ES_RunSampleFn fn, void *arg)
+{
+	run->sampleFn = fn;
+	run->sampleArg = arg;
+}
+
+/* Record a sample. Returns non-zero if the analysis should end. */
+static int
+Sample(ES_Run *run, M_Real t)
+{
+	Uint k;
+
+	for (k = 0; k < run->nProbes; k++) {
+		run->vCur[k] = ES_ProbeValue(run->ckt, &run->probes[k]);
+	}
+	if (run->flags & ES_RUN_KEEP_SAMPLES) {
+		if (run->nSamples == run->maxSamples) {
+			run->maxSamples = (run->maxSamples > 0) ?
+			                  run->maxSamples*2 : 256;
+			run->t = Realloc(run->t,
+			    run->maxSamples*sizeof(M_Real));
+			run->v = Realloc(run->v,
+			    (run->maxSamples*run->nProbes + 1)*sizeof(M_Real));
+		}
+		run->t[run->nSamples] = t;
+		for (k = 0; k < run->nProbes; k++) {
+			ES_RUN_SAMPLE(run, run->nSamples, k) = run->vCur[k];
+		}
+	}
+	run->nSamples++;
+
+	if (run->sampleFn != NULL) {
+		return run->sampleFn(run, t, run->vCur, run->sampleArg);
+	}
+	return (0);
+}
+
+static int
+ExecTransient(ES_Run *run)
+{
+	ES_SimDC *sim = run->sim;
+	Uint nSteps = 0;
+
+	if (ES_SimDCBegin(sim) == -1) {
+		return (-1);
+	}
+	if (Sample(run, sim->Telapsed) != 0) {
+		return (0);
+	}
+	for (;;) {
+		if ((run->maxSteps > 0 && nSteps >= run->maxSteps) ||
+		    (run->tStop > 0.0 && sim->Telapsed >= run->tStop)) {
+			break;
+		}
+		if (ES_SimDCStep(sim) == -1) {
+			return (-1);
+		}
+		nSteps++;
+		if (Sample(run, sim->Telapsed) != 0)
+			break;
+	}
+	return (0);
+}
+
+/*
+ * Temperature sweep. The system is set up once at the first temperature;
+ * every following point only updates the temperature-dependent parameters
+ * and solves from the previous operating point.
+ */
+static int
+ExecTempSweep(ES_Run *run)
+{
+	ES_SimDC *sim = run->sim;
+	M_Real T;
+	Uint i;
+
+	sim->T0 = run->Tstart;
+	if (ES_SimDCBegin(sim) == -1) {
+		return (-1);
+	}
+	if (Sample(run, sim->T0) != 0) {
+		return (0);
+	}
+	for (i = 1; i < run->nTemps; i++) {
+		T = run->Tstart + (run->Tstop - run->Tstart)*i/(run->nTemps-1);
+		ES_SimDCSetTemp(sim, T);
+		if (ES_SimDCSolveOP(sim) == -1) {
+			return (-1);
+		}
+		if (Sample(run, T) != 0)
+			break;
+	}
+	return (0);
+}
+
+/* Create the simulation object and apply the solver options. */
+static ES_SimDC *
+CreateSim(ES_Run *run)
+{
+	ES_SimDC *sim;
+
+	sim = (ES_SimDC *)ES_CreateSimulation(run->ckt, &esSimDcOps);
+	sim->flags |= ES_SIMDC_HEADLESS | run->simFlags;
+	if (run->nThreads > 0) {
+		sim->nThreads = run->nThreads;
+	}
+	return (sim);
+}
+
+/*
+ * Run the analysis to completion, starting with the initial bias point.
+ * The simulation state is kept until the next run, so that it may be
+ * queried with ES_NodeVoltage() and friends.
+ */
+int
+ES_RunExec(ES_Run *run)
+{
+	if (run->analysis == ES_RUN_TRANSIENT &&
+	    run->tStop <= 0.0 && run->maxSteps == 0 &&
+	    run->sampleFn == NULL) {
+		AG_SetError(_("No stop condition"));
+		return (-1);
+	}
+	if (run->analysis == ES_RUN_TEMP_SWEEP && run->nTemps < 2) {
+		AG_SetError(_("Temperature sweep needs at least 2 points"));
+		return (-1);
+	}
+	run->nSamples = 0;
+	run->vCur = Realloc(run->vCur, (run->nProbes+1)*sizeof(M_Real));
+
+	switch (run->analysis) {
+	case ES_RUN_TRANSIENT:
+		run->sim = CreateSim(run);
+		return ExecTransient(run);
+	case ES_RUN_TEMP_SWEEP:
+		run->sim = CreateSim(run);
+		return ExecTempSweep(run);
+	}
+	AG_SetError(_("No such analysis"));
+	return (-1);
+}
@@ -0,0 +1,58 @@
+/*	Public domain	*/
+
+/* Analyses available through the ES_Run interface. */
+enum es_run_analysis {
+	ES_RUN_TRANSIENT,		/* Transient analysis */
+	ES_RUN_TEMP_SWEEP		/* Operating point vs. temperature */
+};
+
+struct es_run;
+
+/*
+ * Called for every sample; return non-zero to end the analysis early. The
+ * abscissa is the time, or the temperature (K) in a temperature sweep.
+ */
+typedef int (*ES_RunSampleFn)(struct es_run *, M_Real t, const M_Real *v,
+                              void *arg);
+
+/* Headless analysis of a circuit (no GUI, timers or event posting). */
+typedef struct es_run {
+	ES_Circuit *ckt;		/* Circuit being analyzed */
+	int ownCircuit;			/* Circuit loaded by ES_RunOpen() */
+	enum es_run_analysis analysis;
+	Uint flags;
+#define ES_RUN_KEEP_SAMPLES	0x01	/* Store the samples in t[] and v[] */
+	M_Real tStop;			/* Simulated time (0 = no limit) */
+	Uint maxSteps;			/* Timestep limit (0 = no limit) */
+	M_Real Tstart, Tstop;		/* Temperature sweep range (K) */
+	Uint nTemps;			/* Temperature sweep points */
+	Uint simFlags;			/* Extra ES_SIMDC_* solver flags */
+	Uint nThreads;			/* Sparse LU threads (0 = default) */
+
+	ES_Probe *probes;		/* Probed quantities */
+	Uint     nProbes;
+	ES_RunSampleFn sampleFn;	/* Sample callback */
+	void *sampleArg;
+
+	M_Real *t;			/* Sample abscissae (ES_RUN_KEEP_SAMPLES) */
+	M_Real *v;			/* Samples (nSamples x nProbes) */
+	Uint nSamples;
+	Uint maxSamples;
+	M_Real *vCur;			/* Current sample */
+	ES_SimDC *sim;			/* Simulation state of the last run */
+} ES_Run;
+
+#define ES_RUN_SAMPLE(run,s,p) ((run)->v[(s)*(run)->nProbes + (p)])
+
+__BEGIN_DECLS
+ES_Run *ES_RunOpen(const char *);
+ES_Run *ES_RunNew(ES_Circuit *);
+void    ES_RunClose(ES_Run *);
+int     ES_RunSetAnalysis(ES_Run *, enum es_run_analysis);
+void    ES_RunSetStop(ES_Run *, M_Real, Uint);
+void    ES_RunSetTempSweep(ES_Run *, M_Real, M_Real, Uint);
+void    ES_RunSetSolver(ES_Run *, Uint, Uint);
+int     ES_RunAddProbe(ES_Run *, const char *);
+void    ES_RunSetSampleFn(ES_Run *, ES_RunSampleFn, void *);
+int     ES_RunExec(ES_Run *);
+__END_DECLS
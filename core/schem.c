@@ -84,56 +84,19 @@ Save(void *obj, AG_DataSource *ds)
 void *
 ES_SchemNearest(VG_View *vv, VG_Vector vPos)
 {
-	VG *vg = vv->vg;
-	float prox, proxNearest;
-	VG_Node *vn, *vnNearest;
-	VG_Vector v;
+	VG_Node *vn;
 
 	/* First check if we intersect a block. */
-	TAILQ_FOREACH(vn, &vg->nodes, list) {
-		if (!VG_NodeIsClass(vn, "SchemBlock")) {
-			continue;
-		}
-		v = vPos;
-		prox = vn->ops->pointProximity(vn, vv, &v);
-		if (prox == 0.0f)
-			return (vn);
-	}
+	if ((vn = ES_SpatialNearest(vv, vPos, "SchemBlock", 0.0f, NULL)) != NULL)
+		return (vn);
 
 	/* Then prioritize points at a fixed distance. */
-	proxNearest = AG_FLT_MAX;
-	vnNearest = NULL;
-	TAILQ_FOREACH(vn, &vg->nodes, list) {
-		if (!VG_NodeIsClass(vn, "Point")) {
-			continue;
-		}
-		v = vPos;
-		prox = vn->ops->pointProximity(vn, vv, &v);
-		if (prox <= vv->pointSelRadius) {
-			if (prox < proxNearest) {
-				proxNearest = prox;
-				vnNearest = vn;
-			}
-		}
-	}
-	if (vnNearest != NULL)
-		return (vnNearest);
+	if ((vn = ES_SpatialNearest(vv, vPos, "Point", vv->pointSelRadius,
+	    NULL)) != NULL)
+		return (vn);
 
 	/* Finally, fallback to a general query. */
-	proxNearest = AG_FLT_MAX;
-	vnNearest = NULL;
-	TAILQ_FOREACH(vn, &vg->nodes, list) {
-		if (vn->ops->pointProximity == NULL) {
-			continue;
-		}
-		v = vPos;
-		prox = vn->ops->pointProximity(vn, vv, &v);
-		if (prox < proxNearest) {
-			proxNearest = prox;
-			vnNearest = vn;
-		}
-	}
-	return (vnNearest);
+	return ES_SpatialNearest(vv, vPos, NULL, AG_FLT_MAX, NULL);
 }
 
 AG_ObjectClass esSchemClass = {
@@ -40,6 +40,8 @@ Init(void *p)
 
 	sb->name[0] = '\0';
 	sb->com = NULL;
+	sb->extGen = 0;
+	sb->extScale = 0.0f;
 }
 
 static int
@@ -69,23 +71,40 @@ GetNodeExtent(VG_Node *vn, VG_View *vv, VG_Vector *aBlk, VG_Vector *bBlk)
 
 	if (vn->ops->extent != NULL) {
 		vn->ops->extent(vn, vv, &a, &b);
+		if (a.x < aBlk->x) { aBlk->x = a.x; }
+		if (a.y < aBlk->y) { aBlk->y = a.y; }
+		if (b.x > bBlk->x) { bBlk->x = b.x; }
+		if (b.y > bBlk->y) { bBlk->y = b.y; }
 	}
-	if (a.x < aBlk->x) { aBlk->x = a.x; }
-	if (a.y < aBlk->y) { aBlk->y = a.y; }
-	if (b.x > bBlk->x) { bBlk->x = b.x; }
-	if (b.y > bBlk->y) { bBlk->y = b.y; }
 
 	VG_FOREACH_CHLD(vnChld, vn, vg_node)
 		GetNodeExtent(vnChld, vv, aBlk, bBlk);
 }
 
+/*
+ * Return the extent of the block. Computing the extents of the entities
+ * (text in particular) is costly, so the result is cached (relative to the
+ * position of the block, so that it remains valid while the block is
+ * dragged) until the next edit of the VG (see ES_SpatialInvalidate()) or
+ * until the view is zoomed.
+ */
 static void
 Extent(void *p, VG_View *vv, VG_Vector *a, VG_Vector *b)
 {
 	ES_SchemBlock *sb = p;
-	VG_Vector vPos = VG_Pos(sb);
+	VG_Vector vPos;
 	VG_Node *vnChld;
 
+	vPos = VG_Pos(sb);
+	if (sb->extScale == vv->wPixel &&
+	    sb->extGen == ES_SpatialGeneration(vv->vg)) {
+		a->x = vPos.x + sb->extA.x;
+		a->y = vPos.y + sb->extA.y;
+		b->x = vPos.x + sb->extB.x;
+		b->y = vPos.y + sb->extB.y;
+		return;
+	}
+
 	a->x = vPos.x;
 	a->y = vPos.y;
 	b->x = vPos.x;
@@ -93,6 +112,13 @@ Extent(void *p, VG_View *vv, VG_Vector *a, VG_Vector *b)
 
 	VG_FOREACH_CHLD(vnChld, sb, vg_node)
 		GetNodeExtent(vnChld, vv, a, b);
+
+	sb->extA.x = a->x - vPos.x;
+	sb->extA.y = a->y - vPos.y;
+	sb->extB.x = b->x - vPos.x;
+	sb->extB.y = b->y - vPos.y;
+	sb->extGen = ES_SpatialGeneration(vv->vg);
+	sb->extScale = vv->wPixel;
 }
 
 static void
@@ -107,6 +133,9 @@ Draw(void *p, VG_View *vv)
 		const float wPixel4 = vv->wPixel*4.0f;
 
 		Extent(sb, vv, &a, &b);
+		if (!ES_SpatialVisible(vv, a, b)) {
+			return;
+		}
 		a.x -= wPixel4;
 		a.y -= wPixel4;
 		b.x += wPixel4;
@@ -6,6 +6,9 @@ typedef struct es_schem_block {
 	struct vg_node _inherit;
 	char name[AG_OBJECT_NAME_MAX];		/* Name of component (R) */
 	struct es_component *com;		/* Pointer to component */
+	VG_Vector extA, extB;			/* Cached extent (relative) */
+	Uint extGen;				/* Edit generation (cached) */
+	float extScale;				/* View scale (cached; 0 = none) */
 } ES_SchemBlock;
 
 #ifdef _ES_INTERNAL
@@ -40,171 +40,19 @@
 #endif
 
 AG_Object *esSchemLibrary = NULL;	/* Schematic block library */
+ES_LibraryIndex esSchemIndex;		/* Index of schem files */
 char **esSchemLibraryDirs;		/* Search directories */
 int    esSchemLibraryDirCount;
 
-/* Load a schem from file. */
-static int
-LoadSchemFile(const char *path, AG_Object *objParent)
-{
-	AG_ObjectHeader oh;
-	AG_DataSource *ds;
-	AG_Object *obj;
-
-	/* Fetch class information from the object file's header. */
-	if ((ds = AG_OpenFile(path, "rb")) == NULL) {
-		return (-1);
-	}
-	if (AG_ObjectReadHeader(ds, &oh) == -1) {
-		AG_CloseFile(ds);
-		return (-1);
-	}
-	AG_CloseFile(ds);
-
-	if ((obj = AG_ObjectNew(objParent, NULL, &esSchemClass)) == NULL) {
-		return (-1);
-	}
-	if (AG_ObjectLoadFromFile(obj, path) == -1) {
-		AG_SetError("%s: %s", path, AG_GetError());
-		AG_ObjectDelete(obj);
-		return (-1);
-	}
-	AG_SetString(obj, "archive-path", path);
-	AG_ObjectSetNameS(obj, AG_ShortFilename(path));
-	return (0);
-}
-
-/* Load schem files in specified directory (and subdirectories). */
-static int
-LoadSchemsFromDisk(const char *schemDir, AG_Object *objParent)
-{
-	char path[AG_PATHNAME_MAX];
-	AG_Object *objFolder;
-	AG_Dir *dir;
-	int j;
-#if 0
-	Debug(NULL, "Scanning schem directory: %s (under \"%s\")\n",
-	    schemDir, objParent->name);
-#endif
-	if ((dir = AG_OpenDir(schemDir)) == NULL) {
-		return (-1);
-	}
-	for (j = 0; j < dir->nents; j++) {
-		char *file = dir->ents[j];
-		AG_FileInfo fileInfo;
-		char *s;
-
-		if (file[0] == '.')
-			continue;
-
-		Strlcpy(path, schemDir, sizeof(path));
-		Strlcat(path, PATHSEP, sizeof(path));
-		Strlcat(path, file, sizeof(path));
-			
-		if (AG_GetFileInfo(path, &fileInfo) == -1) {
-			AG_Verbose("Ignoring: %s (%s)\n", path, AG_GetError());
-			continue;
-		}
-		if (fileInfo.type == AG_FILE_DIRECTORY) {
-			if ((objFolder = AG_ObjectFindChild(objParent, file))
-			    == NULL) {
-				/* Should not happen */
-				AG_Verbose("Ignoring folder: %s\n", file);
-				continue;
-			}
-			if (LoadSchemsFromDisk(path, objFolder) == -1) {
-				AG_Verbose("Ignoring schem dir: %s (%s)\n",
-				    path, AG_GetError());
-			}
-			continue;
-		}
-		if ((s = strstr(file, ".esh")) == NULL || s[4] != '\0') {
-			continue;
-		}
-		if (LoadSchemFile(path, objParent) == -1)
-			AG_Verbose("Ignoring schem file: %s (%s)", path,
-			    AG_GetError());
-	}
-	AG_CloseDir(dir);
-	return (0);
-}
-
-/* Load schem "folder" objects from disk. */
-static int
-LoadFoldersFromDisk(const char *schemDir, AG_Object *objParent)
-{
-	char path[AG_PATHNAME_MAX];
-	AG_Dir *dir;
-	AG_Object *objFolder;
-	int j;
-#if 0
-	Debug(NULL, "Scanning for folders in: %s (under \"%s\")\n",
-	    schemDir, objParent->name);
-#endif
-	if ((dir = AG_OpenDir(schemDir)) == NULL) {
-		return (-1);
-	}
-	for (j = 0; j < dir->nents; j++) {
-		char *file = dir->ents[j];
-		AG_FileInfo fileInfo;
-
-		if (file[0] == '.')
-			continue;
-
-		Strlcpy(path, schemDir, sizeof(path));
-		Strlcat(path, PATHSEP, sizeof(path));
-		Strlcat(path, file, sizeof(path));
-			
-		if (AG_GetFileInfo(path, &fileInfo) == -1) {
-			AG_Verbose("Ignoring: %s (%s)\n", path, AG_GetError());
-			continue;
-		}
-		if (fileInfo.type != AG_FILE_DIRECTORY) {
-			continue;
-		}
-		if ((objFolder = AG_ObjectNew(objParent, file, &agObjectClass))
-		    == NULL) {
-			AG_Verbose("Ignoring folder: %s (%s)\n", path,
-			    AG_GetError());
-			continue;
-		}
-		if (LoadFoldersFromDisk(path, objFolder) == -1) {
-			AG_Verbose("Ignoring folder: %s (%s)\n", path,
-			    AG_GetError());
-		}
-	}
-	AG_CloseDir(dir);
-	return (0);
-}
-
-/* Load the schem library from disk. */
+/* Bring the schem library up to date with the schem directories. */
 int
 ES_SchemLibraryLoad(void)
 {
-	int i;
-
-	if (esSchemLibrary != NULL) {
-		if (AG_ObjectInUse(esSchemLibrary)) {
-			/* XXX */
-			AG_Verbose("Not freeing schem library; schem(s) are"
-			           "currently in use");
-		} else {
-	//		AG_ObjectDestroy(esSchemLibrary);
-		}
-	}
-
-	/* Create the folder structure. */
-	esSchemLibrary = AG_ObjectNew(NULL, "Schematic library", &agObjectClass);
-	for (i = 0; i < esSchemLibraryDirCount; i++) {
-		if (LoadFoldersFromDisk(esSchemLibraryDirs[i], esSchemLibrary) == -1)
-			AG_Verbose("Skipping: %s\n",  AG_GetError());
-	}
-
-	/* Load the schem files. */
-	for (i = 0; i < esSchemLibraryDirCount; i++) {
-		if (LoadSchemsFromDisk(esSchemLibraryDirs[i], esSchemLibrary) == -1)
-			AG_Verbose("Skipping: %s\n",  AG_GetError());
+	if (ES_LibraryIndexUpdate(&esSchemIndex, "Schematic library",
+	    esSchemLibraryDirs, esSchemLibraryDirCount) == -1) {
+		return (-1);
 	}
+	esSchemLibrary = esSchemIndex.root;
 	return (0);
 }
 
@@ -252,6 +100,7 @@ ES_SchemLibraryInit(void)
 	esSchemLibrary = NULL;
 	esSchemLibraryDirs = NULL;
 	esSchemLibraryDirCount = 0;
+	ES_LibraryIndexInit(&esSchemIndex, "Schematics", ".esh", &esSchemClass);
 	
 	Strlcpy(path, DATADIR, sizeof(path));
 	Strlcat(path, "/Schematics", sizeof(path));
@@ -274,57 +123,24 @@ ES_SchemLibraryInit(void)
 		ES_SchemLibraryRegisterDir(path);
 	}
 #endif
-	if (ES_SchemLibraryLoad() == -1)
-		AG_Verbose("Loading library: %s", AG_GetError());
 }
 
 /* Destroy the schematic library. */
 void
 ES_SchemLibraryDestroy(void)
 {
-	AG_ObjectDestroy(esSchemLibrary);
+	ES_LibraryIndexDestroy(&esSchemIndex);
 	esSchemLibrary = NULL;
 	Free(esSchemLibraryDirs);
 }
 
-static AG_TlistItem *
-FindSchems(AG_Tlist *tl, AG_Object *pob, int depth)
-{
-	AG_Object *chld;
-	AG_TlistItem *it;
-
-	it = AG_TlistAddPtr(tl,
-	    AG_OfClass(pob, "ES_Schem:*") ?
-	    esIconComponent.s : agIconDirectory.s,
-	    pob->name, pob);
-	it->depth = depth;
-
-	if (!TAILQ_EMPTY(&pob->children)) {
-		it->flags |= AG_TLIST_HAS_CHILDREN;
-	}
-	if ((it->flags & AG_TLIST_HAS_CHILDREN) &&
-	    AG_TlistVisibleChildren(tl, it)) {
-		TAILQ_FOREACH(chld, &pob->children, cobjs)
-			FindSchems(tl, chld, depth+1);
-	}
-	return (it);
-}
-
 /* Generate a Tlist tree for the schem library. */
 static void
 PollLibrary(AG_Event *event)
 {
 	AG_Tlist *tl = AG_TLIST_SELF();
-	AG_TlistItem *ti;
-
-	AG_TlistClear(tl);
-	AG_LockVFS(esSchemLibrary);
 
-	ti = FindSchems(tl, OBJECT(esSchemLibrary), 0);
-	ti->flags |= AG_TLIST_ITEM_EXPANDED;
-
-	AG_UnlockVFS(esSchemLibrary);
-	AG_TlistRestore(tl);
+	ES_LibraryIndexPoll(&esSchemIndex, tl);
 }
 
 static void
@@ -332,22 +148,27 @@ InsertSchematic(AG_Event *event)
 {
 	VG_View *vv = VG_VIEW_PTR(1);
 	AG_TlistItem *ti = AG_TLIST_ITEM_PTR(2);
-	ES_Schem *schem = ti->p1;
-	
-	if (!AG_OfClass(schem, "ES_Schem:*"))
+	ES_Schem *schem;
+
+	if (strcmp(ti->cat, "object") != 0)
 		return;
 
+	if ((schem = (ES_Schem *)ES_LibraryIndexLoadItem(&esSchemIndex,
+	    ti)) == NULL) {
+		AG_TextMsgFromError();
+		return;
+	}
+
 	AG_TextMsg(AG_MSG_ERROR, "Insert schem %s in %s", OBJECT(schem)->name,
 	    OBJECT(vv)->name);
 }
 
+/* Rescan all schem directories (attached browsers are refreshed). */
 static void
 RefreshLibrary(AG_Event *event)
 {
-	if (ES_SchemLibraryLoad() == -1) {
+	if (ES_SchemLibraryLoad() == -1)
 		AG_TextMsgFromError();
-		return;
-	}
 }
 
 static void
@@ -413,9 +234,17 @@ static void
 SchemMenu(AG_Event *event)
 {
 	AG_Tlist *tl = AG_TLIST_SELF();
-	AG_Object *obj = AG_TlistSelectedItemPtr(tl);
+	AG_TlistItem *ti = AG_TlistSelectedItem(tl);
 	AG_PopupMenu *pm;
+	AG_Object *obj;
+
+	if (ti == NULL || strcmp(ti->cat, "object") != 0)
+		return;
 
+	if ((obj = ES_LibraryIndexLoadItem(&esSchemIndex, ti)) == NULL) {
+		AG_TextMsgFromError();
+		return;
+	}
 	if (!AG_OfClass(obj, "ES_Schem:*"))
 		return;
 	
@@ -440,6 +269,11 @@ ES_SchemLibraryEditorNew(void *parent, VG_View *vv, Uint flags)
 	AG_Button *btn;
 	AG_Tlist *tl;
 
+	/* The library is only scanned once a browser is needed. */
+	if (esSchemLibrary == NULL &&
+	    ES_SchemLibraryLoad() == -1)
+		AG_Verbose("Loading library: %s", AG_GetError());
+
 	box = AG_BoxNewVert(parent, AG_BOX_EXPAND);
 
 	tl = AG_TlistNewPolled(box, AG_TLIST_TREE|AG_TLIST_EXPAND,
@@ -454,6 +288,9 @@ ES_SchemLibraryEditorNew(void *parent, VG_View *vv, Uint flags)
 	    RefreshLibrary, NULL);
 	AG_WidgetSetFocusable(btn, 0);
 
-	RefreshLibrary(NULL);
+	/* Changes to the schem directories are pushed to the list. */
+	AG_TlistSetRefresh(tl, -1);
+	ES_LibraryIndexAttach(&esSchemIndex, tl);
+	AG_TlistRefresh(tl);
 	return (ES_SchemLibraryEditor *)box;
 }
@@ -4,6 +4,7 @@ typedef AG_Box ES_SchemLibraryEditor;
 
 __BEGIN_DECLS
 extern AG_Object *esSchemLibrary;
+extern ES_LibraryIndex esSchemIndex;
 extern char **esSchemLibraryDirs;
 extern int    esSchemLibraryDirCount;
 
@@ -87,7 +87,7 @@ Draw(void *p, VG_View *vv)
 {
 	ES_SchemPort *sp = p;
 /*	char text[16]; */
-	int x, y;
+	int x, y, rView;
 	float r;
 	AG_Color c;
 
@@ -99,9 +99,15 @@ Draw(void *p, VG_View *vv)
 		} else {
 			r = sp->r;
 		}
+		/* Skip ports outside of the view or smaller than a pixel. */
+		rView = (int)(r*vv->scale);
+		if (rView < 1 ||
+		    x+rView < 0 || x-rView >= AGWIDGET(vv)->w ||
+		    y+rView < 0 || y-rView >= AGWIDGET(vv)->h) {
+			return;
+		}
 		c = VG_MapColorRGB(VGNODE(sp)->color);
-		AG_DrawCircle(vv, x, y, (int)(r*vv->scale), &c);
-		    
+		AG_DrawCircle(vv, x, y, rView, &c);
 	}
 #if 0
 	/* XXX VG_DrawText */
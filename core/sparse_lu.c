@@ -0,0 +1,1154 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Sparse LU factorization with a static pivot order, for systems too
+ * large to be factored densely. Columns are factored left-looking (Crout),
+ * column j of L and row j of U sharing the structure of the symbolic
+ * Cholesky factor of the symmetrized pattern. Column j only depends on
+ * its descendants in the elimination tree, which is what allows the
+ * subtrees and the columns of a same level to be factored concurrently.
+ */
+
+#include "core.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int
+CompareEntries(const void *p1, const void *p2)
+{
+	const ES_MatrixEntry *e1 = p1, *e2 = p2;
+
+	if (e1->col != e2->col) {
+		return (e1->col < e2->col ? -1 : 1);
+	}
+	if (e1->row != e2->row) {
+		return (e1->row < e2->row ? -1 : 1);
+	}
+	return (0);
+}
+
+void
+ES_SparseLUInit(ES_SparseLU *lu)
+{
+	memset(lu, 0, sizeof(ES_SparseLU));
+	lu->nThreads = 1;
+#ifdef AG_THREADS
+	AG_MutexInit(&lu->lock);
+	AG_CondInit(&lu->jobStart);
+	AG_CondInit(&lu->jobDone);
+#endif
+}
+
+static void
+FreeSchedule(ES_SparseLU *lu)
+{
+	Free(lu->subNodes);
+	Free(lu->subPtr);
+	Free(lu->topNodes);
+	Free(lu->topPtr);
+	lu->subNodes = lu->subPtr = lu->topNodes = lu->topPtr = NULL;
+	lu->nTopLevels = 0;
+}
+
+static void
+FreeAnalysis(ES_SparseLU *lu)
+{
+	Free(lu->rowOf);
+	Free(lu->colOf);
+	Free(lu->parent);
+	Free(lu->height);
+	Free(lu->lp);
+	Free(lu->li);
+	Free(lu->rp);
+	Free(lu->rk);
+	Free(lu->rq);
+	Free(lu->ap);
+	Free(lu->ai);
+	Free(lu->av);
+	Free(lu->lvNodes);
+	Free(lu->lvPtr);
+	Free(lu->lx);
+	Free(lu->ux);
+	Free(lu->d);
+	Free(lu->w);
+	lu->rowOf = lu->colOf = NULL;
+	lu->parent = NULL;
+	lu->height = lu->lp = lu->li = lu->rp = lu->rk = lu->rq = NULL;
+	lu->ap = lu->ai = lu->lvNodes = lu->lvPtr = NULL;
+	lu->av = NULL;
+	lu->lx = lu->ux = lu->d = lu->w = NULL;
+	lu->n = 0;
+	lu->nnz = 0;
+	lu->nLevels = 0;
+	FreeSchedule(lu);
+}
+
+/*
+ * Thread pool. A job is a function run by every worker (including the
+ * caller, as worker 0); it returns once all workers are done.
+ */
+#ifdef AG_THREADS
+static void *
+PoolWorker(void *p)
+{
+	ES_SparseLUWorker *wk = p;
+	ES_SparseLU *lu = wk->lu;
+	Uint gen = 0;
+
+	AG_MutexLock(&lu->lock);
+	for (;;) {
+		while (lu->jobGen == gen && !lu->poolExit) {
+			AG_CondWait(&lu->jobStart, &lu->lock);
+		}
+		if (lu->poolExit) {
+			break;
+		}
+		gen = lu->jobGen;
+		AG_MutexUnlock(&lu->lock);
+
+		lu->job(lu, wk);
+
+		AG_MutexLock(&lu->lock);
+		if (--lu->jobBusy == 0)
+			AG_CondSignal(&lu->jobDone);
+	}
+	AG_MutexUnlock(&lu->lock);
+	return (NULL);
+}
+#endif /* AG_THREADS */
+
+static void
+RunJob(ES_SparseLU *lu, void (*job)(ES_SparseLU *, ES_SparseLUWorker *),
+    Uint lo, Uint hi, int parallel)
+{
+	lu->job = job;
+	lu->jobLo = lo;
+	lu->jobHi = hi;
+#ifdef AG_THREADS
+	if (parallel && lu->nThreads > 1) {
+		lu->jobThreads = lu->nThreads;
+		AG_MutexLock(&lu->lock);
+		lu->jobBusy = lu->nThreads - 1;
+		lu->jobGen++;
+		AG_CondBroadcast(&lu->jobStart);
+		AG_MutexUnlock(&lu->lock);
+
+		job(lu, &lu->workers[0]);
+
+		AG_MutexLock(&lu->lock);
+		while (lu->jobBusy > 0) {
+			AG_CondWait(&lu->jobDone, &lu->lock);
+		}
+		AG_MutexUnlock(&lu->lock);
+		return;
+	}
+#endif
+	lu->jobThreads = 1;			/* Worker 0 does everything */
+	job(lu, &lu->workers[0]);
+}
+
+static void
+StopPool(ES_SparseLU *lu)
+{
+	Uint i;
+
+	if (lu->workers == NULL) {
+		return;
+	}
+#ifdef AG_THREADS
+	if (lu->nThreads > 1) {
+		AG_MutexLock(&lu->lock);
+		lu->poolExit = 1;
+		AG_CondBroadcast(&lu->jobStart);
+		AG_MutexUnlock(&lu->lock);
+		for (i = 1; i < lu->nThreads; i++) {
+			AG_ThreadJoin(lu->workers[i].th, NULL);
+		}
+		lu->poolExit = 0;
+		lu->jobGen = 0;
+	}
+#endif
+	for (i = 0; i < lu->nThreads; i++) {
+		Free(lu->workers[i].x);
+		Free(lu->workers[i].y);
+	}
+	Free(lu->workers);
+	lu->workers = NULL;
+}
+
+static void
+StartPool(ES_SparseLU *lu)
+{
+	Uint i;
+
+	lu->workers = Malloc(lu->nThreads*sizeof(ES_SparseLUWorker));
+	for (i = 0; i < lu->nThreads; i++) {
+		ES_SparseLUWorker *wk = &lu->workers[i];
+
+		wk->lu = lu;
+		wk->idx = i;
+		wk->x = Malloc((lu->n+1)*sizeof(M_Real));
+		wk->y = Malloc((lu->n+1)*sizeof(M_Real));
+		wk->failed = 0;
+		wk->pivot = 0;
+	}
+#ifdef AG_THREADS
+	for (i = 1; i < lu->nThreads; i++)
+		AG_ThreadCreate(&lu->workers[i].th, PoolWorker, &lu->workers[i]);
+#endif
+}
+
+void
+ES_SparseLUDestroy(ES_SparseLU *lu)
+{
+	StopPool(lu);
+	FreeAnalysis(lu);
+#ifdef AG_THREADS
+	AG_CondDestroy(&lu->jobStart);
+	AG_CondDestroy(&lu->jobDone);
+	AG_MutexDestroy(&lu->lock);
+#endif
+}
+
+/*
+ * Find a row permutation giving a zero-free diagonal (maximum transversal
+ * by depth-first augmenting paths), preferring the diagonal itself.
+ * cp/ci is the pattern of A by columns. Sets rowOf[j] to the row of A
+ * placed on the diagonal of column j.
+ */
+static int
+Transversal(Uint n, const Uint *cp, const Uint *ci, Uint *rowOf)
+{
+	int *colOfRow, *visited;
+	Uint *stk, *pos, *rowAt;
+	Uint8 *matched;
+	Uint c, p, r;
+	int top, t, rv = 0;
+
+	colOfRow = Malloc((n+1)*sizeof(int));
+	matched = Malloc(n+1);
+	visited = Malloc((n+1)*sizeof(int));
+	stk = Malloc((n+1)*sizeof(Uint));
+	pos = Malloc((n+1)*sizeof(Uint));
+	rowAt = Malloc((n+1)*sizeof(Uint));
+	for (r = 0; r < n; r++) {
+		colOfRow[r] = -1;
+		visited[r] = -1;
+		matched[r] = 0;
+	}
+	for (c = 0; c < n; c++) {			/* Diagonal first */
+		for (p = cp[c]; p < cp[c+1]; p++) {
+			if (ci[p] == c) {
+				colOfRow[c] = (int)c;
+				matched[c] = 1;
+				break;
+			}
+		}
+	}
+	for (c = 0; c < n; c++) {
+		if (matched[c]) {
+			continue;
+		}
+		/* Augmenting path from column c. */
+		top = 0;
+		stk[0] = c;
+		pos[0] = cp[c];
+		visited[c] = (int)c;
+		while (top >= 0) {
+			Uint cc = stk[top];
+
+			for (p = cp[cc]; p < cp[cc+1]; p++) {	/* Free row */
+				if (colOfRow[ci[p]] == -1)
+					break;
+			}
+			if (p < cp[cc+1]) {
+				rowAt[top] = ci[p];
+				for (t = 0; t <= top; t++) {
+					colOfRow[rowAt[t]] = (int)stk[t];
+				}
+				matched[c] = 1;
+				break;
+			}
+			for (p = pos[top]; p < cp[cc+1]; p++) {
+				Uint c2 = (Uint)colOfRow[ci[p]];
+
+				if (visited[c2] != (int)c)
+					break;
+			}
+			if (p == cp[cc+1]) {
+				top--;				/* Dead end */
+				continue;
+			}
+			pos[top] = p+1;
+			rowAt[top] = ci[p];
+			top++;
+			stk[top] = (Uint)colOfRow[ci[p]];
+			pos[top] = cp[stk[top]];
+			visited[stk[top]] = (int)c;
+		}
+		if (top < 0) {
+			AG_SetError(_("Structurally singular matrix "
+			              "(column %u)"), c);
+			rv = -1;
+			goto out;
+		}
+	}
+	for (r = 0; r < n; r++)
+		rowOf[colOfRow[r]] = r;
+out:
+	free(colOfRow);
+	free(matched);
+	free(visited);
+	free(stk);
+	free(pos);
+	free(rowAt);
+	return (rv);
+}
+
+/* Binary heap of (degree, node), for the minimum degree ordering. */
+typedef struct md_heap {
+	Uint *deg, *node;
+	Uint n, maxEnts;
+} MD_Heap;
+
+static __inline__ int
+HeapLess(const MD_Heap *h, Uint a, Uint b)
+{
+	return (h->deg[a] < h->deg[b] ||
+	        (h->deg[a] == h->deg[b] && h->node[a] < h->node[b]));
+}
+
+static void
+HeapSwap(MD_Heap *h, Uint a, Uint b)
+{
+	Uint t;
+
+	t = h->deg[a]; h->deg[a] = h->deg[b]; h->deg[b] = t;
+	t = h->node[a]; h->node[a] = h->node[b]; h->node[b] = t;
+}
+
+static void
+HeapPush(MD_Heap *h, Uint deg, Uint node)
+{
+	Uint i, up;
+
+	if (h->n+1 > h->maxEnts) {
+		h->maxEnts *= 2;
+		h->deg = Realloc(h->deg, h->maxEnts*sizeof(Uint));
+		h->node = Realloc(h->node, h->maxEnts*sizeof(Uint));
+	}
+	i = h->n++;
+	h->deg[i] = deg;
+	h->node[i] = node;
+	while (i > 0 && HeapLess(h, i, (up = (i-1)/2))) {
+		HeapSwap(h, i, up);
+		i = up;
+	}
+}
+
+static void
+HeapPop(MD_Heap *h, Uint *deg, Uint *node)
+{
+	Uint i = 0, c;
+
+	*deg = h->deg[0];
+	*node = h->node[0];
+	h->n--;
+	h->deg[0] = h->deg[h->n];
+	h->node[0] = h->node[h->n];
+	while ((c = 2*i+1) < h->n) {
+		if (c+1 < h->n && HeapLess(h, c+1, c)) {
+			c++;
+		}
+		if (!HeapLess(h, c, i)) {
+			break;
+		}
+		HeapSwap(h, i, c);
+		i = c;
+	}
+}
+
+/*
+ * Order the nodes of a symmetric graph by minimum degree (on the explicit
+ * elimination graph; ties broken by node number). order[k] is the k-th
+ * node eliminated.
+ */
+static void
+MinimumDegree(Uint n, Uint **adj, Uint *nAdj, Uint *order)
+{
+	MD_Heap h;
+	Uint *mark, *nbrs, *maxAdj;
+	Uint k, v, u, deg, i, j, nNbrs, len;
+	Uint8 *done;
+
+	mark = Malloc((n+1)*sizeof(Uint));
+	nbrs = Malloc((n+1)*sizeof(Uint));
+	maxAdj = Malloc((n+1)*sizeof(Uint));
+	done = Malloc(n+1);
+	h.maxEnts = n*2 + 16;
+	h.deg = Malloc(h.maxEnts*sizeof(Uint));
+	h.node = Malloc(h.maxEnts*sizeof(Uint));
+	h.n = 0;
+	for (v = 0; v < n; v++) {
+		mark[v] = (Uint)-1;
+		maxAdj[v] = nAdj[v];
+		done[v] = 0;
+		HeapPush(&h, nAdj[v], v);
+	}
+	for (k = 0; k < n; ) {
+		HeapPop(&h, &deg, &v);
+		if (done[v] || deg != nAdj[v]) {
+			continue;			/* Stale entry */
+		}
+		done[v] = 1;
+		order[k++] = v;
+
+		/* Remaining neighbors of v form a clique. */
+		for (i = 0, nNbrs = 0; i < nAdj[v]; i++) {
+			if (!done[adj[v][i]])
+				nbrs[nNbrs++] = adj[v][i];
+		}
+		for (i = 0; i < nNbrs; i++) {
+			mark[nbrs[i]] = v;
+		}
+		for (i = 0; i < nNbrs; i++) {
+			u = nbrs[i];
+			for (j = 0, len = 0; j < nAdj[u]; j++) {
+				Uint t = adj[u][j];
+
+				if (!done[t] && mark[t] != v)
+					adj[u][len++] = t;
+			}
+			if (len + nNbrs-1 > maxAdj[u]) {
+				maxAdj[u] = len + nNbrs-1;
+				adj[u] = Realloc(adj[u], maxAdj[u]*sizeof(Uint));
+			}
+			for (j = 0; j < nNbrs; j++) {
+				if (nbrs[j] != u)
+					adj[u][len++] = nbrs[j];
+			}
+			nAdj[u] = len;
+			HeapPush(&h, len, u);		/* Old entry is stale */
+		}
+		nAdj[v] = 0;
+	}
+	free(h.deg);
+	free(h.node);
+	free(mark);
+	free(nbrs);
+	free(maxAdj);
+	free(done);
+}
+
+/*
+ * Distribute the factorization over the workers: the elimination tree is
+ * split into subtrees until no subtree holds more than a fraction of the
+ * work, the subtrees are assigned (heaviest first) to the least loaded
+ * worker, and the columns above them are grouped by level.
+ */
+static void
+Schedule(ES_SparseLU *lu)
+{
+	Uint n = lu->n, nThreads = lu->nThreads;
+	Uint *head, *next, *post, *size, *stk, *cands, *owner, *cnt;
+	double *work, *load, total = 0.0, target;
+	Uint8 *isTop;
+	Uint i, j, k, r, t, nCands, nPost, top, w;
+
+	FreeSchedule(lu);
+	head = Malloc((n+1)*sizeof(Uint));
+	next = Malloc((n+1)*sizeof(Uint));
+	post = Malloc((n+1)*sizeof(Uint));
+	size = Malloc((n+1)*sizeof(Uint));
+	stk = Malloc((n+1)*sizeof(Uint));
+	cands = Malloc((n+1)*sizeof(Uint));
+	owner = Malloc((n+1)*sizeof(Uint));
+	work = Malloc((n+1)*sizeof(double));
+	load = Malloc((nThreads+1)*sizeof(double));
+	isTop = Malloc(n+1);
+
+	/* Operation counts, accumulated over the subtrees. */
+	for (j = 0; j < n; j++) {
+		work[j] = 1.0;
+		for (r = lu->rp[j]; r < lu->rp[j+1]; r++) {
+			work[j] += (double)(lu->lp[lu->rk[r]+1] - lu->rq[r]);
+		}
+		total += work[j];
+		head[j] = (Uint)-1;
+		size[j] = 1;
+		isTop[j] = 0;
+	}
+	for (j = 0; j < n; j++) {
+		if (lu->parent[j] != -1) {
+			work[lu->parent[j]] += work[j];
+			size[lu->parent[j]] += size[j];
+		}
+	}
+	for (j = n; j-- > 0; ) {			/* Ascending children */
+		if (lu->parent[j] != -1) {
+			next[j] = head[lu->parent[j]];
+			head[lu->parent[j]] = j;
+		}
+	}
+
+	/* Postorder (children before parents, in ascending order). */
+	for (j = 0, nPost = 0; j < n; j++) {
+		if (lu->parent[j] != -1) {
+			continue;
+		}
+		top = 0;
+		stk[0] = j;
+		for (;;) {
+			Uint v = stk[top];
+
+			if (head[v] != (Uint)-1) {	/* Descend */
+				Uint c = head[v];
+
+				head[v] = next[c];
+				stk[++top] = c;
+				continue;
+			}
+			post[nPost++] = v;
+			if (top-- == 0)
+				break;
+		}
+	}
+	for (j = n; j-- > 0; ) {			/* Restore child lists */
+		head[j] = (Uint)-1;
+	}
+	for (j = n; j-- > 0; ) {
+		if (lu->parent[j] != -1) {
+			next[j] = head[lu->parent[j]];
+			head[lu->parent[j]] = j;
+		}
+	}
+	for (k = 0; k < n; k++)
+		stk[post[k]] = k;			/* Postorder index */
+
+	/* Split the heaviest subtrees. */
+	for (j = 0, nCands = 0; j < n; j++) {
+		if (lu->parent[j] == -1)
+			cands[nCands++] = j;
+	}
+	target = total/(nThreads*ES_SPARSE_LU_SUBTREES);
+	while (nThreads > 1) {
+		Uint iMax = 0;
+
+		for (i = 1; i < nCands; i++) {
+			if (work[cands[i]] > work[cands[iMax]])
+				iMax = i;
+		}
+		j = cands[iMax];
+		if (work[j] <= target || head[j] == (Uint)-1) {
+			break;
+		}
+		isTop[j] = 1;
+		cands[iMax] = cands[--nCands];
+		for (k = head[j]; k != (Uint)-1; k = next[k])
+			cands[nCands++] = k;
+	}
+
+	/* Heaviest subtree first, to the least loaded worker. */
+	for (i = 1; i < nCands; i++) {
+		for (k = i; k > 0; k--) {
+			Uint a = cands[k-1], b = cands[k];
+
+			if (work[a] > work[b] || (work[a] == work[b] && a < b))
+				break;
+			cands[k-1] = b;
+			cands[k] = a;
+		}
+	}
+	for (w = 0; w < nThreads; w++) {
+		load[w] = 0.0;
+	}
+	for (i = 0; i < nCands; i++) {
+		for (t = 0, w = 1; w < nThreads; w++) {
+			if (load[w] < load[t])
+				t = w;
+		}
+		owner[i] = t;
+		load[t] += work[cands[i]];
+	}
+	lu->subNodes = Malloc((n+1)*sizeof(Uint));
+	lu->subPtr = Malloc((nThreads+1)*sizeof(Uint));
+	for (w = 0, k = 0; w < nThreads; w++) {
+		lu->subPtr[w] = k;
+		for (i = 0; i < nCands; i++) {
+			Uint end;
+
+			if (owner[i] != w) {
+				continue;
+			}
+			end = stk[cands[i]];
+			for (t = end+1 - size[cands[i]]; t <= end; t++)
+				lu->subNodes[k++] = post[t];
+		}
+	}
+	lu->subPtr[nThreads] = k;
+
+	/* Columns above the subtrees, by level. */
+	cnt = Malloc((n+2)*sizeof(Uint));
+	memset(cnt, 0, (n+2)*sizeof(Uint));
+	for (j = 0; j < n; j++) {
+		if (isTop[j])
+			cnt[lu->height[j]+1]++;
+	}
+	lu->topPtr = Malloc((n+2)*sizeof(Uint));
+	lu->topNodes = Malloc((n+1)*sizeof(Uint));
+	lu->nTopLevels = 0;
+	lu->topPtr[0] = 0;
+	for (i = 1; i <= n; i++) {
+		if (cnt[i] > 0) {
+			lu->topPtr[lu->nTopLevels+1] =
+			    lu->topPtr[lu->nTopLevels] + cnt[i];
+			lu->nTopLevels++;
+		}
+		cnt[i] = lu->topPtr[lu->nTopLevels] - cnt[i];
+	}
+	for (j = 0; j < n; j++) {
+		if (isTop[j])
+			lu->topNodes[cnt[lu->height[j]+1]++] = j;
+	}
+
+	free(cnt);
+	free(head);
+	free(next);
+	free(post);
+	free(size);
+	free(stk);
+	free(cands);
+	free(owner);
+	free(work);
+	free(load);
+	free(isTop);
+}
+
+/*
+ * Analyze the pattern of A (the given entries, in any order and possibly
+ * repeated) and keep pointers to its entries for the numeric
+ * factorizations. Fails if the pattern is structurally singular.
+ */
+int
+ES_SparseLUAnalyze(ES_SparseLU *lu, M_Matrix *A, Uint n,
+    const ES_MatrixEntry *ents, Uint nEnts)
+{
+	ES_MatrixEntry *e;
+	Uint *cp, *ci, *rowOf0, *bRow, *cOfB, *order, *nAdj, **adj;
+	Uint *lo, *loPtr, *ancestor, *mark, *cnt;
+	Uint i, j, k, p, nE, a, b;
+
+	StopPool(lu);
+	FreeAnalysis(lu);
+	if (n == 0) {
+		AG_SetError("Empty system");
+		return (-1);
+	}
+	lu->n = n;
+
+	/* Pattern of A by columns. */
+	e = Malloc((nEnts+1)*sizeof(ES_MatrixEntry));
+	for (i = 0, nE = 0; i < nEnts; i++) {
+		if (ents[i].row < n && ents[i].col < n)
+			e[nE++] = ents[i];
+	}
+	qsort(e, nE, sizeof(ES_MatrixEntry), CompareEntries);
+	for (i = 1, k = (nE > 0); i < nE; i++) {
+		if (e[i].row != e[k-1].row || e[i].col != e[k-1].col)
+			e[k++] = e[i];
+	}
+	nE = k;
+	cp = Malloc((n+1)*sizeof(Uint));
+	ci = Malloc(nE*sizeof(Uint));
+	memset(cp, 0, (n+1)*sizeof(Uint));
+	for (i = 0; i < nE; i++) {
+		cp[e[i].col+1]++;
+		ci[i] = e[i].row;
+	}
+	for (j = 0; j < n; j++)
+		cp[j+1] += cp[j];
+
+	/* Zero-free diagonal: B(j,c) = A(rowOf0[j],c). */
+	rowOf0 = Malloc(n*sizeof(Uint));
+	if (Transversal(n, cp, ci, rowOf0) == -1) {
+		free(e);
+		free(cp);
+		free(ci);
+		free(rowOf0);
+		FreeAnalysis(lu);
+		return (-1);
+	}
+	bRow = Malloc(n*sizeof(Uint));
+	for (j = 0; j < n; j++)
+		bRow[rowOf0[j]] = j;
+
+	/* Minimum degree ordering of the symmetrized pattern of B. */
+	nAdj = Malloc(n*sizeof(Uint));
+	adj = Malloc(n*sizeof(Uint *));
+	mark = Malloc(n*sizeof(Uint));
+	memset(nAdj, 0, n*sizeof(Uint));
+	for (i = 0; i < nE; i++) {
+		a = bRow[e[i].row];
+		b = e[i].col;
+		if (a != b) {
+			nAdj[a]++;
+			nAdj[b]++;
+		}
+	}
+	for (j = 0; j < n; j++) {
+		adj[j] = (nAdj[j] > 0) ? Malloc(nAdj[j]*sizeof(Uint)) : NULL;
+		nAdj[j] = 0;
+		mark[j] = (Uint)-1;
+	}
+	for (i = 0; i < nE; i++) {
+		a = bRow[e[i].row];
+		b = e[i].col;
+		if (a != b) {
+			adj[a][nAdj[a]++] = b;
+			adj[b][nAdj[b]++] = a;
+		}
+	}
+	for (j = 0; j < n; j++) {			/* Remove duplicates */
+		for (i = 0, k = 0; i < nAdj[j]; i++) {
+			if (mark[adj[j][i]] != j) {
+				mark[adj[j][i]] = j;
+				adj[j][k++] = adj[j][i];
+			}
+		}
+		nAdj[j] = k;
+	}
+	order = Malloc(n*sizeof(Uint));
+	MinimumDegree(n, adj, nAdj, order);
+	for (j = 0; j < n; j++) {
+		Free(adj[j]);
+	}
+	free(adj);
+	free(nAdj);
+
+	lu->rowOf = Malloc(n*sizeof(Uint));
+	lu->colOf = Malloc(n*sizeof(Uint));
+	cOfB = Malloc(n*sizeof(Uint));
+	for (a = 0; a < n; a++) {
+		lu->colOf[a] = order[a];
+		lu->rowOf[a] = rowOf0[order[a]];
+		cOfB[order[a]] = a;
+	}
+
+	/* Neighbors i < j of every j in the symmetrized pattern of C. */
+	loPtr = Malloc((n+1)*sizeof(Uint));
+	lo = Malloc(nE*sizeof(Uint));
+	memset(loPtr, 0, (n+1)*sizeof(Uint));
+	for (i = 0; i < nE; i++) {
+		a = cOfB[bRow[e[i].row]];
+		b = cOfB[e[i].col];
+		if (a != b)
+			loPtr[MAX(a,b)+1]++;
+	}
+	for (j = 0; j < n; j++) {
+		loPtr[j+1] += loPtr[j];
+	}
+	cnt = Malloc((n+1)*sizeof(Uint));
+	memcpy(cnt, loPtr, (n+1)*sizeof(Uint));
+	for (i = 0; i < nE; i++) {
+		a = cOfB[bRow[e[i].row]];
+		b = cOfB[e[i].col];
+		if (a != b)
+			lo[cnt[MAX(a,b)]++] = MIN(a,b);
+	}
+
+	/* Elimination tree (with path compression). */
+	lu->parent = Malloc(n*sizeof(int));
+	ancestor = Malloc(n*sizeof(Uint));
+	for (j = 0; j < n; j++) {
+		lu->parent[j] = -1;
+		ancestor[j] = (Uint)-1;
+		for (p = loPtr[j]; p < loPtr[j+1]; p++) {
+			for (i = lo[p]; i != (Uint)-1 && i < j; i = k) {
+				k = ancestor[i];		/* Next */
+				ancestor[i] = j;
+				if (k == (Uint)-1)
+					lu->parent[i] = (int)j;
+			}
+		}
+	}
+
+	/*
+	 * Structure of L: row j holds the columns reached by climbing the
+	 * tree from the neighbors i < j. Columns are filled by ascending row.
+	 */
+	lu->lp = Malloc((n+1)*sizeof(Uint));
+	memset(lu->lp, 0, (n+1)*sizeof(Uint));
+	for (j = 0; j < n; j++) {
+		mark[j] = (Uint)-1;
+	}
+	for (j = 0; j < n; j++) {
+		mark[j] = j;
+		for (p = loPtr[j]; p < loPtr[j+1]; p++) {
+			for (i = lo[p]; mark[i] != j; i = (Uint)lu->parent[i]) {
+				mark[i] = j;
+				lu->lp[i+1]++;
+			}
+		}
+	}
+	for (j = 0; j < n; j++) {
+		lu->lp[j+1] += lu->lp[j];
+	}
+	lu->nnz = lu->lp[n];
+	lu->li = Malloc((lu->nnz+1)*sizeof(Uint));
+	memcpy(cnt, lu->lp, (n+1)*sizeof(Uint));
+	for (j = 0; j < n; j++) {
+		mark[j] = (Uint)-1;
+	}
+	for (j = 0; j < n; j++) {
+		mark[j] = j;
+		for (p = loPtr[j]; p < loPtr[j+1]; p++) {
+			for (i = lo[p]; mark[i] != j; i = (Uint)lu->parent[i]) {
+				mark[i] = j;
+				lu->li[cnt[i]++] = j;
+			}
+		}
+	}
+
+	/* Rows of L, by ascending column. */
+	lu->rp = Malloc((n+1)*sizeof(Uint));
+	lu->rk = Malloc((lu->nnz+1)*sizeof(Uint));
+	lu->rq = Malloc((lu->nnz+1)*sizeof(Uint));
+	memset(lu->rp, 0, (n+1)*sizeof(Uint));
+	for (p = 0; p < lu->nnz; p++) {
+		lu->rp[lu->li[p]+1]++;
+	}
+	for (j = 0; j < n; j++) {
+		lu->rp[j+1] += lu->rp[j];
+	}
+	memcpy(cnt, lu->rp, (n+1)*sizeof(Uint));
+	for (k = 0; k < n; k++) {
+		for (p = lu->lp[k]; p < lu->lp[k+1]; p++) {
+			j = lu->li[p];
+			lu->rk[cnt[j]] = k;
+			lu->rq[cnt[j]] = p;
+			cnt[j]++;
+		}
+	}
+
+	/* Entries of A, by the step which consumes them. */
+	lu->ap = Malloc((n+1)*sizeof(Uint));
+	lu->ai = Malloc(nE*sizeof(Uint));
+	lu->av = Malloc(nE*sizeof(M_Real *));
+	memset(lu->ap, 0, (n+1)*sizeof(Uint));
+	for (i = 0; i < nE; i++) {
+		a = cOfB[bRow[e[i].row]];
+		b = cOfB[e[i].col];
+		lu->ap[MIN(a,b)+1]++;
+	}
+	for (j = 0; j < n; j++) {
+		lu->ap[j+1] += lu->ap[j];
+	}
+	memcpy(cnt, lu->ap, (n+1)*sizeof(Uint));
+	for (i = 0; i < nE; i++) {
+		a = cOfB[bRow[e[i].row]];
+		b = cOfB[e[i].col];
+		k = cnt[MIN(a,b)]++;
+		lu->ai[k] = (a >= b) ? a : n+b;
+		lu->av[k] = M_GetElement(A, e[i].row, e[i].col);
+	}
+
+	/* Levels of the elimination tree. */
+	lu->height = Malloc(n*sizeof(Uint));
+	memset(lu->height, 0, n*sizeof(Uint));
+	for (j = 0; j < n; j++) {
+		if (lu->parent[j] != -1 &&
+		    lu->height[lu->parent[j]] < lu->height[j]+1)
+			lu->height[lu->parent[j]] = lu->height[j]+1;
+	}
+	lu->lvPtr = Malloc((n+2)*sizeof(Uint));
+	lu->lvNodes = Malloc(n*sizeof(Uint));
+	memset(lu->lvPtr, 0, (n+2)*sizeof(Uint));
+	for (j = 0, lu->nLevels = 0; j < n; j++) {
+		lu->lvPtr[lu->height[j]+1]++;
+		if (lu->height[j]+1 > lu->nLevels)
+			lu->nLevels = lu->height[j]+1;
+	}
+	for (i = 0; i < lu->nLevels; i++) {
+		lu->lvPtr[i+1] += lu->lvPtr[i];
+	}
+	memcpy(cnt, lu->lvPtr, (lu->nLevels+1)*sizeof(Uint));
+	for (j = 0; j < n; j++)
+		lu->lvNodes[cnt[lu->height[j]]++] = j;
+
+	lu->lx = Malloc((lu->nnz+1)*sizeof(M_Real));
+	lu->ux = Malloc((lu->nnz+1)*sizeof(M_Real));
+	lu->d = Malloc(n*sizeof(M_Real));
+	lu->w = Malloc(n*sizeof(M_Real));
+
+	free(e);
+	free(cp);
+	free(ci);
+	free(rowOf0);
+	free(bRow);
+	free(cOfB);
+	free(order);
+	free(mark);
+	free(lo);
+	free(loPtr);
+	free(cnt);
+	free(ancestor);
+
+	Schedule(lu);
+	StartPool(lu);
+	return (0);
+}
+
+/* Resize the thread pool (effective immediately). */
+void
+ES_SparseLUSetThreads(ES_SparseLU *lu, Uint nThreads)
+{
+#ifdef AG_THREADS
+	if (nThreads < 1) { nThreads = 1; }
+	if (nThreads > ES_SPARSE_LU_THREADS_MAX) {
+		nThreads = ES_SPARSE_LU_THREADS_MAX;
+	}
+#else
+	nThreads = 1;
+#endif
+	if (nThreads == lu->nThreads) {
+		return;
+	}
+	StopPool(lu);
+	lu->nThreads = nThreads;
+	if (lu->n > 0) {
+		Schedule(lu);
+		StartPool(lu);
+	}
+}
+
+/*
+ * Compute column j of L and row j of U from A and the columns k < j of
+ * L(j,:) (Crout), using the worker's dense work vectors.
+ */
+static int
+FactorColumn(ES_SparseLU *lu, Uint j, M_Real *x, M_Real *y)
+{
+	const Uint *li = lu->li;
+	M_Real *lx = lu->lx, *ux = lu->ux;
+	M_Real lj, uj, ujj, xMax;
+	Uint n = lu->n, e, p, q, r, k, i;
+
+	x[j] = 0.0;
+	for (p = lu->lp[j]; p < lu->lp[j+1]; p++) {
+		x[li[p]] = 0.0;
+		y[li[p]] = 0.0;
+	}
+	for (e = lu->ap[j]; e < lu->ap[j+1]; e++) {
+		i = lu->ai[e];
+		if (i < n) {
+			x[i] += *lu->av[e];
+		} else {
+			y[i-n] += *lu->av[e];
+		}
+	}
+	for (r = lu->rp[j]; r < lu->rp[j+1]; r++) {
+		k = lu->rk[r];
+		p = lu->rq[r];				/* li[p] == j */
+		lj = lx[p];				/* L(j,k) */
+		uj = ux[p];				/* U(k,j) */
+		x[j] -= lj*uj;
+		for (q = p+1; q < lu->lp[k+1]; q++) {
+			i = li[q];
+			x[i] -= lx[q]*uj;
+			y[i] -= lj*ux[q];
+		}
+	}
+	ujj = x[j];
+	xMax = Fabs(ujj);
+	for (p = lu->lp[j]; p < lu->lp[j+1]; p++) {
+		if (Fabs(x[li[p]]) > xMax)
+			xMax = Fabs(x[li[p]]);
+	}
+	if (xMax == 0.0 || Fabs(ujj) <= ES_SPARSE_LU_PIVOT_TOL*xMax) {
+		return (-1);
+	}
+	lu->d[j] = ujj;
+	for (p = lu->lp[j]; p < lu->lp[j+1]; p++) {
+		i = li[p];
+		lx[p] = x[i]/ujj;
+		ux[p] = y[i];
+	}
+	return (0);
+}
+
+static __inline__ void
+FactorNode(ES_SparseLU *lu, ES_SparseLUWorker *wk, Uint j)
+{
+	if (FactorColumn(lu, j, wk->x, wk->y) == -1 &&
+	    (!wk->failed || j < wk->pivot)) {
+		wk->failed = 1;
+		wk->pivot = j;
+	}
+}
+
+/* Factor the subtrees assigned to the worker. */
+static void
+FactorSubtrees(ES_SparseLU *lu, ES_SparseLUWorker *wk)
+{
+	Uint s, i;
+
+	for (s = wk->idx; s < lu->nThreads; s += lu->jobThreads) {
+		for (i = lu->subPtr[s]; i < lu->subPtr[s+1]; i++)
+			FactorNode(lu, wk, lu->subNodes[i]);
+	}
+}
+
+/* Factor the worker's share of topNodes[jobLo..jobHi). */
+static void
+FactorLevel(ES_SparseLU *lu, ES_SparseLUWorker *wk)
+{
+	Uint cnt = lu->jobHi - lu->jobLo, N = lu->jobThreads, i;
+
+	for (i = lu->jobLo + cnt*wk->idx/N;
+	     i < lu->jobLo + cnt*(wk->idx+1)/N;
+	     i++)
+		FactorNode(lu, wk, lu->topNodes[i]);
+}
+
+int
+ES_SparseLUFactor(ES_SparseLU *lu)
+{
+	Uint l, w, lo, hi, pivot = 0;
+	int failed = 0;
+
+	for (w = 0; w < lu->nThreads; w++) {
+		lu->workers[w].failed = 0;
+	}
+	if (lu->nThreads == 1) {
+		Uint j;
+
+		for (j = 0; j < lu->n; j++)
+			FactorNode(lu, &lu->workers[0], j);
+	} else {
+		RunJob(lu, FactorSubtrees, 0, 0, 1);
+		for (l = 0; l < lu->nTopLevels; l++) {
+			lo = lu->topPtr[l];
+			hi = lu->topPtr[l+1];
+			RunJob(lu, FactorLevel, lo, hi, (hi-lo > 1));
+		}
+	}
+	for (w = 0; w < lu->nThreads; w++) {
+		ES_SparseLUWorker *wk = &lu->workers[w];
+
+		if (wk->failed && (!failed || wk->pivot < pivot)) {
+			failed = 1;
+			pivot = wk->pivot;
+		}
+	}
+	if (failed) {
+		AG_SetError(_("Small pivot in column %u"), pivot);
+		return (-1);
+	}
+	return (0);
+}
+
+static __inline__ void
+ForwardNode(ES_SparseLU *lu, Uint j)
+{
+	M_Real *w = lu->w, s = w[j];
+	Uint r;
+
+	for (r = lu->rp[j]; r < lu->rp[j+1]; r++) {
+		s -= lu->lx[lu->rq[r]]*w[lu->rk[r]];
+	}
+	w[j] = s;
+}
+
+static __inline__ void
+BackwardNode(ES_SparseLU *lu, Uint j)
+{
+	M_Real *w = lu->w, s = w[j];
+	Uint p;
+
+	for (p = lu->lp[j]; p < lu->lp[j+1]; p++) {
+		s -= lu->ux[p]*w[lu->li[p]];
+	}
+	w[j] = s/lu->d[j];
+}
+
+static void
+ForwardLevel(ES_SparseLU *lu, ES_SparseLUWorker *wk)
+{
+	Uint cnt = lu->jobHi - lu->jobLo, N = lu->jobThreads, i;
+
+	for (i = lu->jobLo + cnt*wk->idx/N;
+	     i < lu->jobLo + cnt*(wk->idx+1)/N;
+	     i++)
+		ForwardNode(lu, lu->lvNodes[i]);
+}
+
+static void
+BackwardLevel(ES_SparseLU *lu, ES_SparseLUWorker *wk)
+{
+	Uint cnt = lu->jobHi - lu->jobLo, N = lu->jobThreads, i;
+
+	for (i = lu->jobLo + cnt*wk->idx/N;
+	     i < lu->jobLo + cnt*(wk->idx+1)/N;
+	     i++)
+		BackwardNode(lu, lu->lvNodes[i]);
+}
+
+/*
+ * Solve Ax = v in place. Forward substitution proceeds up the elimination
+ * tree and back substitution down, one level at a time.
+ */
+void
+ES_SparseLUSolve(ES_SparseLU *lu, M_Vector *v)
+{
+	Uint n = lu->n, j, l, lo, hi;
+
+	for (j = 0; j < n; j++) {
+		lu->w[j] = M_VecGet(v, lu->rowOf[j]);
+	}
+	if (lu->nThreads == 1) {
+		for (j = 0; j < n; j++) {
+			ForwardNode(lu, j);
+		}
+		for (j = n; j-- > 0; )
+			BackwardNode(lu, j);
+	} else {
+		for (l = 0; l < lu->nLevels; l++) {
+			lo = lu->lvPtr[l];
+			hi = lu->lvPtr[l+1];
+			RunJob(lu, ForwardLevel, lo, hi,
+			    (hi-lo >= ES_SPARSE_LU_LEVEL_MIN));
+		}
+		for (l = lu->nLevels; l-- > 0; ) {
+			lo = lu->lvPtr[l];
+			hi = lu->lvPtr[l+1];
+			RunJob(lu, BackwardLevel, lo, hi,
+			    (hi-lo >= ES_SPARSE_LU_LEVEL_MIN));
+		}
+	}
+	for (j = 0; j < n; j++)
+		*M_VecGetElement(v, lu->colOf[j]) = lu->w[j];
+}
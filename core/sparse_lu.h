@@ -0,0 +1,89 @@
+/*	Public domain	*/
+
+/*
+ * Sparse LU factorization for large MNA systems. The pattern of A (the
+ * entries written by the stamps) is analyzed once: rows are permuted for
+ * a zero-free diagonal (maximum transversal), the symmetrized pattern is
+ * ordered by minimum degree, and the elimination tree and the structure
+ * of the factors are computed. Numeric factorizations then only follow
+ * that structure, with the independent subtrees of the elimination tree
+ * and the columns of every level above them distributed over a pool of
+ * threads. The triangular solves are scheduled by levels of the tree.
+ * Every column is computed in the same order regardless of the number
+ * of threads, so the results do not depend on it.
+ */
+
+#define ES_SPARSE_LU_PIVOT_TOL	1e-13	/* Smallest relative pivot */
+#define ES_SPARSE_LU_SUBTREES	4	/* Subtrees per thread (balance) */
+#define ES_SPARSE_LU_LEVEL_MIN	32	/* Least columns solved in parallel */
+#define ES_SPARSE_LU_THREADS_MAX 64
+
+/* Position of an entry in the matrix. */
+typedef struct es_matrix_entry {
+	Uint row, col;
+} ES_MatrixEntry;
+
+struct es_sparse_lu;
+
+/* Thread of the pool (worker 0 is the calling thread). */
+typedef struct es_sparse_lu_worker {
+	struct es_sparse_lu *lu;
+	Uint idx;			/* Worker index */
+	M_Real *x, *y;			/* Column and row being factored */
+	int failed;			/* Small pivot encountered */
+	Uint pivot;			/* Column of the small pivot */
+#ifdef AG_THREADS
+	AG_Thread th;
+#endif
+} ES_SparseLUWorker;
+
+typedef struct es_sparse_lu {
+	Uint n;				/* Order of the system */
+	Uint nnz;			/* Entries in L and U (off-diagonal) */
+
+	/* Symbolic analysis (C = PAQ, C(a,b) = A(rowOf[a],colOf[b])) */
+	Uint *rowOf, *colOf;		/* Permutations */
+	int *parent;			/* Elimination tree of C */
+	Uint *height;			/* Height in the elimination tree */
+	Uint *lp, *li;			/* Rows of L(:,j), columns of U(j,:) */
+	Uint *rp, *rk, *rq;		/* Columns k of L(j,:), positions in li */
+	Uint *ap, *ai;			/* Entries of C(:,j) (i) and C(j,:)
+					   (n+i), in li order */
+	M_Real **av;			/* Values of these entries in A */
+
+	/* Schedule */
+	Uint *subNodes, *subPtr;	/* Subtree columns of every worker */
+	Uint *topNodes, *topPtr;	/* Remaining columns by level */
+	Uint nTopLevels;
+	Uint *lvNodes, *lvPtr;		/* All columns by level (solves) */
+	Uint nLevels;
+
+	/* Numeric factors */
+	M_Real *lx, *ux;		/* L (unit diagonal) and U */
+	M_Real *d;			/* Diagonal of U */
+	M_Real *w;			/* Work vector for solves */
+
+	/* Thread pool */
+	Uint nThreads;
+	ES_SparseLUWorker *workers;
+	void (*job)(struct es_sparse_lu *, ES_SparseLUWorker *);
+	Uint jobLo, jobHi;		/* Range of the current job */
+	Uint jobThreads;		/* Workers running the current job */
+#ifdef AG_THREADS
+	AG_Mutex lock;
+	AG_Cond jobStart, jobDone;
+	Uint jobGen;			/* Incremented for every job */
+	Uint jobBusy;			/* Workers still running the job */
+	int poolExit;
+#endif
+} ES_SparseLU;
+
+__BEGIN_DECLS
+void ES_SparseLUInit(ES_SparseLU *);
+void ES_SparseLUDestroy(ES_SparseLU *);
+int  ES_SparseLUAnalyze(ES_SparseLU *, M_Matrix *, Uint,
+                        const ES_MatrixEntry *, Uint);
+void ES_SparseLUSetThreads(ES_SparseLU *, Uint);
+int  ES_SparseLUFactor(ES_SparseLU *);
+void ES_SparseLUSolve(ES_SparseLU *, M_Vector *);
+__END_DECLS
@@ -0,0 +1,544 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Spatial index for hit-testing the nodes of a VG_View. Node extents are
+ * binned into a uniform grid, and nearest-node queries only evaluate the
+ * proximity functions of the nodes in the cells around the cursor.
+ *
+ * VG offers no notification when nodes are edited (by our tools, by the
+ * generic VG tools or from the edit areas), so edits are detected from
+ * the input events of the view. While a button is held, motion events
+ * only flag the nodes being dragged (the selected nodes, their children
+ * and the nodes referencing them), which are binned again on the next
+ * query. Button and key events and the return of the focus to the view
+ * advance the edit generation of its VG, and indexes (and cached block
+ * extents) from an older generation are rebuilt on their next use. Code
+ * which modifies a VG outside of these events should call
+ * ES_SpatialInvalidate().
+ */
+
+#include "core.h"
+
+#include <string.h>
+#include <math.h>
+#include <agar/core/limits.h>
+
+/*
+ * Invalidate the indexes and cached extents of a VG following an edit.
+ * The generation is kept in a pointer variable so that it is not saved
+ * along with the VG.
+ */
+void
+ES_SpatialInvalidate(VG *vg)
+{
+	AG_SetPointer(vg, "es-spatial-gen",
+	    (void *)(size_t)(ES_SpatialGeneration(vg) + 1));
+}
+
+/* Return the edit generation of a VG, for validating cached geometry. */
+Uint
+ES_SpatialGeneration(VG *vg)
+{
+	if (!AG_Defined(vg, "es-spatial-gen")) {
+		return (1);
+	}
+	return ((Uint)(size_t)AG_GetPointer(vg, "es-spatial-gen"));
+}
+
+static void
+OnEdit(AG_Event *event)
+{
+	VG_View *vv = AG_SELF();
+
+	if (vv->vg != NULL)
+		ES_SpatialInvalidate(vv->vg);
+}
+
+static void
+OnButtonDown(AG_Event *event)
+{
+	VG_View *vv = AG_SELF();
+	ES_SpatialIndex *si;
+
+	/* The tool may have attached or detached nodes. */
+	AG_SetInt(vv, "es-spatial-drag", 1);
+	if (vv->vg != NULL) {
+		ES_SpatialInvalidate(vv->vg);
+	}
+	if (AG_Defined(vv, "es-spatial-index")) {
+		si = AG_GetPointer(vv, "es-spatial-index");
+		si->movingValid = 0;
+		si->moved = 0;
+	}
+}
+
+static void
+OnButtonUp(AG_Event *event)
+{
+	VG_View *vv = AG_SELF();
+
+	AG_SetInt(vv, "es-spatial-drag", 0);
+	if (vv->vg != NULL)
+		ES_SpatialInvalidate(vv->vg);
+}
+
+static void
+OnMotion(AG_Event *event)
+{
+	VG_View *vv = AG_SELF();
+	ES_SpatialIndex *si;
+
+	if (AG_GetInt(vv, "es-spatial-drag") &&
+	    AG_Defined(vv, "es-spatial-index")) {
+		si = AG_GetPointer(vv, "es-spatial-index");
+		si->moved = 1;
+	}
+}
+
+/* Return 1 if the given extent intersects the visible area of the view. */
+int
+ES_SpatialVisible(VG_View *vv, VG_Vector a, VG_Vector b)
+{
+	int x1, y1, x2, y2, t;
+
+	VG_GetViewCoords(vv, a, &x1, &y1);
+	VG_GetViewCoords(vv, b, &x2, &y2);
+	if (x1 > x2) { t = x1; x1 = x2; x2 = t; }
+	if (y1 > y2) { t = y1; y1 = y2; y2 = t; }
+	return (x2 >= 0 && y2 >= 0 &&
+	        x1 < AGWIDGET(vv)->w && y1 < AGWIDGET(vv)->h);
+}
+
+static void
+ClearIndex(ES_SpatialIndex *si)
+{
+	int i;
+
+	for (i = 0; i < si->w*si->h; i++) {
+		Free(si->cells[i].items);
+	}
+	Free(si->cells);
+	si->cells = NULL;
+	si->w = 0;
+	si->h = 0;
+	si->nItems = 0;
+	si->nUnbounded = 0;
+	si->nMoving = 0;
+	si->movingValid = 0;
+	si->moved = 0;
+}
+
+static __inline__ int
+CellX(const ES_SpatialIndex *si, float x)
+{
+	int i = (int)floorf((x - si->origin.x)/si->cellSize);
+
+	return (i < 0 ? 0 : i >= si->w ? si->w-1 : i);
+}
+
+static __inline__ int
+CellY(const ES_SpatialIndex *si, float y)
+{
+	int i = (int)floorf((y - si->origin.y)/si->cellSize);
+
+	return (i < 0 ? 0 : i >= si->h ? si->h-1 : i);
+}
+
+static void
+AddUnbounded(ES_SpatialIndex *si, Uint i)
+{
+	si->unbounded = Realloc(si->unbounded, (si->nUnbounded+1)*sizeof(Uint));
+	si->unbounded[si->nUnbounded++] = i;
+	si->items[i].unbounded = 1;
+}
+
+static void
+AddToCell(ES_SpatialCell *cell, Uint i)
+{
+	if (cell->n+1 > cell->maxItems) {
+		cell->maxItems = (cell->maxItems > 0) ? cell->maxItems*2 : 4;
+		cell->items = Realloc(cell->items, cell->maxItems*sizeof(Uint));
+	}
+	cell->items[cell->n++] = i;
+}
+
+static void
+RemoveFromCell(ES_SpatialCell *cell, Uint i)
+{
+	Uint k;
+
+	for (k = 0; k < cell->n; k++) {
+		if (cell->items[k] == i) {
+			cell->items[k] = cell->items[--cell->n];
+			return;
+		}
+	}
+}
+
+/* Compute the extent of an item from its node. */
+static void
+ItemExtent(ES_SpatialItem *it, VG_View *vv)
+{
+	VG_Vector a, b;
+
+	it->vn->ops->extent(it->vn, vv, &a, &b);
+	it->a.x = MIN(a.x, b.x);
+	it->a.y = MIN(a.y, b.y);
+	it->b.x = MAX(a.x, b.x);
+	it->b.y = MAX(a.y, b.y);
+}
+
+/* Add a bounded item to the cells overlapping its extent. */
+static void
+BinItem(ES_SpatialIndex *si, Uint i)
+{
+	ES_SpatialItem *it = &si->items[i];
+	int x, y;
+
+	it->x1 = CellX(si, it->a.x);
+	it->y1 = CellY(si, it->a.y);
+	it->x2 = CellX(si, it->b.x);
+	it->y2 = CellY(si, it->b.y);
+	if ((it->x2 - it->x1 + 1)*(it->y2 - it->y1 + 1) >
+	    ES_SPATIAL_MAX_CELLS) {
+		AddUnbounded(si, i);
+		return;
+	}
+	for (y = it->y1; y <= it->y2; y++) {
+		for (x = it->x1; x <= it->x2; x++)
+			AddToCell(&si->cells[y*si->w + x], i);
+	}
+}
+
+/* Compute the node extents and bin them into a new grid. */
+static void
+BuildIndex(ES_SpatialIndex *si, VG_View *vv)
+{
+	VG_Vector lo, hi;
+	ES_SpatialItem *it;
+	VG_Node *vn;
+	Uint i, seq = 0, nBounded = 0;
+	float cs, wGrid, hGrid;
+
+	ClearIndex(si);
+	lo.x = lo.y = AG_FLT_MAX;
+	hi.x = hi.y = -AG_FLT_MAX;
+
+	TAILQ_FOREACH(vn, &vv->vg->nodes, list) {
+		seq++;
+		if (vn->ops->pointProximity == NULL) {
+			continue;
+		}
+		if (si->nItems+1 > si->maxItems) {
+			si->maxItems = (si->maxItems > 0) ? si->maxItems*2 : 64;
+			si->items = Realloc(si->items,
+			    si->maxItems*sizeof(ES_SpatialItem));
+		}
+		it = &si->items[si->nItems];
+		it->vn = vn;
+		it->seq = seq;
+		it->mark = 0;
+		it->unbounded = 0;
+		if (vn->ops->extent == NULL) {
+			AddUnbounded(si, si->nItems++);
+			continue;
+		}
+		ItemExtent(it, vv);
+		lo.x = MIN(lo.x, it->a.x);
+		lo.y = MIN(lo.y, it->a.y);
+		hi.x = MAX(hi.x, it->b.x);
+		hi.y = MAX(hi.y, it->b.y);
+		si->nItems++;
+		nBounded++;
+	}
+	if (nBounded == 0)
+		goto unbounded;
+
+	/* Aim for about two items per cell. */
+	wGrid = MAX(hi.x - lo.x, 1e-3f);
+	hGrid = MAX(hi.y - lo.y, 1e-3f);
+	cs = sqrtf(wGrid*hGrid / (float)MAX(nBounded/2, 1));
+	while ((wGrid/cs + 1.0f)*(hGrid/cs + 1.0f) > (float)(4*nBounded + 16)) {
+		cs *= 2.0f;
+	}
+	si->origin = lo;
+	si->cellSize = cs;
+	si->w = (int)(wGrid/cs) + 1;
+	si->h = (int)(hGrid/cs) + 1;
+	si->cells = Malloc(si->w*si->h*sizeof(ES_SpatialCell));
+	memset(si->cells, 0, si->w*si->h*sizeof(ES_SpatialCell));
+
+	for (i = 0; i < si->nItems; i++) {
+		if (!si->items[i].unbounded)
+			BinItem(si, i);
+	}
+unbounded:
+	si->vg = vv->vg;
+	si->gen = ES_SpatialGeneration(vv->vg);
+	si->wPixel = vv->wPixel;
+}
+
+/* Return 1 if a node or one of its parents is selected. */
+static int
+NodeSelected(VG_Node *vn)
+{
+	for (; vn != NULL; vn = vn->parent) {
+		if (vn->flags & VG_NODE_SELECTED)
+			return (1);
+	}
+	return (0);
+}
+
+/*
+ * Find the items moved by a drag: the selected nodes, their children and
+ * the nodes referencing them (e.g., wires attached to a moved block).
+ */
+static void
+FindMoving(ES_SpatialIndex *si)
+{
+	ES_SpatialItem *it;
+	Uint i, k;
+
+	si->nMoving = 0;
+	for (i = 0; i < si->nItems; i++) {
+		it = &si->items[i];
+		if (it->unbounded) {
+			continue;
+		}
+		if (!NodeSelected(it->vn)) {
+			for (k = 0; k < it->vn->nRefs; k++) {
+				if (NodeSelected(it->vn->refs[k]))
+					break;
+			}
+			if (k == it->vn->nRefs)
+				continue;
+		}
+		si->moving = Realloc(si->moving, (si->nMoving+1)*sizeof(Uint));
+		si->moving[si->nMoving++] = i;
+	}
+	si->movingValid = 1;
+}
+
+/*
+ * Bin the items being dragged again at their current position. Items
+ * moving outside of the grid are binned into the cells on its border,
+ * which the queries still visit in order of distance.
+ */
+static void
+UpdateMoving(ES_SpatialIndex *si, VG_View *vv)
+{
+	ES_SpatialItem *it;
+	Uint i;
+	int x, y;
+
+	if (!si->movingValid) {
+		FindMoving(si);
+	}
+	for (i = 0; i < si->nMoving; i++) {
+		it = &si->items[si->moving[i]];
+		if (it->unbounded) {
+			continue;
+		}
+		for (y = it->y1; y <= it->y2; y++) {
+			for (x = it->x1; x <= it->x2; x++)
+				RemoveFromCell(&si->cells[y*si->w + x],
+				    si->moving[i]);
+		}
+		ItemExtent(it, vv);
+		BinItem(si, si->moving[i]);
+	}
+	si->moved = 0;
+}
+
+static void
+FreeIndex(AG_Event *event)
+{
+	VG_View *vv = AG_SELF();
+	ES_SpatialIndex *si = AG_PTR(1);
+
+	ClearIndex(si);
+	Free(si->items);
+	Free(si->unbounded);
+	Free(si->moving);
+	Free(si);
+	AG_Unset(vv, "es-spatial-index");
+}
+
+/* Return the index of the given view, rebuilding it if it is stale. */
+static ES_SpatialIndex *
+GetIndex(VG_View *vv)
+{
+	ES_SpatialIndex *si;
+
+	if (AG_Defined(vv, "es-spatial-index")) {
+		si = AG_GetPointer(vv, "es-spatial-index");
+		if (si->vg == vv->vg &&
+		    si->gen == ES_SpatialGeneration(vv->vg) &&
+		    si->wPixel == vv->wPixel) {
+			if (si->moved && si->w > 0) {
+				UpdateMoving(si, vv);
+			}
+			return (si);
+		}
+	} else {
+		si = Malloc(sizeof(ES_SpatialIndex));
+		memset(si, 0, sizeof(ES_SpatialIndex));
+		AG_SetPointer(vv, "es-spatial-index", si);
+		AG_AddEvent(vv, "detached", FreeIndex, "%p", si);
+		if (!AG_Defined(vv, "es-spatial-drag")) {
+			AG_SetInt(vv, "es-spatial-drag", 0);
+			AG_AddEvent(vv, "mouse-button-down", OnButtonDown, NULL);
+			AG_AddEvent(vv, "mouse-button-up", OnButtonUp, NULL);
+			AG_AddEvent(vv, "mouse-motion", OnMotion, NULL);
+			AG_AddEvent(vv, "key-down", OnEdit, NULL);
+			AG_AddEvent(vv, "key-up", OnEdit, NULL);
+			AG_AddEvent(vv, "widget-gainfocus", OnEdit, NULL);
+		}
+	}
+	BuildIndex(si, vv);
+	return (si);
+}
+
+/* State of a nearest-node query. */
+typedef struct es_spatial_query {
+	VG_View *vv;
+	VG_Vector vPos;
+	const char *cls;
+	float radius;
+	VG_Node *vn;		/* Nearest node found */
+	float prox;		/* Its proximity */
+	Uint seq;		/* Its position in the node list */
+} ES_SpatialQuery;
+
+static void
+Visit(ES_SpatialIndex *si, ES_SpatialQuery *q, Uint i)
+{
+	ES_SpatialItem *it = &si->items[i];
+	VG_Node *vn = it->vn;
+	VG_Vector v;
+	float prox;
+
+	if (it->mark == si->mark) {
+		return;
+	}
+	it->mark = si->mark;
+	if (q->cls != NULL && !VG_NodeIsClass(vn, q->cls)) {
+		return;
+	}
+	v = q->vPos;
+	prox = vn->ops->pointProximity(vn, q->vv, &v);
+	if (prox > q->radius || prox >= AG_FLT_MAX) {
+		return;
+	}
+	/* Ties go to the node first in the list, as in a linear scan. */
+	if (q->vn == NULL || prox < q->prox ||
+	    (prox == q->prox && it->seq < q->seq)) {
+		q->vn = vn;
+		q->prox = prox;
+		q->seq = it->seq;
+	}
+}
+
+/*
+ * Return the node nearest to vPos whose proximity does not exceed radius,
+ * optionally restricted to the given class (NULL = any class). The node's
+ * proximity is returned into pProx if not NULL.
+ */
+VG_Node *
+ES_SpatialNearest(VG_View *vv, VG_Vector vPos, const char *cls, float radius,
+    float *pProx)
+{
+	ES_SpatialIndex *si = GetIndex(vv);
+	ES_SpatialQuery q;
+	ES_SpatialCell *cell;
+	float slack, lb;
+	int cx, cy, r, x, y, step;
+	Uint i;
+
+	q.vv = vv;
+	q.vPos = vPos;
+	q.cls = cls;
+	q.radius = radius;
+	q.vn = NULL;
+	q.prox = AG_FLT_MAX;
+	q.seq = 0;
+
+	if (++si->mark == 0) {
+		for (i = 0; i < si->nItems; i++) {
+			si->items[i].mark = 0;
+		}
+		si->mark = 1;
+	}
+	for (i = 0; i < si->nUnbounded; i++)
+		Visit(si, &q, si->unbounded[i]);
+
+	if (si->w == 0)
+		goto out;
+
+	/*
+	 * Visit rings of cells around vPos until the cells not yet visited
+	 * are all farther than the best candidate. Proximity functions
+	 * tolerate a few pixels outside of the node extents.
+	 */
+	slack = ES_SPATIAL_SLACK*vv->wPixel;
+	cx = CellX(si, vPos.x);
+	cy = CellY(si, vPos.y);
+	for (r = 0; ; r++) {
+		for (y = cy-r; y <= cy+r; y++) {
+			if (y < 0 || y >= si->h) {
+				continue;
+			}
+			step = (y == cy-r || y == cy+r) ? 1 : MAX(2*r, 1);
+			for (x = cx-r; x <= cx+r; x += step) {
+				if (x < 0 || x >= si->w) {
+					continue;
+				}
+				cell = &si->cells[y*si->w + x];
+				for (i = 0; i < cell->n; i++)
+					Visit(si, &q, cell->items[i]);
+			}
+		}
+
+		/* Lower bound on the distance to the cells not yet visited. */
+		lb = AG_FLT_MAX;
+		if (cx-r > 0)
+			lb = MIN(lb, vPos.x - (si->origin.x + (cx-r)*si->cellSize));
+		if (cx+r < si->w-1)
+			lb = MIN(lb, si->origin.x + (cx+r+1)*si->cellSize - vPos.x);
+		if (cy-r > 0)
+			lb = MIN(lb, vPos.y - (si->origin.y + (cy-r)*si->cellSize));
+		if (cy+r < si->h-1)
+			lb = MIN(lb, si->origin.y + (cy+r+1)*si->cellSize - vPos.y);
+		if (lb >= AG_FLT_MAX ||
+		    lb - slack > MIN(q.radius, q.prox))
+			break;
+	}
+out:
+	if (pProx != NULL) {
+		*pProx = q.prox;
+	}
+	return (q.vn);
+}
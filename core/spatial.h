@@ -0,0 +1,55 @@
+/*	Public domain	*/
+
+/*
+ * Uniform grid over the extents of the nodes of a VG, used to answer
+ * proximity queries without evaluating every node. One index is kept
+ * per VG_View. While nodes are dragged, only the moving nodes are binned
+ * again; the index is rebuilt after other edits of its VG (see
+ * ES_SpatialInvalidate()) and whenever the view is zoomed. Helpers are
+ * also provided for culling entities outside of the view and for
+ * validating cached geometry.
+ */
+
+#define ES_SPATIAL_MAX_CELLS	64	/* Max cells spanned by one item */
+#define ES_SPATIAL_SLACK	8	/* Proximity tolerance (pixels) */
+
+/* Indexed node. */
+typedef struct es_spatial_item {
+	VG_Node *vn;
+	Uint seq;			/* Position in the node list */
+	VG_Vector a, b;			/* Extent */
+	int x1, y1, x2, y2;		/* Cells spanned (if binned) */
+	int unbounded;			/* In the unbounded list */
+	Uint mark;			/* Last query visiting this item */
+} ES_SpatialItem;
+
+typedef struct es_spatial_cell {
+	Uint *items;			/* Items overlapping this cell */
+	Uint n, maxItems;
+} ES_SpatialCell;
+
+typedef struct es_spatial_index {
+	VG *vg;				/* VG indexed */
+	Uint gen;			/* Edit generation indexed */
+	float wPixel;			/* Scale of the view */
+	VG_Vector origin;		/* Lower corner of the grid */
+	float cellSize;
+	int w, h;			/* Dimensions in cells */
+	ES_SpatialCell *cells;
+	ES_SpatialItem *items;
+	Uint           nItems, maxItems;
+	Uint *unbounded;		/* Items without extent (or too large) */
+	Uint nUnbounded;
+	Uint mark;			/* Current query */
+	Uint *moving;			/* Items being dragged */
+	Uint nMoving;
+	int movingValid;		/* Moving items have been found */
+	int moved;			/* Moving items must be binned again */
+} ES_SpatialIndex;
+
+__BEGIN_DECLS
+VG_Node *ES_SpatialNearest(VG_View *, VG_Vector, const char *, float, float *);
+void     ES_SpatialInvalidate(VG *);
+Uint     ES_SpatialGeneration(VG *);
+int      ES_SpatialVisible(VG_View *, VG_Vector, VG_Vector);
+__END_DECLS
@@ -46,8 +46,8 @@ ES_CircuitExportSPICE3(ES_Circuit *ckt, const char *path)
 	}
 
 	fputs(OBJECT(ckt)->name, f);
-	if (ckt->descr[0] != '\0') {
-		fprintf(f, " (%s)", ckt->descr);
+	if (ckt->info != NULL && ckt->info->descr[0] != '\0') {
+		fprintf(f, " (%s)", ckt->info->descr);
 	}
 	fprintf(f,
 	    "\n* Generated by Edacious %s "
@@ -40,12 +40,13 @@
 #define G_HUGE 1e6
 
 /* Macros to simplify function bodies */
-#define GetElemG(k, l) (((k) == 0 || (l) == 0) ? &esDummy : \
-                       M_GetElement(dc->A, (k), (l)))
+#define GetElemG(k, l) (((k) == 0 || (l) == 0) ? &dc->groundSink : \
+                       ES_SimDCGetElement(dc, (k), (l)))
 #define GetElemB(k, l) GetElemG(k, SIM(dc)->ckt->n + l)
 #define GetElemC(k, l) GetElemG(SIM(dc)->ckt->n + k, l)
 #define GetElemD(k, l) GetElemG(SIM(dc)->ckt->n+k, SIM(dc)->ckt->n+l)
-#define GetElemI(k) ((k) == 0 ? &esDummy : M_VecGetElement(dc->z, (k)))
+#define GetElemI(k) ((k) == 0 ? &dc->groundSink : \
+                    M_VecGetElement(dc->z, (k)))
 #define GetElemV(k) GetElemI(k+SIM(dc)->ckt->n)
 
 typedef M_Real *StampConductanceData[4];
@@ -56,9 +57,6 @@ typedef M_Real *StampTheveninData[6];
 
 __BEGIN_DECLS
 
-/* A dummy variable that will contain all stamps relating to the ground. */
-extern M_Real esDummy;
-
 /*
  * Conductance
  */
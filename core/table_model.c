@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Tabulated device models with cubic Hermite interpolation. The grid is
+ * refined by bisecting every interval where the interpolant misses f at
+ * the midpoint by more than the tolerance.
+ */
+
+#include "core.h"
+
+#include <string.h>
+
+/* Cubic Hermite basis (weights of f0, f'0, f1, f'1) and its derivative. */
+static __inline__ void
+Hermite(M_Real t, M_Real h, M_Real *H, M_Real *dH)
+{
+	M_Real t2 = t*t, t3 = t2*t;
+
+	H[0] = 2.0*t3 - 3.0*t2 + 1.0;
+	H[1] = (t3 - 2.0*t2 + t)*h;
+	H[2] = -2.0*t3 + 3.0*t2;
+	H[3] = (t3 - t2)*h;
+	dH[0] = (6.0*t2 - 6.0*t)/h;
+	dH[1] = 3.0*t2 - 4.0*t + 1.0;
+	dH[2] = (6.0*t - 6.0*t2)/h;
+	dH[3] = 3.0*t2 - 2.0*t;
+}
+
+/* Interpolate within the cell (i,j). */
+static void
+Interp(const ES_TableModel *tm, Uint i, Uint j, M_Real x, M_Real y,
+    M_Real *f, M_Real *fx, M_Real *fy)
+{
+	M_Real hx = tm->x[i+1] - tm->x[i], hy;
+	M_Real Hx[4], dHx[4], Hy[4], dHy[4];
+	Uint a, b, k;
+
+	Hermite((x - tm->x[i])/hx, hx, Hx, dHx);
+	if (tm->ny == 1) {
+		k = i;
+		*f  =  Hx[0]*tm->f[k] +  Hx[1]*tm->fx[k] +
+		       Hx[2]*tm->f[k+1] +  Hx[3]*tm->fx[k+1];
+		*fx = dHx[0]*tm->f[k] + dHx[1]*tm->fx[k] +
+		      dHx[2]*tm->f[k+1] + dHx[3]*tm->fx[k+1];
+		*fy = 0.0;
+		return;
+	}
+	hy = tm->y[j+1] - tm->y[j];
+	Hermite((y - tm->y[j])/hy, hy, Hy, dHy);
+
+	*f = 0.0;
+	*fx = 0.0;
+	*fy = 0.0;
+	for (b = 0; b < 2; b++) {
+		for (a = 0; a < 2; a++) {
+			M_Real vx = Hx[2*a], sx = Hx[2*a+1];
+			M_Real dvx = dHx[2*a], dsx = dHx[2*a+1];
+			M_Real vy = Hy[2*b], sy = Hy[2*b+1];
+			M_Real dvy = dHy[2*b], dsy = dHy[2*b+1];
+
+			k = (j+b)*tm->nx + i+a;
+			*f  += vx*vy*tm->f[k]   + sx*vy*tm->fx[k] +
+			       vx*sy*tm->fy[k]  + sx*sy*tm->fxy[k];
+			*fx += dvx*vy*tm->f[k]  + dsx*vy*tm->fx[k] +
+			       dvx*sy*tm->fy[k] + dsx*sy*tm->fxy[k];
+			*fy += vx*dvy*tm->f[k]  + sx*dvy*tm->fx[k] +
+			       vx*dsy*tm->fy[k] + sx*dsy*tm->fxy[k];
+		}
+	}
+}
+
+/* Sample the function at every node of the grid. */
+static void
+Sample(ES_TableModel *tm, ES_TableModelFn fn, const void *arg)
+{
+	M_Real v[4];
+	Uint i, j, k;
+
+	for (j = 0, k = 0; j < tm->ny; j++) {
+		for (i = 0; i < tm->nx; i++, k++) {
+			fn(arg, tm->x[i], tm->y[j], v);
+			tm->f[k] = v[0];
+			tm->fx[k] = v[1];
+			tm->fy[k] = (tm->ny > 1) ? v[2] : 0.0;
+			tm->fxy[k] = (tm->ny > 1) ? v[3] : 0.0;
+		}
+	}
+}
+
+/*
+ * Check the interpolant of cell (i,j) against f at (x,y). The relative
+ * tolerance applies to the largest |f| over the cell, so that zero
+ * crossings do not require an infinitely fine grid.
+ */
+static int
+Accurate(const ES_TableModel *tm, ES_TableModelFn fn, const void *arg,
+    Uint i, Uint j, M_Real x, M_Real y)
+{
+	M_Real v[4], f, fi, fxi, fyi, fMax;
+	Uint k = j*tm->nx + i;
+
+	fn(arg, x, y, v);
+	f = v[0];
+	Interp(tm, i, j, x, y, &fi, &fxi, &fyi);
+
+	fMax = MAX(Fabs(f), MAX(Fabs(tm->f[k]), Fabs(tm->f[k+1])));
+	if (tm->ny > 1) {
+		k += tm->nx;
+		fMax = MAX(fMax, MAX(Fabs(tm->f[k]), Fabs(tm->f[k+1])));
+	}
+	return (Fabs(fi - f) <= tm->relTol*fMax + tm->absTol);
+}
+
+/* Insert the midpoints of the marked intervals into a set of breakpoints. */
+static M_Real *
+Bisect(const M_Real *b, Uint n, const Uint8 *mark, Uint nNew)
+{
+	M_Real *bNew;
+	Uint i, k = 0;
+
+	bNew = Malloc(nNew*sizeof(M_Real));
+	for (i = 0; i < n; i++) {
+		bNew[k++] = b[i];
+		if (i < n-1 && mark[i])
+			bNew[k++] = (b[i] + b[i+1])/2.0;
+	}
+	return (bNew);
+}
+
+/*
+ * Tabulate fn over [x0,x1] (and [y0,y1] if y1 > y0), to within
+ * relTol*|f| + absTol. Returns NULL if the tolerance cannot be met
+ * within ES_TABLE_MODEL_MAX breakpoints per axis.
+ */
+ES_TableModel *
+ES_TableModelNew(ES_TableModelFn fn, const void *arg, M_Real x0, M_Real x1,
+    M_Real y0, M_Real y1, M_Real relTol, M_Real absTol)
+{
+	ES_TableModel *tm;
+	Uint8 *markX = NULL, *markY = NULL;
+	Uint i, j, nxNew, nyNew;
+
+	tm = Malloc(sizeof(ES_TableModel));
+	tm->nx = ES_TABLE_MODEL_INIT;
+	tm->ny = (y1 > y0) ? ES_TABLE_MODEL_INIT : 1;
+	tm->x = Malloc(tm->nx*sizeof(M_Real));
+	tm->y = Malloc(tm->ny*sizeof(M_Real));
+	for (i = 0; i < tm->nx; i++) {
+		tm->x[i] = x0 + (x1 - x0)*i/(tm->nx - 1);
+	}
+	tm->y[0] = y0;
+	for (j = 1; j < tm->ny; j++) {
+		tm->y[j] = y0 + (y1 - y0)*j/(tm->ny - 1);
+	}
+	tm->f = NULL;
+	tm->relTol = relTol;
+	tm->absTol = absTol;
+
+	for (;;) {
+		Uint n = tm->nx*tm->ny;
+		M_Real *xNew, *yNew;
+
+		tm->f = Realloc(tm->f, 4*n*sizeof(M_Real));
+		tm->fx = &tm->f[n];
+		tm->fy = &tm->f[2*n];
+		tm->fxy = &tm->f[3*n];
+		Sample(tm, fn, arg);
+
+		markX = Realloc(markX, tm->nx);
+		markY = Realloc(markY, tm->ny);
+		memset(markX, 0, tm->nx);
+		memset(markY, 0, tm->ny);
+		for (j = 0; j < tm->ny; j++) {
+			Uint jc = (j > 0 && j == tm->ny-1) ? j-1 : j;
+
+			for (i = 0; i < tm->nx-1; i++) {
+				M_Real xm = (tm->x[i] + tm->x[i+1])/2.0;
+				M_Real ym;
+
+				if (!Accurate(tm, fn, arg, i, jc, xm, tm->y[j]))
+					markX[i] = 1;
+				if (tm->ny == 1 || j == tm->ny-1)
+					continue;
+
+				ym = (tm->y[j] + tm->y[j+1])/2.0;
+				if (!Accurate(tm, fn, arg, i, j, tm->x[i], ym))
+					markY[j] = 1;
+				if (!Accurate(tm, fn, arg, i, j, xm, ym))
+					markX[i] = markY[j] = 1;
+			}
+			if (tm->ny > 1 && j < tm->ny-1 &&
+			    !Accurate(tm, fn, arg, tm->nx-2, j, tm->x[tm->nx-1],
+			     (tm->y[j] + tm->y[j+1])/2.0))
+				markY[j] = 1;
+		}
+
+		for (i = 0, nxNew = tm->nx; i < tm->nx-1; i++) {
+			if (markX[i])
+				nxNew++;
+		}
+		for (j = 0, nyNew = tm->ny; j+1 < tm->ny; j++) {
+			if (markY[j])
+				nyNew++;
+		}
+		if (nxNew == tm->nx && nyNew == tm->ny) {
+			break;
+		}
+		if (nxNew > ES_TABLE_MODEL_MAX || nyNew > ES_TABLE_MODEL_MAX) {
+			AG_SetError("Table model exceeds %u points within "
+			            "tolerance %g", ES_TABLE_MODEL_MAX, relTol);
+			Free(markX);
+			Free(markY);
+			ES_TableModelFree(tm);
+			return (NULL);
+		}
+		xNew = Bisect(tm->x, tm->nx, markX, nxNew);
+		yNew = Bisect(tm->y, tm->ny, markY, nyNew);
+		Free(tm->x);
+		Free(tm->y);
+		tm->x = xNew;
+		tm->y = yNew;
+		tm->nx = nxNew;
+		tm->ny = nyNew;
+	}
+	Free(markX);
+	Free(markY);
+	return (tm);
+}
+
+void
+ES_TableModelFree(ES_TableModel *tm)
+{
+	Free(tm->x);
+	Free(tm->y);
+	Free(tm->f);
+	Free(tm);
+}
+
+/* Return the interval of b[0..n-1] containing v. */
+static __inline__ Uint
+Locate(const M_Real *b, Uint n, M_Real v)
+{
+	Uint lo = 0, hi = n-1, mid;
+
+	while (hi - lo > 1) {
+		mid = (lo + hi)/2;
+		if (v < b[mid]) {
+			hi = mid;
+		} else {
+			lo = mid;
+		}
+	}
+	return (lo);
+}
+
+/*
+ * Evaluate the table at (x,y). Returns -1 if the point lies outside of
+ * the tabulated range (the caller should then evaluate the model itself).
+ */
+int
+ES_TableModelEval(const ES_TableModel *tm, M_Real x, M_Real y, M_Real *f,
+    M_Real *fx, M_Real *fy)
+{
+	Uint i, j = 0;
+
+	if (x < tm->x[0] || x > tm->x[tm->nx-1]) {
+		return (-1);
+	}
+	if (tm->ny > 1) {
+		if (y < tm->y[0] || y > tm->y[tm->ny-1]) {
+			return (-1);
+		}
+		j = Locate(tm->y, tm->ny, y);
+	}
+	i = Locate(tm->x, tm->nx, x);
+	Interp(tm, i, j, x, y, f, fx, fy);
+	return (0);
+}
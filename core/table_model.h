@@ -0,0 +1,34 @@
+/*	Public domain	*/
+
+/*
+ * Tabulated device models. A function f(x,y) and its partial derivatives
+ * are sampled once on a grid which is refined until cubic Hermite
+ * interpolation reproduces f within a given tolerance; evaluation is then
+ * a table lookup with continuous first derivatives. One-dimensional
+ * tables (ny = 1) interpolate over x only.
+ */
+
+#define ES_TABLE_MODEL_INIT	9	/* Initial breakpoints per axis */
+#define ES_TABLE_MODEL_MAX	257	/* Maximum breakpoints per axis */
+#define ES_TABLE_MODEL_ABSTOL	1e-12	/* Absolute tolerance for currents */
+
+/* Tabulated function: return f(x,y), df/dx, df/dy and d2f/dxdy. */
+typedef void (*ES_TableModelFn)(const void *, M_Real, M_Real, M_Real [4]);
+
+typedef struct es_table_model {
+	Uint nx, ny;			/* Breakpoints along x and y */
+	M_Real *x, *y;			/* Breakpoints (ascending) */
+	M_Real *f;			/* f at the nodes (nx*ny, x fastest) */
+	M_Real *fx, *fy;		/* df/dx, df/dy at the nodes */
+	M_Real *fxy;			/* d2f/dxdy at the nodes (2-D only) */
+	M_Real relTol, absTol;		/* Accuracy bound */
+} ES_TableModel;
+
+__BEGIN_DECLS
+ES_TableModel *ES_TableModelNew(ES_TableModelFn, const void *,
+                                M_Real, M_Real, M_Real, M_Real,
+                                M_Real, M_Real);
+void           ES_TableModelFree(ES_TableModel *);
+int            ES_TableModelEval(const ES_TableModel *, M_Real, M_Real,
+                                 M_Real *, M_Real *, M_Real *);
+__END_DECLS
@@ -140,9 +140,9 @@ ConnectWire(ES_WireTool *t, VG_Vector vPos)
 	TAILQ_INSERT_TAIL(&ckt->components, COMPONENT(wire), components);
 	COMPONENT(wire)->flags |= ES_COMPONENT_CONNECTED;
 
-	VG_Status(vv, _("Connected as n%d"), nMerged);
-
+	/* Nodes may be renumbered as unused ones are compacted. */
 	ES_CircuitModified(ckt);
+	VG_Status(vv, _("Connected as n%d"), port1->node);
 	ES_UnlockCircuit(ckt);
 	t->curWire = NULL;
 	return;
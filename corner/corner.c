@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * corner: Perform a corner (worst-case) analysis over the min/typ/max
+ * specifications of the components in a circuit, and output the envelope
+ * of the probed quantities.
+ */
+
+#include <core/core.h>
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+char **specs = NULL;
+Uint nSpecs = 0;
+
+static void
+printusage(void)
+{
+	fprintf(stderr, "Usage: corner [-PeH] [-j threads] [-t tStop] "
+	                "[-n points] [-S com:param=min,typ,max] "
+	                "[file] [var1] [var2] [...]\n");
+	exit(1);
+}
+
+/* Parse a "com:param=min,typ,max" specification and apply it. */
+static int
+AddSpec(ES_Circuit *ckt, char *s)
+{
+	char *comName = s, *param, *sMin, *sTyp, *sMax;
+	ES_Component *com;
+
+	if ((param = strchr(comName, ':')) == NULL ||
+	    (sMin = strchr(param, '=')) == NULL) {
+		AG_SetError("%s: Expected com:param=min,typ,max", s);
+		return (-1);
+	}
+	*param++ = '\0';
+	*sMin++ = '\0';
+	if ((sTyp = strchr(sMin, ',')) == NULL ||
+	    (sMax = strchr(sTyp+1, ',')) == NULL) {
+		AG_SetError("%s: Expected min,typ,max", param);
+		return (-1);
+	}
+	*sTyp++ = '\0';
+	*sMax++ = '\0';
+
+	if ((com = AG_ObjectFindChild(ckt, comName)) == NULL ||
+	    !AG_OfClass(com, "ES_Circuit:ES_Component:*")) {
+		AG_SetError("%s: No such component", comName);
+		return (-1);
+	}
+	if (ES_ComponentAddSpec(com, param, (M_Real)strtod(sMin, NULL),
+	    (M_Real)strtod(sTyp, NULL), (M_Real)strtod(sMax, NULL)) == NULL) {
+		return (-1);
+	}
+	return (0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	enum es_corner_design design = ES_CORNER_FULL;
+	ES_CornerAnalysis *ca;
+	ES_Circuit *ckt;
+	char *file;
+	int c, rv, printEnvelope = 0, showHeader = 1;
+	Uint i, nThreads = 1, nPoints = 101, k, p;
+	M_Real tStop = 1.0;
+
+	AG_InitCore("corner", 0);
+	ES_CoreInit(0);
+	agDebugLvl = 0;
+
+	while ((c = getopt(argc, argv, "?hPeHj:t:n:S:")) != -1) {
+		extern char *optarg;
+
+		switch (c) {
+		case 'P':
+			design = ES_CORNER_PRUNED;
+			break;
+		case 'e':
+			printEnvelope = 1;
+			break;
+		case 'H':
+			showHeader = 0;
+			break;
+		case 'j':
+			nThreads = (Uint)atoi(optarg);
+			break;
+		case 't':
+			tStop = (M_Real)strtod(optarg, NULL);
+			break;
+		case 'n':
+			nPoints = (Uint)atoi(optarg);
+			break;
+		case 'S':
+			specs = Realloc(specs, (nSpecs+1)*sizeof(char *));
+			specs[nSpecs++] = Strdup(optarg);
+			break;
+		case '?':
+		case 'h':
+			printusage();
+		}
+	}
+	if (optind == argc) {
+		printusage();
+	}
+	file = argv[optind];
+
+	ckt = AG_ObjectNew(NULL, NULL, &esCircuitClass);
+	ckt->flags |= ES_CIRCUIT_HEADLESS;
+	if ((ES_NetlistIsCompiled(file) ?
+	    ES_NetlistLoad(ckt, file) :
+	    AG_ObjectLoadFromFile(ckt, file)) == -1) {
+		fprintf(stderr, "%s: %s\n", file, AG_GetError());
+		exit(1);
+	}
+	for (i = 0; i < nSpecs; i++) {
+		if (AddSpec(ckt, specs[i]) == -1) {
+			fprintf(stderr, "%s: %s\n", file, AG_GetError());
+			exit(1);
+		}
+	}
+
+	ca = ES_CornerNew(ckt);
+	ca->tStop = tStop;
+	ca->nPoints = nPoints;
+	ca->nThreads = nThreads;
+	for (c = optind+1; c < argc; c++) {
+		if (ES_CornerAddProbe(ca, argv[c]) == -1) {
+			fprintf(stderr, "%s: %s\n", file, AG_GetError());
+			exit(1);
+		}
+	}
+	if (ES_CornerSetup(ca, design) == -1 ||
+	    ES_CornerRun(ca) == -1) {
+		fprintf(stderr, "%s: %s\n", file, AG_GetError());
+		exit(1);
+	}
+
+	/* Corner definitions */
+	if (showHeader) {
+		printf("#Corner\tStatus");
+		for (p = 0; p < ca->nParams; p++) {
+			printf("\t%s:%s", ca->params[p].comName,
+			    ca->params[p].spec->name);
+		}
+		printf("\n");
+	}
+	for (k = 0; k < ca->nCorners; k++) {
+		if (ca->status[k] != 0) {
+			fprintf(stderr, "%s: Corner %u: %s\n", file, k,
+			    ES_CornerError(ca, k));
+		}
+		printf("%u\t%s", k, ca->status[k] == 0 ? "OK" : "FAILED");
+		for (p = 0; p < ca->nParams; p++) {
+			printf("\t%g", ES_CornerValue(ca, k, p));
+		}
+		printf("\n");
+	}
+
+	/* Worst-case extrema */
+	if (showHeader) {
+		printf("\n#Probe\tMin\tCorner\tMax\tCorner\n");
+	}
+	for (k = 0; k < ca->nProbes; k++) {
+		ES_CornerProbe *cp = &ca->probes[k];
+
+		printf("%s\t%.08g\t%u\t%.08g\t%u\n", cp->name,
+		    cp->worstMin, cp->cornerMin,
+		    cp->worstMax, cp->cornerMax);
+	}
+
+	/* Envelope over the output grid */
+	if (printEnvelope) {
+		Uint j;
+
+		if (showHeader) {
+			printf("\n#Time");
+			for (k = 0; k < ca->nProbes; k++) {
+				printf("\tmin(%s)\tmax(%s)", ca->probes[k].name,
+				    ca->probes[k].name);
+			}
+			printf("\n");
+		}
+		for (j = 0; j < ca->nPoints; j++) {
+			printf("%.06f", ca->tStop*j/(ca->nPoints-1));
+			for (k = 0; k < ca->nProbes; k++) {
+				printf("\t%.08f\t%.08f", ca->probes[k].min[j],
+				    ca->probes[k].max[j]);
+			}
+			printf("\n");
+		}
+	}
+
+	rv = (ca->nFailed > 0) ? 1 : 0;
+	for (i = 0; i < nSpecs; i++) {
+		free(specs[i]);
+	}
+	Free(specs);
+	ES_CornerFree(ca);
+	AG_ObjectDestroy(ckt);
+	return (rv);
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * ecmcompile: Compile Edacious circuit model (.ecm) files into netlists
+ * (.ecn) which can be mapped into memory by the headless simulators.
+ */
+
+#include <core/core.h>
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void
+printusage(void)
+{
+	fprintf(stderr, "Usage: ecmcompile [-o outfile] [file] [...]\n");
+	exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	char path[AG_PATHNAME_MAX];
+	const char *outFile = NULL;
+	ES_Circuit *ckt;
+	int i, c, rv = 0;
+
+	AG_InitCore("ecmcompile", 0);
+	ES_CoreInit(0);
+	agDebugLvl = 0;
+
+	while ((c = getopt(argc, argv, "?ho:")) != -1) {
+		extern char *optarg;
+
+		switch (c) {
+		case 'o':
+			outFile = optarg;
+			break;
+		case '?':
+		case 'h':
+			printusage();
+		}
+	}
+	if (optind == argc ||
+	    (outFile != NULL && argc-optind > 1)) {
+		printusage();
+	}
+	for (i = optind; i < argc; i++) {
+		char *ext;
+
+		if (outFile != NULL) {
+			Strlcpy(path, outFile, sizeof(path));
+		} else {
+			Strlcpy(path, argv[i], sizeof(path));
+			if ((ext = strrchr(path, '.')) != NULL &&
+			    strchr(ext, PATHSEPCHAR) == NULL) {
+				*ext = '\0';
+			}
+			Strlcat(path, ES_NETLIST_EXT, sizeof(path));
+		}
+		ckt = AG_ObjectNew(NULL, NULL, &esCircuitClass);
+		ckt->flags |= ES_CIRCUIT_HEADLESS;
+		if (AG_ObjectLoadFromFile(ckt, argv[i]) == -1 ||
+		    ES_NetlistCompile(ckt, path) == -1) {
+			fprintf(stderr, "%s: %s\n", argv[i], AG_GetError());
+			AG_ObjectDestroy(ckt);
+			rv = 1;
+			continue;
+		}
+		AG_ObjectDestroy(ckt);
+	}
+	return (rv);
+}
@@ -31,10 +31,6 @@
 
 #include <core/core.h>
 
-#include <generic/generic.h>
-#include <sources/sources.h>
-#include <macro/macro.h>
-
 #include <unistd.h>
 
 int showProps = 1;
@@ -75,18 +71,19 @@ main(int argc, char *argv[])
 	for (i = optind; i < argc; i++) {
 		printf("%s:\n", argv[i]);
 		ckt = AG_ObjectNew(NULL, NULL, &esCircuitClass);
+		ckt->flags |= ES_CIRCUIT_HEADLESS;
 		if (AG_ObjectLoadFromFile(ckt, argv[i]) == -1) {
 			fprintf(stderr, "%s: %s\n", argv[i], AG_GetError());
 			continue;
 		}
-		if (ckt->descr[0] != '\0') {
-			printf("\tDescription: \"%s\"\n", ckt->descr);
+		if (ckt->info->descr[0] != '\0') {
+			printf("\tDescription: \"%s\"\n", ckt->info->descr);
 		}
-		if (ckt->authors[0] != '\0') {
-			printf("\tAuthor: \"%s\"\n", ckt->authors);
+		if (ckt->info->authors[0] != '\0') {
+			printf("\tAuthor: \"%s\"\n", ckt->info->authors);
 		}
-		if (ckt->keywords[0] != '\0') {
-			printf("\tKeywords: \"%s\"\n", ckt->keywords);
+		if (ckt->info->keywords[0] != '\0') {
+			printf("\tKeywords: \"%s\"\n", ckt->info->keywords);
 		}
 		printf("\tTotal voltage sources: %u\n", ckt->m);
 		printf("\tTotal nodes: %u\n", ckt->n);
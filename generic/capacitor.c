@@ -233,6 +233,7 @@ Init(void *p)
 	COMPONENT(cap)->dcSimBegin = DC_SimBegin;
 	COMPONENT(cap)->dcStepBegin = DC_StepBegin;
 	COMPONENT(cap)->dcStepIter = DC_StepIter;
+	COMPONENT(cap)->flags |= ES_COMPONENT_LINEAR;
 	COMPONENT(cap)->dcUpdateError = DC_UpdateError;
 	
 	AG_SetEvent(cap, "circuit-connected", Connected, NULL);
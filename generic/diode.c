@@ -32,6 +32,8 @@
 #include <core/core.h>
 #include "generic.h"
 
+#include <stddef.h>
+
 enum {
 	PORT_P = 1,
 	PORT_N = 2
@@ -43,6 +45,28 @@ const ES_Port esDiodePorts[] = {
 	{ -1 },
 };
 
+static void
+DeriveModel(void *p)
+{
+	ES_DiodeModel *m = p;
+
+	m->VtInv = 1.0/m->Vt;
+	m->Vcrit = m->Vt*Log(m->Vt/(Sqrt(2.0)*m->Is));
+}
+
+const ES_ModelCardParam esDiodeModelParams[] = {
+	{ "Is",	offsetof(ES_DiodeModel, Is),	1e-14 },
+	{ "Vt",	offsetof(ES_DiodeModel, Vt),	0.025 },
+	{ NULL }
+};
+const ES_ModelCardClass esDiodeModelClass = {
+	"D",
+	sizeof(ES_DiodeModel),
+	esDiodeModelParams,
+	DeriveModel,
+	NULL		/* destroy */
+};
+
 /*
  * Returns the voltage across the diode calculated in the last Newton-Raphson
  * iteration.
@@ -66,24 +90,27 @@ ResetModel(ES_Diode *d)
 	d->g = 1.0;
 	d->Ieq = 0.0;
 	d->vPrevIter = 0.7;
+	d->evaluated = 0;
 }
 
 /* Updates the small- and large-signal models, saving the previous values. */
 static void
 UpdateModel(ES_Diode *d, ES_SimDC *dc, M_Real v)
 {
-	M_Real vDiff = v - d->vPrevIter;
+	const ES_DiodeModel *m = d->model;
 	M_Real I;
 
-	if (Fabs(vDiff) > d->Vt) {
-		v = d->vPrevIter + vDiff/Fabs(vDiff)*d->Vt;
-		dc->isDamped = 1;
+	if (dc->flags & ES_SIMDC_NO_LIMIT) {
+		v = ES_LimitStep(v, d->vPrevIter, m->Vt, &dc->isDamped);
+	} else {
+		v = ES_LimitPN(v, d->vPrevIter, m->Vt, m->Vcrit,
+		    &dc->isDamped);
 	}
-
 	d->vPrevIter = v;
+	d->evaluated = 1;
 
-	I = d->Is*(Exp(v/(d->Vt)) - 1);
-	d->g = I/(d->Vt);
+	I = m->Is*(Exp(v*m->VtInv) - 1);
+	d->g = I*m->VtInv;
 	d->Ieq = I-(d->g)*v;
 }
 
@@ -102,6 +129,9 @@ DC_SimBegin(void *obj, ES_SimDC *dc)
 	Uint k = PNODE(d,PORT_P);
 	Uint l = PNODE(d,PORT_N);
 
+	ES_ModelCardRelease(d->model);
+	d->model = ES_ModelCardGet(d, &esDiodeModelClass);
+
 	InitStampConductance(k, l, d->s_conductance, dc);
 	InitStampCurrentSource(l, k, d->s_current_source, dc);
 
@@ -131,8 +161,12 @@ static void
 DC_StepIter(void *obj, ES_SimDC *dc)
 {
 	ES_Diode *d = obj;
+	M_Real vNew = v(d);
 
-	UpdateModel(d, dc, v(d));
+	if (!ES_SimDCBypass(dc, d->evaluated &&
+	    ES_BypassCheck(vNew, d->vPrevIter))) {
+		UpdateModel(d, dc, vNew);
+	}
 	Stamp(d, dc);
 }
 
@@ -142,15 +176,20 @@ Init(void *p)
 	ES_Diode *d = p;
 
 	ES_InitPorts(d, esDiodePorts);
-	d->Is = 1e-14;
-	d->Vt = 0.025;
+	ES_ModelCardInitParams(d, &esDiodeModelClass, d->params);
+	d->model = NULL;
 	
 	COMPONENT(d)->dcSimBegin = DC_SimBegin;
 	COMPONENT(d)->dcStepBegin = DC_StepBegin;
 	COMPONENT(d)->dcStepIter = DC_StepIter;
+}
+
+static void
+Destroy(void *p)
+{
+	ES_Diode *d = p;
 
-	M_BindReal(d, "Is", &d->Is);
-	M_BindReal(d, "Vt", &d->Vt);
+	ES_ModelCardRelease(d->model);
 }
 
 static void *
@@ -158,11 +197,15 @@ Edit(void *p)
 {
 	ES_Diode *d = p;
 	AG_Box *box = AG_BoxNewVert(NULL, AG_BOX_EXPAND);
+	M_Real *v;
 
-	M_NumericalNewRealR(box, 0, "pA",
-	    _("Reverse saturation current: "), &d->Is, M_TINYVAL, HUGE_VAL);
-	M_NumericalNewRealPNZ(box, 0, "mV",
-	    _("Thermal voltage: "), &d->Vt);
+	if ((v = ES_ModelCardParamPtr(d, "Is")) != NULL)
+		M_NumericalNewRealR(box, 0, "pA",
+		    _("Reverse saturation current: "), v,
+		    M_TINYVAL, HUGE_VAL);
+	if ((v = ES_ModelCardParamPtr(d, "Vt")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, "mV",
+		    _("Thermal voltage: "), v);
 
 	return (box);
 }
@@ -175,7 +218,7 @@ ES_ComponentClass esDiodeClass = {
 		{ 0,0 },
 		Init,
 		NULL,		/* reinit */
-		NULL,		/* destroy */
+		Destroy,
 		NULL,		/* load */
 		NULL,		/* save */
 		Edit
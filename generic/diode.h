@@ -1,15 +1,28 @@
 /*	Public domain	*/
 
-typedef struct es_diode {
-	struct es_component _inherit;
+/* Diode model card ("D"). */
+typedef struct es_diode_model {
+	struct es_model_card _inherit;
 	M_Real Is;			/* Reverse saturation current (A) */
 	M_Real Vt;			/* Thermal voltage (V) */
+	M_Real VtInv;			/* 1/Vt */
+	M_Real Vcrit;			/* Critical voltage (V) */
+} ES_DiodeModel;
+
+#define ES_DIODE_NPARAMS 2		/* Entries in esDiodeModelParams */
+
+typedef struct es_diode {
+	struct es_component _inherit;
+	ES_DiodeModel *model;		/* Model card (during simulation) */
+	M_Real params[ES_DIODE_NPARAMS];	/* Model parameters (bound) */
 	M_Real Ieq, g;			/* Companion model parameters */
 	M_Real vPrevIter;
+	int evaluated;			/* Model is at vPrevIter (bypass) */
 	StampConductanceData s_conductance;
 	StampCurrentSourceData s_current_source;
 } ES_Diode;
 
 __BEGIN_DECLS
 extern ES_ComponentClass esDiodeClass;
+extern const ES_ModelCardClass esDiodeModelClass;
 __END_DECLS
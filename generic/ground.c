@@ -42,29 +42,10 @@ Connect(void *p, ES_Port *p1, ES_Port *p2)
 {
 	ES_Ground *gnd = p;
 	ES_Circuit *ckt = COMCIRCUIT(gnd);
-	ES_Branch *br;
 
 	if (p2 != NULL && p2->node > 0) {
-		Uint nOld = p2->node;
-		ES_Node *node = ckt->nodes[nOld];
-rescan:
-		NODE_FOREACH_BRANCH(br, node) {
-			ES_Port *brPort = br->port;
-			
-			if (brPort == NULL || brPort->com == NULL ||
-			    COMPONENT_IS_FLOATING(brPort->com)) {
-				continue;
-			}
-			ES_CircuitLog(ckt,
-			    _("Grounding %s(%s) (previously on n%d)"),
-			    OBJECT(brPort->com)->name, brPort->name,
-			    brPort->node);
-			brPort->node = 0;
-			ES_AddBranch(ckt, 0, brPort);
-			ES_DelBranch(ckt, nOld, br);
-			goto rescan;
-		}
-		ES_DelNode(ckt, nOld);
+		ES_CircuitLog(ckt, _("Grounding n%d"), p2->node);
+		ES_MergeNodes(ckt, 0, p2->node);
 	}
 	p1->node = 0;
 	p1->branch = ES_AddBranch(ckt, 0, p1);
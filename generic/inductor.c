@@ -254,6 +254,7 @@ Init(void *p)
 	COMPONENT(i)->dcStepBegin = DC_StepBegin;
 	COMPONENT(i)->dcStepEnd = DC_StepEnd;
 	COMPONENT(i)->dcStepIter = DC_StepIter;
+	COMPONENT(i)->flags |= ES_COMPONENT_LINEAR;
 	COMPONENT(i)->dcUpdateError = DC_UpdateError;
 
 	M_BindReal(i, "L", &i->L);
@@ -32,6 +32,8 @@
 #include <core/core.h>
 #include "generic.h"
 
+#include <stddef.h>
+
 enum {
 	PORT_G = 1,
 	PORT_D = 2,
@@ -45,6 +47,92 @@ const ES_Port esNMOSPorts[] = {
 	{ -1 },
 };
 
+/* Drain current and its exact partial derivatives (for table models). */
+static void
+MOSModelTabulate(const void *p, M_Real vGS, M_Real vDS, M_Real v[4])
+{
+	const ES_MOSModel *m = p;
+	M_Real vOv = vGS - m->Vt, a;
+
+	if (vOv < 0.0) {					/* Cutoff */
+		v[0] = v[1] = v[2] = v[3] = 0.0;
+	} else if (vOv < vDS) {					/* Saturation */
+		a = 1.0 + (vDS - vOv)*m->VaInv;
+		v[0] = m->Khalf*vOv*vOv*a;
+		v[1] = m->K*vOv*a - m->Khalf*vOv*vOv*m->VaInv;
+		v[2] = m->Khalf*vOv*vOv*m->VaInv;
+		v[3] = m->K*vOv*m->VaInv;
+	} else {						/* Triode */
+		v[0] = m->K*(vOv - vDS/2.0)*vDS;
+		v[1] = m->K*vDS;
+		v[2] = m->K*(vOv - vDS);
+		v[3] = m->K;
+	}
+}
+
+void
+ES_MOSModelDerive(void *p)
+{
+	ES_MOSModel *m = p;
+
+	m->VaInv = 1.0/m->Va;
+	m->Khalf = m->K/2.0;
+
+	/*
+	 * The vGS range is centered on Vt, so that the threshold falls on
+	 * a breakpoint. Negative vDS is left to the analytic model.
+	 */
+	m->tab = NULL;
+	if (m->tableTol > 0.0) {
+		m->tab = ES_TableModelNew(MOSModelTabulate, m,
+		    m->Vt - ES_MOS_TABLE_VRANGE/2.0,
+		    m->Vt + ES_MOS_TABLE_VRANGE/2.0,
+		    0.0, ES_MOS_TABLE_VRANGE,
+		    m->tableTol, ES_TABLE_MODEL_ABSTOL);
+		if (m->tab == NULL)
+			AG_Verbose("%s model: %s; using analytic model\n",
+			    m->_inherit.cls->name, AG_GetError());
+	}
+}
+
+void
+ES_MOSModelDestroy(void *p)
+{
+	ES_MOSModel *m = p;
+
+	if (m->tab != NULL)
+		ES_TableModelFree(m->tab);
+}
+
+/*
+ * Evaluate the table model of a MOSFET. Returns -1 if the analytic model
+ * must be used instead.
+ */
+int
+ES_MOSModelLookup(const ES_MOSModel *m, const ES_SimDC *dc, M_Real vGS,
+    M_Real vDS, M_Real *I, M_Real *gm, M_Real *go)
+{
+	if (m->tab == NULL || (dc->flags & ES_SIMDC_ANALYTIC)) {
+		return (-1);
+	}
+	return (ES_TableModelEval(m->tab, vGS, vDS, I, gm, go));
+}
+
+const ES_ModelCardParam esMOSModelParams[] = {
+	{ "Vt",	offsetof(ES_MOSModel, Vt),	0.5 },
+	{ "Va",	offsetof(ES_MOSModel, Va),	10.0 },
+	{ "K",	offsetof(ES_MOSModel, K),	1e-3 },
+	{ "tableTol", offsetof(ES_MOSModel, tableTol), 0.0 },
+	{ NULL }
+};
+const ES_ModelCardClass esNMOSModelClass = {
+	"NMOS",
+	sizeof(ES_MOSModel),
+	esMOSModelParams,
+	ES_MOSModelDerive,
+	ES_MOSModelDestroy
+};
+
 static __inline__ M_Real
 VdsPrevStep(ES_NMOS *u)
 {
@@ -68,24 +156,38 @@ vGS(ES_NMOS *u)
 }
 
 static void
-UpdateModel(ES_NMOS *u, M_Real vGS, M_Real vDS)
+UpdateModel(ES_NMOS *u, ES_SimDC *dc, M_Real vGS, M_Real vDS)
 {
+	const ES_MOSModel *m = u->model;
 	M_Real I;
 
-	if (vGS < u->Vt) {					/* Cutoff */
-		I = 0;
-		u->gm = 0;
-		u->go = 0;
-	} else if ((vGS-u->Vt) < vDS) {				/* Saturation */
-		M_Real vSat = vGS-u->Vt;
+	if (!(dc->flags & ES_SIMDC_NO_LIMIT)) {
+		vGS = ES_LimitFET(vGS, u->vGSPrevIter, m->Vt, &dc->isDamped);
+		vDS = ES_LimitVDS(vDS, u->vDSPrevIter, &dc->isDamped);
+	}
+	u->vGSPrevIter = vGS;
+	u->vDSPrevIter = vDS;
+	u->evaluated = 1;
+
+	if (ES_MOSModelLookup(m, dc, vGS, vDS, &I, &u->gm, &u->go) == -1) {
+		/* Not tabulated; evaluate the analytic model. */
+		if (vGS < m->Vt) {				/* Cutoff */
+			I = 0;
+			u->gm = 0;
+			u->go = 0;
+		} else if ((vGS-m->Vt) < vDS) {			/* Saturation */
+			M_Real vSat = vGS-m->Vt;
+			M_Real a = 1.0 + (vDS - vSat)*m->VaInv;
 
-		I = (u->K)/2.0*(vSat*vSat)*(1.0 + (vDS - vSat)/u->Va);
-		u->gm = Sqrt(2.0*(u->K)*I);
-		u->go = I/u->Va;
-	} else {						/* Triode */
-		I = (u->K)*((vGS - (u->Vt)) - vDS/2)*vDS;
-		u->gm = (u->K)*vDS;
-		u->go = (u->K)*((vGS - (u->Vt)) - vDS);
+			/* Exact derivatives, including channel-length terms. */
+			I = m->Khalf*(vSat*vSat)*a;
+			u->gm = m->K*vSat*a - m->Khalf*(vSat*vSat)*m->VaInv;
+			u->go = m->Khalf*(vSat*vSat)*m->VaInv;
+		} else {					/* Triode */
+			I = (m->K)*((vGS - (m->Vt)) - vDS/2)*vDS;
+			u->gm = (m->K)*vDS;
+			u->go = (m->K)*((vGS - (m->Vt)) - vDS);
+		}
 	}
 
 	u->Ieq = I - u->gm*vGS - u->go*vDS;
@@ -107,6 +209,9 @@ DC_SimBegin(void *obj, ES_SimDC *dc)
 	Uint d = PNODE(u,PORT_D);
 	Uint s = PNODE(u,PORT_S);
 
+	ES_ModelCardRelease(u->model);
+	u->model = ES_ModelCardGet(u, &esNMOSModelClass);
+
 	InitStampVCCS(g,s,d,s, u->s_vccs, dc);
 	InitStampConductance(d,s, u->s_conductance, dc);
 	InitStampCurrentSource(s,d, u->s_current, dc);
@@ -114,6 +219,9 @@ DC_SimBegin(void *obj, ES_SimDC *dc)
 	u->gm = 0.0;
 	u->go = 1.0;
 	u->Ieq = 0.0;
+	u->vGSPrevIter = 0.0;
+	u->vDSPrevIter = 0.0;
+	u->evaluated = 0;
 	Stamp(u,dc);
 
 	return (0);
@@ -124,7 +232,9 @@ DC_StepBegin(void *obj, ES_SimDC *dc)
 {
 	ES_NMOS *u = obj;
 
-	UpdateModel(u,VgsPrevStep(u),VdsPrevStep(u));
+	u->vGSPrevIter = VgsPrevStep(u);
+	u->vDSPrevIter = VdsPrevStep(u);
+	UpdateModel(u,dc,VgsPrevStep(u),VdsPrevStep(u));
 	Stamp(u,dc);
 }
 
@@ -132,8 +242,13 @@ static void
 DC_StepIter(void *obj, ES_SimDC *dc)
 {
         ES_NMOS *u = obj;
+	M_Real vGSnew = vGS(u), vDSnew = vDS(u);
 
-	UpdateModel(u,vGS(u),vDS(u));
+	if (!ES_SimDCBypass(dc, u->evaluated &&
+	    ES_BypassCheck(vGSnew, u->vGSPrevIter) &&
+	    ES_BypassCheck(vDSnew, u->vDSPrevIter))) {
+		UpdateModel(u,dc,vGSnew,vDSnew);
+	}
 	Stamp(u,dc);
 }
 
@@ -143,17 +258,20 @@ Init(void *p)
 	ES_NMOS *u = p;
 
 	ES_InitPorts(u, esNMOSPorts);
-	u->Vt = 0.5;
-	u->Va = 10;
-	u->K = 1e-3;
+	ES_ModelCardInitParams(u, &esNMOSModelClass, u->params);
+	u->model = NULL;
 
 	COMPONENT(u)->dcSimBegin = DC_SimBegin;
 	COMPONENT(u)->dcStepBegin = DC_StepBegin;
 	COMPONENT(u)->dcStepIter = DC_StepIter;
+}
+
+static void
+Destroy(void *p)
+{
+	ES_NMOS *u = p;
 
-	M_BindReal(u, "Vt", &u->Vt);
-	M_BindReal(u, "Va", &u->Va);
-	M_BindReal(u, "K", &u->K);
+	ES_ModelCardRelease(u->model);
 }
 
 static void *
@@ -161,10 +279,17 @@ Edit(void *p)
 {
 	ES_NMOS *u = p;
 	AG_Box *box = AG_BoxNewVert(NULL, AG_BOX_EXPAND);
+	M_Real *v;
 
-	M_NumericalNewRealPNZ(box, 0, "V", _("Threshold voltage: "), &u->Vt);
-	M_NumericalNewRealPNZ(box, 0, "V", _("Early voltage: "), &u->Va);
-	M_NumericalNewRealPNZ(box, 0, NULL, _("K: "), &u->K);
+	if ((v = ES_ModelCardParamPtr(u, "Vt")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, "V", _("Threshold voltage: "), v);
+	if ((v = ES_ModelCardParamPtr(u, "Va")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, "V", _("Early voltage: "), v);
+	if ((v = ES_ModelCardParamPtr(u, "K")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, NULL, _("K: "), v);
+	if ((v = ES_ModelCardParamPtr(u, "tableTol")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, NULL,
+		    _("Table model tolerance (0 = analytic): "), v);
 
 	return (box);
 }
@@ -177,7 +302,7 @@ ES_ComponentClass esNMOSClass = {
 		{ 0,0 },
 		Init,
 		NULL,		/* reinit */
-		NULL,		/* destroy */
+		Destroy,
 		NULL,		/* load */
 		NULL,		/* save */
 		Edit		/* edit */
@@ -1,11 +1,28 @@
 /*	Public domain	*/
 
-typedef struct es_nmos {
-	struct es_component _inherit;
+/* MOSFET model card ("NMOS" or "PMOS"). */
+typedef struct es_mos_model {
+	struct es_model_card _inherit;
 	M_Real Vt;			/* Threshold voltage */
 	M_Real Va;			/* Early voltage */
 	M_Real K;			/* K-value */
+	M_Real tableTol;		/* Table model tolerance (0 = analytic) */
+	M_Real VaInv;			/* 1/Va */
+	M_Real Khalf;			/* K/2 */
+	ES_TableModel *tab;		/* Tabulated I(vGS,vDS) (or NULL) */
+} ES_MOSModel;
+
+#define ES_MOS_NPARAMS 4		/* Entries in esMOSModelParams */
+
+#define ES_MOS_TABLE_VRANGE 16.0	/* Span of tabulated vGS and vDS */
+
+typedef struct es_nmos {
+	struct es_component _inherit;
+	ES_MOSModel *model;		/* Model card (during simulation) */
+	M_Real params[ES_MOS_NPARAMS];	/* Model parameters (bound) */
 	M_Real Ieq, gm, go;		/* Companion model parameters */
+	M_Real vGSPrevIter, vDSPrevIter;
+	int evaluated;			/* Model is at PrevIter (bypass) */
 	StampVCCSData s_vccs;
 	StampConductanceData s_conductance;
 	StampCurrentSourceData s_current;
@@ -13,4 +30,11 @@ typedef struct es_nmos {
 
 __BEGIN_DECLS
 extern ES_ComponentClass esNMOSClass;
+extern const ES_ModelCardParam esMOSModelParams[];
+extern const ES_ModelCardClass esNMOSModelClass;
+
+void ES_MOSModelDerive(void *);
+void ES_MOSModelDestroy(void *);
+int  ES_MOSModelLookup(const ES_MOSModel *, const ES_SimDC *, M_Real, M_Real,
+                       M_Real *, M_Real *, M_Real *);
 __END_DECLS
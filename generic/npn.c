@@ -32,6 +32,8 @@
 #include <core/core.h>
 #include "generic.h"
 
+#include <stddef.h>
+
 enum {
 	PORT_B = 1,
 	PORT_E = 2,
@@ -45,6 +47,112 @@ const ES_Port esNPNPorts[] = {
 	{ -1 },
 };
 
+/* Forward and reverse base currents (for table models). */
+static void
+BJTModelTabulateF(const void *p, M_Real v, M_Real unused, M_Real f[4])
+{
+	const ES_BJTModel *m = p;
+	M_Real e = M_Exp(v*m->VtInv);
+
+	f[0] = m->IbfSat*(e - 1.0);
+	f[1] = m->IbfSat*e*m->VtInv;
+	f[2] = f[3] = 0.0;
+}
+static void
+BJTModelTabulateR(const void *p, M_Real v, M_Real unused, M_Real f[4])
+{
+	const ES_BJTModel *m = p;
+	M_Real e = M_Exp(v*m->VtInv);
+
+	f[0] = m->IbrSat*(e - 1.0);
+	f[1] = m->IbrSat*e*m->VtInv;
+	f[2] = f[3] = 0.0;
+}
+
+void
+ES_BJTModelDerive(void *p)
+{
+	ES_BJTModel *m = p;
+
+	m->VtInv = 1.0/m->Vt;
+	m->VaInv = 1.0/m->Va;
+	m->IbfSat = m->Ifs/m->betaF;
+	m->IbrSat = m->Irs/m->betaR;
+	m->VcritF = m->Vt*Log(m->Vt/(Sqrt(2.0)*m->Ifs));
+	m->VcritR = m->Vt*Log(m->Vt/(Sqrt(2.0)*m->Irs));
+
+	/*
+	 * Junction voltages are limited around Vcrit, so the tables only
+	 * need to extend a little beyond it.
+	 */
+	m->tabF = NULL;
+	m->tabR = NULL;
+	if (m->tableTol > 0.0) {
+		m->tabF = ES_TableModelNew(BJTModelTabulateF, m,
+		    ES_BJT_TABLE_VMIN, m->VcritF + ES_BJT_TABLE_VOVER, 0.0, 0.0,
+		    m->tableTol, ES_TABLE_MODEL_ABSTOL);
+		m->tabR = ES_TableModelNew(BJTModelTabulateR, m,
+		    ES_BJT_TABLE_VMIN, m->VcritR + ES_BJT_TABLE_VOVER, 0.0, 0.0,
+		    m->tableTol, ES_TABLE_MODEL_ABSTOL);
+		if (m->tabF == NULL || m->tabR == NULL) {
+			AG_Verbose("%s model: %s; using analytic model\n",
+			    m->_inherit.cls->name, AG_GetError());
+			ES_BJTModelDestroy(m);
+		}
+	}
+}
+
+void
+ES_BJTModelDestroy(void *p)
+{
+	ES_BJTModel *m = p;
+
+	if (m->tabF != NULL) {
+		ES_TableModelFree(m->tabF);
+		m->tabF = NULL;
+	}
+	if (m->tabR != NULL) {
+		ES_TableModelFree(m->tabR);
+		m->tabR = NULL;
+	}
+}
+
+/*
+ * Evaluate the table model of the forward and reverse junctions of a
+ * BJT. Returns -1 if the analytic model must be used instead.
+ */
+int
+ES_BJTModelLookup(const ES_BJTModel *m, const ES_SimDC *dc, M_Real vF,
+    M_Real vR, M_Real *Ibf, M_Real *gPiF, M_Real *Ibr, M_Real *gPiR)
+{
+	M_Real dummy;
+
+	if (m->tabF == NULL || (dc->flags & ES_SIMDC_ANALYTIC) ||
+	    ES_TableModelEval(m->tabF, vF, 0.0, Ibf, gPiF, &dummy) == -1 ||
+	    ES_TableModelEval(m->tabR, vR, 0.0, Ibr, gPiR, &dummy) == -1) {
+		return (-1);
+	}
+	return (0);
+}
+
+const ES_ModelCardParam esBJTModelParams[] = {
+	{ "Vt",		offsetof(ES_BJTModel, Vt),	0.025 },
+	{ "Va",		offsetof(ES_BJTModel, Va),	10.0 },
+	{ "betaF",	offsetof(ES_BJTModel, betaF),	100.0 },
+	{ "betaR",	offsetof(ES_BJTModel, betaR),	1.0 },
+	{ "Ifs",	offsetof(ES_BJTModel, Ifs),	1e-14 },
+	{ "Irs",	offsetof(ES_BJTModel, Irs),	1e-14 },
+	{ "tableTol",	offsetof(ES_BJTModel, tableTol), 0.0 },
+	{ NULL }
+};
+const ES_ModelCardClass esNPNModelClass = {
+	"NPN",
+	sizeof(ES_BJTModel),
+	esBJTModelParams,
+	ES_BJTModelDerive,
+	ES_BJTModelDestroy
+};
+
 static M_Real
 vBE(ES_NPN *u)
 {
@@ -84,39 +192,44 @@ ResetModel(ES_NPN *u)
 
 	u->VbePrevIter = 0.7;
 	u->VbcPrevIter = 0.7;
+	u->evaluated = 0;
 }
 
 static void
 UpdateModel(ES_NPN *u, ES_SimDC *dc, M_Real vBE, M_Real vBC)
 {
-	M_Real vCE = -vBC+vBE;
-	M_Real VbeDiff = vBE - u->VbePrevIter;
-	M_Real VbcDiff = vBC - u->VbcPrevIter;
+	const ES_BJTModel *m = u->model;
+	M_Real vCE;
 	M_Real Ibf, Ibr, Icc;
 
-	if (M_Fabs(VbeDiff) > u->Vt) {
-		vBE = u->VbePrevIter + M_Fabs(VbeDiff)/VbeDiff*u->Vt;
-		dc->isDamped = 1;
-	}
-	if (M_Fabs(VbcDiff) > u->Vt) {
-		vBC = u->VbcPrevIter + M_Fabs(VbcDiff)/VbcDiff*u->Vt;
-		dc->isDamped = 1;
+	if (dc->flags & ES_SIMDC_NO_LIMIT) {
+		vBE = ES_LimitStep(vBE, u->VbePrevIter, m->Vt, &dc->isDamped);
+		vBC = ES_LimitStep(vBC, u->VbcPrevIter, m->Vt, &dc->isDamped);
+	} else {
+		vBE = ES_LimitPN(vBE, u->VbePrevIter, m->Vt, m->VcritF,
+		    &dc->isDamped);
+		vBC = ES_LimitPN(vBC, u->VbcPrevIter, m->Vt, m->VcritR,
+		    &dc->isDamped);
 	}
+	vCE = vBE - vBC;
 
 	u->VbePrevIter = vBE;
 	u->VbcPrevIter = vBC;
+	u->evaluated = 1;
+
+	if (ES_BJTModelLookup(m, dc, vBE, vBC, &Ibf, &u->gPiF, &Ibr,
+	    &u->gPiR) == -1) {
+		Ibf = m->IbfSat*(M_Exp(vBE*m->VtInv) - 1.0);
+		Ibr = m->IbrSat*(M_Exp(vBC*m->VtInv) - 1.0);
+		u->gPiF = Ibf*m->VtInv;
+		u->gPiR = Ibr*m->VtInv;
+	}
+	Icc = (m->betaF*Ibf - m->betaR*Ibr)*(1.0 + vCE*m->VaInv);
 
-	Ibf = (u->Ifs/u->betaF)*(M_Exp(vBE/u->Vt) - 1.0);
-	Ibr = (u->Irs/u->betaR)*(M_Exp(vBC/u->Vt) - 1.0);
-	Icc = (u->betaF*Ibf - u->betaR*Ibr)*(1.0 + vCE/u->Va);
-
-	u->gPiF = Ibf/u->Vt;
-	u->gPiR = Ibr/u->Vt;
-
-	u->go = Icc/u->Va;
+	u->go = Icc*m->VaInv;
 
-	u->gmF = u->betaF*u->gPiF;
-	u->gmR = u->betaR*u->gPiR;
+	u->gmF = m->betaF*u->gPiF;
+	u->gmR = m->betaR*u->gPiR;
 
     	u->Ibf_eq = Ibf - u->gPiF*vBE;
 	u->Ibr_eq = Ibr - u->gPiR*vBC;
@@ -144,6 +257,9 @@ DC_SimBegin(void *obj, ES_SimDC *dc)
 	Uint e = PNODE(u,PORT_E);
 	Uint c = PNODE(u,PORT_C);
 
+	ES_ModelCardRelease(u->model);
+	u->model = ES_ModelCardGet(u, &esNPNModelClass);
+
 	InitStampConductance(b,e, u->sc_be, dc);
 	InitStampConductance(b,c, u->sc_bc, dc);
 	InitStampConductance(e,c, u->sc_ec, dc);
@@ -178,8 +294,13 @@ static void
 DC_StepIter(void *obj, ES_SimDC *dc)
 {
         ES_NPN *u = obj;
+	M_Real vBEnew = vBE(u), vBCnew = vBC(u);
 
-	UpdateModel(u,dc,vBE(u),vBC(u));
+	if (!ES_SimDCBypass(dc, u->evaluated &&
+	    ES_BypassCheck(vBEnew, u->VbePrevIter) &&
+	    ES_BypassCheck(vBCnew, u->VbcPrevIter))) {
+		UpdateModel(u,dc,vBEnew,vBCnew);
+	}
 	Stamp(u,dc);
 }
 
@@ -189,24 +310,20 @@ Init(void *p)
 	ES_NPN *u = p;
 
 	ES_InitPorts(u, esNPNPorts);
-
-	u->Vt = 0.025;
-	u->Va = 10.0;
-	u->betaF = 100.0;
-	u->betaR = 1.0;
-	u->Ifs = 1e-14;
-	u->Irs = 1e-14;
+	ES_ModelCardInitParams(u, &esNPNModelClass, u->params);
+	u->model = NULL;
 
 	COMPONENT(u)->dcSimBegin = DC_SimBegin;
 	COMPONENT(u)->dcStepBegin = DC_StepBegin;
 	COMPONENT(u)->dcStepIter = DC_StepIter;
+}
 
-	M_BindReal(u, "Vt",	&u->Vt);
-	M_BindReal(u, "Va",	&u->Va);
-	M_BindReal(u, "betaF",	&u->betaF);
-	M_BindReal(u, "betaR",	&u->betaR);
-	M_BindReal(u, "Ifs",	&u->Ifs);
-	M_BindReal(u, "Irs",	&u->Irs);
+static void
+Destroy(void *p)
+{
+	ES_NPN *u = p;
+
+	ES_ModelCardRelease(u->model);
 }
 
 static void *
@@ -214,13 +331,25 @@ Edit(void *p)
 {
 	ES_NPN *u = p;
 	AG_Box *box = AG_BoxNewVert(NULL, AG_BOX_EXPAND);
-
-	M_NumericalNewRealPNZ(box, 0, "V", _("Threshold voltage: "), &u->Vt);
-	M_NumericalNewRealPNZ(box, 0, "V", _("Early voltage: "), &u->Va);
-	M_NumericalNewRealPNZ(box, 0, NULL, _("Forward Beta: "), &u->betaF);
-	M_NumericalNewRealPNZ(box, 0, NULL, _("Reverse Beta: "), &u->betaR);
-	M_NumericalNewRealPNZ(box, 0, "pA", _("Forward Sat. Current: "), &u->Ifs);
-	M_NumericalNewRealPNZ(box, 0, "pA", _("Reverse Sat. Current: "), &u->Irs);
+	M_Real *v;
+
+	if ((v = ES_ModelCardParamPtr(u, "Vt")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, "V", _("Threshold voltage: "), v);
+	if ((v = ES_ModelCardParamPtr(u, "Va")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, "V", _("Early voltage: "), v);
+	if ((v = ES_ModelCardParamPtr(u, "betaF")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, NULL, _("Forward Beta: "), v);
+	if ((v = ES_ModelCardParamPtr(u, "betaR")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, NULL, _("Reverse Beta: "), v);
+	if ((v = ES_ModelCardParamPtr(u, "Ifs")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, "pA", _("Forward Sat. Current: "),
+		    v);
+	if ((v = ES_ModelCardParamPtr(u, "Irs")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, "pA", _("Reverse Sat. Current: "),
+		    v);
+	if ((v = ES_ModelCardParamPtr(u, "tableTol")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, NULL,
+		    _("Table model tolerance (0 = analytic): "), v);
 
 	return (box);
 }
@@ -233,7 +362,7 @@ ES_ComponentClass esNPNClass = {
 		{ 0,0 },
 		Init,
 		NULL,		/* reinit */
-		NULL,		/* destroy */
+		Destroy,
 		NULL,		/* load */
 		NULL,		/* save */
 		Edit		/* edit */
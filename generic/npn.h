@@ -1,12 +1,29 @@
 /*	Public domain	*/
 
+/* Bipolar transistor model card ("NPN" or "PNP"). */
+typedef struct es_bjt_model {
+	struct es_model_card _inherit;
+	M_Real Vt;			/* Thermal voltage */
+	M_Real Va;			/* Early voltage */
+	M_Real Ifs, Irs;		/* Saturation currents */
+	M_Real betaF, betaR;		/* Current gains */
+	M_Real VtInv, VaInv;		/* 1/Vt, 1/Va */
+	M_Real IbfSat, IbrSat;		/* Ifs/betaF, Irs/betaR */
+	M_Real VcritF, VcritR;		/* Critical voltages */
+	M_Real tableTol;		/* Table model tolerance (0 = analytic) */
+	ES_TableModel *tabF, *tabR;	/* Tabulated Ibf, Ibr (or NULL) */
+} ES_BJTModel;
+
+#define ES_BJT_NPARAMS 7		/* Entries in esBJTModelParams */
+
+#define ES_BJT_TABLE_VMIN -10.0		/* Lowest tabulated junction voltage */
+#define ES_BJT_TABLE_VOVER 0.5		/* Tabulated range above Vcrit */
+
 typedef struct es_npn {
 	struct es_component _inherit;
 
-	M_Real Vt;		/* Thermal voltage */
-	M_Real Va;		/* Early voltage */
-	M_Real Ifs,Irs;
-	M_Real betaF,betaR;		
+	ES_BJTModel *model;		/* Model card (during simulation) */
+	M_Real params[ES_BJT_NPARAMS];	/* Model parameters (bound) */
 
 	M_Real Ibf_eq;
 	M_Real Ibr_eq;
@@ -19,6 +36,7 @@ typedef struct es_npn {
 
 	M_Real VbePrevIter;
 	M_Real VbcPrevIter;
+	int evaluated;			/* Model is at PrevIter (bypass) */
 
 	StampConductanceData sc_be;
 	StampConductanceData sc_bc;
@@ -34,4 +52,11 @@ typedef struct es_npn {
 
 __BEGIN_DECLS
 extern ES_ComponentClass esNPNClass;
+extern const ES_ModelCardParam esBJTModelParams[];
+extern const ES_ModelCardClass esNPNModelClass;
+
+void ES_BJTModelDerive(void *);
+void ES_BJTModelDestroy(void *);
+int  ES_BJTModelLookup(const ES_BJTModel *, const ES_SimDC *, M_Real, M_Real,
+                       M_Real *, M_Real *, M_Real *, M_Real *);
 __END_DECLS
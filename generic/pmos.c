@@ -45,6 +45,14 @@ const ES_Port esPMOSPorts[] = {
 	{ -1 },
 };
 
+const ES_ModelCardClass esPMOSModelClass = {
+	"PMOS",
+	sizeof(ES_MOSModel),
+	esMOSModelParams,
+	ES_MOSModelDerive,
+	ES_MOSModelDestroy
+};
+
 static M_Real
 vSD(ES_PMOS *u)
 {
@@ -68,38 +76,38 @@ VsgPrevStep(ES_PMOS *u)
 }
 
 static void
-UpdateModel(ES_PMOS *u, M_Real vSG, M_Real vSD)
+UpdateModel(ES_PMOS *u, ES_SimDC *dc, M_Real vSG, M_Real vSD)
 {
+	const ES_MOSModel *m = u->model;
 	M_Real I;
 
-	if (vSG < u->Vt)
-	{
-		// Cutoff 
-
-		I = 0;
-		u->gm = 0;
-		u->go = 0;
-
-	}
-	else if ((vSG-u->Vt) < vSD)
-	{
-		// Saturation
-
-		M_Real vSat = vSG-u->Vt;
-
-		I=(u->K)/2*vSat*vSat*(1+(vSD-vSat)/u->Va);
-		u->gm=sqrt(2*(u->K)*I);
-		u->go=I/(u->Va);
-
+	if (!(dc->flags & ES_SIMDC_NO_LIMIT)) {
+		vSG = ES_LimitFET(vSG, u->vSGPrevIter, m->Vt, &dc->isDamped);
+		vSD = ES_LimitVDS(vSD, u->vSDPrevIter, &dc->isDamped);
 	}
-	else
-	{
-		// Triode
-		
-		I=(u->K)*((vSG-(u->Vt))-vSD/2)*vSD;
-		u->gm=(u->K)*vSD;
-		u->go=(u->K)*((vSG-(u->Vt))-vSD);
-
+	u->vSGPrevIter = vSG;
+	u->vSDPrevIter = vSD;
+	u->evaluated = 1;
+
+	if (ES_MOSModelLookup(m, dc, vSG, vSD, &I, &u->gm, &u->go) == -1) {
+		/* Not tabulated; evaluate the analytic model. */
+		if (vSG < m->Vt) {				/* Cutoff */
+			I = 0;
+			u->gm = 0;
+			u->go = 0;
+		} else if ((vSG-m->Vt) < vSD) {			/* Saturation */
+			M_Real vSat = vSG-m->Vt;
+			M_Real a = 1.0 + (vSD-vSat)*m->VaInv;
+
+			/* Exact derivatives, including channel-length terms. */
+			I = m->Khalf*vSat*vSat*a;
+			u->gm = m->K*vSat*a - m->Khalf*vSat*vSat*m->VaInv;
+			u->go = m->Khalf*vSat*vSat*m->VaInv;
+		} else {					/* Triode */
+			I = (m->K)*((vSG-(m->Vt))-vSD/2)*vSD;
+			u->gm = (m->K)*vSD;
+			u->go = (m->K)*((vSG-(m->Vt))-vSD);
+		}
 	}
 
 	u->Ieq = I - u->gm*vSG - u->go*vSD;
@@ -122,6 +130,9 @@ DC_SimBegin(void *obj, ES_SimDC *dc)
 	Uint d = PNODE(u,PORT_D);
 	Uint s = PNODE(u,PORT_S);
 
+	ES_ModelCardRelease(u->model);
+	u->model = ES_ModelCardGet(u, &esPMOSModelClass);
+
 	InitStampVCCS(s,g,s,d,u->s_vccs, dc);
 	InitStampConductance(s,d,u->s_conductance, dc);
 	InitStampCurrentSource(d,s, u->s_current, dc);
@@ -129,6 +140,9 @@ DC_SimBegin(void *obj, ES_SimDC *dc)
 	u->gm=0.0;
 	u->go=1.0;
 	u->Ieq=0.0;
+	u->vSGPrevIter=0.0;
+	u->vSDPrevIter=0.0;
+	u->evaluated=0;
 	Stamp(u,dc);
 	return (0);
 }
@@ -138,7 +152,9 @@ DC_StepBegin(void *obj, ES_SimDC *dc)
 {
 	ES_PMOS *u = obj;
 
-	UpdateModel(u,VsgPrevStep(u),VsdPrevStep(u));
+	u->vSGPrevIter = VsgPrevStep(u);
+	u->vSDPrevIter = VsdPrevStep(u);
+	UpdateModel(u,dc,VsgPrevStep(u),VsdPrevStep(u));
 	Stamp(u,dc);
 
 }
@@ -147,8 +163,13 @@ static void
 DC_StepIter(void *obj, ES_SimDC *dc)
 {
         ES_PMOS *u = obj;
+	M_Real vSGnew = vSG(u), vSDnew = vSD(u);
 
-	UpdateModel(u,vSG(u),vSD(u));
+	if (!ES_SimDCBypass(dc, u->evaluated &&
+	    ES_BypassCheck(vSGnew, u->vSGPrevIter) &&
+	    ES_BypassCheck(vSDnew, u->vSDPrevIter))) {
+		UpdateModel(u,dc,vSGnew,vSDnew);
+	}
 	Stamp(u,dc);
 }
 
@@ -158,17 +179,20 @@ Init(void *p)
 	ES_PMOS *u = p;
 
 	ES_InitPorts(u, esPMOSPorts);
-	u->Vt = 0.5;
-	u->Va = 10;
-	u->K = 1e-3;
+	ES_ModelCardInitParams(u, &esPMOSModelClass, u->params);
+	u->model = NULL;
 
 	COMPONENT(u)->dcSimBegin = DC_SimBegin;
 	COMPONENT(u)->dcStepBegin = DC_StepBegin;
 	COMPONENT(u)->dcStepIter = DC_StepIter;
+}
 
-	M_BindReal(u, "Vt", &u->Vt);
-	M_BindReal(u, "Va", &u->Va);
-	M_BindReal(u, "K", &u->K);
+static void
+Destroy(void *p)
+{
+	ES_PMOS *u = p;
+
+	ES_ModelCardRelease(u->model);
 }
 
 static void *
@@ -176,10 +200,17 @@ Edit(void *p)
 {
 	ES_PMOS *u = p;
 	AG_Box *box = AG_BoxNewVert(NULL, AG_BOX_EXPAND);
-
-	M_NumericalNewRealPNZ(box, 0, "V", _("Threshold voltage: "), &u->Vt);
-	M_NumericalNewRealPNZ(box, 0, "V", _("Early voltage: "), &u->Va);
-	M_NumericalNewRealPNZ(box, 0, NULL, _("K: "), &u->K);
+	M_Real *v;
+
+	if ((v = ES_ModelCardParamPtr(u, "Vt")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, "V", _("Threshold voltage: "), v);
+	if ((v = ES_ModelCardParamPtr(u, "Va")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, "V", _("Early voltage: "), v);
+	if ((v = ES_ModelCardParamPtr(u, "K")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, NULL, _("K: "), v);
+	if ((v = ES_ModelCardParamPtr(u, "tableTol")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, NULL,
+		    _("Table model tolerance (0 = analytic): "), v);
 
 	return (box);
 }
@@ -192,7 +223,7 @@ ES_ComponentClass esPMOSClass = {
 		{ 0,0 },
 		Init,
 		NULL,		/* reinit */
-		NULL,		/* destroy */
+		Destroy,
 		NULL,		/* load */
 		NULL,		/* save */
 		Edit		/* edit */
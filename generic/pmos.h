@@ -2,12 +2,13 @@
 
 typedef struct es_pmos {
 	struct es_component _inherit;
-	M_Real Vt;			/* Threshold voltage */
-	M_Real Va;			/* Early voltage */
-	M_Real K;			/* K-value */
+	ES_MOSModel *model;		/* Model card (during simulation) */
+	M_Real params[ES_MOS_NPARAMS];	/* Model parameters (bound) */
 	M_Real Ieq;
 	M_Real gm;
 	M_Real go;
+	M_Real vSGPrevIter, vSDPrevIter;
+	int evaluated;			/* Model is at PrevIter (bypass) */
 	StampVCCSData s_vccs;
 	StampConductanceData s_conductance;
 	StampCurrentSourceData s_current;
@@ -15,4 +16,5 @@ typedef struct es_pmos {
 
 __BEGIN_DECLS
 extern ES_ComponentClass esPMOSClass;
+extern const ES_ModelCardClass esPMOSModelClass;
 __END_DECLS
@@ -45,6 +45,14 @@ const ES_Port esPNPPorts[] = {
 	{ -1 },
 };
 
+const ES_ModelCardClass esPNPModelClass = {
+	"PNP",
+	sizeof(ES_BJTModel),
+	esBJTModelParams,
+	ES_BJTModelDerive,
+	ES_BJTModelDestroy
+};
+
 static M_Real
 vEB(ES_PNP *u)
 {
@@ -82,43 +90,45 @@ ResetModel(ES_PNP *u)
 
 	u->VebPrevIter = 0.7;
 	u->VcbPrevIter = 0.7;
+	u->evaluated = 0;
 }
 
 static void
 UpdateModel(ES_PNP *u, ES_SimDC *dc, M_Real vEB, M_Real vCB)
 {
-	M_Real vEC=vEB-vCB;
-
-	M_Real VebDiff = vEB - u->VebPrevIter;
-	M_Real VcbDiff = vCB - u->VcbPrevIter;
-
-	if (M_Fabs(VebDiff) > u->Vt)
-	{
-		vEB = u->VebPrevIter + M_Fabs(VebDiff)/VebDiff*u->Vt;
-		dc->isDamped = 1;
-	}
+	const ES_BJTModel *m = u->model;
+	M_Real vEC;
+	M_Real Ibf, Ibr, Icc;
 
-	if (M_Fabs(VcbDiff) > u->Vt)
-	{
-		vCB = u->VcbPrevIter + M_Fabs(VcbDiff)/VcbDiff*u->Vt;
-		dc->isDamped = 1;
+	if (dc->flags & ES_SIMDC_NO_LIMIT) {
+		vEB = ES_LimitStep(vEB, u->VebPrevIter, m->Vt, &dc->isDamped);
+		vCB = ES_LimitStep(vCB, u->VcbPrevIter, m->Vt, &dc->isDamped);
+	} else {
+		vEB = ES_LimitPN(vEB, u->VebPrevIter, m->Vt, m->VcritF,
+		    &dc->isDamped);
+		vCB = ES_LimitPN(vCB, u->VcbPrevIter, m->Vt, m->VcritR,
+		    &dc->isDamped);
 	}
+	vEC = vEB-vCB;
 
 	u->VebPrevIter = vEB;
 	u->VcbPrevIter = vCB;
+	u->evaluated = 1;
+
+	if (ES_BJTModelLookup(m, dc, vEB, vCB, &Ibf, &u->gPiF, &Ibr,
+	    &u->gPiR) == -1) {
+		Ibf = m->IbfSat*(M_Exp(vEB*m->VtInv)-1);
+		Ibr = m->IbrSat*(M_Exp(vCB*m->VtInv)-1);
+		u->gPiF = Ibf*m->VtInv;
+		u->gPiR = Ibr*m->VtInv;
+	}
 
-	M_Real Ibf = (u->Ifs/u->betaF)*(M_Exp(vEB/u->Vt)-1);
-	M_Real Ibr = (u->Irs/u->betaR)*(M_Exp(vCB/u->Vt)-1);
-
-	M_Real Icc = (u->betaF*Ibf-u->betaR*Ibr)*(1+vEC/u->Va);
-
-	u->gPiF = Ibf/u->Vt;
-	u->gPiR = Ibr/u->Vt;
+	Icc = (m->betaF*Ibf-m->betaR*Ibr)*(1+vEC*m->VaInv);
 
-	u->go = Icc/u->Va;
+	u->go = Icc*m->VaInv;
 
-	u->gmF = u->betaF*u->gPiF;
-	u->gmR = u->betaR*u->gPiR;
+	u->gmF = m->betaF*u->gPiF;
+	u->gmR = m->betaR*u->gPiR;
 
     	u->Ibf_eq = Ibf - u->gPiF*vEB;
 	u->Ibr_eq = Ibr - u->gPiR*vCB;
@@ -146,6 +156,9 @@ DC_SimBegin(void *obj, ES_SimDC *dc)
 	Uint e = PNODE(u,PORT_E);
 	Uint c = PNODE(u,PORT_C);
 
+	ES_ModelCardRelease(u->model);
+	u->model = ES_ModelCardGet(u, &esPNPModelClass);
+
 	InitStampConductance(b,e, u->sc_be, dc);
 	InitStampConductance(b,c, u->sc_bc, dc);
 	InitStampConductance(e,c, u->sc_ec, dc);
@@ -179,8 +192,13 @@ static void
 DC_StepIter(void *obj, ES_SimDC *dc)
 {
         ES_PNP *u = obj;
+	M_Real vEBnew = vEB(u), vCBnew = vCB(u);
 
-	UpdateModel(u,dc,vEB(u),vCB(u));
+	if (!ES_SimDCBypass(dc, u->evaluated &&
+	    ES_BypassCheck(vEBnew, u->VebPrevIter) &&
+	    ES_BypassCheck(vCBnew, u->VcbPrevIter))) {
+		UpdateModel(u,dc,vEBnew,vCBnew);
+	}
 	Stamp(u,dc);
 }
 
@@ -190,24 +208,20 @@ Init(void *p)
 	ES_PNP *u = p;
 
 	ES_InitPorts(u, esPNPPorts);
-
-	u->Vt = 0.025;
-	u->Va = 10.0;
-	u->betaF = 100.0;
-	u->betaR = 1.0;
-	u->Ifs = 1e-14;
-	u->Irs = 1e-14;
+	ES_ModelCardInitParams(u, &esPNPModelClass, u->params);
+	u->model = NULL;
 
 	COMPONENT(u)->dcSimBegin = DC_SimBegin;
 	COMPONENT(u)->dcStepBegin = DC_StepBegin;
 	COMPONENT(u)->dcStepIter = DC_StepIter;
+}
 
-	M_BindReal(u, "Vt",	&u->Vt);
-	M_BindReal(u, "Va",	&u->Va);
-	M_BindReal(u, "betaF",	&u->betaF);
-	M_BindReal(u, "betaR",	&u->betaR);
-	M_BindReal(u, "Ifs",	&u->Ifs);
-	M_BindReal(u, "Irs",	&u->Irs);
+static void
+Destroy(void *p)
+{
+	ES_PNP *u = p;
+
+	ES_ModelCardRelease(u->model);
 }
 
 static void *
@@ -215,13 +229,25 @@ Edit(void *p)
 {
 	ES_PNP *u = p;
 	AG_Box *box = AG_BoxNewVert(NULL, AG_BOX_EXPAND);
-
-	M_NumericalNewRealPNZ(box, 0, "V", _("Thermal voltage: "), &u->Vt);
-	M_NumericalNewRealPNZ(box, 0, "V", _("Early voltage: "), &u->Va);
-	M_NumericalNewRealPNZ(box, 0, NULL, _("Forward Beta: "), &u->betaF);
-	M_NumericalNewRealPNZ(box, 0, NULL, _("Reverse Beta: "), &u->betaR);
-	M_NumericalNewRealPNZ(box, 0, "pA", _("Forward Sat. Current: "), &u->Ifs);
-	M_NumericalNewRealPNZ(box, 0, "pA", _("Reverse Sat. Current: "), &u->Irs);
+	M_Real *v;
+
+	if ((v = ES_ModelCardParamPtr(u, "Vt")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, "V", _("Thermal voltage: "), v);
+	if ((v = ES_ModelCardParamPtr(u, "Va")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, "V", _("Early voltage: "), v);
+	if ((v = ES_ModelCardParamPtr(u, "betaF")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, NULL, _("Forward Beta: "), v);
+	if ((v = ES_ModelCardParamPtr(u, "betaR")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, NULL, _("Reverse Beta: "), v);
+	if ((v = ES_ModelCardParamPtr(u, "Ifs")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, "pA", _("Forward Sat. Current: "),
+		    v);
+	if ((v = ES_ModelCardParamPtr(u, "Irs")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, "pA", _("Reverse Sat. Current: "),
+		    v);
+	if ((v = ES_ModelCardParamPtr(u, "tableTol")) != NULL)
+		M_NumericalNewRealPNZ(box, 0, NULL,
+		    _("Table model tolerance (0 = analytic): "), v);
 
 	return (box);
 }
@@ -234,7 +260,7 @@ ES_ComponentClass esPNPClass = {
 		{ 0,0 },
 		Init,
 		NULL,		/* reinit */
-		NULL,		/* destroy */
+		Destroy,
 		NULL,		/* load */
 		NULL,		/* save */
 		Edit		/* edit */
@@ -3,10 +3,8 @@
 typedef struct es_pnp {
 	struct es_component _inherit;
 
-	M_Real Vt;			/* Thermal voltage */
-	M_Real Va;			/* Early voltage */
-	M_Real Ifs, Irs;
-	M_Real betaF, betaR;		
+	ES_BJTModel *model;		/* Model card (during simulation) */
+	M_Real params[ES_BJT_NPARAMS];	/* Model parameters (bound) */
 
 	M_Real Ibf_eq;
 	M_Real Ibr_eq;
@@ -19,6 +17,7 @@ typedef struct es_pnp {
 
 	M_Real VebPrevIter;
 	M_Real VcbPrevIter;
+	int evaluated;			/* Model is at PrevIter (bypass) */
 
 	StampConductanceData sc_be;
 	StampConductanceData sc_bc;
@@ -34,4 +33,5 @@ typedef struct es_pnp {
 
 __BEGIN_DECLS
 extern ES_ComponentClass esPNPClass;
+extern const ES_ModelCardClass esPNPModelClass;
 __END_DECLS
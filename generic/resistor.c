@@ -57,9 +57,11 @@ Export(void *p, enum circuit_format fmt, FILE *f)
 	return (0);
 }
 
+/* Compute the conductance at the circuit temperature. */
 static void
-UpdateModel(ES_Resistor *r, ES_SimDC *dc)
+DC_TempUpdate(void *obj, ES_SimDC *dc)
 {
+	ES_Resistor *r = obj;
 	M_Real dT = dc->T0 - COMPONENT(r)->Tspec;
 
 	r->g = 1.0/(r->R*(1.0 + r->Tc1*dT + r->Tc2*dT*dT));
@@ -83,7 +85,7 @@ DC_SimBegin(void *obj, ES_SimDC *dc)
 		return (-1);
 	}
 	InitStampConductance(k, j, r->s, dc);
-	UpdateModel(r, dc);
+	DC_TempUpdate(r, dc);
 	Stamp(r, dc);
 	return (0);
 }
@@ -115,8 +117,10 @@ Init(void *p)
 	r->Tc1 = 0.0;
 	r->Tc2 = 0.0;
 	COMPONENT(r)->dcSimBegin = DC_SimBegin;
+	COMPONENT(r)->dcTempUpdate = DC_TempUpdate;
 	COMPONENT(r)->dcStepBegin = DC_StepBegin;
 	COMPONENT(r)->dcStepIter = DC_StepIter;
+	COMPONENT(r)->flags |= ES_COMPONENT_LINEAR;
 
 	M_BindReal(r, "R",	&r->R);
 	M_BindReal(r, "Pmax",	&r->Pmax);
@@ -39,6 +39,16 @@ const ES_Port esSemiResistorPorts[] = {
 	{ -1 },
 };
 
+/* Compute the conductance at the circuit temperature. */
+static void
+DC_TempUpdate(void *obj, ES_SimDC *dc)
+{
+	ES_SemiResistor *r = obj;
+	M_Real dT = dc->T0 - COMPONENT(r)->Tspec;
+
+	r->g = 1.0/(r->rEff * (1.0 + r->Tc1*dT + r->Tc2*dT*dT));
+}
+
 /* Compute the effective resistance from the parameters. */
 static int
 DC_SimBegin(void *obj, ES_SimDC *dc)
@@ -58,30 +68,24 @@ DC_SimBegin(void *obj, ES_SimDC *dc)
 	}
 
 	InitStampConductance(k, j, r->s, dc);
+	DC_TempUpdate(r, dc);
 	return (0);
 }
 
-/* TODO : move computations out of the loop */
 static void
 DC_StepBegin(void *obj, ES_SimDC *dc)
 {
 	ES_SemiResistor *r = obj;
-	M_Real dT = dc->T0 - COMPONENT(r)->Tspec;
-	M_Real g;
 
-	g = 1.0/(r->rEff * (1.0 + r->Tc1*dT + r->Tc2*dT*dT));	
-	StampConductance(g,r->s);
+	StampConductance(r->g,r->s);
 }
 
 static void
 DC_StepIter(void *obj, ES_SimDC *dc)
 {
 	ES_SemiResistor *r = obj;
-	M_Real dT = dc->T0 - COMPONENT(r)->Tspec;
-	M_Real g;
 
-	g = 1.0/(r->rEff * (1.0 + r->Tc1*dT + r->Tc2*dT*dT));	
-	StampConductance(g,r->s);
+	StampConductance(r->g,r->s);
 }
 
 static void
@@ -97,9 +101,12 @@ Init(void *p)
 	r->Tc1 = 0.0;
 	r->Tc2 = 0.0;
 	r->rEff = 0.0;
+	r->g = 0.0;
 	COMPONENT(r)->dcSimBegin = DC_SimBegin;
+	COMPONENT(r)->dcTempUpdate = DC_TempUpdate;
 	COMPONENT(r)->dcStepBegin = DC_StepBegin;
 	COMPONENT(r)->dcStepIter = DC_StepIter;
+	COMPONENT(r)->flags |= ES_COMPONENT_LINEAR;
 
 	M_BindReal(r, "l", &r->l);
 	M_BindReal(r, "w", &r->w);
@@ -113,7 +120,6 @@ static int
 Export(void *p, enum circuit_format fmt, FILE *f)
 {
 	ES_SemiResistor *r = p;
-	static int nRmod = 1;
 
 	if (PNODE(r,1) == -1 ||
 	    PNODE(r,2) == -1)
@@ -121,13 +127,13 @@ Export(void *p, enum circuit_format fmt, FILE *f)
 	
 	switch (fmt) {
 	case CIRCUIT_SPICE3:
-		fprintf(f, ".MODEL Rmod%u R "
+		/* Model name is derived from the (unique) component name. */
+		fprintf(f, ".MODEL Rmod_%s R "
 		           "(tc1=%g tc2=%g rsh=%g narrow=%g)\n",
-		    nRmod, r->Tc1, r->Tc2, r->rSh, r->narrow);
-		fprintf(f, "%s %d %d Rmod%u L=%g W=%g TEMP=%g\n",
+		    OBJECT(r)->name, r->Tc1, r->Tc2, r->rSh, r->narrow);
+		fprintf(f, "%s %d %d Rmod_%s L=%g W=%g TEMP=%g\n",
 		    OBJECT(r)->name, PNODE(r,1), PNODE(r,2),
-		    nRmod, r->l, r->w, COMPONENT(r)->Tspec);
-		nRmod++;
+		    OBJECT(r)->name, r->l, r->w, COMPONENT(r)->Tspec);
 		break;
 	}
 	return (0);
@@ -7,6 +7,7 @@ typedef struct es_semiresistor {
 	M_Real narrow;			/* Narrowing due to side etching */
 	M_Real Tc1, Tc2;		/* Resistance/temperature coefficients */
 	M_Real rEff;			/* Effective resistance */
+	M_Real g;			/* Conductance at circuit temperature */
 	StampConductanceData s;
 } ES_SemiResistor;
 
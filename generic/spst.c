@@ -95,6 +95,7 @@ Init(void *p)
 	COMPONENT(sw)->dcSimBegin = DC_SimBegin;
 	COMPONENT(sw)->dcStepBegin = DC_StepBegin;
 	COMPONENT(sw)->dcStepIter = DC_StepIter;
+	COMPONENT(sw)->flags |= ES_COMPONENT_LINEAR;
 
 	M_BindReal(sw, "Ron", &sw->Ron);
 	M_BindReal(sw, "Roff", &sw->Roff);
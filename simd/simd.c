@@ -0,0 +1,878 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * edacious-simd: Long-running simulation job server. Initialization and
+ * class registration are done once, parsed circuits are cached (keyed by
+ * path and modification time) and jobs received over a Unix domain socket
+ * are run by a pool of worker threads. With -C, act as a client and
+ * print the results in the same format as transient(1).
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE			/* For struct ucred */
+#endif
+#include <core/core.h>
+
+#include "simd.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <agar/config/ag_threads.h>
+
+/* Parsed circuit in the cache, kept in serialized form. */
+typedef struct cached_circuit {
+	char path[ES_SIMD_PATH_MAX];	/* Circuit file */
+	time_t mtime;			/* Modification time of file */
+	off_t size;			/* Size of file */
+	Uint8 *image;			/* Serialized circuit */
+	size_t imageSize;
+	Uint nRefs;			/* Jobs using the image */
+	int stale;			/* Free when no longer referenced */
+	Uint32 lastUse;			/* For LRU replacement */
+	TAILQ_ENTRY(cached_circuit) circuits;
+} CachedCircuit;
+
+#define QUEUE_MAX 64			/* Max pending connections */
+
+static TAILQ_HEAD(,cached_circuit) cache = TAILQ_HEAD_INITIALIZER(cache);
+static Uint nCached = 0, cacheMax = 64;
+static Uint32 cacheTick = 0;
+static AG_Mutex cacheLock;
+
+#ifdef AG_THREADS
+static int queue[QUEUE_MAX];		/* Accepted connections */
+static Uint queueHead = 0, queueCount = 0;
+static AG_Mutex queueLock;
+static AG_Cond queueNotEmpty, queueNotFull;
+#endif
+
+static Uint idleTimeout = 30;		/* Close idle connections (s) */
+static volatile sig_atomic_t doExit = 0;
+
+static void
+printusage(void)
+{
+	fprintf(stderr, "Usage: edacious-simd [-s socket] [-j workers] "
+	                "[-c cacheSize] [-i idleTimeout]\n"
+	                "       edacious-simd -C [-HN] [-s socket] [-t tStop] "
+	                "[-n maxSteps] [file] [var1] [var2] [...]\n");
+	exit(1);
+}
+
+static void
+SigTerm(int sig)
+{
+	doExit = 1;
+}
+
+/* Read exactly len bytes from fd. */
+static int
+ReadFull(int fd, void *buf, size_t len)
+{
+	Uint8 *p = buf;
+	ssize_t rv;
+
+	while (len > 0) {
+		if ((rv = read(fd, p, len)) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			AG_SetError("read: %s", strerror(errno));
+			return (-1);
+		} else if (rv == 0) {
+			AG_SetError("read: Unexpected EOF");
+			return (-1);
+		}
+		p += rv;
+		len -= rv;
+	}
+	return (0);
+}
+
+/* Write exactly len bytes to fd. */
+static int
+WriteFull(int fd, const void *buf, size_t len)
+{
+	const Uint8 *p = buf;
+	ssize_t rv;
+
+	while (len > 0) {
+		if ((rv = write(fd, p, len)) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			AG_SetError("write: %s", strerror(errno));
+			return (-1);
+		}
+		p += rv;
+		len -= rv;
+	}
+	return (0);
+}
+
+static int
+WriteReply(int fd, int status, Uint nCols, const char *msg)
+{
+	ES_SimdReply rep;
+
+	rep.magic = ES_SIMD_REPLY_MAGIC;
+	rep.status = (Sint32)status;
+	rep.nCols = (Uint32)nCols;
+	rep.msgLen = (msg != NULL) ? (Uint32)strlen(msg) : 0;
+	if (WriteFull(fd, &rep, sizeof(rep)) == -1 ||
+	    WriteFull(fd, msg, rep.msgLen) == -1) {
+		return (-1);
+	}
+	return (0);
+}
+
+/* Serialize a circuit into a newly allocated image. */
+static Uint8 *
+SerializeCircuit(ES_Circuit *ckt, size_t *size)
+{
+	AG_DataSource *ds;
+	Uint8 *image;
+
+	if ((ds = AG_OpenAutoCore()) == NULL) {
+		return (NULL);
+	}
+	if (AG_ObjectSerialize(ckt, ds) == -1) {
+		AG_CloseDataSource(ds);
+		return (NULL);
+	}
+	*size = AG_CORE_SOURCE(ds)->size;
+	image = Malloc(*size);
+	memcpy(image, AG_CORE_SOURCE(ds)->data, *size);
+	AG_CloseDataSource(ds);
+	return (image);
+}
+
+/* Instantiate a private circuit from a serialized image. */
+static ES_Circuit *
+UnserializeCircuit(const Uint8 *image, size_t size)
+{
+	ES_Circuit *ckt;
+	AG_DataSource *ds;
+
+	if ((ds = AG_OpenConstCore(image, size)) == NULL) {
+		return (NULL);
+	}
+	ckt = AG_ObjectNew(NULL, NULL, &esCircuitClass);
+	ckt->flags |= ES_CIRCUIT_HEADLESS;
+	if (AG_ObjectUnserialize(ckt, ds) == -1) {
+		AG_CloseDataSource(ds);
+		AG_ObjectDestroy(ckt);
+		return (NULL);
+	}
+	AG_CloseDataSource(ds);
+	return (ckt);
+}
+
+static void
+FreeCachedCircuit(CachedCircuit *cc)
+{
+	Free(cc->image);
+	free(cc);
+}
+
+/* Drop a reference to a cached circuit (cacheLock held). */
+static void
+ReleaseCachedCircuit(CachedCircuit *cc)
+{
+	if (--cc->nRefs == 0 && cc->stale)
+		FreeCachedCircuit(cc);
+}
+
+/*
+ * Return a referenced cache entry for the given circuit file, loading and
+ * serializing the circuit if it is not cached or its file has changed.
+ */
+static CachedCircuit *
+GetCachedCircuit(const char *path, int noCache)
+{
+	CachedCircuit *cc, *ccOld, *ccLRU;
+	struct stat sb;
+	ES_Circuit *ckt;
+
+	if (stat(path, &sb) == -1) {
+		AG_SetError("%s: %s", path, strerror(errno));
+		return (NULL);
+	}
+	AG_MutexLock(&cacheLock);
+	TAILQ_FOREACH(cc, &cache, circuits) {
+		if (strcmp(cc->path, path) == 0)
+			break;
+	}
+	if (cc != NULL) {
+		if (!noCache &&
+		    cc->mtime == sb.st_mtime && cc->size == sb.st_size) {
+			cc->nRefs++;
+			cc->lastUse = ++cacheTick;
+			AG_MutexUnlock(&cacheLock);
+			return (cc);
+		}
+		TAILQ_REMOVE(&cache, cc, circuits);	/* Out of date */
+		nCached--;
+		if (cc->nRefs == 0) {
+			FreeCachedCircuit(cc);
+		} else {
+			cc->stale = 1;
+		}
+	}
+	AG_MutexUnlock(&cacheLock);
+
+	/* Load the circuit outside of the lock. */
+	cc = Malloc(sizeof(CachedCircuit));
+	Strlcpy(cc->path, path, sizeof(cc->path));
+	cc->mtime = sb.st_mtime;
+	cc->size = sb.st_size;
+	cc->nRefs = 1;
+	cc->stale = noCache;
+	ckt = AG_ObjectNew(NULL, NULL, &esCircuitClass);
+	ckt->flags |= ES_CIRCUIT_HEADLESS;
+	if (AG_ObjectLoadFromFile(ckt, path) == -1 ||
+	    (cc->image = SerializeCircuit(ckt, &cc->imageSize)) == NULL) {
+		AG_ObjectDestroy(ckt);
+		free(cc);
+		return (NULL);
+	}
+	AG_ObjectDestroy(ckt);
+	if (noCache)
+		return (cc);
+
+	AG_MutexLock(&cacheLock);
+	TAILQ_FOREACH(ccOld, &cache, circuits) {	/* Loaded concurrently */
+		if (strcmp(ccOld->path, path) == 0)
+			break;
+	}
+	if (ccOld == NULL && nCached >= cacheMax) {
+		TAILQ_FOREACH(ccLRU, &cache, circuits) {
+			if (ccOld == NULL || ccLRU->lastUse < ccOld->lastUse)
+				ccOld = ccLRU;
+		}
+	}
+	if (ccOld != NULL) {
+		TAILQ_REMOVE(&cache, ccOld, circuits);
+		nCached--;
+		if (ccOld->nRefs == 0) {
+			FreeCachedCircuit(ccOld);
+		} else {
+			ccOld->stale = 1;
+		}
+	}
+	cc->lastUse = ++cacheTick;
+	TAILQ_INSERT_HEAD(&cache, cc, circuits);
+	nCached++;
+	AG_MutexUnlock(&cacheLock);
+	return (cc);
+}
+
+/* Results being streamed back to a client. */
+typedef struct simd_job {
+	int fd;				/* Client connection */
+	Uint nCols;			/* Values per row */
+	double *block;			/* Pending rows */
+	Uint nRows;
+	int replied;			/* Reply header was sent */
+	int ioError;			/* Connection failed */
+} SimdJob;
+
+static int
+FlushBlock(SimdJob *job)
+{
+	Uint32 n = job->nRows;
+
+	if (WriteFull(job->fd, &n, sizeof(n)) == -1 ||
+	    WriteFull(job->fd, job->block, n*job->nCols*sizeof(double)) == -1)
+		return (-1);
+
+	job->nRows = 0;
+	return (0);
+}
+
+static int
+StreamSample(ES_Run *run, M_Real t, const M_Real *v, void *arg)
+{
+	SimdJob *job = arg;
+	double *row;
+	Uint k;
+
+	if (!job->replied) {
+		if (WriteReply(job->fd, 0, job->nCols, NULL) == -1) {
+			job->ioError = 1;
+			return (1);
+		}
+		job->replied = 1;
+	}
+	row = &job->block[job->nRows*job->nCols];
+	row[0] = (double)t;
+	for (k = 0; k < run->nProbes; k++) {
+		row[1+k] = (double)v[k];
+	}
+	if (++job->nRows == ES_SIMD_BLOCK_ROWS &&
+	    FlushBlock(job) == -1) {
+		job->ioError = 1;
+		return (1);
+	}
+	return (0);
+}
+
+/*
+ * Run a transient analysis and stream the probed values. Returns -1 if
+ * the connection is no longer usable.
+ */
+static int
+RunTransient(int fd, const ES_SimdRequest *req, ES_Circuit *ckt,
+    const char *probeNames)
+{
+	SimdJob job;
+	ES_Run *run;
+	const char *s;
+	Uint i;
+	int rv = -1, status;
+
+	run = ES_RunNew(ckt);
+	for (i = 0, s = probeNames; i < req->nProbes; i++, s += strlen(s)+1) {
+		if (ES_RunAddProbe(run, s) == -1) {
+			ES_RunClose(run);
+			return WriteReply(fd, -1, 0, AG_GetError());
+		}
+	}
+	ES_RunSetStop(run, (M_Real)req->tStop, req->maxSteps);
+	ES_RunSetSampleFn(run, StreamSample, &job);
+
+	job.fd = fd;
+	job.nCols = req->nProbes + 1;
+	job.block = Malloc(ES_SIMD_BLOCK_ROWS*job.nCols*sizeof(double));
+	job.nRows = 0;
+	job.replied = 0;
+	job.ioError = 0;
+
+	status = ES_RunExec(run);
+	if (job.ioError) {
+		goto out;
+	}
+	if (!job.replied) {				/* Failed to start */
+		rv = WriteReply(fd, -1, 0, AG_GetError());
+		goto out;
+	}
+	if ((job.nRows > 0 && FlushBlock(&job) == -1) ||
+	    FlushBlock(&job) == -1 ||			/* End of results */
+	    WriteReply(fd, status, job.nCols,
+	    (status == 0) ? NULL : AG_GetError()) == -1) {
+		goto out;
+	}
+	rv = 0;
+out:
+	free(job.block);
+	ES_RunClose(run);
+	return (rv);
+}
+
+/* Read and process one request. Returns -1 to close the connection. */
+static int
+ProcessRequest(int fd, const ES_SimdRequest *req)
+{
+	char path[ES_SIMD_PATH_MAX];
+	CachedCircuit *cc;
+	ES_Circuit *ckt;
+	char *data, *probeNames;
+	const char *s;
+	size_t len;
+	Uint i;
+	int rv;
+
+	if (req->magic != ES_SIMD_REQUEST_MAGIC) {
+		WriteReply(fd, -1, 0, "Bad request");
+		return (-1);
+	}
+	if (req->pathLen >= ES_SIMD_PATH_MAX ||
+	    req->imageLen > ES_SIMD_IMAGE_MAX ||
+	    req->nProbes > ES_SIMD_PROBES_MAX ||
+	    req->probesLen > ES_SIMD_PROBES_MAX*(ESCIRCUIT_SYM_MAX+2)) {
+		WriteReply(fd, -1, 0, "Request too large");
+		return (-1);
+	}
+	if (ReadFull(fd, path, req->pathLen) == -1) {
+		return (-1);
+	}
+	path[req->pathLen] = '\0';
+	len = req->imageLen + req->probesLen;
+	data = Malloc(len + 1);
+	if (ReadFull(fd, data, len) == -1) {
+		free(data);
+		return (-1);
+	}
+	data[len] = '\0';
+	probeNames = &data[req->imageLen];
+
+	/* The probe block must hold nProbes NUL-terminated names. */
+	for (i = 0, s = probeNames; i < req->nProbes; i++, s += strlen(s)+1) {
+		if (s >= &data[len]) {
+			free(data);
+			return WriteReply(fd, -1, 0, "Bad probe list");
+		}
+	}
+	if (req->analysis != ES_SIMD_TRANSIENT) {
+		free(data);
+		return WriteReply(fd, -1, 0, "No such analysis");
+	}
+	if (req->maxSteps == 0 && req->tStop <= 0.0) {
+		free(data);
+		return WriteReply(fd, -1, 0, "No stop condition");
+	}
+
+	if (req->imageLen > 0) {
+		ckt = UnserializeCircuit((Uint8 *)data, req->imageLen);
+	} else {
+		if ((cc = GetCachedCircuit(path,
+		    (req->flags & ES_SIMD_NOCACHE))) == NULL) {
+			free(data);
+			return WriteReply(fd, -1, 0, AG_GetError());
+		}
+		ckt = UnserializeCircuit(cc->image, cc->imageSize);
+		AG_MutexLock(&cacheLock);
+		ReleaseCachedCircuit(cc);
+		AG_MutexUnlock(&cacheLock);
+	}
+	if (ckt == NULL) {
+		free(data);
+		return WriteReply(fd, -1, 0, AG_GetError());
+	}
+	rv = RunTransient(fd, req, ckt, probeNames);
+	AG_ObjectDestroy(ckt);
+	free(data);
+	return (rv);
+}
+
+/*
+ * Serve the requests on a connection until the client disconnects. The
+ * connection holds a worker for as long as it is open, so clients which
+ * send no further request within idleTimeout seconds (or stop reading
+ * their results) are disconnected to let queued connections be served.
+ */
+static void
+ServeConnection(int fd)
+{
+	ES_SimdRequest req;
+	struct timeval tv;
+
+	if (idleTimeout > 0) {
+		tv.tv_sec = (time_t)idleTimeout;
+		tv.tv_usec = 0;
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+	}
+	for (;;) {
+		if (ReadFull(fd, &req, sizeof(req)) == -1 ||
+		    ProcessRequest(fd, &req) == -1)
+			break;
+	}
+	close(fd);
+}
+
+#ifdef AG_THREADS
+static void *
+Worker(void *arg)
+{
+	int fd;
+
+	for (;;) {
+		AG_MutexLock(&queueLock);
+		while (queueCount == 0) {
+			AG_CondWait(&queueNotEmpty, &queueLock);
+		}
+		fd = queue[queueHead];
+		queueHead = (queueHead+1) % QUEUE_MAX;
+		queueCount--;
+		AG_CondSignal(&queueNotFull);
+		AG_MutexUnlock(&queueLock);
+
+		ServeConnection(fd);
+	}
+	return (NULL);
+}
+#endif /* AG_THREADS */
+
+/*
+ * Return the default socket path. Use $XDG_RUNTIME_DIR if set, otherwise
+ * a directory under /tmp which must be private to the user (it is created
+ * by the server if it does not exist).
+ */
+static int
+DefaultSocketPath(char *path, size_t len, int create)
+{
+	const char *runDir;
+	struct stat sb;
+
+	if ((runDir = getenv("XDG_RUNTIME_DIR")) != NULL &&
+	    runDir[0] != '\0') {
+		if (Strlcpy(path, runDir, len) >= len ||
+		    Strlcat(path, "/", len) >= len ||
+		    Strlcat(path, ES_SIMD_SOCKET, len) >= len) {
+			goto too_long;
+		}
+		return (0);
+	}
+	snprintf(path, len, "/tmp/edacious-simd-%u", (Uint)getuid());
+	if (create && mkdir(path, 0700) == -1 && errno != EEXIST) {
+		AG_SetError("%s: %s", path, strerror(errno));
+		return (-1);
+	}
+	if (lstat(path, &sb) == -1) {
+		AG_SetError("%s: %s", path, strerror(errno));
+		return (-1);
+	}
+	if (!S_ISDIR(sb.st_mode) || sb.st_uid != getuid() ||
+	    (sb.st_mode & 077) != 0) {
+		AG_SetError("%s: Not a private directory", path);
+		return (-1);
+	}
+	if (Strlcat(path, "/", len) >= len ||
+	    Strlcat(path, ES_SIMD_SOCKET, len) >= len) {
+		goto too_long;
+	}
+	return (0);
+too_long:
+	AG_SetError("Socket path too long");
+	return (-1);
+}
+
+/* Check that the peer of a connection runs as the same user as we do. */
+static int
+CheckPeer(int fd)
+{
+#if defined(__linux__) && defined(SO_PEERCRED)
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == -1) {
+		return (-1);
+	}
+	return (cred.uid == getuid() ? 0 : -1);
+#elif defined(__FreeBSD__) || defined(__NetBSD__) || \
+      defined(__OpenBSD__) || defined(__APPLE__)
+	uid_t uid;
+	gid_t gid;
+
+	if (getpeereid(fd, &uid, &gid) == -1) {
+		return (-1);
+	}
+	return (uid == getuid() ? 0 : -1);
+#else
+	return (0);			/* Rely on the socket permissions */
+#endif
+}
+
+static int
+Server(const char *sockPath, Uint nWorkers)
+{
+	struct sockaddr_un sun;
+	struct sigaction sa;
+	struct stat sb;
+	mode_t mask;
+	int sock, fd;
+#ifdef AG_THREADS
+	AG_Thread th;
+	Uint i;
+#endif
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	if (Strlcpy(sun.sun_path, sockPath, sizeof(sun.sun_path)) >=
+	    sizeof(sun.sun_path)) {
+		AG_SetError("%s: Path too long", sockPath);
+		return (-1);
+	}
+	if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+		AG_SetError("socket: %s", strerror(errno));
+		return (-1);
+	}
+	/* Only replace a stale socket of our own. */
+	if (lstat(sockPath, &sb) == 0) {
+		if (!S_ISSOCK(sb.st_mode) || sb.st_uid != getuid()) {
+			AG_SetError("%s: File exists", sockPath);
+			close(sock);
+			return (-1);
+		}
+		unlink(sockPath);
+	}
+	mask = umask(077);
+	if (bind(sock, (struct sockaddr *)&sun, sizeof(sun)) == -1) {
+		AG_SetError("%s: %s", sockPath, strerror(errno));
+		umask(mask);
+		close(sock);
+		return (-1);
+	}
+	umask(mask);
+	if (chmod(sockPath, 0600) == -1 ||
+	    listen(sock, QUEUE_MAX) == -1) {
+		AG_SetError("%s: %s", sockPath, strerror(errno));
+		close(sock);
+		unlink(sockPath);
+		return (-1);
+	}
+
+	/* Let accept() be interrupted so that the socket is removed. */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = SigTerm;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+#ifdef AG_THREADS
+	for (i = 0; i < nWorkers; i++)
+		AG_ThreadCreate(&th, Worker, NULL);
+#endif
+	while (!doExit) {
+		if ((fd = accept(sock, NULL, NULL)) == -1) {
+			if (errno != EINTR && errno != ECONNABORTED) {
+				AG_SetError("accept: %s", strerror(errno));
+				break;
+			}
+			continue;
+		}
+		if (CheckPeer(fd) == -1) {
+			close(fd);
+			continue;
+		}
+#ifdef AG_THREADS
+		AG_MutexLock(&queueLock);
+		while (queueCount == QUEUE_MAX) {
+			AG_CondWait(&queueNotFull, &queueLock);
+		}
+		queue[(queueHead + queueCount) % QUEUE_MAX] = fd;
+		queueCount++;
+		AG_CondSignal(&queueNotEmpty);
+		AG_MutexUnlock(&queueLock);
+#else
+		ServeConnection(fd);
+#endif
+	}
+	close(sock);
+	unlink(sockPath);
+	return (doExit ? 0 : -1);
+}
+
+/* Submit a single job and print the results. */
+static int
+Client(const char *sockPath, ES_SimdRequest *req, const char *file,
+    char **vars, Uint nVars, int showHeader)
+{
+	char path[PATH_MAX];
+	struct sockaddr_un sun;
+	ES_SimdReply rep;
+	double *block;
+	Uint32 nRows;
+	Uint i, j;
+	int sock;
+
+	if (realpath(file, path) == NULL) {
+		AG_SetError("%s: %s", file, strerror(errno));
+		return (-1);
+	}
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	Strlcpy(sun.sun_path, sockPath, sizeof(sun.sun_path));
+	if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) == -1 ||
+	    connect(sock, (struct sockaddr *)&sun, sizeof(sun)) == -1) {
+		AG_SetError("%s: %s", sockPath, strerror(errno));
+		return (-1);
+	}
+
+	req->pathLen = strlen(path);
+	req->probesLen = 0;
+	for (i = 0; i < nVars; i++) {
+		req->probesLen += strlen(vars[i])+1;
+	}
+	req->nProbes = nVars;
+	if (WriteFull(sock, req, sizeof(ES_SimdRequest)) == -1 ||
+	    WriteFull(sock, path, req->pathLen) == -1)
+		goto fail;
+	for (i = 0; i < nVars; i++) {
+		if (WriteFull(sock, vars[i], strlen(vars[i])+1) == -1)
+			goto fail;
+	}
+
+	if (ReadFull(sock, &rep, sizeof(rep)) == -1)
+		goto fail;
+	if (rep.status != 0) {
+		goto fail_reply;
+	}
+	if (showHeader) {
+		printf("#Time\t");
+		for (i = 0; i < nVars; i++) {
+			printf("%c(%s)\t", vars[i][0], &vars[i][1]);
+		}
+		printf("\n");
+	}
+	block = Malloc(ES_SIMD_BLOCK_ROWS*rep.nCols*sizeof(double));
+	for (;;) {
+		if (ReadFull(sock, &nRows, sizeof(nRows)) == -1 ||
+		    nRows > ES_SIMD_BLOCK_ROWS ||
+		    ReadFull(sock, block, nRows*rep.nCols*sizeof(double))
+		    == -1) {
+			free(block);
+			goto fail;
+		}
+		if (nRows == 0) {
+			break;
+		}
+		for (i = 0; i < nRows; i++) {
+			const double *row = &block[i*rep.nCols];
+
+			printf("%.06f\t", row[0]);
+			for (j = 1; j < rep.nCols; j++) {
+				printf("%.08f\t", row[j]);
+			}
+			printf("\n");
+		}
+	}
+	free(block);
+	if (ReadFull(sock, &rep, sizeof(rep)) == -1)
+		goto fail;
+	if (rep.status != 0) {
+		goto fail_reply;
+	}
+	close(sock);
+	return (0);
+fail_reply:
+	{
+		char msg[256];
+		Uint32 len = MIN(rep.msgLen, sizeof(msg)-1);
+
+		if (ReadFull(sock, msg, len) == 0) {
+			msg[len] = '\0';
+			AG_SetError("%s", msg);
+		}
+	}
+fail:
+	close(sock);
+	return (-1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	char sockDefault[sizeof(((struct sockaddr_un *)0)->sun_path)];
+	const char *sockPath = NULL;
+	ES_SimdRequest req;
+	int c, clientMode = 0, showHeader = 1;
+	Uint nWorkers = 4;
+
+	memset(&req, 0, sizeof(req));
+	req.magic = ES_SIMD_REQUEST_MAGIC;
+	req.analysis = ES_SIMD_TRANSIENT;
+
+	while ((c = getopt(argc, argv, "?hCHNs:j:c:i:t:n:")) != -1) {
+		extern char *optarg;
+
+		switch (c) {
+		case 'C':
+			clientMode = 1;
+			break;
+		case 'H':
+			showHeader = 0;
+			break;
+		case 'N':
+			req.flags |= ES_SIMD_NOCACHE;
+			break;
+		case 's':
+			sockPath = optarg;
+			break;
+		case 'j':
+			nWorkers = MAX(1, atoi(optarg));
+			break;
+		case 'c':
+			cacheMax = MAX(1, atoi(optarg));
+			break;
+		case 'i':
+			idleTimeout = (Uint)MAX(0, atoi(optarg));
+			break;
+		case 't':
+			req.tStop = strtod(optarg, NULL);
+			break;
+		case 'n':
+			req.maxSteps = (Uint32)atoi(optarg);
+			break;
+		case '?':
+		case 'h':
+			printusage();
+		}
+	}
+
+	AG_InitCore("edacious-simd", 0);
+	agDebugLvl = 0;
+
+	if (sockPath == NULL) {
+		if (DefaultSocketPath(sockDefault, sizeof(sockDefault),
+		    !clientMode) == -1) {
+			fprintf(stderr, "edacious-simd: %s\n", AG_GetError());
+			return (1);
+		}
+		sockPath = sockDefault;
+	}
+
+	if (clientMode) {
+		if (optind == argc) {
+			printusage();
+		}
+		if (Client(sockPath, &req, argv[optind], &argv[optind+1],
+		    argc-optind-1, showHeader) == -1) {
+			fprintf(stderr, "%s: %s\n", argv[optind],
+			    AG_GetError());
+			return (1);
+		}
+		return (0);
+	}
+
+	/* Done once for all jobs. */
+	ES_CoreInit(0);
+
+	AG_MutexInit(&cacheLock);
+#ifdef AG_THREADS
+	AG_MutexInit(&queueLock);
+	AG_CondInit(&queueNotEmpty);
+	AG_CondInit(&queueNotFull);
+#endif
+	if (Server(sockPath, nWorkers) == -1) {
+		fprintf(stderr, "edacious-simd: %s\n", AG_GetError());
+		return (1);
+	}
+	return (0);
+}
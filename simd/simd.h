@@ -0,0 +1,58 @@
+/*	Public domain	*/
+
+/*
+ * Protocol of the edacious-simd job server. Clients connect to a local
+ * (Unix domain) socket and send any number of requests, each of which is
+ * answered before the next one is read. Connections on which no request
+ * arrives within the server's idle timeout are closed. Integers and reals
+ * are in host byte order.
+ *
+ * A request is an ES_SimdRequest header followed by the circuit path
+ * (pathLen bytes), the serialized circuit (imageLen bytes; used instead
+ * of the path if non-zero) and the probe names (probesLen bytes of
+ * NUL-terminated "v<node>" or "i<vsource>" strings).
+ *
+ * The socket is created in $XDG_RUNTIME_DIR or, failing that, in a
+ * private (mode 0700) directory under /tmp, and only connections from
+ * processes of the same user are served.
+ *
+ * The server answers with an ES_SimdReply header. If the job is accepted
+ * (status 0), the results follow in blocks of a Uint32 row count and
+ * nRows*nCols doubles (simulated time, then the probes). A block of 0
+ * rows ends the results, and is followed by a second ES_SimdReply giving
+ * the final status of the simulation. Error messages (msgLen bytes)
+ * follow the ES_SimdReply they belong to.
+ */
+
+#define ES_SIMD_SOCKET		"edacious-simd.sock"	/* Socket name */
+#define ES_SIMD_REQUEST_MAGIC	0x45534a31		/* "ESJ1" */
+#define ES_SIMD_REPLY_MAGIC	0x45535231		/* "ESR1" */
+
+#define ES_SIMD_PATH_MAX	1024			/* Max circuit path */
+#define ES_SIMD_IMAGE_MAX	(64*1024*1024)		/* Max circuit image */
+#define ES_SIMD_PROBES_MAX	256			/* Max probes per job */
+#define ES_SIMD_BLOCK_ROWS	256			/* Rows per result block */
+
+enum es_simd_analysis {
+	ES_SIMD_TRANSIENT		/* Transient analysis */
+};
+
+typedef struct es_simd_request {
+	Uint32 magic;			/* ES_SIMD_REQUEST_MAGIC */
+	Uint32 analysis;		/* Analysis (enum es_simd_analysis) */
+	Uint32 flags;
+#define ES_SIMD_NOCACHE	0x01		/* Bypass the circuit cache */
+	Uint32 maxSteps;		/* Stop after n steps (0 = no limit) */
+	double tStop;			/* Stop at simulated time (0 = no limit) */
+	Uint32 pathLen;			/* Length of circuit path */
+	Uint32 imageLen;		/* Length of serialized circuit */
+	Uint32 probesLen;		/* Length of probe names */
+	Uint32 nProbes;			/* Number of probe names */
+} ES_SimdRequest;
+
+typedef struct es_simd_reply {
+	Uint32 magic;			/* ES_SIMD_REPLY_MAGIC */
+	Sint32 status;			/* 0 = success, -1 = failure */
+	Uint32 nCols;			/* Values per result row */
+	Uint32 msgLen;			/* Length of error message */
+} ES_SimdReply;
@@ -87,6 +87,7 @@ Init(void *p)
 	COMPONENT(i)->dcSimBegin = DC_SimBegin;
 	COMPONENT(i)->dcStepBegin = DC_StepBegin;
 	COMPONENT(i)->dcStepIter = DC_StepIter;
+	COMPONENT(i)->flags |= ES_COMPONENT_LINEAR;
 
 	M_BindReal(i, "I", &i->I);
 }
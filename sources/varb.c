@@ -34,9 +34,6 @@
 
 #include <agar/config/ag_threads.h>
 
-PARAM params[] = { {"pi" , M_PI},
-		   {"t"  , 0.0}
-};
 const ES_Port esVArbPorts[] = {
 	{  0, "" },
 	{  1, "v+" },
@@ -44,6 +41,22 @@ const ES_Port esVArbPorts[] = {
 	{ -1 },
 };
 
+/*
+ * Evaluate the expression at time t. The parameters and interpreter context
+ * are local, so that separate instances may be evaluated concurrently.
+ */
+static int
+Evaluate(ES_VArb *va, M_Real t, M_Real *v)
+{
+	INTERPRETEUR ctx;
+	PARAM params[] = { {"pi" , M_PI},
+			   {"t"  , 0.0} };
+
+	params[1].Value = t;
+	return Calculer(&ctx, va->exp, params,
+	    (sizeof(params)/sizeof(params[0])), v);
+}
+
 static __inline__ void 
 Stamp(ES_VArb *va, ES_SimDC *dc)
 {
@@ -60,9 +73,7 @@ DC_SimBegin(void *obj, ES_SimDC *dc)
 	Uint j = PNODE(va,2);
 
 	/* Calculate initial voltage */
-	params[1].Value = 0.0;
-	Calculer(va->exp, params, (sizeof(params)/sizeof(params[0])),
-	    &(vs->v));
+	Evaluate(va, 0.0, &vs->v);
 
 	InitStampVoltageSource(k,j, vs->vIdx, vs->s, dc);
 
@@ -81,10 +92,7 @@ DC_StepBegin(void *obj, ES_SimDC *dc)
 	M_Real res;
 	int ret;
 
-	params[1].Value = dc->Telapsed;
-	InterpreteurReset();
-	ret = Calculer(va->exp, params, (sizeof(params)/sizeof(params[0])),
-	    &res);
+	ret = Evaluate(va, dc->Telapsed, &res);
 	if (ret != EVALUER_SUCCESS) {
 		printf("Error !");
 	}
@@ -114,11 +122,11 @@ Init(void *p)
 
 	Strlcpy(va->exp, "sin(2*pi*t)", sizeof(va->exp));
 	va->flags = 0;
-	InterpreteurInit();
 	
 	COMPONENT(va)->dcSimBegin = DC_SimBegin;
 	COMPONENT(va)->dcStepBegin = DC_StepBegin;
 	COMPONENT(va)->dcStepIter = DC_StepIter;
+	COMPONENT(va)->flags |= ES_COMPONENT_LINEAR;
 
 	AG_BindString(va, "expr", va->exp, sizeof(va->exp));
 }
@@ -134,10 +142,7 @@ UpdatePlot(AG_Event *event)
 	M_PlotClear(pl);
 	pl->flags &= ~(ES_VARB_ERROR);
 	for (i = 0.0; i < 1.5; i += 0.01) {
-		params[1].Value = i;
-		InterpreteurReset();
-		ret = Calculer(va->exp, params,
-		    (sizeof(params)/sizeof(params[0])), &v);
+		ret = Evaluate(va, i, &v);
 		if (ret != EVALUER_SUCCESS) {
 			va->flags |= ES_VARB_ERROR;
 			return;
@@ -147,6 +147,7 @@ Init(void *p)
 	COMPONENT(vn)->dcSimEnd = DC_SimEnd;
 	COMPONENT(vn)->dcStepBegin = DC_StepBegin;
 	COMPONENT(vn)->dcStepIter = DC_StepIter;
+	COMPONENT(vn)->flags |= ES_COMPONENT_LINEAR;
 
 	M_BindReal(vn, "vMin", &vn->vMin);
 	M_BindReal(vn, "vMax", &vn->vMax);
@@ -92,6 +92,7 @@ Init(void *p)
 	COMPONENT(vs)->dcSimBegin = DC_SimBegin;
 	COMPONENT(vs)->dcStepBegin = DC_StepBegin;
 	COMPONENT(vs)->dcStepIter = DC_StepIter;
+	COMPONENT(vs)->flags |= ES_COMPONENT_LINEAR;
 
 	M_BindReal(vs, "vPeak", &vs->vPeak);
 	M_BindReal(vs, "f", &vs->f);
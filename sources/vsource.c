@@ -58,10 +58,10 @@ FindContigPair(ES_Port *pA, ES_Port *pB, ES_Pair **Rdip, int *Rpol)
 		 * determined by the port number order.
 		 */
 		if (dip->p1 == pA && dip->p2->node >= 0) {
-			node = ckt->nodes[dip->p2->node];
+			node = &ckt->nodes[dip->p2->node];
 			pol = -1;
 		} else if (dip->p2 == pA && dip->p1->node >= 0) {
-			node = ckt->nodes[dip->p1->node];
+			node = &ckt->nodes[dip->p1->node];
 			pol = +1;
 		} else {
 			continue;
@@ -127,7 +127,7 @@ static void
 FindLoops(ES_Vsource *vs, ES_Port *portCur)
 {
 	ES_Circuit *ckt = COMPONENT(vs)->ckt;
-	ES_Node *nodeCur = ckt->nodes[portCur->node], *nodeNext;
+	ES_Node *nodeCur = &ckt->nodes[portCur->node], *nodeNext;
 	ES_Port *portNext;
 	ES_Branch *br;
 	Uint i;
@@ -155,7 +155,7 @@ FindLoops(ES_Vsource *vs, ES_Port *portCur)
 			continue;
 		}
 		COMPONENT_FOREACH_PORT(portNext, i, br->port->com) {
-			nodeNext = ckt->nodes[portNext->node];
+			nodeNext = &ckt->nodes[portNext->node];
 			if ((portNext == portCur) ||
 			    (portNext->com == br->port->com &&
 			     portNext->n == br->port->n) ||
@@ -256,6 +256,7 @@ Init(void *p)
 	COMPONENT(vs)->dcSimBegin = DC_SimBegin;
 	COMPONENT(vs)->dcStepBegin = DC_StepBegin;
 	COMPONENT(vs)->dcStepIter = DC_StepIter;
+	COMPONENT(vs)->flags |= ES_COMPONENT_LINEAR;
 
 	AG_SetEvent(vs, "circuit-connected", Connected, NULL);
 	AG_SetEvent(vs, "circuit-disconnected", Disconnected, NULL);
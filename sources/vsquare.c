@@ -102,6 +102,7 @@ Init(void *p)
 	COMPONENT(vs)->dcSimBegin = DC_SimBegin;
 	COMPONENT(vs)->dcStepBegin = DC_StepBegin;
 	COMPONENT(vs)->dcStepIter = DC_StepIter;
+	COMPONENT(vs)->flags |= ES_COMPONENT_LINEAR;
 
 	M_BindReal(vs, "vH", &vs->vH);
 	M_BindReal(vs, "vL", &vs->vL);
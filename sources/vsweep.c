@@ -105,6 +105,7 @@ Init(void *p)
 	COMPONENT(vsw)->dcSimBegin = DC_SimBegin;
 	COMPONENT(vsw)->dcStepBegin = DC_StepBegin;
 	COMPONENT(vsw)->dcStepIter = DC_StepIter;
+	COMPONENT(vsw)->flags |= ES_COMPONENT_LINEAR;
 
 	M_BindReal(vsw, "v1", &vsw->v1);
 	M_BindReal(vsw, "v2", &vsw->v2);
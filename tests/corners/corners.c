@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * corners: Run the same corner analysis of a circuit with one thread and
+ * with several, and check that the results (status of every corner, the
+ * envelopes and the worst-case extrema) are identical.
+ */
+
+#include <core/core.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static Uint nThreads = 4;
+static Uint nPoints = 51;
+static M_Real tStop = 0.05;
+
+static void
+printusage(void)
+{
+	fprintf(stderr, "Usage: corners [-j threads] [-t tStop] [-n points] "
+	                "[-S com:param=percent] [file] [var1] [...]\n");
+	exit(1);
+}
+
+/*
+ * Parse a "com:param=percent" specification and vary the parameter by
+ * that percentage around its current value.
+ */
+static int
+AddSpec(ES_Circuit *ckt, const char *arg)
+{
+	char s[128], *param, *sPct;
+	ES_Component *com;
+	M_Real v, d;
+
+	Strlcpy(s, arg, sizeof(s));
+	if ((param = strchr(s, ':')) == NULL ||
+	    (sPct = strchr(param, '=')) == NULL) {
+		AG_SetError("%s: Expected com:param=percent", arg);
+		return (-1);
+	}
+	*param++ = '\0';
+	*sPct++ = '\0';
+	if ((com = AG_ObjectFindChild(ckt, s)) == NULL ||
+	    !AG_OfClass(com, "ES_Circuit:ES_Component:*")) {
+		AG_SetError("%s: No such component", s);
+		return (-1);
+	}
+	if (!AG_Defined(com, param)) {
+		AG_SetError("%s: No such parameter: %s", s, param);
+		return (-1);
+	}
+	v = M_GetReal(com, param);
+	d = Fabs(v)*(M_Real)strtod(sPct, NULL)/100.0;
+	if (ES_ComponentAddSpec(com, param, v-d, v, v+d) == NULL) {
+		return (-1);
+	}
+	return (0);
+}
+
+static ES_CornerAnalysis *
+Analyze(ES_Circuit *ckt, char **probes, int nProbes, Uint threads)
+{
+	ES_CornerAnalysis *ca;
+	int i;
+
+	ca = ES_CornerNew(ckt);
+	ca->tStop = tStop;
+	ca->nPoints = nPoints;
+	ca->nThreads = threads;
+	for (i = 0; i < nProbes; i++) {
+		if (ES_CornerAddProbe(ca, probes[i]) == -1)
+			goto fail;
+	}
+	if (ES_CornerSetup(ca, ES_CORNER_FULL) == -1 ||
+	    ES_CornerRun(ca) == -1) {
+		goto fail;
+	}
+	return (ca);
+fail:
+	ES_CornerFree(ca);
+	return (NULL);
+}
+
+/* Compare two analyses of the same circuit bit for bit. */
+static int
+Compare(const ES_CornerAnalysis *a, const ES_CornerAnalysis *b)
+{
+	Uint c, k;
+
+	if (a->nCorners != b->nCorners || a->nProbes != b->nProbes) {
+		AG_SetError("Different number of corners or probes");
+		return (-1);
+	}
+	for (c = 0; c < a->nCorners; c++) {
+		if (a->status[c] != b->status[c]) {
+			AG_SetError("Corner %u: Status %d, expected %d", c,
+			    b->status[c], a->status[c]);
+			return (-1);
+		}
+	}
+	for (k = 0; k < a->nProbes; k++) {
+		const ES_CornerProbe *pa = &a->probes[k], *pb = &b->probes[k];
+
+		if (memcmp(pa->min, pb->min, a->nPoints*sizeof(M_Real)) != 0 ||
+		    memcmp(pa->max, pb->max, a->nPoints*sizeof(M_Real)) != 0) {
+			AG_SetError("%s: Envelopes differ", pa->name);
+			return (-1);
+		}
+		if (memcmp(&pa->worstMin, &pb->worstMin, sizeof(M_Real)) != 0 ||
+		    memcmp(&pa->worstMax, &pb->worstMax, sizeof(M_Real)) != 0 ||
+		    pa->cornerMin != pb->cornerMin ||
+		    pa->cornerMax != pb->cornerMax) {
+			AG_SetError("%s: Worst-case extrema differ", pa->name);
+			return (-1);
+		}
+	}
+	return (0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	ES_CornerAnalysis *ca1 = NULL, *caN = NULL;
+	ES_Circuit *ckt;
+	char **specs = NULL, *file;
+	Uint nSpecs = 0, i;
+	int c, rv = 1;
+
+	while ((c = getopt(argc, argv, "?hj:t:n:S:")) != -1) {
+		extern char *optarg;
+
+		switch (c) {
+		case 'j':
+			nThreads = (Uint)atoi(optarg);
+			break;
+		case 't':
+			tStop = (M_Real)strtod(optarg, NULL);
+			break;
+		case 'n':
+			nPoints = (Uint)atoi(optarg);
+			break;
+		case 'S':
+			specs = Realloc(specs, (nSpecs+1)*sizeof(char *));
+			specs[nSpecs++] = optarg;
+			break;
+		case '?':
+		case 'h':
+			printusage();
+		}
+	}
+	if (optind+1 >= argc || nSpecs == 0 || nThreads < 2) {
+		printusage();
+	}
+	file = argv[optind];
+
+	AG_InitCore("corners", 0);
+	ES_CoreInit(0);
+	agDebugLvl = 0;
+
+	ckt = AG_ObjectNew(NULL, NULL, &esCircuitClass);
+	ckt->flags |= ES_CIRCUIT_HEADLESS;
+	if (AG_ObjectLoadFromFile(ckt, file) == -1) {
+		goto out;
+	}
+	for (i = 0; i < nSpecs; i++) {
+		if (AddSpec(ckt, specs[i]) == -1)
+			goto out;
+	}
+	if ((ca1 = Analyze(ckt, &argv[optind+1], argc-optind-1, 1)) == NULL ||
+	    (caN = Analyze(ckt, &argv[optind+1], argc-optind-1,
+	     nThreads)) == NULL) {
+		goto out;
+	}
+	if (ca1->nFailed == ca1->nCorners) {
+		AG_SetError("All %u corners failed", ca1->nCorners);
+		goto out;
+	}
+	if (Compare(ca1, caN) == -1) {
+		AG_SetError("1 vs. %u threads: %s", nThreads, AG_GetError());
+		goto out;
+	}
+	rv = 0;
+out:
+	if (rv == 0) {
+		printf("%s: OK (%u corners)\n", file, ca1->nCorners);
+	} else {
+		printf("%s: FAILED (%s)\n", file, AG_GetError());
+	}
+	if (caN != NULL) { ES_CornerFree(caN); }
+	if (ca1 != NULL) { ES_CornerFree(ca1); }
+	AG_ObjectDestroy(ckt);
+	Free(specs);
+	return (rv);
+}
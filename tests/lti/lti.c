@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * lti: Simulate linear circuits with and without the linear time-invariant
+ * solver (which reuses the LU factors and updates them by low rank), with
+ * both the dense and the sparse LU, and check that the solutions agree at
+ * every timestep. Besides the given files, a generated RC ladder large
+ * enough for the sparse LU may be checked (-l).
+ *
+ * Every LTI_TOGGLE steps, all switches are toggled, so that the LTI solver
+ * updates its factors by low rank where the reference refactors. The
+ * ladder has a switch to ground, and must be solved by such updates.
+ */
+
+#include <core/core.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#define LTI_RTOL 1e-6		/* Relative tolerance on the solutions */
+#define LTI_ATOL 1e-9		/* Absolute tolerance on the solutions */
+#define LTI_TOGGLE 50		/* Steps between switch toggles */
+
+#define LTI_LADDER_VSRC	"Edacious(Circuit:Component:Vsource:VSine)@sources"
+#define LTI_LADDER_R	"Edacious(Circuit:Component:Resistor)@generic"
+#define LTI_LADDER_C	"Edacious(Circuit:Component:Capacitor)@generic"
+#define LTI_LADDER_SW	"Edacious(Circuit:Component:Spst)@generic"
+
+/* Solver statistics of a simulation. */
+typedef struct run_info {
+	Uint n;				/* Unknowns */
+	int isLTI;			/* Linear solver was used */
+	int isSparse;			/* Sparse LU was used */
+	Uint updates;			/* Steps solved by low-rank update */
+} RunInfo;
+
+static const struct {
+	const char *name;
+	Uint flags;
+} configs[] = {
+	{ "dense LU, NR",	ES_SIMDC_NO_LTI },
+	{ "dense LU, LTI",	0 },
+	{ "sparse LU, NR",	ES_SIMDC_SPARSE|ES_SIMDC_NO_LTI },
+	{ "sparse LU, LTI",	ES_SIMDC_SPARSE },
+};
+static const Uint nConfigs = sizeof(configs)/sizeof(configs[0]);
+
+static Uint nSteps = 500;
+static Uint nLadder = 0;	/* Sections of the generated RC ladder */
+
+static void
+printusage(void)
+{
+	fprintf(stderr, "Usage: lti [-s steps] [-l sections] [file ...]\n");
+	exit(1);
+}
+
+/* Attach a new two-port component between nodes n1 and n2. */
+static ES_Component *
+AddComponent(ES_Circuit *ckt, const char *classSpec, const char *name,
+    int n1, int n2)
+{
+	AG_ObjectClass *cls;
+	ES_Component *com;
+
+	if ((cls = ES_LoadClass(classSpec)) == NULL ||
+	    (com = AG_ObjectNew(ckt, name, cls)) == NULL) {
+		return (NULL);
+	}
+	TAILQ_INSERT_TAIL(&ckt->components, com, components);
+	com->flags |= ES_COMPONENT_CONNECTED;
+	ES_AddBranch(ckt, n1, &com->ports[1]);
+	com->ports[1].node = n1;
+	ES_AddBranch(ckt, n2, &com->ports[2]);
+	com->ports[2].node = n2;
+	return (com);
+}
+
+/*
+ * Build a ladder of nLadder RC sections driven by a sine voltage source,
+ * with a switch from its middle node to ground. There is one unknown per
+ * section, so that past ES_DENSE_LU_MAX sections the sparse LU is used
+ * even without ES_SIMDC_SPARSE.
+ */
+static int
+BuildLadder(ES_Circuit *ckt)
+{
+	ES_Component *com;
+	char name[32];
+	Uint i;
+
+	ES_ReserveNodes(ckt, nLadder+2);
+	for (i = 0; i <= nLadder; i++) {
+		ES_AddNode(ckt);
+	}
+	if (AddComponent(ckt, LTI_LADDER_VSRC, "V1", 1, 0) == NULL) {
+		return (-1);
+	}
+	for (i = 1; i <= nLadder; i++) {
+		Snprintf(name, sizeof(name), "R%u", i);
+		if ((com = AddComponent(ckt, LTI_LADDER_R, name, i, i+1)) ==
+		    NULL) {
+			return (-1);
+		}
+		M_SetReal(com, "R", 100.0);
+
+		Snprintf(name, sizeof(name), "C%u", i);
+		if ((com = AddComponent(ckt, LTI_LADDER_C, name, i+1, 0)) ==
+		    NULL) {
+			return (-1);
+		}
+		M_SetReal(com, "C", 1e-6);
+	}
+	if ((com = AddComponent(ckt, LTI_LADDER_SW, "S1", nLadder/2 + 1, 0)) ==
+	    NULL) {
+		return (-1);
+	}
+	M_SetReal(com, "Ron", 10.0);
+	CIRCUIT_FOREACH_COMPONENT(com, ckt) {
+		AG_PostEvent(com, "circuit-connected", NULL);
+	}
+	ES_CircuitModified(ckt);
+	return (0);
+}
+
+/* Toggle every switch in the circuit. */
+static void
+ToggleSwitches(ES_Circuit *ckt)
+{
+	ES_Component *com;
+
+	CIRCUIT_FOREACH_COMPONENT(com, ckt) {
+		if (AG_OfClass(com, "ES_Circuit:ES_Component:ES_Spst:*"))
+			AG_SetInt(com, "state", !AG_GetInt(com, "state"));
+	}
+}
+
+/*
+ * Simulate nSteps timesteps of a circuit (or of the RC ladder if file is
+ * NULL), toggling the switches every LTI_TOGGLE steps. Return the time and
+ * solution at every step in t[] and a newly allocated x[], and the solver
+ * statistics in ri.
+ */
+static M_Real *
+Simulate(const char *file, Uint flags, M_Real *t, RunInfo *ri)
+{
+	ES_Circuit *ckt;
+	ES_SimDC *sim;
+	M_Real *x = NULL;
+	Uint step, i, n;
+
+	ckt = AG_ObjectNew(NULL, NULL, &esCircuitClass);
+	ckt->flags |= ES_CIRCUIT_HEADLESS;
+	if ((file != NULL) ? AG_ObjectLoadFromFile(ckt, file) == -1 :
+	                     BuildLadder(ckt) == -1) {
+		AG_ObjectDestroy(ckt);
+		return (NULL);
+	}
+	sim = (ES_SimDC *)ES_CreateSimulation(ckt, &esSimDcOps);
+	sim->flags |= ES_SIMDC_HEADLESS | flags;
+	if (ES_SimDCBegin(sim) == -1) {
+		goto fail;
+	}
+	ri->n = n = ckt->n + ckt->m;
+	ri->isLTI = sim->isLTI;
+	ri->isSparse = sim->sparse;
+	x = Malloc(nSteps*n*sizeof(M_Real));
+	for (step = 0; step < nSteps; step++) {
+		if (step > 0 && step % LTI_TOGGLE == 0) {
+			ToggleSwitches(ckt);
+		}
+		if (ES_SimDCStep(sim) == -1) {
+			goto fail;
+		}
+		t[step] = sim->Telapsed;
+		for (i = 0; i < n; i++)
+			x[step*n + i] = M_VecGet(sim->x, i);
+	}
+	ri->updates = sim->updatesLowRank;
+	ES_DestroySimulation(ckt);
+	AG_ObjectDestroy(ckt);
+	return (x);
+fail:
+	Free(x);
+	ES_DestroySimulation(ckt);
+	AG_ObjectDestroy(ckt);
+	return (NULL);
+}
+
+/*
+ * Compare the solutions of a configuration against the reference. The
+ * timesteps are the same, but the times may differ by rounding.
+ */
+static int
+Compare(Uint n, const M_Real *xRef, const M_Real *tRef, const M_Real *x,
+    const M_Real *t)
+{
+	Uint step, i;
+
+	for (step = 0; step < nSteps; step++) {
+		if (Fabs(t[step] - tRef[step]) >
+		    LTI_ATOL + LTI_RTOL*Fabs(tRef[step])) {
+			AG_SetError("Step %u: t=%g, expected %g", step,
+			    (double)t[step], (double)tRef[step]);
+			return (-1);
+		}
+		for (i = 0; i < n; i++) {
+			M_Real v = x[step*n + i], vRef = xRef[step*n + i];
+
+			if (Fabs(v - vRef) > LTI_ATOL + LTI_RTOL*Fabs(vRef)) {
+				AG_SetError("Step %u: x[%u]=%g, expected %g",
+				    step, i, (double)v, (double)vRef);
+				return (-1);
+			}
+		}
+	}
+	return (0);
+}
+
+/*
+ * Simulate a circuit (or the RC ladder if file is NULL) in every
+ * configuration and compare the solutions against the first one. The
+ * circuit must be linear, and large systems must use the sparse LU. The
+ * ladder must also have been solved by low-rank updates.
+ */
+static int
+Check(const char *file)
+{
+	M_Real *xRef, *tRef, *x, *t;
+	RunInfo ri, riRef;
+	Uint c;
+	int rv = -1;
+
+	tRef = Malloc(nSteps*sizeof(M_Real));
+	t = Malloc(nSteps*sizeof(M_Real));
+	if ((xRef = Simulate(file, configs[0].flags, tRef, &riRef)) == NULL) {
+		AG_SetError("%s: %s", configs[0].name, AG_GetError());
+		goto out;
+	}
+	for (c = 1; c < nConfigs; c++) {
+		if ((x = Simulate(file, configs[c].flags, t, &ri)) == NULL) {
+			AG_SetError("%s: %s", configs[c].name, AG_GetError());
+			goto out;
+		}
+		if (!ri.isLTI && !(configs[c].flags & ES_SIMDC_NO_LTI)) {
+			AG_SetError("Circuit is not linear");
+			Free(x);
+			goto out;
+		}
+		if (!ri.isSparse && ri.n > ES_DENSE_LU_MAX) {
+			AG_SetError("%s: %u unknowns without the sparse LU",
+			    configs[c].name, ri.n);
+			Free(x);
+			goto out;
+		}
+		if (file == NULL && ri.isLTI && ri.updates == 0) {
+			AG_SetError("%s: No low-rank update", configs[c].name);
+			Free(x);
+			goto out;
+		}
+		if (ri.n != riRef.n) {
+			AG_SetError("%s: %u unknowns, expected %u",
+			    configs[c].name, ri.n, riRef.n);
+			Free(x);
+			goto out;
+		}
+		if (Compare(ri.n, xRef, tRef, x, t) == -1) {
+			AG_SetError("%s: %s", configs[c].name, AG_GetError());
+			Free(x);
+			goto out;
+		}
+		Free(x);
+	}
+	rv = 0;
+out:
+	Free(xRef);
+	Free(tRef);
+	Free(t);
+	return (rv);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int i, c, nFailed = 0;
+
+	while ((c = getopt(argc, argv, "?hs:l:")) != -1) {
+		extern char *optarg;
+
+		switch (c) {
+		case 's':
+			nSteps = (Uint)atoi(optarg);
+			break;
+		case 'l':
+			nLadder = (Uint)atoi(optarg);
+			break;
+		case '?':
+		case 'h':
+			printusage();
+		}
+	}
+	if ((optind == argc && nLadder == 0) || nSteps == 0) {
+		printusage();
+	}
+
+	AG_InitCore("lti", 0);
+	ES_CoreInit(0);
+	agDebugLvl = 0;
+
+	if (nLadder > 0) {
+		if (Check(NULL) == -1) {
+			printf("RC ladder (%u sections): FAILED (%s)\n",
+			    nLadder, AG_GetError());
+			nFailed++;
+		} else {
+			printf("RC ladder (%u sections): OK\n", nLadder);
+		}
+	}
+	for (i = optind; i < argc; i++) {
+		if (Check(argv[i]) == -1) {
+			printf("%s: FAILED (%s)\n", argv[i], AG_GetError());
+			nFailed++;
+		} else {
+			printf("%s: OK\n", argv[i]);
+		}
+	}
+	return (nFailed > 0) ? 1 : 0;
+}
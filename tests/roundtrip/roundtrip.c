@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * roundtrip: Load circuits, save them into memory and load them back (with
+ * and without the schematics), checking that components, nodes, port
+ * assignments and symbols are preserved and that saving again yields an
+ * identical image. The circuits are also compiled into netlists (see
+ * ecmcompile(1)) and instantiated back.
+ */
+
+#include <core/core.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct image {
+	Uint8 *data;
+	size_t size;
+} Image;
+
+static void
+printusage(void)
+{
+	fprintf(stderr, "Usage: roundtrip [file ...]\n");
+	exit(1);
+}
+
+static int
+SaveImage(ES_Circuit *ckt, Image *img)
+{
+	AG_DataSource *ds;
+
+	if ((ds = AG_OpenAutoCore()) == NULL) {
+		return (-1);
+	}
+	if (AG_ObjectSerialize(ckt, ds) == -1) {
+		AG_CloseDataSource(ds);
+		return (-1);
+	}
+	img->size = AG_CORE_SOURCE(ds)->size;
+	img->data = Malloc(img->size);
+	memcpy(img->data, AG_CORE_SOURCE(ds)->data, img->size);
+	AG_CloseDataSource(ds);
+	return (0);
+}
+
+static ES_Circuit *
+LoadImage(const Image *img, Uint flags)
+{
+	ES_Circuit *ckt;
+	AG_DataSource *ds;
+
+	if ((ds = AG_OpenConstCore(img->data, img->size)) == NULL) {
+		return (NULL);
+	}
+	ckt = AG_ObjectNew(NULL, NULL, &esCircuitClass);
+	ckt->flags |= flags;
+	if (AG_ObjectUnserialize(ckt, ds) == -1) {
+		AG_CloseDataSource(ds);
+		AG_ObjectDestroy(ckt);
+		return (NULL);
+	}
+	AG_CloseDataSource(ds);
+	return (ckt);
+}
+
+/* Compare the circuit structure of two instances. */
+static int
+Compare(ES_Circuit *a, ES_Circuit *b)
+{
+	ES_Component *ca, *cb;
+	ES_Port *pa;
+	ES_Sym *sa, *sb;
+	Uint i;
+
+	if (a->n != b->n || a->m != b->m || a->nSyms != b->nSyms) {
+		AG_SetError("%u/%u nodes, %u/%u vsources, %u/%u symbols",
+		    a->n, b->n, a->m, b->m, a->nSyms, b->nSyms);
+		return (-1);
+	}
+	for (i = 0; i < a->n; i++) {
+		if (a->nodes[i].nBranches != b->nodes[i].nBranches) {
+			AG_SetError("n%u: %u/%u branches", i,
+			    a->nodes[i].nBranches, b->nodes[i].nBranches);
+			return (-1);
+		}
+	}
+	cb = AG_TAILQ_FIRST(&b->components);
+	ESCIRCUIT_FOREACH_COMPONENT(ca, a) {
+		if (cb == AG_TAILQ_END(&b->components)) {
+			AG_SetError("%s: Missing component", OBJECT(ca)->name);
+			return (-1);
+		}
+		if (strcmp(OBJECT(ca)->name, OBJECT(cb)->name) != 0 ||
+		    OBJECT(ca)->cls != OBJECT(cb)->cls ||
+		    ca->nports != cb->nports) {
+			AG_SetError("%s: Component differs", OBJECT(ca)->name);
+			return (-1);
+		}
+		ESCOMPONENT_FOREACH_PORT(pa, i, ca) {
+			if (pa->node != cb->ports[i].node) {
+				AG_SetError("%s:%u: Node n%d/n%d",
+				    OBJECT(ca)->name, i, pa->node,
+				    cb->ports[i].node);
+				return (-1);
+			}
+		}
+		cb = AG_TAILQ_NEXT(cb, components);
+	}
+	sb = AG_TAILQ_FIRST(&b->syms);
+	AG_TAILQ_FOREACH(sa, &a->syms, syms) {
+		if (sb == NULL || strcmp(sa->name, sb->name) != 0 ||
+		    sa->type != sb->type || sa->p.node != sb->p.node) {
+			AG_SetError("%s: Symbol differs", sa->name);
+			return (-1);
+		}
+		sb = AG_TAILQ_NEXT(sb, syms);
+	}
+	return (0);
+}
+
+/* Compile a circuit into a netlist and instantiate it back. */
+static int
+NetlistRoundTrip(ES_Circuit *ckt)
+{
+	char path[AG_PATHNAME_MAX];
+	ES_Circuit *cktNl;
+	int fd, rv;
+
+	Strlcpy(path, "/tmp/roundtrip.XXXXXXXX", sizeof(path));
+	if ((fd = mkstemp(path)) == -1) {
+		AG_SetError("%s: %s", path, strerror(errno));
+		return (-1);
+	}
+	close(fd);
+	cktNl = AG_ObjectNew(NULL, NULL, &esCircuitClass);
+	if (ES_NetlistCompile(ckt, path) == -1 ||
+	    ES_NetlistLoad(cktNl, path) == -1) {
+		AG_SetError("Netlist: %s", AG_GetError());
+		rv = -1;
+	} else if ((rv = Compare(ckt, cktNl)) == -1) {
+		AG_SetError("Netlist: %s", AG_GetError());
+	}
+	AG_ObjectDestroy(cktNl);
+	unlink(path);
+	return (rv);
+}
+
+static int
+RoundTrip(const char *file)
+{
+	ES_Circuit *ckt, *cktFull = NULL, *cktHeadless = NULL;
+	Image img1 = { NULL, 0 }, img2 = { NULL, 0 };
+	int rv = -1;
+
+	ckt = AG_ObjectNew(NULL, NULL, &esCircuitClass);
+	if (AG_ObjectLoadFromFile(ckt, file) == -1 ||
+	    SaveImage(ckt, &img1) == -1) {
+		goto out;
+	}
+	if ((cktFull = LoadImage(&img1, 0)) == NULL) {
+		AG_SetError("Reload: %s", AG_GetError());
+		goto out;
+	}
+	if ((cktHeadless = LoadImage(&img1, ES_CIRCUIT_HEADLESS)) == NULL) {
+		AG_SetError("Headless reload: %s", AG_GetError());
+		goto out;
+	}
+	if (Compare(ckt, cktFull) == -1 ||
+	    Compare(ckt, cktHeadless) == -1 ||
+	    NetlistRoundTrip(ckt) == -1 ||
+	    SaveImage(cktFull, &img2) == -1) {
+		goto out;
+	}
+	if (img1.size != img2.size ||
+	    memcmp(img1.data, img2.data, img1.size) != 0) {
+		AG_SetError("Saved images differ (%lu/%lu bytes)",
+		    (unsigned long)img1.size, (unsigned long)img2.size);
+		goto out;
+	}
+	rv = 0;
+out:
+	Free(img1.data);
+	Free(img2.data);
+	if (cktHeadless != NULL) { AG_ObjectDestroy(cktHeadless); }
+	if (cktFull != NULL) { AG_ObjectDestroy(cktFull); }
+	AG_ObjectDestroy(ckt);
+	return (rv);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int i, c, nFailed = 0;
+
+	while ((c = getopt(argc, argv, "?h")) != -1) {
+		switch (c) {
+		case '?':
+		case 'h':
+			printusage();
+		}
+	}
+	if (optind == argc) {
+		printusage();
+	}
+	AG_InitCore("roundtrip", 0);
+	ES_CoreInit(0);
+	agDebugLvl = 0;
+
+	for (i = optind; i < argc; i++) {
+		if (RoundTrip(argv[i]) == -1) {
+			printf("%s: FAILED (%s)\n", argv[i], AG_GetError());
+			nFailed++;
+		} else {
+			printf("%s: OK\n", argv[i]);
+		}
+	}
+	return (nFailed > 0) ? 1 : 0;
+}
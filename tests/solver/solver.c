@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * solver: Simulate circuits with a solver option and with the reference
+ * behaviour it replaced, and check that the operating points and the
+ * transient solutions agree. The reference run is interpolated at the
+ * times of the other run, since timestep control may differ slightly.
+ *
+ *	limit	SPICE-style voltage limiting vs. the fixed step clamp
+ *	bypass	Device bypass vs. evaluating every device (the bypass
+ *		counters must also show that devices were bypassed)
+ *	chord	Chord Newton vs. full Newton (some iterations must have
+ *		reused the factors)
+ *	lu	Blocked dense LU vs. the generic LU of the math library
+ */
+
+#include <core/core.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SOLVER_RTOL	1e-3	/* Relative tolerance (NR convergence) */
+#define SOLVER_VTOL	1e-4	/* Absolute tolerance on voltages */
+#define SOLVER_ITOL	1e-7	/* Absolute tolerance on currents */
+
+/* Results of a simulation. */
+typedef struct run {
+	Uint n;				/* Unknowns */
+	Uint nNodes;			/* Node voltages among them */
+	Uint nPoints;			/* Operating point and steps */
+	M_Real *t;			/* Time of every point */
+	M_Real *x;			/* Solution at every point */
+	Uint iters;			/* NR iterations */
+	Uint bypassHits;		/* Device evaluations bypassed */
+	Uint bypassMisses;		/* Device evaluations performed */
+	Uint itersChord;		/* NR iterations reusing the LU */
+	int dense;			/* Blocked dense LU was used */
+	int sparse;			/* Sparse LU was used */
+} Run;
+
+static int VerifyBypass(const Run *, const Run *);
+static int VerifyChord(const Run *, const Run *);
+static int VerifyLU(const Run *, const Run *);
+
+static const struct {
+	const char *name;
+	Uint flags;			/* Options under test */
+	Uint flagsRef;			/* Reference */
+	int (*verify)(const Run *, const Run *);	/* Extra checks */
+} checks[] = {
+	{ "limit",	0,	ES_SIMDC_NO_LIMIT,	NULL },
+	{ "bypass",	0,	ES_SIMDC_NO_BYPASS,	VerifyBypass },
+	{ "chord",	ES_SIMDC_CHORD,	0,		VerifyChord },
+	{ "lu",		0,	ES_SIMDC_GENERIC_LU,	VerifyLU },
+};
+static const Uint nChecks = sizeof(checks)/sizeof(checks[0]);
+
+static Uint nSteps = 200;
+
+static void
+printusage(void)
+{
+	Uint i;
+
+	fprintf(stderr, "Usage: solver [-s steps] check file [...]\n"
+	                "Checks:");
+	for (i = 0; i < nChecks; i++) {
+		fprintf(stderr, " %s", checks[i].name);
+	}
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+static void
+FreeRun(Run *r)
+{
+	Free(r->t);
+	Free(r->x);
+	r->t = NULL;
+	r->x = NULL;
+}
+
+/* Find the operating point and simulate nSteps timesteps. */
+static int
+Simulate(const char *file, Uint flags, Run *r)
+{
+	ES_Circuit *ckt;
+	ES_SimDC *sim;
+	Uint i, j, n;
+	int rv = -1;
+
+	memset(r, 0, sizeof(Run));
+	ckt = AG_ObjectNew(NULL, NULL, &esCircuitClass);
+	ckt->flags |= ES_CIRCUIT_HEADLESS;
+	if (AG_ObjectLoadFromFile(ckt, file) == -1) {
+		AG_ObjectDestroy(ckt);
+		return (-1);
+	}
+	sim = (ES_SimDC *)ES_CreateSimulation(ckt, &esSimDcOps);
+	sim->flags |= ES_SIMDC_HEADLESS | flags;
+	if (ES_SimDCBegin(sim) == -1) {
+		goto out;
+	}
+	r->n = n = ckt->n + ckt->m;
+	r->nNodes = ckt->n;
+	r->t = Malloc((nSteps+1)*sizeof(M_Real));
+	r->x = Malloc((nSteps+1)*n*sizeof(M_Real));
+	for (i = 0; i <= nSteps; i++) {
+		if (i > 0 && ES_SimDCStep(sim) == -1) {
+			AG_SetError("Step %u: %s", i, AG_GetError());
+			FreeRun(r);
+			goto out;
+		}
+		r->t[i] = sim->Telapsed;
+		for (j = 0; j < n; j++)
+			r->x[i*n + j] = M_VecGet(sim->x, j);
+	}
+	r->nPoints = nSteps+1;
+	r->iters = sim->itersTotal;
+	r->bypassHits = sim->bypassHits;
+	r->bypassMisses = sim->bypassMisses;
+	r->itersChord = sim->itersChord;
+	r->dense = sim->dense;
+	r->sparse = sim->sparse;
+	rv = 0;
+out:
+	ES_DestroySimulation(ckt);
+	AG_ObjectDestroy(ckt);
+	return (rv);
+}
+
+/*
+ * Compare every point of a run against the reference, interpolated
+ * linearly at the same time (points past the end of the reference are
+ * not compared).
+ */
+static int
+Compare(const Run *r, const Run *ref)
+{
+	Uint i, j, k = 1, n = r->n;
+
+	if (r->n != ref->n) {
+		AG_SetError("%u unknowns, expected %u", r->n, ref->n);
+		return (-1);
+	}
+	for (i = 0; i < r->nPoints; i++) {
+		M_Real t = r->t[i], a = 0.0;
+		Uint kRef = 0;			/* Operating point */
+
+		if (i > 0) {
+			while (k < ref->nPoints && ref->t[k] < t) {
+				k++;
+			}
+			if (k == ref->nPoints) {
+				break;
+			}
+			if (ref->t[k] > ref->t[k-1]) {
+				a = (ref->t[k] - t)/(ref->t[k] - ref->t[k-1]);
+			}
+			kRef = k;
+		}
+		for (j = 0; j < n; j++) {
+			M_Real v = r->x[i*n + j], vRef = ref->x[kRef*n + j];
+			M_Real tol = (j < r->nNodes) ? SOLVER_VTOL :
+			                               SOLVER_ITOL;
+
+			if (kRef > 0) {
+				vRef += a*(ref->x[(kRef-1)*n + j] - vRef);
+			}
+			if (Fabs(v - vRef) > tol + SOLVER_RTOL*Fabs(vRef)) {
+				AG_SetError("t=%g: x[%u]=%g, expected %g",
+				    (double)t, j, (double)v, (double)vRef);
+				return (-1);
+			}
+		}
+	}
+	return (0);
+}
+
+/*
+ * Devices must have been bypassed, and never in the reference. Both runs
+ * count every device evaluation decision.
+ */
+static int
+VerifyBypass(const Run *r, const Run *ref)
+{
+	if (r->bypassHits == 0) {
+		AG_SetError("No device was bypassed");
+		return (-1);
+	}
+	if (ref->bypassHits != 0) {
+		AG_SetError("%u devices bypassed with ES_SIMDC_NO_BYPASS",
+		    ref->bypassHits);
+		return (-1);
+	}
+	if (ref->bypassMisses == 0) {
+		AG_SetError("No device evaluation was counted");
+		return (-1);
+	}
+	return (0);
+}
+
+/* Some iterations must have reused the factors, and none in full Newton. */
+static int
+VerifyChord(const Run *r, const Run *ref)
+{
+	if (r->itersChord == 0) {
+		AG_SetError("No chord iteration was performed");
+		return (-1);
+	}
+	if (ref->itersChord != 0) {
+		AG_SetError("%u chord iterations without ES_SIMDC_CHORD",
+		    ref->itersChord);
+		return (-1);
+	}
+	return (0);
+}
+
+/* The blocked dense LU must have been used, and neither LU in reference. */
+static int
+VerifyLU(const Run *r, const Run *ref)
+{
+	if (!r->dense) {
+		AG_SetError("Not factored by the blocked dense LU");
+		return (-1);
+	}
+	if (ref->dense || ref->sparse) {
+		AG_SetError("Reference not factored by the generic LU");
+		return (-1);
+	}
+	return (0);
+}
+
+static int
+Check(Uint c, const char *file)
+{
+	Run r, ref;
+	int rv = -1;
+
+	if (Simulate(file, checks[c].flagsRef, &ref) == -1) {
+		AG_SetError("Reference: %s", AG_GetError());
+		return (-1);
+	}
+	if (Simulate(file, checks[c].flags, &r) == -1) {
+		FreeRun(&ref);
+		return (-1);
+	}
+	if (Compare(&r, &ref) == 0 &&
+	    (checks[c].verify == NULL || checks[c].verify(&r, &ref) == 0)) {
+		printf("%s: OK (%u NR iterations, %u in reference; "
+		       "%u/%u evaluations bypassed)\n", file,
+		    r.iters, ref.iters, r.bypassHits,
+		    r.bypassHits + r.bypassMisses);
+		rv = 0;
+	}
+	FreeRun(&r);
+	FreeRun(&ref);
+	return (rv);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int i, c, nFailed = 0;
+	Uint k;
+
+	while ((c = getopt(argc, argv, "?hs:")) != -1) {
+		extern char *optarg;
+
+		switch (c) {
+		case 's':
+			nSteps = (Uint)atoi(optarg);
+			break;
+		case '?':
+		case 'h':
+			printusage();
+		}
+	}
+	if (optind+1 >= argc) {
+		printusage();
+	}
+	for (k = 0; k < nChecks; k++) {
+		if (strcmp(checks[k].name, argv[optind]) == 0)
+			break;
+	}
+	if (k == nChecks) {
+		printusage();
+	}
+
+	AG_InitCore("solver", 0);
+	ES_CoreInit(0);
+	agDebugLvl = 0;
+
+	for (i = optind+1; i < argc; i++) {
+		if (Check(k, argv[i]) == -1) {
+			printf("%s: FAILED (%s)\n", argv[i], AG_GetError());
+			nFailed++;
+		}
+	}
+	return (nFailed > 0) ? 1 : 0;
+}
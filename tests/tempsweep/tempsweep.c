@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * tempsweep: Check the temperature sweep against complete simulations.
+ * The operating point found at every temperature of a sweep (which only
+ * updates the temperature-dependent parameters and solves from the point
+ * before) must agree with the one found by a new simulation started at
+ * that temperature. The bundled circuits have no temperature coefficients,
+ * so they are given to every resistor.
+ */
+
+#include <core/core.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#define TS_RTOL	1e-3		/* Relative tolerance (NR convergence) */
+#define TS_VTOL	1e-5		/* Absolute tolerance on voltages */
+#define TS_ITOL	1e-8		/* Absolute tolerance on currents */
+#define TS_TC1	4e-3		/* Resistor temperature coefficients */
+#define TS_TC2	1e-5
+
+static M_Real Tstart = -40.0+273.15, Tstop = 125.0+273.15;
+static Uint nPoints = 12;
+
+static void
+printusage(void)
+{
+	fprintf(stderr, "Usage: tempsweep [-n points] [file ...]\n");
+	exit(1);
+}
+
+static M_Real
+TempAt(Uint i)
+{
+	return (Tstart + (Tstop - Tstart)*i/(nPoints-1));
+}
+
+/* Load a circuit and give its resistors temperature coefficients. */
+static ES_Circuit *
+Load(const char *file)
+{
+	ES_Circuit *ckt;
+	ES_Component *com;
+
+	ckt = AG_ObjectNew(NULL, NULL, &esCircuitClass);
+	ckt->flags |= ES_CIRCUIT_HEADLESS;
+	if (AG_ObjectLoadFromFile(ckt, file) == -1) {
+		AG_ObjectDestroy(ckt);
+		return (NULL);
+	}
+	CIRCUIT_FOREACH_COMPONENT(com, ckt) {
+		if (AG_OfClass(com, "ES_Circuit:ES_Component:ES_Resistor:*") ||
+		    AG_OfClass(com,
+		    "ES_Circuit:ES_Component:ES_SemiResistor:*")) {
+			M_SetReal(com, "Tc1", TS_TC1);
+			M_SetReal(com, "Tc2", TS_TC2);
+		}
+	}
+	return (ckt);
+}
+
+static ES_SimDC *
+Begin(ES_Circuit *ckt, M_Real T)
+{
+	ES_SimDC *sim;
+
+	sim = (ES_SimDC *)ES_CreateSimulation(ckt, &esSimDcOps);
+	sim->flags |= ES_SIMDC_HEADLESS;
+	sim->T0 = T;
+	if (ES_SimDCBegin(sim) == -1) {
+		AG_SetError("T=%gK: %s", (double)T, AG_GetError());
+		return (NULL);
+	}
+	return (sim);
+}
+
+/*
+ * Sweep a circuit over the temperatures, returning the operating points in
+ * a newly allocated array of nPoints vectors of *nx unknowns.
+ */
+static M_Real *
+Sweep(const char *file, Uint *nx)
+{
+	ES_Circuit *ckt;
+	ES_SimDC *sim;
+	M_Real *x = NULL;
+	Uint i, j, n;
+
+	if ((ckt = Load(file)) == NULL) {
+		return (NULL);
+	}
+	if ((sim = Begin(ckt, TempAt(0))) == NULL) {
+		goto out;
+	}
+	*nx = n = ckt->n + ckt->m;
+	x = Malloc(nPoints*n*sizeof(M_Real));
+	for (i = 0; i < nPoints; i++) {
+		if (i > 0) {
+			ES_SimDCSetTemp(sim, TempAt(i));
+			if (ES_SimDCSolveOP(sim) == -1) {
+				Free(x);
+				x = NULL;
+				goto out;
+			}
+		}
+		for (j = 0; j < n; j++)
+			x[i*n + j] = M_VecGet(sim->x, j);
+	}
+out:
+	ES_DestroySimulation(ckt);
+	AG_ObjectDestroy(ckt);
+	return (x);
+}
+
+/* Compare a point of the sweep against a new simulation. */
+static int
+ComparePoint(const char *file, Uint i, const M_Real *xSweep, Uint n)
+{
+	ES_Circuit *ckt;
+	ES_SimDC *sim;
+	Uint j, nNodes;
+	int rv = -1;
+
+	if ((ckt = Load(file)) == NULL) {
+		return (-1);
+	}
+	if ((sim = Begin(ckt, TempAt(i))) == NULL) {
+		goto out;
+	}
+	if (ckt->n + ckt->m != n) {
+		AG_SetError("%u unknowns, expected %u", ckt->n + ckt->m, n);
+		goto out;
+	}
+	nNodes = ckt->n;
+	for (j = 0; j < n; j++) {
+		M_Real v = xSweep[j], vRef = M_VecGet(sim->x, j);
+		M_Real tol = (j < nNodes) ? TS_VTOL : TS_ITOL;
+
+		if (Fabs(v - vRef) > tol + TS_RTOL*Fabs(vRef)) {
+			AG_SetError("T=%gK: x[%u]=%g, expected %g",
+			    (double)TempAt(i), j, (double)v, (double)vRef);
+			goto out;
+		}
+	}
+	rv = 0;
+out:
+	ES_DestroySimulation(ckt);
+	AG_ObjectDestroy(ckt);
+	return (rv);
+}
+
+/*
+ * Sweep a circuit and check every point. Return in dMax the largest change
+ * of an unknown over the sweep, to show that the circuit does depend on
+ * the temperature.
+ */
+static int
+Check(const char *file, M_Real *dMax)
+{
+	M_Real *x;
+	Uint i, j, n;
+
+	if ((x = Sweep(file, &n)) == NULL) {
+		return (-1);
+	}
+	*dMax = 0.0;
+	for (j = 0; j < n; j++) {
+		M_Real d = Fabs(x[(nPoints-1)*n + j] - x[j]);
+
+		if (d > *dMax)
+			*dMax = d;
+	}
+	for (i = 0; i < nPoints; i++) {
+		if (ComparePoint(file, i, &x[i*n], n) == -1) {
+			Free(x);
+			return (-1);
+		}
+	}
+	Free(x);
+	return (0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	M_Real dMax;
+	int i, c, nFailed = 0;
+
+	while ((c = getopt(argc, argv, "?hn:")) != -1) {
+		extern char *optarg;
+
+		switch (c) {
+		case 'n':
+			nPoints = (Uint)atoi(optarg);
+			break;
+		case '?':
+		case 'h':
+			printusage();
+		}
+	}
+	if (optind == argc || nPoints < 2) {
+		printusage();
+	}
+
+	AG_InitCore("tempsweep", 0);
+	ES_CoreInit(0);
+	agDebugLvl = 0;
+
+	for (i = optind; i < argc; i++) {
+		if (Check(argv[i], &dMax) == -1) {
+			printf("%s: FAILED (%s)\n", argv[i], AG_GetError());
+			nFailed++;
+		} else if (dMax == 0.0) {
+			printf("%s: FAILED (no temperature dependence)\n",
+			    argv[i]);
+			nFailed++;
+		} else {
+			printf("%s: OK (max. change %g)\n", argv[i],
+			    (double)dMax);
+		}
+	}
+	return (nFailed > 0) ? 1 : 0;
+}
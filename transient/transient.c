@@ -29,9 +29,6 @@
  */
 
 #include <core/core.h>
-#include <generic/generic.h>
-#include <sources/sources.h>
-#include <macro/macro.h>
 
 #include <unistd.h>
 #include <stdlib.h>
@@ -42,17 +39,23 @@ int maxSteps = 0;
 int curSteps = 0;
 int showHeader = 1;
 int plotDerivative = 0;
+int showStats = 0;
+int noBypass = 0;
+int analytic = 0;
+int chord = 0;
+Uint nThreads = 1;
 
 char fmtString[16];
 char **vars = NULL;
+ES_Probe *probes = NULL;
 M_Real *vPrev = NULL;
 Uint nVars = 0;
 
 static void
 printusage(void)
 {
-	fprintf(stderr, "Usage: transient [-dHg] [-s maxSteps] [-p prec] "
-	                "[file] [var1] [var2] [...]\n");
+	fprintf(stderr, "Usage: transient [-dHgSBAc] [-s maxSteps] [-p prec] "
+	                "[-j threads] [file] [var1] [var2] [...]\n");
 	exit(1);
 }
 		
@@ -96,7 +99,7 @@ StepBegin(AG_Event *event)
 		printf("OK");
 	}
 	for (i = 0; i < nVars; i++) {
-		v = M_GetReal(ckt, vars[i]);
+		v = ES_ProbeValue(ckt, &probes[i]);
 		if (plotDerivative) {
 			printf(fmtString, v-vPrev[i]);
 			vPrev[i] = v;
@@ -125,7 +128,7 @@ main(int argc, char *argv[])
 	ES_CoreInit(0);
 	agDebugLvl = 0;
 
-	while ((c = getopt(argc, argv, "?hHdgs:p:")) != -1) {
+	while ((c = getopt(argc, argv, "?hHdgSBAcs:p:j:")) != -1) {
 		extern char *optarg;
 
 		switch (c) {
@@ -138,12 +141,27 @@ main(int argc, char *argv[])
 		case 'g':
 			pfmt = 'g';
 			break;
+		case 'S':
+			showStats = 1;
+			break;
+		case 'B':
+			noBypass = 1;
+			break;
+		case 'A':
+			analytic = 1;
+			break;
+		case 'c':
+			chord = 1;
+			break;
 		case 's':
 			maxSteps = atoi(optarg);
 			break;
 		case 'p':
 			prec = atoi(optarg);
 			break;
+		case 'j':
+			nThreads = (Uint)atoi(optarg);
+			break;
 		case '?':
 		case 'h':
 			printusage();
@@ -157,7 +175,8 @@ main(int argc, char *argv[])
 	}
 	nVars = argc-optind-1;
 	vars = Malloc(nVars*sizeof(char *));
-	vPrev = Malloc(nVars*sizeof(char *));
+	probes = Malloc(nVars*sizeof(ES_Probe));
+	vPrev = Malloc(nVars*sizeof(M_Real));
 	for (i = 0; i < nVars; i++) {
 		vars[i] = Strdup(argv[optind+1+i]);
 		vPrev[i] = 0.0;
@@ -166,13 +185,29 @@ main(int argc, char *argv[])
 	file = argv[optind];
 
 	ckt = AG_ObjectNew(NULL, NULL, &esCircuitClass);
-	if (AG_ObjectLoadFromFile(ckt, file) == -1) {
+	ckt->flags |= ES_CIRCUIT_HEADLESS;
+	if ((ES_NetlistIsCompiled(file) ?
+	    ES_NetlistLoad(ckt, file) :
+	    AG_ObjectLoadFromFile(ckt, file)) == -1) {
 		fprintf(stderr, "%s: %s\n", file, AG_GetError());
 		exit(1);
 	}
+	for (i = 0; i < nVars; i++) {
+		if (ES_ParseProbe(ckt, vars[i], &probes[i]) == -1) {
+			fprintf(stderr, "%s: %s\n", file, AG_GetError());
+			exit(1);
+		}
+	}
 	
 	/* Initialize and begin transient simulation. */
 	sim = (ES_SimDC *)ES_SetSimulationMode(ckt, &esSimDcOps);
+	if (noBypass)
+		sim->flags |= ES_SIMDC_NO_BYPASS;
+	if (analytic)
+		sim->flags |= ES_SIMDC_ANALYTIC;
+	if (chord)
+		sim->flags |= ES_SIMDC_CHORD;
+	sim->nThreads = nThreads;
 	
 	/* Create a "monitor" object to receive notification events. */
 	mon = AG_ObjectNew(NULL, "mon", &agObjectClass);
@@ -192,7 +227,37 @@ main(int argc, char *argv[])
 		}
 	}
 
+	if (showStats) {
+		fprintf(stderr, "Steps: %u, NR iterations: %u (%.2f/step, "
+		                "%u-%u), limited: %u\n",
+		    sim->currStep, sim->itersTotal,
+		    (sim->currStep > 0) ?
+		    (double)sim->itersTotal/sim->currStep : 0.0,
+		    sim->itersLow, sim->itersHigh, sim->itersLimited);
+		fprintf(stderr, "Device evaluations: %u, bypassed: %u "
+		                "(%.1f%%)\n",
+		    sim->bypassMisses, sim->bypassHits,
+		    (sim->bypassHits+sim->bypassMisses > 0) ?
+		    100.0*sim->bypassHits/(sim->bypassHits+sim->bypassMisses) :
+		    0.0);
+		fprintf(stderr, "LU factorizations: %u (%.2f/step), "
+		                "chord iterations: %u%s\n",
+		    sim->factorsTotal,
+		    (sim->currStep > 0) ?
+		    (double)sim->factorsTotal/sim->currStep : 0.0,
+		    sim->itersChord, sim->isLTI ? " (linear circuit)" : "");
+		if (sim->isLTI)
+			fprintf(stderr, "Low-rank LU updates: %u\n",
+			    sim->updatesLowRank);
+		if (sim->sparse)
+			fprintf(stderr, "Sparse LU: %u unknowns, %u entries in "
+			                "L+U, %u levels, %u threads\n",
+			    sim->slu.n, 2*sim->slu.nnz + sim->slu.n,
+			    sim->slu.nLevels, sim->slu.nThreads);
+	}
+
 	Free(vars);
+	Free(probes);
 	Free(vPrev);
 	AG_ObjectDestroy(mon);
 	AG_ObjectDestroy(ckt);
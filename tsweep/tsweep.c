@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2020 Julien Nadeau Carriere (vedge@csoft.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * tsweep: Find the operating point of a circuit over a range of
+ * temperatures, and output the probed quantities at every point.
+ */
+
+#include <core/core.h>
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TSWEEP_KELVIN	273.15
+
+static void
+printusage(void)
+{
+	fprintf(stderr, "Usage: tsweep [-H] [-f Tstart] [-t Tstop] "
+	                "[-n points] [file] [var1] [var2] [...]\n");
+	exit(1);
+}
+
+static int
+PrintSample(ES_Run *run, M_Real T, const M_Real *v, void *arg)
+{
+	Uint k;
+
+	printf("%.03f", T - TSWEEP_KELVIN);
+	for (k = 0; k < run->nProbes; k++) {
+		printf("\t%.08g", v[k]);
+	}
+	printf("\n");
+	return (0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	ES_Run *run;
+	char *file;
+	int i, c, showHeader = 1;
+	Uint nPoints = 11;
+	M_Real Tstart = -40.0, Tstop = 125.0;	/* degC */
+
+	AG_InitCore("tsweep", 0);
+	ES_CoreInit(0);
+	agDebugLvl = 0;
+
+	while ((c = getopt(argc, argv, "?hHf:t:n:")) != -1) {
+		extern char *optarg;
+
+		switch (c) {
+		case 'H':
+			showHeader = 0;
+			break;
+		case 'f':
+			Tstart = (M_Real)strtod(optarg, NULL);
+			break;
+		case 't':
+			Tstop = (M_Real)strtod(optarg, NULL);
+			break;
+		case 'n':
+			nPoints = (Uint)atoi(optarg);
+			break;
+		case '?':
+		case 'h':
+			printusage();
+		}
+	}
+	if (optind == argc) {
+		printusage();
+	}
+	file = argv[optind];
+
+	if ((run = ES_RunOpen(file)) == NULL) {
+		fprintf(stderr, "%s: %s\n", file, AG_GetError());
+		exit(1);
+	}
+	for (i = optind+1; i < argc; i++) {
+		if (ES_RunAddProbe(run, argv[i]) == -1) {
+			fprintf(stderr, "%s: %s\n", file, AG_GetError());
+			exit(1);
+		}
+	}
+	ES_RunSetAnalysis(run, ES_RUN_TEMP_SWEEP);
+	ES_RunSetTempSweep(run, Tstart + TSWEEP_KELVIN, Tstop + TSWEEP_KELVIN,
+	    nPoints);
+	ES_RunSetSampleFn(run, PrintSample, NULL);
+
+	if (showHeader) {
+		printf("#Temp(C)");
+		for (i = optind+1; i < argc; i++) {
+			printf("\t%s", argv[i]);
+		}
+		printf("\n");
+	}
+	if (ES_RunExec(run) == -1) {
+		fprintf(stderr, "%s: %s\n", file, AG_GetError());
+		ES_RunClose(run);
+		exit(1);
+	}
+	ES_RunClose(run);
+	return (0);
+}